@@ -0,0 +1,63 @@
+/* cabinet.h
+ * Speaker cabinet impulse response via uniformly-partitioned FFT
+ * convolution, with an optional direct-form FIR head for low latency
+ */
+#ifndef CABINET_H
+#define CABINET_H
+
+#include "main.h"
+#include "globals.h"
+
+/* Longest IR accepted; every 64 taps costs 1 KB of spectra + history */
+#ifndef CAB_MAX_TAPS
+#define CAB_MAX_TAPS 256
+#endif
+
+/* Taps per CAB:DATA command (4 hex digits each, fits the RX line) */
+#define CAB_CHUNK_MAX_TAPS 24
+
+#define CAB_PARTITION (BUFFER_SIZE / 2)
+#define CAB_FFT_SIZE (2 * CAB_PARTITION)
+#define CAB_MAX_PARTITIONS ((CAB_MAX_TAPS + CAB_PARTITION - 1) / CAB_PARTITION)
+
+/* Taps run per sample in the interrupt in low-latency mode: the block
+ * path is exactly BUFFER_SIZE samples late, so it covers the rest */
+#define CAB_HEAD_TAPS BUFFER_SIZE
+
+#define CAB_MODE_FFT 0          // whole IR in the block path, BUFFER_SIZE latency
+#define CAB_MODE_LOW_LATENCY 1  // first CAB_HEAD_TAPS as direct FIR, no latency
+
+typedef struct {
+  uint8_t enabled;
+  uint8_t mode;
+  volatile uint8_t loading;  // IR being replaced, stage bypassed
+  uint16_t taps;
+  uint16_t partitions;       // partitions run in the block path
+  uint16_t head_taps;        // taps run in the interrupt
+  uint16_t tap_limit;        // governor cap on taps run, 0 = whole IR
+  uint16_t run_partitions;   // partitions run after tap_limit
+  uint16_t run_head;         // head taps run after tap_limit
+  float32_t gain;            // normalisation applied to the Q15 IR
+} Cabinet_t;
+
+extern Cabinet_t cabinet;
+
+void Cabinet_Init(void);
+void Cabinet_Set_Mode(uint8_t mode);
+void Cabinet_Clear(void);
+void Cabinet_Set_Tap_Limit(uint16_t taps);
+
+/* IR upload: Begin, any number of Data chunks, then End to rebuild */
+uint8_t Cabinet_Load_Begin(uint16_t taps);
+uint8_t Cabinet_Load_Data(uint16_t offset, const int16_t *taps, uint16_t count);
+const int16_t *Cabinet_IR(void);
+void Cabinet_Load_End(void);
+
+/* Block engine: one CAB_PARTITION block in, one block out */
+void Cabinet_Process_Block(const float32_t *in, float32_t *out);
+
+/* Audio path glue, same split as the reverb */
+float32_t Apply_Cabinet(float32_t input);
+void Cabinet_Process_Half(uint8_t half);
+
+#endif // CABINET_H
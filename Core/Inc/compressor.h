@@ -0,0 +1,43 @@
+/* compressor.h
+ * Feed-forward compressor / output limiter with a block detector and
+ * log-domain gain computed once per sub-block
+ */
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include "main.h"
+#include "globals.h"
+
+/* Detector / gain update granularity (divides BUFFER_SIZE / 2) */
+#ifndef COMP_SUBBLOCK
+#define COMP_SUBBLOCK 16
+#endif
+
+#define COMP_MODE_COMPRESS 0  // RMS detector, finite ratio
+#define COMP_MODE_LIMIT 1     // peak detector, infinite ratio
+
+typedef struct {
+  uint8_t enabled;
+  uint8_t mode;
+  uint8_t lookahead;       // 1: gain applied in the block path, BUFFER_SIZE + COMP_SUBBLOCK latency
+  float32_t threshold_db;  // -40 to 0
+  float32_t ratio;         // 1 to 20 (compress mode)
+  float32_t attack_ms;     // 0.1 to 100
+  float32_t release_ms;    // 10 to 2000
+  float32_t makeup_db;     // 0 to 24
+  float32_t gr_db;         // current gain reduction
+  volatile float32_t target_gain;  // published to the interrupt (no look-ahead)
+} Compressor_t;
+
+extern Compressor_t compressor;
+
+void Compressor_Init(void);
+uint8_t Compressor_Set(float32_t threshold_db, float32_t ratio, float32_t attack_ms,
+                       float32_t release_ms, float32_t makeup_db);
+void Compressor_Set_Lookahead(uint8_t on);
+float32_t Compressor_Take_GR_Peak(void);
+void Compressor_Process_Block(const int16_t *in, int16_t *out, uint16_t length);
+float32_t Apply_Compressor(float32_t input);
+void Compressor_Process_Half(uint8_t half);
+
+#endif // COMPRESSOR_H
@@ -0,0 +1,107 @@
+/* cost_model.h
+ * Worst-case cycle cost of the audio chain for a given configuration
+ *
+ * One table, in core cycles on the Cortex-M4 at full quality (governor
+ * level FULL), and one function that adds it up. The firmware uses it for
+ * COST? and CAB:MODE,AUTO; the backend runs the same arithmetic in
+ * backend/costModel.js on a copy of the table (backend/cost_table.json,
+ * regenerated with make cost-table in host/), and make cost checks that
+ * both give the same numbers.
+ *
+ * Per-sample entries run in the timer interrupt, per-half entries in the
+ * block engine once per BUFFER_SIZE / 2 samples. The entries come from
+ * make cost-bench in host/: the Debug (-O0) firmware timed on the host
+ * with each stage on and off, at its worst-case setting (full-length IR,
+ * all combs, loud input), turned into M4 cycles by the ratio llvm-mca
+ * gives for the Debug listing. The ADC wait and HAL drivers in the base
+ * and the CMSIS-DSP calls (biquad, real FFT) are counted instructions,
+ * not timings. Each value is the median of nine runs, rounded up by
+ * about a tenth. Re-run it after any change to a stage, then
+ * make cost-table.
+ *
+ * No HAL dependency: host tools build it as is.
+ */
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include <stdint.h>
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 128
+#endif
+
+/* Core clock the table was measured at (SystemCoreClock) */
+#define COST_CORE_HZ 170000000UL
+
+/* Interrupt, cycles per sample */
+#define COST_ISR_BASE 1300       // TIM IRQ and HAL, ADC wait, meter, DAC, every stage off
+#define COST_GATE 190
+#define COST_OD_SOFT 470         // mode 0
+#define COST_OD_HARD 510         // mode 1
+#define COST_OD_ASYM 520         // mode 2
+#define COST_DELAY 470
+#define COST_DELAY_PINGPONG 520  // two crossed taps, OUT:PINGPONG
+#define COST_EQ_BASE 60          // EQ stage around the cascade
+#define COST_EQ_BAND 16          // one DF2T biquad in arm_biquad_cascade_df2T_f32
+#define COST_CAB_ISR 40          // head empty (FFT mode)
+#define COST_CAB_HEAD_TAP 70     // per low-latency head tap
+#define COST_MOD_ISR 110
+#define COST_RVB_ISR 80
+#define COST_COMP_ISR 90
+#define COST_LOOP_ISR 130
+
+/* Block engine, cycles per half buffer */
+#define COST_BLOCK_BASE 900      // every stage off: guitar path, telemetry, scope
+#define COST_CAB_FFT 11800       // forward + inverse arm_rfft_fast_f32, counted
+#define COST_CAB_PARTITION 11500 // per partition: complex MAC
+#define COST_MOD_BLOCK 41000     // slowest of chorus, flanger, vibrato
+#define COST_RVB_COMB 11500      // per active comb
+#define COST_RVB_ALLPASSES 19500
+#define COST_COMP_BLOCK 11500
+#define COST_COMP_LOOKAHEAD 4700 // gain applied in the block path
+#define COST_LOOP_REC 3200       // ADPCM encode
+#define COST_LOOP_PLAY 2700      // decode
+#define COST_LOOP_OVERDUB 6500   // decode + encode
+#define COST_TUNER 46500         // one YIN slice
+
+/* Geometry the cabinet terms depend on, as in cabinet.h */
+#define COST_CAB_PARTITION_TAPS (BUFFER_SIZE / 2)
+#define COST_CAB_HEAD_TAPS BUFFER_SIZE
+
+/* Load (permille of the half-buffer budget) above which a configuration
+ * is reported as risky; GOV_HIGH_PERMILLE, where the governor steps down */
+#define COST_WARN_PERMILLE 850
+#define COST_MAX_PERMILLE 1000
+
+/* Stages off are 0; modes use the firmware's own values */
+typedef struct {
+  uint32_t core_hz;
+  uint32_t sample_rate_hz;
+  uint8_t gate;
+  uint8_t od;
+  uint8_t od_mode;         // 0 soft, 1 hard, 2 asymmetric
+  uint8_t delay;
+  uint8_t pingpong;
+  uint8_t eq_bands;        // biquads run, 0 = EQ off
+  uint8_t cab;
+  uint8_t cab_low_latency;
+  uint16_t cab_taps;
+  uint8_t mod;             // MOD_CHORUS .. MOD_VIBRATO, 0 = off
+  uint8_t rvb_combs;       // active combs, 0 = reverb off
+  uint8_t comp;
+  uint8_t comp_lookahead;
+  uint8_t looper;          // LOOP_REC .. LOOP_OVERDUB, 0 = clear
+  uint8_t tuner;
+} CostConfig_t;
+
+typedef struct {
+  uint32_t isr_per_sample;   // interrupt cycles per sample
+  uint32_t block_per_half;   // block engine cycles per half buffer
+  uint32_t total_per_half;
+  uint32_t budget_per_half;  // core_hz / sample_rate_hz * BUFFER_SIZE / 2
+  uint32_t permille;         // total against budget
+} CostEstimate_t;
+
+void CostModel_Predict(const CostConfig_t *config, CostEstimate_t *estimate);
+
+#endif // COST_MODEL_H
@@ -0,0 +1,12 @@
+/* crc32.h
+ * CRC-32 (poly 0x04C11DB7, init 0xFFFFFFFF) on the hardware CRC unit
+ */
+#ifndef CRC32_H
+#define CRC32_H
+
+#include "main.h"
+
+void CRC32_Init(void);
+uint32_t CRC32_Calculate(const void *data, uint32_t length);
+
+#endif // CRC32_H
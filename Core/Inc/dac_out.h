@@ -0,0 +1,37 @@
+/* dac_out.h
+ * Audio output: DAC1 channel 1, or both DAC1 channels written together
+ * by one 32-bit DMA transfer per sample (DAC_DUAL_OUTPUT)
+ */
+#ifndef DAC_OUT_H
+#define DAC_OUT_H
+
+#include "main.h"
+#include "globals.h"
+
+/* Words in the DMA ring behind DHR12RD. The interrupt writes the word
+ * the DMA will send on the next TIM1 update, so the ring only has to
+ * cover one sample period; a few spare words ride out a late interrupt. */
+#ifndef DAC_RING_SIZE
+#define DAC_RING_SIZE 4
+#endif
+
+#define OUT_MONO 0       // channel 2 follows channel 1
+#define OUT_SPLIT 1      // channel 1 full chain, channel 2 dry (after the cabinet)
+#define OUT_PINGPONG 2   // echo repeats alternate between channel 1 and 2
+
+typedef struct {
+  uint8_t mode;
+  uint8_t dual;          // built with DAC_DUAL_OUTPUT
+} DacOut_t;
+
+extern DacOut_t dac_out;
+
+#if DAC_DUAL_OUTPUT
+extern DMA_HandleTypeDef hdma_tim1_up;
+#endif
+
+void DacOut_Start(void);
+uint8_t DacOut_Set_Mode(uint8_t mode);
+void DacOut_Write(float32_t output, float32_t dry);
+
+#endif // DAC_OUT_H
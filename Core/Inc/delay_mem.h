@@ -0,0 +1,34 @@
+/* delay_mem.h
+ * Shares delay_buffer between the echo delay and the other delay-line
+ * effects: clients take fixed slices from the end, the echo keeps the rest
+ */
+#ifndef DELAY_MEM_H
+#define DELAY_MEM_H
+
+#include "main.h"
+#include "globals.h"
+
+#define DELAY_MEM_ECHO 0
+#define DELAY_MEM_MOD 1
+#define DELAY_MEM_TUNER 2
+#define DELAY_MEM_LOOP 3
+#define DELAY_MEM_CLIENTS 4
+
+/* Samples the echo always keeps, whatever the other clients hold */
+#ifndef DELAY_MEM_ECHO_MIN
+#define DELAY_MEM_ECHO_MIN (DELAY_BUFFER_SIZE / 4)
+#endif
+
+typedef struct {
+  int16_t *base;
+  uint32_t length;  // samples, 0 when not allocated
+} DelayMemRegion_t;
+
+extern DelayMemRegion_t delay_mem[DELAY_MEM_CLIENTS];
+
+void DelayMem_Init(void);
+uint8_t DelayMem_Request(uint8_t client, uint32_t length);
+void DelayMem_Release(uint8_t client);
+uint32_t DelayMem_Available(uint8_t client);
+
+#endif // DELAY_MEM_H
@@ -12,6 +12,33 @@ extern uint16_t dac_buffer[BUFFER_SIZE];
 extern volatile uint8_t process_audio_flag;
 extern volatile uint16_t buffer_index;
 
+/* Half of adc/reverb buffers ready for block work (0 = first, 1 = second) */
+extern volatile uint8_t audio_ready_half;
+extern volatile uint32_t audio_block_overruns;
+extern volatile uint32_t audio_isr_cycles;  // timer interrupt cycles in the last half
+
+/* DWT cycle counts for a processing stage (peak cleared by the reader) */
+typedef struct {
+  uint32_t last;
+  uint32_t peak;
+} StageCycles_t;
+
+extern StageCycles_t reverb_cycles;        // per block
+extern StageCycles_t cabinet_cycles;       // per block
+extern StageCycles_t cabinet_isr_cycles;   // per sample, FIR head
+extern StageCycles_t eq_cycles;            // per sample
+extern StageCycles_t modulation_cycles;    // per block
+extern StageCycles_t compressor_cycles;    // per block
+extern StageCycles_t looper_cycles;        // per block
+
+static inline void Stage_Cycles_Record(StageCycles_t *stage, uint32_t cycles)
+{
+  stage->last = cycles;
+  if (cycles > stage->peak) stage->peak = cycles;
+}
+
+void DSP_Cycle_Counter_Init(void);
+void DSP_Flush_To_Zero_Init(void);
 void Process_Guitar_Signal(void);
 
 #endif // DSP_CORE_H
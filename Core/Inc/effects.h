@@ -20,11 +20,14 @@ typedef struct {
 
 typedef struct {
   uint32_t delay_samples;
+  float32_t time_ms;     // as last asked for; delay_samples is derived from it at the running rate
   float32_t feedback;
   float32_t mix;
   float32_t tone;
   uint8_t enabled;
+  uint8_t pingpong;      // echo line split into crossed halves (dac_out.c)
   float32_t lp_state;
+  float32_t side;        // ping-pong: right minus left wet signal
 } Delay_t;
 
 typedef struct {
@@ -35,6 +38,27 @@ typedef struct {
   uint8_t enabled;
 } NoiseGate_t;
 
+/* Canonical user-facing effect state (no filter/envelope state).
+ * Used for presets and whole-state updates; applied at a block boundary. */
+typedef struct {
+  float32_t volume;
+  float32_t od_gain;
+  float32_t od_threshold;
+  float32_t od_tone;
+  float32_t od_mix;
+  float32_t dly_feedback;
+  float32_t dly_mix;
+  float32_t dly_tone;
+  float32_t gate_threshold;
+  float32_t gate_attack;
+  float32_t gate_release;
+  uint32_t dly_samples;
+  uint8_t od_mode;
+  uint8_t od_enabled;
+  uint8_t dly_enabled;
+  uint8_t gate_enabled;
+} EffectParams_t;
+
 extern Overdrive_t overdrive;
 extern Delay_t delay_effect;
 extern NoiseGate_t noise_gate;
@@ -50,4 +74,12 @@ float32_t Apply_Overdrive(float32_t input);
 float32_t Apply_Delay(float32_t input);
 float32_t Apply_NoiseGate(float32_t input);
 
+// Whole-state snapshot and block-boundary update
+void Effects_Get_Params(EffectParams_t *params);
+uint8_t Effects_Validate_Params(const EffectParams_t *params);
+void Effects_Queue_Params(const EffectParams_t *params);
+void Effects_Apply_Pending(void);
+uint8_t Effects_Params_Pending(void);
+uint32_t Effects_Params_Digest(const EffectParams_t *params);
+
 #endif // EFFECTS_H
@@ -0,0 +1,42 @@
+/* eq.h
+ * Parametric EQ as a cascade of direct-form-II-transposed biquads
+ * (CMSIS arm_biquad_cascade_df2T_f32 layout)
+ */
+#ifndef EQ_H
+#define EQ_H
+
+#include "main.h"
+#include "globals.h"
+
+#ifndef EQ_BANDS
+#define EQ_BANDS 5
+#endif
+
+#define EQ_TYPE_PEAK 0
+#define EQ_TYPE_LOW_SHELF 1
+#define EQ_TYPE_HIGH_SHELF 2
+
+#define EQ_POS_PRE 0   // between gate and overdrive
+#define EQ_POS_POST 1  // after overdrive, before cabinet
+
+typedef struct {
+  uint8_t type;
+  float32_t freq;     // Hz
+  float32_t gain_db;  // -15 to +15
+  float32_t q;        // 0.1 to 10 (slope for shelves)
+} EqBand_t;
+
+typedef struct {
+  uint8_t enabled;
+  uint8_t position;
+  EqBand_t band[EQ_BANDS];
+} Eq_t;
+
+extern Eq_t eq;
+
+void EQ_Init(void);
+uint8_t EQ_Set_Band(uint8_t index, uint8_t type, float32_t freq, float32_t gain_db, float32_t q);
+void EQ_Recompute(void);
+float32_t Apply_EQ(float32_t input);
+
+#endif // EQ_H
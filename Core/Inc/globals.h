@@ -15,7 +15,7 @@
 
 /* Sample/config constants */
 #ifndef SAMPLE_RATE
-#define SAMPLE_RATE 48000
+#define SAMPLE_RATE 48000  // boot rate; SR: changes it at runtime
 #endif
 
 /* ADC/DAC full scale (12-bit by default) */
@@ -36,25 +36,32 @@
 #endif
 
 #ifndef UART_RX_BUFFER_SIZE
-#define UART_RX_BUFFER_SIZE 64
+#define UART_RX_BUFFER_SIZE 128
 #endif
 
 #ifndef UART_TX_BUFFER_SIZE
 #define UART_TX_BUFFER_SIZE 128
 #endif
 
+#ifndef UART_TX_QUEUE_SIZE
+#define UART_TX_QUEUE_SIZE 512
+#endif
+
 /* Externs for audio buffers and control flags */
 extern uint16_t adc_buffer[BUFFER_SIZE];
 extern uint16_t dac_buffer[BUFFER_SIZE];
 extern volatile uint8_t process_audio_flag;
 extern volatile uint16_t buffer_index;
 
+/* Real audio rate in Hz, from the TIM1 period (sample_rate.c) */
+extern float32_t sample_rate_hz;
+
 /* ADC monitoring (used in dsp_core.c) */
 extern volatile uint16_t max_adc_deviation;
 extern volatile uint16_t current_adc_value;
 
-/* Delay buffer storage */
-extern float32_t delay_buffer[DELAY_BUFFER_SIZE];
+/* Delay buffer storage (Q15) */
+extern int16_t delay_buffer[DELAY_BUFFER_SIZE];
 extern uint32_t delay_write_index;
 
 /* UART communication buffers and counters */
@@ -0,0 +1,87 @@
+/* governor.h
+ * CPU-load governor: watches the cycles spent per half buffer and steps
+ * processing quality down (and back up) instead of overrunning
+ */
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include "main.h"
+#include "globals.h"
+#include "cost_model.h"
+
+/* Quality levels, each one keeps everything the previous one dropped */
+#define GOV_LEVEL_FULL 0
+#define GOV_LEVEL_SKIP_IDLE 1     // skip stages with no audible output
+#define GOV_LEVEL_SHORT_IR 2      // cabinet runs the first half of the IR
+#define GOV_LEVEL_SHORT_REVERB 3  // reverb runs two of its four combs
+#define GOV_LEVEL_MINIMAL 4       // one cabinet partition, one comb
+#define GOV_LEVEL_MAX GOV_LEVEL_MINIMAL
+#define GOV_LEVEL_AUTO 0xFF       // governor.forced value for automatic
+
+/* Load thresholds in permille of the half-buffer cycle budget */
+#ifndef GOV_HIGH_PERMILLE
+#define GOV_HIGH_PERMILLE 850
+#endif
+#ifndef GOV_LOW_PERMILLE
+#define GOV_LOW_PERMILLE 600
+#endif
+
+/* Halves over the high mark before stepping down, and time under the
+ * low mark before stepping up (doubled each time a restore does not
+ * stick; Governor_Init converts it to halves at the running rate) */
+#define GOV_DEGRADE_HALVES 4
+#define GOV_RESTORE_MS 500
+#define GOV_RESTORE_MAX_SHIFT 3
+
+/* SR:AUTO waits this many restore periods before raising the rate, and
+ * ignores the halves right after a rate change */
+#define GOV_RATE_UP_FACTOR 4
+#define GOV_SETTLE_HALVES 8
+
+/* Stages skipped at GOV_LEVEL_SKIP_IDLE and above (governor.skip) */
+#define GOV_SKIP_EQ (1U << 0)
+#define GOV_SKIP_MODULATION (1U << 1)
+#define GOV_SKIP_REVERB (1U << 2)
+
+/* Mix below which a parallel wet stage counts as idle */
+#define GOV_IDLE_MIX 0.01f
+
+/* Governor frame payload (little endian), sent on every level or rate change */
+typedef struct __attribute__((packed)) {
+  uint16_t seq;
+  uint8_t level;
+  uint8_t previous;
+  uint16_t load_permille;  // load that triggered the change
+  uint16_t peak_permille;  // highest load since GOV? last read it
+  uint16_t overruns;       // audio_block_overruns, truncated
+  uint8_t skip;            // GOV_SKIP_* mask in force
+  uint8_t forced;          // 1 if pinned by GOV:<level>
+  uint32_t sample_rate;    // nominal rate in Hz after the change
+} GovernorFrame_t;
+
+typedef struct {
+  uint8_t level;
+  uint8_t forced;          // GOV_LEVEL_AUTO or the pinned level
+  uint8_t skip;            // GOV_SKIP_* mask read by the audio path
+  uint8_t restore_shift;
+  uint16_t load_permille;
+  uint16_t peak_permille;
+  uint16_t over_count;
+  uint16_t under_count;
+  uint32_t budget_cycles;  // cycles available per half buffer
+  uint32_t restore_halves; // GOV_RESTORE_MS in halves
+  uint32_t changes;
+} Governor_t;
+
+extern Governor_t governor;
+
+void Governor_Init(void);
+void Governor_Update(uint32_t isr_cycles, uint32_t block_cycles);
+void Governor_Force(uint8_t level);
+uint16_t Governor_Take_Peak(void);
+
+/* Cost model glue (cost_model.h) */
+void Governor_Cost_Config(CostConfig_t *config);
+uint8_t Governor_Pick_Cab_Mode(void);
+
+#endif // GOVERNOR_H
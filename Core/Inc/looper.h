@@ -0,0 +1,83 @@
+/* looper.h
+ * Record / overdub / play looper storing decimated audio as 4-bit
+ * IMA-ADPCM blocks in a slice of delay_buffer
+ */
+#ifndef LOOPER_H
+#define LOOPER_H
+
+#include "main.h"
+#include "globals.h"
+
+#ifndef LOOP_DECIMATION
+#define LOOP_DECIMATION 8        // 48 kHz -> 6 kHz loop rate
+#endif
+#if ((BUFFER_SIZE / 2) % LOOP_DECIMATION) != 0
+#error "LOOP_DECIMATION must divide BUFFER_SIZE / 2"
+#endif
+#define LOOP_HALF_SAMPLES (BUFFER_SIZE / 2 / LOOP_DECIMATION)
+
+/* One ADPCM block: predictor (int16 LE) and step index, then two codes
+ * per byte, low nibble first. Every block restarts the decoder, so
+ * overdub can rewrite any block without touching its neighbours. */
+#define LOOP_BLOCK_SAMPLES 128
+#define LOOP_BLOCK_HEADER 3
+#define LOOP_BLOCK_BYTES (LOOP_BLOCK_HEADER + LOOP_BLOCK_SAMPLES / 2)
+
+/* Loop time per KB at sample_rate_hz / LOOP_DECIMATION:
+ *   1024 / LOOP_BLOCK_BYTES * LOOP_BLOCK_SAMPLES = 1956 samples per KB
+ *   12 kHz (48 kHz / 4): 0.163 s/KB    6 kHz (48 kHz / 8): 0.326 s/KB
+ * The loop takes what delay_buffer can spare when recording starts,
+ * after the running echo and room for the modulation line, but never
+ * less than LOOP_RESERVE_SAMPLES: a longer echo gets a shorter line
+ * while the loop is held. At 48 kHz (half as long at 96 kHz):
+ *   clean, crunch, metal (echo off)   5.1 KB = 1.62 s
+ *   lead (120 ms), ambient (250 ms)   3.1 KB = 1.00 s, echo cut to 67 ms
+ * The echo line and the loop share 9.6 KB and no other RAM is free. */
+
+/* delay_buffer samples LOOP:REC always gets (the echo keeps the rest) */
+#ifndef LOOP_RESERVE_SAMPLES
+#define LOOP_RESERVE_SAMPLES (DELAY_BUFFER_SIZE / 3)
+#endif
+
+#define LOOP_CLEAR 0     // no loop, no memory held
+#define LOOP_REC 1       // recording the first pass, length grows
+#define LOOP_PLAY 2
+#define LOOP_OVERDUB 3   // playing and adding the input into the loop
+
+/* Loop playback level relative to the live signal */
+#ifndef LOOP_LEVEL
+#define LOOP_LEVEL 0.8f
+#endif
+
+typedef struct {
+  uint8_t state;
+  uint16_t blocks;       // capacity in ADPCM blocks
+  uint32_t length;       // loop length in decimated samples
+  uint32_t position;     // next decimated sample to play or record
+  float32_t level;
+} Looper_t;
+
+extern Looper_t looper;
+
+void Looper_Init(void);
+uint8_t Looper_Command(uint8_t state);
+float32_t Looper_Seconds(uint32_t samples);
+uint32_t Looper_Capacity(void);
+
+typedef struct {
+  int16_t predictor;
+  uint8_t index;         // into the IMA step table, 0 - 88
+} AdpcmState_t;
+
+/* Block codec, run a chunk at a time: offset is the chunk's first sample
+ * within the block. Offset 0 writes (encode) or loads (decode) the header. */
+void Looper_Encode_Block(AdpcmState_t *state, const int16_t *in, uint8_t *block,
+                         uint16_t offset, uint16_t count);
+void Looper_Decode_Block(AdpcmState_t *state, const uint8_t *block, int16_t *out,
+                         uint16_t offset, uint16_t count);
+
+/* Audio path glue, same split as the reverb */
+float32_t Apply_Looper(float32_t input);
+void Looper_Process_Half(uint8_t half);
+
+#endif // LOOPER_H
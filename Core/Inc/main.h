@@ -61,6 +61,13 @@ void Error_Handler(void);
 /* USER CODE BEGIN Private defines */
 #define LED_PIN GPIO_PIN_5
 #define LED_GPIO_PORT GPIOA
+
+/* 1: drive DAC1 channel 2 (PA5) as a second output, both channels fed
+ * by one DMA word per sample (dac_out.c). PA5 is also the Nucleo LED,
+ * so a dual-output build has no command blink. */
+#ifndef DAC_DUAL_OUTPUT
+#define DAC_DUAL_OUTPUT 0
+#endif
 /* USER CODE END Private defines */
 
 #ifdef __cplusplus
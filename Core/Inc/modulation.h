@@ -0,0 +1,48 @@
+/* modulation.h
+ * Chorus / flanger / vibrato on a fractional delay line taken from
+ * delay_buffer, with a table LFO
+ */
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include "main.h"
+#include "globals.h"
+
+#define MOD_OFF 0
+#define MOD_CHORUS 1
+#define MOD_FLANGER 2
+#define MOD_VIBRATO 3
+
+/* Slice of delay_buffer held while a mode is active (longest sweep + block) */
+#ifndef MOD_LINE_SAMPLES
+#define MOD_LINE_SAMPLES 1024
+#endif
+
+#define MOD_LFO_TABLE_BITS 8
+#define MOD_LFO_TABLE_SIZE (1U << MOD_LFO_TABLE_BITS)
+
+/* Block path budget, cycles per sample (checked by MOD?) */
+#ifndef MOD_CYCLE_BUDGET
+#define MOD_CYCLE_BUDGET 64
+#endif
+
+typedef struct {
+  uint8_t mode;
+  float32_t rate_hz;   // 0.05 - 10
+  float32_t depth;     // 0.0 - 1.0 of the mode's sweep range
+  float32_t mix;       // 0.0 - 1.0 (ignored for vibrato)
+  float32_t feedback;  // 0.0 - 0.9 (flanger only)
+  uint32_t phase;
+  uint32_t phase_inc;
+  uint32_t write_pos;
+} Modulation_t;
+
+extern Modulation_t modulation;
+
+void Modulation_Init(void);
+uint8_t Modulation_Set(uint8_t mode, float32_t rate_hz, float32_t depth, float32_t mix, float32_t feedback);
+void Modulation_Process_Block(const int16_t *in, int16_t *wet, uint16_t length);
+float32_t Apply_Modulation(float32_t input);
+void Modulation_Process_Half(uint8_t half);
+
+#endif // MODULATION_H
@@ -0,0 +1,39 @@
+/* presets.h
+ * Preset slots stored in the last flash pages (wear levelled, CRC checked)
+ */
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include "main.h"
+#include "effects.h"
+
+#ifndef PRESET_SLOTS
+#define PRESET_SLOTS 8
+#endif
+
+/* Two banks of PRESET_BANK_PAGES pages at the top of flash. The linker
+ * script keeps FLASH below PRESET_FLASH_BASE. */
+#define PRESET_BANK_PAGES 2
+#define PRESET_BANK_SIZE (PRESET_BANK_PAGES * FLASH_PAGE_SIZE)
+#define PRESET_FLASH_BASE (FLASH_BASE + 0x20000U - 2U * PRESET_BANK_SIZE)
+
+#define PRESET_MAGIC 0x50525354U  // "PRST"
+#define PRESET_VERSION 1
+#define PRESET_RECORD_SIZE 128
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint8_t slot;
+  uint8_t version;
+  uint16_t size;  // sizeof(EffectParams_t) at save time
+  EffectParams_t params;
+  uint8_t reserved[PRESET_RECORD_SIZE - 16 - sizeof(EffectParams_t)];
+  uint32_t crc;   // over everything above
+} PresetRecord_t;
+
+uint8_t Preset_Save(uint8_t slot);
+uint8_t Preset_Load(uint8_t slot);
+uint32_t Preset_List(void);
+
+#endif // PRESETS_H
@@ -0,0 +1,54 @@
+/* reverb.h
+ * Freeverb-style reverb (parallel damped combs + series allpasses) with
+ * Q15 delay lines carved from a fixed RAM budget
+ */
+#ifndef REVERB_H
+#define REVERB_H
+
+#include "main.h"
+#include "globals.h"
+
+/* Total bytes for all comb/allpass lines; lengths are scaled to fit */
+#ifndef REVERB_RAM_BYTES
+#define REVERB_RAM_BYTES 4096
+#endif
+
+#define REVERB_COMBS 4
+#define REVERB_ALLPASSES 2
+
+typedef struct {
+  int16_t *buf;
+  uint16_t length;
+  uint16_t index;
+  float32_t filter_state;  // comb damping low-pass
+} ReverbLine_t;
+
+typedef struct {
+  float32_t room_size;  // 0.0 - 1.0
+  float32_t damping;    // 0.0 - 1.0
+  float32_t mix;        // 0.0 - 1.0
+  uint8_t enabled;
+  uint8_t active_combs; // combs run, lowered by the governor
+  float32_t feedback;   // derived from room_size and sample_rate_hz
+  float32_t damp_pole;  // derived from damping and sample_rate_hz
+  ReverbLine_t comb[REVERB_COMBS];
+  ReverbLine_t allpass[REVERB_ALLPASSES];
+} Reverb_t;
+
+extern Reverb_t reverb;
+
+void Reverb_Init(void);
+void Reverb_Set_Params(float32_t room_size, float32_t damping, float32_t mix);
+void Reverb_Clear(void);
+void Reverb_Set_Active_Combs(uint8_t combs);
+uint32_t Reverb_Memory_Used(void);
+
+/* Block engine: wet[] receives the unscaled reverb tail for in[] */
+void Reverb_Process_Block(const int16_t *in, int16_t *wet, uint16_t length);
+
+/* Audio path glue: the timer interrupt feeds/mixes per sample, the main
+ * loop renders the half of the shared buffer the interrupt just left */
+float32_t Apply_Reverb(float32_t input);
+void Reverb_Process_Half(uint8_t half);
+
+#endif // REVERB_H
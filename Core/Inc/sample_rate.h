@@ -0,0 +1,34 @@
+/* sample_rate.h
+ * Runtime audio sample rate: TIM1 period derived from the real timer
+ * clock, and recomputation of every rate-dependent coefficient
+ */
+#ifndef SAMPLE_RATE_H
+#define SAMPLE_RATE_H
+
+#include "main.h"
+#include "globals.h"
+
+#define SR_RATE_COUNT 4
+
+/* SR:AUTO moves between this rate and the highest one in the table */
+#ifndef SR_AUTO_FLOOR
+#define SR_AUTO_FLOOR 48000
+#endif
+
+typedef struct {
+  uint32_t nominal;      // selected rate, Hz (sample_rate_hz is the real one)
+  uint32_t timer_clock;  // TIM1 kernel clock, Hz
+  uint32_t period;       // TIM1 auto-reload value
+  uint8_t auto_rate;     // governor may step between SR_AUTO_FLOOR and the top rate
+  uint32_t changes;
+} SampleRate_t;
+
+extern SampleRate_t sample_rate;
+extern const uint32_t sample_rate_table[SR_RATE_COUNT];
+
+void SampleRate_Init(void);
+uint8_t SampleRate_Set(uint32_t rate_hz);
+void SampleRate_Set_Auto(uint8_t on);
+uint32_t SampleRate_Neighbour(int8_t direction);
+
+#endif // SAMPLE_RATE_H
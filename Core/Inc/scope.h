@@ -0,0 +1,65 @@
+/* scope.h
+ * Oscilloscope capture of input/output samples from the audio path
+ */
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include "main.h"
+#include "globals.h"
+
+/* Fixed RAM budget: one int16 input + one int16 output per sample */
+#ifndef SCOPE_MAX_SAMPLES
+#define SCOPE_MAX_SAMPLES 512
+#endif
+
+#ifndef SCOPE_MAX_DECIMATION
+#define SCOPE_MAX_DECIMATION 64
+#endif
+
+/* Samples per data frame (offset + pairs must fit UART_FRAME_MAX_PAYLOAD) */
+#define SCOPE_CHUNK_SAMPLES 15
+
+typedef enum {
+  SCOPE_IDLE = 0,
+  SCOPE_ARMED,      // waiting for the trigger crossing
+  SCOPE_CAPTURING,  // audio path is filling the buffer
+  SCOPE_READY       // buffer owned by the main loop, being transmitted
+} ScopeState_t;
+
+typedef struct {
+  volatile uint8_t state;
+  uint16_t length;
+  uint16_t decimation;
+  float32_t trigger_level;   // 0 = capture immediately
+  uint16_t count;
+  uint16_t decim_counter;
+  float32_t last_input;
+  uint16_t sent;
+  uint8_t header_sent;
+} Scope_t;
+
+/* Scope header frame payload */
+typedef struct __attribute__((packed)) {
+  uint16_t samples;
+  uint16_t decimation;
+  int16_t trigger_level;     // Q15, 0 = free running
+  uint16_t chunk_samples;
+} ScopeHeader_t;
+
+extern Scope_t scope;
+
+void Scope_Capture(float32_t input, float32_t output);
+
+static inline void Scope_Sample(float32_t input, float32_t output)
+{
+  if (scope.state == SCOPE_ARMED || scope.state == SCOPE_CAPTURING)
+  {
+    Scope_Capture(input, output);
+  }
+}
+
+uint8_t Scope_Arm(uint16_t length, float32_t trigger_level, uint16_t decimation);
+void Scope_Cancel(void);
+void Scope_Process(void);
+
+#endif // SCOPE_H
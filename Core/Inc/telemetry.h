@@ -0,0 +1,76 @@
+/* telemetry.h
+ * Level metering accumulated in the audio path and periodic binary
+ * telemetry frames sent to the ESP32 over USART3
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "main.h"
+#include "globals.h"
+#include <math.h>
+
+#ifndef TELEMETRY_MAX_RATE_HZ
+#define TELEMETRY_MAX_RATE_HZ 50
+#endif
+
+/* Per-block meter accumulators (written only from the audio interrupt) */
+typedef struct {
+  float32_t out_peak;
+  float32_t in_sumsq;
+  float32_t out_sumsq;
+  float32_t gate_gain_min;
+  float32_t drive_peak;   // |signal| before the overdrive clipper
+  float32_t clip_peak;    // |signal| after the overdrive clipper
+  uint16_t out_clips;
+  uint16_t in_clips;
+} MeterBlock_t;
+
+/* Telemetry frame payload (little endian, levels in Q15 full scale) */
+typedef struct __attribute__((packed)) {
+  uint16_t seq;
+  uint16_t in_peak;
+  uint16_t in_rms;
+  uint16_t out_peak;
+  uint16_t out_rms;
+  uint16_t gate_gain;
+  uint16_t drive_gr_cdb;  // overdrive gain reduction in 0.01 dB
+  uint16_t in_clips;
+  uint16_t out_clips;
+  uint16_t comp_gr_cdb;   // compressor/limiter gain reduction in 0.01 dB
+} TelemetryFrame_t;
+
+extern MeterBlock_t meter_block;
+extern volatile uint8_t telemetry_rate_hz;
+
+static inline void Meter_Sample(uint16_t adc_value, float32_t input, float32_t output)
+{
+  uint16_t deviation = (adc_value >= 2048) ? (adc_value - 2048) : (2048 - adc_value);
+  float32_t a = fabsf(output);
+
+  current_adc_value = adc_value;
+  if (deviation > max_adc_deviation) max_adc_deviation = deviation;
+  if (adc_value == 0 || adc_value >= ADC_MAX_VALUE) meter_block.in_clips++;
+  if (a > 1.0f) meter_block.out_clips++;
+  if (a > meter_block.out_peak) meter_block.out_peak = a;
+  meter_block.in_sumsq += input * input;
+  meter_block.out_sumsq += output * output;
+}
+
+static inline void Meter_Drive(float32_t gained, float32_t clipped)
+{
+  float32_t a = fabsf(gained);
+  float32_t b = fabsf(clipped);
+  if (a > meter_block.drive_peak) meter_block.drive_peak = a;
+  if (b > meter_block.clip_peak) meter_block.clip_peak = b;
+}
+
+static inline void Meter_Gate(float32_t gain)
+{
+  if (gain < meter_block.gate_gain_min) meter_block.gate_gain_min = gain;
+}
+
+void Meter_Block_End(void);
+void Telemetry_Set_Rate(uint8_t hz);
+void Telemetry_Process(void);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,53 @@
+/* tuner.h
+ * Background tuner: decimated input collected from adc_buffer and a YIN
+ * pitch detector run in small slices from the main loop
+ */
+#ifndef TUNER_H
+#define TUNER_H
+
+#include "main.h"
+#include "globals.h"
+
+#ifndef TUNER_DECIMATION
+#define TUNER_DECIMATION 4       // 48 kHz -> 12 kHz analysis rate
+#endif
+#define TUNER_FRAME 1024         // samples per analysis frame (taken from delay_buffer)
+#define TUNER_WINDOW (TUNER_FRAME / 2)
+#define TUNER_MIN_HZ 60.0f
+#define TUNER_MAX_HZ 1000.0f
+#define TUNER_YIN_THRESHOLD 0.15f
+#define TUNER_LAGS_PER_SLICE 8   // lags evaluated per Tuner_Process call
+
+/* Tuner frame payload (little endian) */
+typedef struct __attribute__((packed)) {
+  uint16_t seq;
+  uint16_t freq_dhz;      // detected frequency in 0.1 Hz, 0 if none
+  uint8_t note;           // MIDI note number, 0 if none
+  int8_t cents;           // -50 to +50
+  uint8_t confidence;     // 255 = clean periodic signal
+  uint8_t muted;
+  uint16_t cpu_permille;  // main-loop share spent in the detector
+} TunerFrame_t;
+
+typedef struct {
+  uint8_t enabled;
+  uint8_t mute;
+  float32_t freq_hz;
+  uint8_t note;
+  int8_t cents;
+  uint8_t confidence;
+  uint16_t cpu_permille;
+} Tuner_t;
+
+extern Tuner_t tuner;
+
+uint8_t Tuner_Enable(uint8_t on, uint8_t mute);
+void Tuner_Collect(const uint16_t *adc, uint16_t length);
+void Tuner_Process(void);
+
+static inline uint8_t Tuner_Muting(void)
+{
+  return tuner.enabled && tuner.mute;
+}
+
+#endif // TUNER_H
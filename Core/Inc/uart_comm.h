@@ -8,10 +8,35 @@
 #include "globals.h"
 
 #ifndef UART_RX_BUFFER_SIZE
-#define UART_RX_BUFFER_SIZE 64
+#define UART_RX_BUFFER_SIZE 128
 #endif
 
+/* Received lines held until the main loop parses them; a sender may have
+ * this many commands in flight */
+#ifndef UART_RX_LINES
+#define UART_RX_LINES 4
+#endif
+
+/* Binary frames sent alongside the ASCII ACK lines */
+#define UART_FRAME_SYNC0 0xA5
+#define UART_FRAME_SYNC1 0x5A
+#define UART_FRAME_OVERHEAD 6
+#ifndef UART_FRAME_MAX_PAYLOAD
+#define UART_FRAME_MAX_PAYLOAD 64
+#endif
+
+#define UART_FRAME_TELEMETRY 0x01
+#define UART_FRAME_SCOPE_HEADER 0x02
+#define UART_FRAME_SCOPE_DATA 0x03
+#define UART_FRAME_STATE_DUMP 0x04
+#define UART_FRAME_TUNER 0x05
+#define UART_FRAME_GOVERNOR 0x06
+
 void Parse_UART_Command(void);
+uint8_t UART_Take_Line(void);
 void Send_UART_Response(const char* msg);
+uint8_t Send_UART_Data(const uint8_t *data, uint16_t len);
+uint8_t Send_UART_Frame(uint8_t type, const uint8_t *payload, uint16_t len);
+uint16_t UART_TX_Free(void);
 
 #endif // UART_COMM_H
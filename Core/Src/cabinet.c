@@ -0,0 +1,272 @@
+/* cabinet.c
+ * Uniformly-partitioned overlap-save convolution for cabinet IRs
+ *
+ * The IR is cut into CAB_PARTITION-tap partitions whose spectra are
+ * kept in cab_spectra[]. Each half buffer the main loop transforms the
+ * newest 2 * CAB_PARTITION input samples once, stores that spectrum in
+ * a frequency-domain delay line and multiply-accumulates it against
+ * every partition, so one forward and one inverse arm_rfft_fast_f32 per
+ * block serve the whole IR.
+ *
+ * The result reaches the interrupt BUFFER_SIZE samples later. In
+ * low-latency mode the interrupt convolves the first CAB_HEAD_TAPS taps
+ * directly and the block path is built from the IR shifted by the same
+ * amount, so the sum is the full convolution with no added delay.
+ *
+ * Cost: block path is two 128-point real FFTs plus 65 complex MACs per
+ * partition; the head costs CAB_HEAD_TAPS MACs per sample in the
+ * interrupt. Both are measured on the target and reported by CAB?.
+ */
+
+#include "main.h"
+#include "cabinet.h"
+#include <math.h>
+#include <string.h>
+
+static int16_t cab_ir[CAB_MAX_TAPS];
+static float32_t cab_spectra[CAB_MAX_PARTITIONS][CAB_FFT_SIZE];
+static float32_t cab_fdl[CAB_MAX_PARTITIONS][CAB_FFT_SIZE];
+static uint16_t cab_fdl_pos = 0;
+static float32_t cab_work[CAB_FFT_SIZE];
+static float32_t cab_time[CAB_FFT_SIZE];
+static float32_t cab_prev[CAB_PARTITION];
+static arm_rfft_fast_instance_f32 cab_fft;
+
+// Interrupt-side FIR head
+static float32_t cab_head[CAB_HEAD_TAPS];
+static float32_t cab_hist[CAB_HEAD_TAPS];
+static uint16_t cab_hist_pos = 0;
+
+// Shared with the audio interrupt (one half each at any time)
+static float32_t cab_in[BUFFER_SIZE];
+static float32_t cab_out[BUFFER_SIZE];
+
+Cabinet_t cabinet = {
+  .enabled = 0,
+  .mode = CAB_MODE_FFT,
+  .loading = 0,
+  .taps = 0,
+  .partitions = 0,
+  .head_taps = 0,
+  .tap_limit = 0,
+  .run_partitions = 0,
+  .run_head = 0,
+  .gain = 1.0f
+};
+
+/**
+  * @brief  Derive the head taps and partitions actually run from tap_limit
+  */
+static void Cabinet_Apply_Limit(void)
+{
+  uint16_t limit = cabinet.tap_limit ? cabinet.tap_limit : cabinet.taps;
+  uint16_t tail_start = (cabinet.mode == CAB_MODE_LOW_LATENCY) ? CAB_HEAD_TAPS : 0;
+  uint16_t parts = 0;
+
+  cabinet.run_head = (cabinet.head_taps < limit) ? cabinet.head_taps : limit;
+  if (limit > tail_start) parts = (limit - tail_start + CAB_PARTITION - 1) / CAB_PARTITION;
+  cabinet.run_partitions = (parts < cabinet.partitions) ? parts : cabinet.partitions;
+}
+
+/**
+  * @brief  Rebuild head taps and partition spectra from the Q15 IR
+  * @note   Main loop only; the stage is bypassed while this runs
+  */
+static void Cabinet_Rebuild(void)
+{
+  float32_t energy = 0.0f;
+  uint16_t tail_start;
+  uint16_t i;
+
+  cabinet.loading = 1;
+
+  for (i = 0; i < cabinet.taps; i++)
+  {
+    float32_t h = (float32_t)cab_ir[i] / 32768.0f;
+    energy += h * h;
+  }
+  // Unit L2 norm: full-scale white noise in gives roughly full scale out
+  cabinet.gain = (energy > 1e-9f) ? 1.0f / sqrtf(energy) : 1.0f;
+
+  cabinet.head_taps = 0;
+  tail_start = 0;
+  if (cabinet.mode == CAB_MODE_LOW_LATENCY)
+  {
+    cabinet.head_taps = (cabinet.taps < CAB_HEAD_TAPS) ? cabinet.taps : CAB_HEAD_TAPS;
+    tail_start = CAB_HEAD_TAPS;
+  }
+  for (i = 0; i < CAB_HEAD_TAPS; i++)
+  {
+    cab_head[i] = (i < cabinet.head_taps) ? (float32_t)cab_ir[i] / 32768.0f * cabinet.gain : 0.0f;
+  }
+
+  cabinet.partitions = 0;
+  if (cabinet.taps > tail_start)
+  {
+    cabinet.partitions = (cabinet.taps - tail_start + CAB_PARTITION - 1) / CAB_PARTITION;
+  }
+  for (uint16_t p = 0; p < cabinet.partitions; p++)
+  {
+    memset(cab_work, 0, sizeof(cab_work));
+    for (i = 0; i < CAB_PARTITION; i++)
+    {
+      uint32_t tap = tail_start + (uint32_t)p * CAB_PARTITION + i;
+      if (tap < cabinet.taps) cab_work[i] = (float32_t)cab_ir[tap] / 32768.0f * cabinet.gain;
+    }
+    arm_rfft_fast_f32(&cab_fft, cab_work, cab_spectra[p], 0);
+  }
+  Cabinet_Apply_Limit();
+
+  Cabinet_Clear();
+  cabinet.loading = 0;
+}
+
+void Cabinet_Init(void)
+{
+  arm_rfft_fast_init_f32(&cab_fft, CAB_FFT_SIZE);
+  memset(cab_ir, 0, sizeof(cab_ir));
+  Cabinet_Clear();
+}
+
+void Cabinet_Set_Mode(uint8_t mode)
+{
+  cabinet.mode = mode ? CAB_MODE_LOW_LATENCY : CAB_MODE_FFT;
+  Cabinet_Rebuild();
+}
+
+/**
+  * @brief  Run only the first taps of the IR (0 = all), used by the governor
+  * @note   Takes effect on the next sample; the FDL and head history keep
+  *         being written, so restoring the full length needs no warm-up
+  */
+void Cabinet_Set_Tap_Limit(uint16_t taps)
+{
+  cabinet.tap_limit = taps;
+  Cabinet_Apply_Limit();
+}
+
+void Cabinet_Clear(void)
+{
+  memset(cab_fdl, 0, sizeof(cab_fdl));
+  memset(cab_prev, 0, sizeof(cab_prev));
+  memset(cab_hist, 0, sizeof(cab_hist));
+  memset(cab_out, 0, sizeof(cab_out));
+  cab_fdl_pos = 0;
+  cab_hist_pos = 0;
+}
+
+uint8_t Cabinet_Load_Begin(uint16_t taps)
+{
+  if (taps == 0 || taps > CAB_MAX_TAPS) return 0;
+  cabinet.loading = 1;
+  cabinet.taps = taps;
+  memset(cab_ir, 0, sizeof(cab_ir));
+  return 1;
+}
+
+uint8_t Cabinet_Load_Data(uint16_t offset, const int16_t *taps, uint16_t count)
+{
+  if (!cabinet.loading) return 0;
+  if ((uint32_t)offset + count > cabinet.taps) return 0;
+  memcpy(&cab_ir[offset], taps, count * sizeof(int16_t));
+  return 1;
+}
+
+const int16_t *Cabinet_IR(void)
+{
+  return cab_ir;
+}
+
+void Cabinet_Load_End(void)
+{
+  Cabinet_Rebuild();
+}
+
+/**
+  * @brief  Convolve one CAB_PARTITION block with the partitioned IR
+  * @param  in: newest block of input samples
+  * @param  out: block of output samples, may alias in
+  */
+void Cabinet_Process_Block(const float32_t *in, float32_t *out)
+{
+  uint16_t p, k;
+
+  memcpy(cab_work, cab_prev, sizeof(cab_prev));
+  memcpy(&cab_work[CAB_PARTITION], in, CAB_PARTITION * sizeof(float32_t));
+  memcpy(cab_prev, in, sizeof(cab_prev));
+
+  arm_rfft_fast_f32(&cab_fft, cab_work, cab_fdl[cab_fdl_pos], 0);
+
+  memset(cab_work, 0, sizeof(cab_work));
+  for (p = 0; p < cabinet.run_partitions; p++)
+  {
+    const float32_t *h = cab_spectra[p];
+    const float32_t *x = cab_fdl[(cab_fdl_pos + CAB_MAX_PARTITIONS - p) % CAB_MAX_PARTITIONS];
+
+    // Packed real-FFT layout: [DC, Nyquist] are both real, then re/im pairs
+    cab_work[0] += h[0] * x[0];
+    cab_work[1] += h[1] * x[1];
+    for (k = 2; k < CAB_FFT_SIZE; k += 2)
+    {
+      cab_work[k] += h[k] * x[k] - h[k + 1] * x[k + 1];
+      cab_work[k + 1] += h[k] * x[k + 1] + h[k + 1] * x[k];
+    }
+  }
+
+  arm_rfft_fast_f32(&cab_fft, cab_work, cab_time, 1);
+  memcpy(out, &cab_time[CAB_PARTITION], CAB_PARTITION * sizeof(float32_t));
+
+  cab_fdl_pos = (cab_fdl_pos + 1) % CAB_MAX_PARTITIONS;
+}
+
+/**
+  * @brief  Hand the sample to the block path and return the cabinet output
+  * @note   Called from the TIM1 interrupt before buffer_index advances
+  */
+float32_t Apply_Cabinet(float32_t input)
+{
+  float32_t output;
+  uint16_t k, n;
+
+  if (!cabinet.enabled || cabinet.loading || cabinet.taps == 0) return input;
+
+  cab_in[buffer_index] = input;
+  output = cab_out[buffer_index];
+
+  if (cabinet.run_head)
+  {
+    cab_hist[cab_hist_pos] = input;
+
+    // Newest-first walk of the history ring in two runs, no per-tap wrap
+    n = cab_hist_pos + 1;
+    if (n > cabinet.run_head) n = cabinet.run_head;
+    for (k = 0; k < n; k++)
+    {
+      output += cab_head[k] * cab_hist[cab_hist_pos - k];
+    }
+    for (; k < cabinet.run_head; k++)
+    {
+      output += cab_head[k] * cab_hist[cab_hist_pos + CAB_HEAD_TAPS - k];
+    }
+
+    if (++cab_hist_pos >= CAB_HEAD_TAPS) cab_hist_pos = 0;
+  }
+
+  return output;
+}
+
+/**
+  * @brief  Run the block path on the half of the shared buffer just filled
+  */
+void Cabinet_Process_Half(uint8_t half)
+{
+  uint16_t offset = half ? CAB_PARTITION : 0;
+
+  if (!cabinet.enabled || cabinet.loading || cabinet.partitions == 0) return;
+  if (cabinet.run_partitions == 0)
+  {
+    memset(&cab_out[offset], 0, CAB_PARTITION * sizeof(float32_t));
+    return;
+  }
+  Cabinet_Process_Block(&cab_in[offset], &cab_out[offset]);
+}
@@ -0,0 +1,250 @@
+/* compressor.c
+ * Block-detector dynamics for the end of the chain
+ *
+ * The interrupt stores the post-volume signal at half scale (Q15 with
+ * 6 dB of headroom) into comp_in[]. For every COMP_SUBBLOCK samples of
+ * the finished half the main loop takes the peak (arm_abs_q15 +
+ * arm_max_q15) or RMS (arm_rms_q15), runs the gain computer in dB,
+ * smooths it with the attack/release coefficients and converts back to
+ * a linear gain, so log/exp run four times per half, not per sample.
+ *
+ * Without look-ahead the interrupt glides towards the latest gain; the
+ * detector is up to a buffer behind and the final clamp catches what
+ * gets through. With look-ahead the gain is ramped across each
+ * sub-block in the block path, sized from that sub-block and the next
+ * one. The last sub-block of a half waits for the first one of the next
+ * half, so the interrupt plays the result BUFFER_SIZE + COMP_SUBBLOCK
+ * samples later.
+ */
+
+#include "main.h"
+#include "compressor.h"
+#include <math.h>
+#include <string.h>
+
+#define COMP_SUBBLOCKS_PER_HALF ((BUFFER_SIZE / 2) / COMP_SUBBLOCK)
+
+/* Per-sample glide of the interrupt gain, about one sub-block */
+#define COMP_GAIN_GLIDE (1.0f / COMP_SUBBLOCK)
+
+static int16_t comp_in[BUFFER_SIZE];
+static int16_t comp_out[BUFFER_SIZE];
+static float32_t comp_attack_coeff = 1.0f;
+static float32_t comp_release_coeff = 0.01f;
+static float32_t comp_last_gain = 1.0f;
+static float32_t comp_isr_gain = 1.0f;
+static float32_t comp_gr_peak = 0.0f;
+
+/* Look-ahead: the sub-block held back until the next half is in */
+static int16_t comp_held_in[COMP_SUBBLOCK];
+static int16_t *comp_held_out = NULL;
+static float32_t comp_held_level = 0.0f;
+
+Compressor_t compressor = {
+  .enabled = 1,
+  .mode = COMP_MODE_LIMIT,
+  .lookahead = 0,
+  .threshold_db = -1.0f,
+  .ratio = 4.0f,
+  .attack_ms = 1.0f,
+  .release_ms = 80.0f,
+  .makeup_db = 0.0f,
+  .gr_db = 0.0f,
+  .target_gain = 1.0f
+};
+
+static float32_t Sub_Block_Coeff(float32_t time_ms)
+{
+  float32_t blocks = time_ms * 0.001f * sample_rate_hz / COMP_SUBBLOCK;
+  if (blocks < 1.0f) return 1.0f;
+  return 1.0f - expf(-1.0f / blocks);
+}
+
+void Compressor_Init(void)
+{
+  Compressor_Set(compressor.threshold_db, compressor.ratio, compressor.attack_ms,
+                 compressor.release_ms, compressor.makeup_db);
+  memset(comp_out, 0, sizeof(comp_out));
+}
+
+uint8_t Compressor_Set(float32_t threshold_db, float32_t ratio, float32_t attack_ms,
+                       float32_t release_ms, float32_t makeup_db)
+{
+  if (threshold_db < -40.0f || threshold_db > 0.0f) return 0;
+  if (ratio < 1.0f || ratio > 20.0f) return 0;
+  if (attack_ms < 0.1f || attack_ms > 100.0f) return 0;
+  if (release_ms < 10.0f || release_ms > 2000.0f) return 0;
+  if (makeup_db < 0.0f || makeup_db > 24.0f) return 0;
+
+  compressor.threshold_db = threshold_db;
+  compressor.ratio = ratio;
+  compressor.attack_ms = attack_ms;
+  compressor.release_ms = release_ms;
+  compressor.makeup_db = makeup_db;
+  comp_attack_coeff = Sub_Block_Coeff(attack_ms);
+  comp_release_coeff = Sub_Block_Coeff(release_ms);
+  return 1;
+}
+
+void Compressor_Set_Lookahead(uint8_t on)
+{
+  memset(comp_out, 0, sizeof(comp_out));
+  comp_held_out = NULL;
+  compressor.lookahead = on ? 1 : 0;
+}
+
+/**
+  * @brief  Largest gain reduction (dB) since the last call (main loop)
+  */
+float32_t Compressor_Take_GR_Peak(void)
+{
+  float32_t peak = comp_gr_peak;
+  comp_gr_peak = 0.0f;
+  return peak;
+}
+
+/**
+  * @brief  Update the gain for one sub-block and ramp it into out, if given
+  * @param  detect: detector level the gain is sized from
+  */
+static void Compressor_Sub_Block(float32_t detect, const int16_t *in, int16_t *out)
+{
+  float32_t over, target, gain;
+  uint16_t i;
+
+  over = 20.0f * log10f(detect + 1e-6f) - compressor.threshold_db;
+  target = 0.0f;
+  if (over > 0.0f)
+  {
+    target = (compressor.mode == COMP_MODE_LIMIT) ? over : over * (1.0f - 1.0f / compressor.ratio);
+  }
+
+  if (target > compressor.gr_db)
+  {
+    // A look-ahead limiter has the ramp to land on, so it attacks at once
+    float32_t a = (out && compressor.mode == COMP_MODE_LIMIT) ? 1.0f : comp_attack_coeff;
+    compressor.gr_db += (target - compressor.gr_db) * a;
+  }
+  else
+  {
+    compressor.gr_db += (target - compressor.gr_db) * comp_release_coeff;
+  }
+  if (compressor.gr_db > comp_gr_peak) comp_gr_peak = compressor.gr_db;
+
+  gain = powf(10.0f, (compressor.makeup_db - compressor.gr_db) * 0.05f);
+
+  if (out)
+  {
+    float32_t step = (gain - comp_last_gain) / COMP_SUBBLOCK;
+    float32_t g = comp_last_gain;
+    for (i = 0; i < COMP_SUBBLOCK; i++)
+    {
+      int32_t v;
+      g += step;
+      v = (int32_t)((float32_t)in[i] * g);
+      if (v > 32767) v = 32767;
+      if (v < -32768) v = -32768;
+      out[i] = (int16_t)v;
+    }
+  }
+  comp_last_gain = gain;
+}
+
+/**
+  * @brief  Detect, compute and (into out, if given) apply gain for a block
+  * @param  in: half-scale Q15 input, length a multiple of COMP_SUBBLOCK
+  * @param  out: half-scale Q15 output or NULL to only update the gain.
+  *         The last sub-block is written on the next call, once the level
+  *         of the sub-block after it is known.
+  */
+void Compressor_Process_Block(const int16_t *in, int16_t *out, uint16_t length)
+{
+  uint16_t blocks = length / COMP_SUBBLOCK;
+  float32_t level[COMP_SUBBLOCKS_PER_HALF];
+  int16_t scratch[COMP_SUBBLOCK];
+  uint16_t s;
+
+  if (blocks > COMP_SUBBLOCKS_PER_HALF) blocks = COMP_SUBBLOCKS_PER_HALF;
+  if (blocks == 0) return;
+
+  for (s = 0; s < blocks; s++)
+  {
+    const int16_t *src = &in[s * COMP_SUBBLOCK];
+    int16_t q;
+    uint32_t where;
+
+    if (compressor.mode == COMP_MODE_LIMIT)
+    {
+      arm_abs_q15(src, scratch, COMP_SUBBLOCK);
+      arm_max_q15(scratch, COMP_SUBBLOCK, &q, &where);
+    }
+    else
+    {
+      arm_rms_q15(src, COMP_SUBBLOCK, &q);
+    }
+    level[s] = (float32_t)q * (2.0f / 32768.0f);
+  }
+
+  if (!out)
+  {
+    for (s = 0; s < blocks; s++) Compressor_Sub_Block(level[s], NULL, NULL);
+  }
+  else
+  {
+    // Look-ahead: size the ramp for the louder of this and the next sub-block
+    if (comp_held_out)
+    {
+      Compressor_Sub_Block((level[0] > comp_held_level) ? level[0] : comp_held_level,
+                           comp_held_in, comp_held_out);
+    }
+    for (s = 0; s + 1 < blocks; s++)
+    {
+      Compressor_Sub_Block((level[s + 1] > level[s]) ? level[s + 1] : level[s],
+                           &in[s * COMP_SUBBLOCK], &out[s * COMP_SUBBLOCK]);
+    }
+    memcpy(comp_held_in, &in[s * COMP_SUBBLOCK], sizeof(comp_held_in));
+    comp_held_out = &out[s * COMP_SUBBLOCK];
+    comp_held_level = level[s];
+  }
+
+  compressor.target_gain = comp_last_gain;
+}
+
+/**
+  * @brief  Hand the sample to the detector and return the gained output
+  * @note   Called from the TIM1 interrupt before buffer_index advances
+  */
+float32_t Apply_Compressor(float32_t input)
+{
+  float32_t half = input * 0.5f;
+
+  if (!compressor.enabled) return input;
+
+  if (half > 0.99997f) half = 0.99997f;
+  if (half < -1.0f) half = -1.0f;
+  comp_in[buffer_index] = (int16_t)(half * 32768.0f);
+
+  if (compressor.lookahead)
+  {
+    // One sub-block behind the input: the block path holds the last one back
+    uint16_t at = (buffer_index >= COMP_SUBBLOCK) ? buffer_index - COMP_SUBBLOCK
+                                                  : buffer_index + BUFFER_SIZE - COMP_SUBBLOCK;
+    return (float32_t)comp_out[at] * (2.0f / 32768.0f);
+  }
+
+  comp_isr_gain += (compressor.target_gain - comp_isr_gain) * COMP_GAIN_GLIDE;
+  return input * comp_isr_gain;
+}
+
+void Compressor_Process_Half(uint8_t half)
+{
+  uint16_t offset = half ? (BUFFER_SIZE / 2) : 0;
+
+  if (!compressor.enabled)
+  {
+    comp_held_out = NULL;
+    return;
+  }
+  Compressor_Process_Block(&comp_in[offset], compressor.lookahead ? &comp_out[offset] : NULL,
+                           BUFFER_SIZE / 2);
+}
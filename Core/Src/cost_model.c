@@ -0,0 +1,84 @@
+/* cost_model.c
+ * Chain cost from the table in cost_model.h
+ *
+ * Integer arithmetic only, in the order backend/costModel.js repeats it,
+ * so both sides agree to the cycle.
+ */
+
+#include "cost_model.h"
+
+static uint32_t Cost_Overdrive(uint8_t mode)
+{
+  if (mode == 0) return COST_OD_SOFT;
+  if (mode == 1) return COST_OD_HARD;
+  return COST_OD_ASYM;
+}
+
+static uint32_t Cost_Looper(uint8_t state)
+{
+  if (state == 1) return COST_LOOP_REC;
+  if (state == 2) return COST_LOOP_PLAY;
+  if (state == 3) return COST_LOOP_OVERDUB;
+  return 0;
+}
+
+/**
+  * @brief  Cabinet block cost: one FFT pair plus a MAC per partition run
+  *         in the block path; in low-latency mode the head is not among them
+  */
+static uint32_t Cost_Cabinet_Block(const CostConfig_t *c)
+{
+  uint32_t tail_start = c->cab_low_latency ? COST_CAB_HEAD_TAPS : 0;
+  uint32_t parts;
+
+  if (c->cab_taps <= tail_start) return 0;
+  parts = (c->cab_taps - tail_start + COST_CAB_PARTITION_TAPS - 1) / COST_CAB_PARTITION_TAPS;
+  return COST_CAB_FFT + parts * COST_CAB_PARTITION;
+}
+
+void CostModel_Predict(const CostConfig_t *c, CostEstimate_t *e)
+{
+  uint32_t isr = COST_ISR_BASE;
+  uint32_t block = COST_BLOCK_BASE;
+  uint64_t budget;
+
+  if (c->gate) isr += COST_GATE;
+  if (c->od) isr += Cost_Overdrive(c->od_mode);
+  if (c->delay) isr += c->pingpong ? COST_DELAY_PINGPONG : COST_DELAY;
+  if (c->eq_bands) isr += COST_EQ_BASE + c->eq_bands * COST_EQ_BAND;
+  if (c->cab && c->cab_taps)
+  {
+    uint32_t head = 0;
+    if (c->cab_low_latency) head = (c->cab_taps < COST_CAB_HEAD_TAPS) ? c->cab_taps : COST_CAB_HEAD_TAPS;
+    isr += COST_CAB_ISR + head * COST_CAB_HEAD_TAP;
+    block += Cost_Cabinet_Block(c);
+  }
+  if (c->mod)
+  {
+    isr += COST_MOD_ISR;
+    block += COST_MOD_BLOCK;
+  }
+  if (c->rvb_combs)
+  {
+    isr += COST_RVB_ISR;
+    block += c->rvb_combs * COST_RVB_COMB + COST_RVB_ALLPASSES;
+  }
+  if (c->comp)
+  {
+    isr += COST_COMP_ISR;
+    block += COST_COMP_BLOCK + (c->comp_lookahead ? COST_COMP_LOOKAHEAD : 0);
+  }
+  if (c->looper)
+  {
+    isr += COST_LOOP_ISR;
+    block += Cost_Looper(c->looper);
+  }
+  if (c->tuner) block += COST_TUNER;
+
+  budget = (uint64_t)c->core_hz * (BUFFER_SIZE / 2) / (c->sample_rate_hz ? c->sample_rate_hz : 1);
+  e->isr_per_sample = isr;
+  e->block_per_half = block;
+  e->total_per_half = isr * (BUFFER_SIZE / 2) + block;
+  e->budget_per_half = (uint32_t)budget;
+  e->permille = budget ? (uint32_t)((uint64_t)e->total_per_half * 1000 / budget) : 0xFFFFFFFFU;
+}
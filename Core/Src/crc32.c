@@ -0,0 +1,41 @@
+/* crc32.c
+ * Hardware CRC unit helpers (main loop use only, the unit is not shared
+ * with interrupts)
+ */
+
+#include "main.h"
+#include "crc32.h"
+
+/**
+  * @brief  Enable the CRC clock and restore the reset configuration
+  */
+void CRC32_Init(void)
+{
+  __HAL_RCC_CRC_CLK_ENABLE();
+  CRC->POL = 0x04C11DB7U;
+  CRC->INIT = 0xFFFFFFFFU;
+  CRC->CR = 0;
+}
+
+/**
+  * @brief  CRC-32/MPEG-2 of a byte buffer (words fed big-endian as the unit does)
+  */
+uint32_t CRC32_Calculate(const void *data, uint32_t length)
+{
+  const uint8_t *bytes = (const uint8_t*)data;
+  uint32_t i = 0;
+
+  CRC->CR |= CRC_CR_RESET;
+
+  for (; i + 4 <= length; i += 4)
+  {
+    CRC->DR = ((uint32_t)bytes[i] << 24) | ((uint32_t)bytes[i + 1] << 16) |
+              ((uint32_t)bytes[i + 2] << 8) | (uint32_t)bytes[i + 3];
+  }
+  for (; i < length; i++)
+  {
+    *(__IO uint8_t*)&CRC->DR = bytes[i];
+  }
+
+  return CRC->DR;
+}
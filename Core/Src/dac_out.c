@@ -0,0 +1,139 @@
+/* dac_out.c
+ * Audio output to DAC1
+ *
+ * Single output: channel 1 (PA4) is written from the timer interrupt as
+ * before. Dual output (DAC_DUAL_OUTPUT): channel 2 (PA5) is enabled as
+ * well and neither channel is written by the CPU. The TIM1 update event
+ * that starts the interrupt also raises a DMA request, and one circular
+ * DMA channel moves a 32-bit word from dac_ring[] into DHR12RD, which
+ * loads both channels at once. No DAC trigger is used: TIM1 TRGO cannot
+ * trigger DAC1, and with the trigger off the holding register reaches
+ * the outputs on the next APB clock.
+ *
+ * The interrupt finds the word the DMA sends next from the channel's
+ * remaining count, so the ring needs no alignment with buffer_index and
+ * survives the timer restart of a rate change. Each sample reaches the
+ * pins on the following update: one sample later than a direct write,
+ * but without the ADC conversion time as jitter.
+ *
+ * The second channel carries:
+ *   OUT_MONO     the same signal
+ *   OUT_SPLIT    the signal after the cabinet, at output_volume: dry
+ *                amp on channel 2, effects amp on channel 1
+ *   OUT_PINGPONG the echo line split in two crossed halves, repeats
+ *                alternating between channels. The difference between
+ *                the sides skips the reverb and looper; it follows the
+ *                compressor's gain without look-ahead.
+ */
+
+#include "main.h"
+#include "dac_out.h"
+#include "peripherals.h"
+#include "effects.h"
+#include "delay_mem.h"
+#include "compressor.h"
+#include "tuner.h"
+#include <string.h>
+
+DacOut_t dac_out = {
+  .mode = OUT_MONO,
+  .dual = DAC_DUAL_OUTPUT
+};
+
+#if DAC_DUAL_OUTPUT
+DMA_HandleTypeDef hdma_tim1_up;
+
+// Channel 1 in bits 0-11, channel 2 in bits 16-27 (DHR12RD layout)
+static uint32_t dac_ring[DAC_RING_SIZE];
+#endif
+
+static inline uint32_t DacOut_Code(float32_t sample)
+{
+  int32_t code = (int32_t)(sample * 2048.0f + 2048.0f);
+
+  if (code > 4095) code = 4095;
+  if (code < 0) code = 0;
+  return (uint32_t)code;
+}
+
+/**
+  * @brief  Enable the output channel(s)
+  * @note   Call after MX_DAC1_Init and MX_TIM1_Init, before TIM1 starts
+  */
+void DacOut_Start(void)
+{
+#if DAC_DUAL_OUTPUT
+  for (uint8_t i = 0; i < DAC_RING_SIZE; i++) dac_ring[i] = 0x08000800U;
+
+  HAL_DAC_Start(&hdac1, DAC_CHANNEL_1);
+  HAL_DAC_Start(&hdac1, DAC_CHANNEL_2);
+  if (HAL_DMA_Start(&hdma_tim1_up, (uint32_t)dac_ring, (uint32_t)&DAC1->DHR12RD,
+                    DAC_RING_SIZE) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  __HAL_TIM_ENABLE_DMA(&htim1, TIM_DMA_UPDATE);
+#else
+  HAL_DAC_Start(&hdac1, DAC_CHANNEL_1);
+#endif
+}
+
+/**
+  * @brief  Select what channel 2 carries
+  * @note   Main loop only. Entering or leaving OUT_PINGPONG clears the
+  *         echo line, whose layout changes.
+  * @retval 1 if accepted, 0 for an unknown mode or a single-output build
+  */
+uint8_t DacOut_Set_Mode(uint8_t mode)
+{
+  uint8_t pingpong = (mode == OUT_PINGPONG);
+  uint32_t primask;
+
+  if (mode > OUT_PINGPONG) return 0;
+  if (!dac_out.dual) return (mode == OUT_MONO);
+
+  if (pingpong != delay_effect.pingpong)
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    memset(delay_mem[DELAY_MEM_ECHO].base, 0,
+           delay_mem[DELAY_MEM_ECHO].length * sizeof(int16_t));
+    delay_effect.pingpong = pingpong;
+    delay_effect.lp_state = 0.0f;
+    delay_effect.side = 0.0f;
+    __set_PRIMASK(primask);
+  }
+  dac_out.mode = mode;
+  return 1;
+}
+
+/**
+  * @brief  Send one sample to the output(s)
+  * @param  output: final signal, clamped and muted
+  * @param  dry: the signal after the cabinet (OUT_SPLIT)
+  * @note   Called from the TIM1 interrupt
+  */
+void DacOut_Write(float32_t output, float32_t dry)
+{
+#if DAC_DUAL_OUTPUT
+  float32_t second = output;
+  uint32_t slot = DAC_RING_SIZE - __HAL_DMA_GET_COUNTER(&hdma_tim1_up);
+
+  if (dac_out.mode == OUT_SPLIT)
+  {
+    second = dry * output_volume;
+  }
+  else if (dac_out.mode == OUT_PINGPONG && delay_effect.enabled)
+  {
+    float32_t gain = compressor.enabled ? compressor.target_gain : 1.0f;
+    second = output + delay_effect.side * output_volume * gain;
+  }
+  if (Tuner_Muting()) second = 0.0f;
+
+  if (slot >= DAC_RING_SIZE) slot = 0;
+  dac_ring[slot] = DacOut_Code(output) | (DacOut_Code(second) << 16);
+#else
+  (void)dry;
+  HAL_DAC_SetValue(&hdac1, DAC_CHANNEL_1, DAC_ALIGN_12B_R, DacOut_Code(output));
+#endif
+}
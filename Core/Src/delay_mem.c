@@ -0,0 +1,116 @@
+/* delay_mem.c
+ * Slice allocator over delay_buffer
+ *
+ * The echo delay owns everything that no other client holds, so the
+ * maximum echo time shrinks while e.g. the chorus is on and comes back
+ * when it is switched off. Clients sit below each other from the end of
+ * the buffer, so a slice changing size shifts the ones below it; those
+ * are copied to their new place with the audio interrupt masked, and
+ * the slice being handed out is cleared. Echo samples the echo gains
+ * are cleared, and a ping-pong echo, whose right line moves with the
+ * length, is cleared whole.
+ */
+
+#include "main.h"
+#include "delay_mem.h"
+#include "effects.h"
+#include <string.h>
+
+DelayMemRegion_t delay_mem[DELAY_MEM_CLIENTS];
+
+static void DelayMem_Carry(uint8_t client, int16_t *from, uint8_t changed)
+{
+  if (client == changed || from == NULL || from == delay_mem[client].base) return;
+  if (delay_mem[client].length)
+    memmove(delay_mem[client].base, from, delay_mem[client].length * sizeof(int16_t));
+}
+
+/**
+  * @brief  Place the slices after a client's length changed
+  * @note   Called with the audio interrupt masked
+  */
+static void DelayMem_Layout(uint8_t changed)
+{
+  int16_t *from[DELAY_MEM_CLIENTS];
+  uint32_t echo = delay_mem[DELAY_MEM_ECHO].length;
+  uint32_t end = DELAY_BUFFER_SIZE;
+
+  for (uint8_t c = DELAY_MEM_CLIENTS - 1; c > DELAY_MEM_ECHO; c--)
+  {
+    from[c] = delay_mem[c].base;
+    end -= delay_mem[c].length;
+    delay_mem[c].base = &delay_buffer[end];
+  }
+
+  // Everything below the changed slice shifts the same way: copy the
+  // lowest first when moving down, the highest first when moving up
+  if (end < echo)
+  {
+    for (uint8_t c = DELAY_MEM_ECHO + 1; c < DELAY_MEM_CLIENTS; c++) DelayMem_Carry(c, from[c], changed);
+  }
+  else
+  {
+    for (uint8_t c = DELAY_MEM_CLIENTS - 1; c > DELAY_MEM_ECHO; c--) DelayMem_Carry(c, from[c], changed);
+  }
+
+  if (end != echo && delay_effect.pingpong)
+    memset(delay_buffer, 0, end * sizeof(int16_t));
+  else if (end > echo)
+    memset(&delay_buffer[echo], 0, (end - echo) * sizeof(int16_t));
+  delay_mem[DELAY_MEM_ECHO].base = delay_buffer;
+  delay_mem[DELAY_MEM_ECHO].length = end;
+  if (delay_write_index >= end) delay_write_index = 0;
+}
+
+void DelayMem_Init(void)
+{
+  memset(delay_mem, 0, sizeof(delay_mem));
+  DelayMem_Layout(DELAY_MEM_ECHO);
+}
+
+/**
+  * @brief  Longest slice a client could be given right now
+  */
+uint32_t DelayMem_Available(uint8_t client)
+{
+  uint32_t others = 0;
+
+  if (client == DELAY_MEM_ECHO || client >= DELAY_MEM_CLIENTS) return 0;
+  for (uint8_t c = DELAY_MEM_ECHO + 1; c < DELAY_MEM_CLIENTS; c++)
+  {
+    if (c != client) others += delay_mem[c].length;
+  }
+  return DELAY_BUFFER_SIZE - DELAY_MEM_ECHO_MIN - others;
+}
+
+/**
+  * @brief  Give a client a cleared slice of the given length
+  * @retval 1 on success, 0 if the echo would drop below DELAY_MEM_ECHO_MIN
+  */
+uint8_t DelayMem_Request(uint8_t client, uint32_t length)
+{
+  uint32_t primask;
+
+  if (length > DelayMem_Available(client)) return 0;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  delay_mem[client].length = length;
+  DelayMem_Layout(client);
+  memset(delay_mem[client].base, 0, length * sizeof(int16_t));
+  __set_PRIMASK(primask);
+  return 1;
+}
+
+void DelayMem_Release(uint8_t client)
+{
+  uint32_t primask;
+
+  if (client == DELAY_MEM_ECHO || client >= DELAY_MEM_CLIENTS) return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  delay_mem[client].length = 0;
+  DelayMem_Layout(client);
+  __set_PRIMASK(primask);
+}
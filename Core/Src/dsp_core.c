@@ -6,6 +6,17 @@
 #include "dsp_core.h"
 #include "effects.h"
 #include "peripherals.h"
+#include "telemetry.h"
+#include "scope.h"
+#include "reverb.h"
+#include "cabinet.h"
+#include "eq.h"
+#include "modulation.h"
+#include "compressor.h"
+#include "tuner.h"
+#include "governor.h"
+#include "looper.h"
+#include "dac_out.h"
 #include <math.h>
 
 // Bring in globals
@@ -17,27 +28,114 @@ extern uint16_t dac_buffer[];
 extern volatile uint8_t process_audio_flag;
 extern volatile uint16_t buffer_index;
 
+volatile uint8_t audio_ready_half = 0;
+volatile uint32_t audio_block_overruns = 0;
+volatile uint32_t audio_isr_cycles = 0;
+static volatile uint32_t isr_cycles_total = 0;  // free running, wraps
+static uint32_t isr_cycles_mark = 0;
+StageCycles_t reverb_cycles = { 0, 0 };
+StageCycles_t cabinet_cycles = { 0, 0 };
+StageCycles_t cabinet_isr_cycles = { 0, 0 };
+StageCycles_t eq_cycles = { 0, 0 };
+StageCycles_t modulation_cycles = { 0, 0 };
+StageCycles_t compressor_cycles = { 0, 0 };
+StageCycles_t looper_cycles = { 0, 0 };
+
+static inline float32_t Timed_EQ(float32_t input)
+{
+  uint32_t start = DWT->CYCCNT;
+  float32_t output = Apply_EQ(input);
+  Stage_Cycles_Record(&eq_cycles, DWT->CYCCNT - start);
+  return output;
+}
+
+/**
+  * @brief  Enable the DWT cycle counter used to time block processing
+  */
+void DSP_Cycle_Counter_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief  Flush denormals to zero in thread mode and in every interrupt
+  * @note   Feedback states (filter poles, envelopes) decaying through
+  *         silence become exact zeros instead of denormals, matching the
+  *         host builds. Exception entry loads FPSCR from FPDSCR, so the
+  *         TIM1 interrupt only runs with FZ if FPDSCR carries it too.
+  */
+void DSP_Flush_To_Zero_Init(void)
+{
+#if (__FPU_PRESENT == 1U)
+  FPU->FPDSCR |= FPU_FPDSCR_FZ_Msk;
+  __set_FPSCR(__get_FPSCR() | FPU_FPDSCR_FZ_Msk);  // FZ is bit 24 in both
+#endif
+}
+
+/**
+  * @brief  Block work for the half buffer the timer interrupt just left
+  * @note   Called from the main loop when process_audio_flag is set
+  */
 void Process_Guitar_Signal(void)
 {
-  uint16_t i;
-  float32_t normalized_input;
-  float32_t processed_signal;
-  
-  for (i = 0; i < BUFFER_SIZE; i++)
+  uint8_t half = audio_ready_half;
+  uint8_t skip = governor.skip;
+  uint32_t block_start = DWT->CYCCNT;
+  uint32_t isr_start = isr_cycles_total;
+  uint32_t start;
+
+  Tuner_Collect(&adc_buffer[half ? (BUFFER_SIZE / 2) : 0], BUFFER_SIZE / 2);
+
+  start = DWT->CYCCNT;
+
+  Cabinet_Process_Half(half);
+  if (cabinet.enabled) Stage_Cycles_Record(&cabinet_cycles, DWT->CYCCNT - start);
+
+  if (!(skip & GOV_SKIP_MODULATION))
+  {
+    start = DWT->CYCCNT;
+    Modulation_Process_Half(half);
+    if (modulation.mode != MOD_OFF) Stage_Cycles_Record(&modulation_cycles, DWT->CYCCNT - start);
+  }
+
+  if (!(skip & GOV_SKIP_REVERB))
+  {
+    start = DWT->CYCCNT;
+    Reverb_Process_Half(half);
+    if (reverb.enabled) Stage_Cycles_Record(&reverb_cycles, DWT->CYCCNT - start);
+  }
+
+  start = DWT->CYCCNT;
+  Looper_Process_Half(half);
+  if (looper.state != LOOP_CLEAR) Stage_Cycles_Record(&looper_cycles, DWT->CYCCNT - start);
+
+  start = DWT->CYCCNT;
+  Compressor_Process_Half(half);
+  if (compressor.enabled) Stage_Cycles_Record(&compressor_cycles, DWT->CYCCNT - start);
+
+  // The flag was cleared before this call, so the interrupt can't see a
+  // block that runs past the next half; count it here instead
+  if (audio_ready_half != half)
   {
-    normalized_input = ((float32_t)adc_buffer[i] / (ADC_MAX_VALUE / 2.0f)) - 1.0f;
-    processed_signal = Apply_Distortion(normalized_input);
-    processed_signal *= output_volume;
-    if (processed_signal > 1.0f) processed_signal = 1.0f;
-    if (processed_signal < -1.0f) processed_signal = -1.0f;
-    dac_buffer[i] = (uint16_t)((processed_signal + 1.0f) * (DAC_MAX_VALUE / 2.0f));
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    audio_block_overruns++;
+    __set_PRIMASK(primask);
   }
+
+  // Wall time minus the interrupts that preempted it; those are in audio_isr_cycles
+  Governor_Update(audio_isr_cycles, (DWT->CYCCNT - block_start) - (isr_cycles_total - isr_start));
 }
 
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
   if (htim->Instance == TIM1)
   {
+    uint32_t isr_start = DWT->CYCCNT;
+    uint8_t skip = governor.skip;
+
     HAL_ADC_Start(&hadc1);
 
     if (HAL_ADC_PollForConversion(&hadc1, 1) == HAL_OK)
@@ -46,26 +144,48 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 
       float32_t normalized_input = ((float32_t)adc_value - 2048.0f) / 2048.0f;
       float32_t processed_signal = Apply_NoiseGate(normalized_input);
+      if (eq.enabled && eq.position == EQ_POS_PRE && !(skip & GOV_SKIP_EQ)) processed_signal = Timed_EQ(processed_signal);
       processed_signal = Apply_Overdrive(processed_signal);
+      if (eq.enabled && eq.position == EQ_POS_POST && !(skip & GOV_SKIP_EQ)) processed_signal = Timed_EQ(processed_signal);
+      if (cabinet.enabled)
+      {
+        uint32_t start = DWT->CYCCNT;
+        processed_signal = Apply_Cabinet(processed_signal);
+        Stage_Cycles_Record(&cabinet_isr_cycles, DWT->CYCCNT - start);
+      }
+      float32_t dry_signal = processed_signal;
+      if (!(skip & GOV_SKIP_MODULATION)) processed_signal = Apply_Modulation(processed_signal);
       processed_signal = Apply_Delay(processed_signal);
+      if (!(skip & GOV_SKIP_REVERB)) processed_signal = Apply_Reverb(processed_signal);
+      processed_signal = Apply_Looper(processed_signal);
       processed_signal *= output_volume;
+      processed_signal = Apply_Compressor(processed_signal);
+      if (Tuner_Muting()) processed_signal = 0.0f;
+      Meter_Sample(adc_value, normalized_input, processed_signal);
       if (processed_signal > 1.0f) processed_signal = 1.0f;
       if (processed_signal < -1.0f) processed_signal = -1.0f;
-
-      uint16_t dac_value = (uint16_t)((processed_signal * 2048.0f) + 2048.0f);
-      if (dac_value > 4095) dac_value = 4095;
-      if (dac_value < 0) dac_value = 0;
-
-      HAL_DAC_SetValue(&hdac1, DAC_CHANNEL_1, DAC_ALIGN_12B_R, dac_value);
+      Scope_Sample(normalized_input, processed_signal);
+      DacOut_Write(processed_signal, dry_signal);
 
       adc_buffer[buffer_index] = adc_value;
       buffer_index++;
+      if (buffer_index == BUFFER_SIZE / 2 || buffer_index >= BUFFER_SIZE)
+      {
+        if (process_audio_flag) audio_block_overruns++;
+        audio_isr_cycles = isr_cycles_total - isr_cycles_mark;
+        isr_cycles_mark = isr_cycles_total;
+        audio_ready_half = (buffer_index >= BUFFER_SIZE) ? 1 : 0;
+        process_audio_flag = 1;
+      }
       if (buffer_index >= BUFFER_SIZE)
       {
         buffer_index = 0;
+        Meter_Block_End();
+        Effects_Apply_Pending();
       }
     }
 
     HAL_ADC_Stop(&hadc1);
+    isr_cycles_total += DWT->CYCCNT - isr_start;
   }
 }
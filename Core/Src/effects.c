@@ -4,6 +4,9 @@
 
 #include "main.h"
 #include "effects.h"
+#include "telemetry.h"
+#include "crc32.h"
+#include "delay_mem.h"
 #include <math.h>
 
 // Default effect states (moved from main.c)
@@ -20,11 +23,14 @@ Overdrive_t overdrive = {
 
 Delay_t delay_effect = {
   .delay_samples = 2400,
+  .time_ms = 50.0f,
   .feedback = 0.6f,
   .mix = 0.5f,
   .tone = 0.5f,
   .enabled = 0,
-  .lp_state = 0.0f
+  .pingpong = 0,
+  .lp_state = 0.0f,
+  .side = 0.0f
 };
 
 NoiseGate_t noise_gate = {
@@ -35,6 +41,36 @@ NoiseGate_t noise_gate = {
   .enabled = 1
 };
 
+// Whole-state update handed from the main loop to the audio interrupt
+static EffectParams_t pending_params;
+static volatile uint8_t params_pending = 0;
+
+// One-pole alphas below are tuned at SAMPLE_RATE; these follow sample_rate_hz
+typedef struct {
+  float32_t nominal;
+  float32_t rate;
+  float32_t alpha;
+} RateAlpha_t;
+
+static RateAlpha_t od_hp_alpha = { 0.0f, 0.0f, 0.0f };
+static RateAlpha_t od_lp_alpha = { 0.0f, 0.0f, 0.0f };
+static RateAlpha_t dly_tone_alpha = { 0.0f, 0.0f, 0.0f };
+
+/**
+  * @brief  Alpha giving the same time constant at sample_rate_hz as nominal
+  *         gives at SAMPLE_RATE; recomputed only when either changes
+  */
+static inline float32_t Rate_Alpha(RateAlpha_t *cache, float32_t nominal)
+{
+  if (nominal != cache->nominal || sample_rate_hz != cache->rate)
+  {
+    cache->nominal = nominal;
+    cache->rate = sample_rate_hz;
+    cache->alpha = 1.0f - powf(1.0f - nominal, (float32_t)SAMPLE_RATE / sample_rate_hz);
+  }
+  return cache->alpha;
+}
+
 float32_t distortion_gain = 3.0f;
 float32_t distortion_threshold = 0.7f;
 float32_t output_volume = 0.8f;
@@ -58,7 +94,7 @@ float32_t Apply_Overdrive(float32_t input)
 {
   if (!overdrive.enabled) return input;
 
-  float32_t hp_alpha = 0.99f;
+  float32_t hp_alpha = 1.0f - Rate_Alpha(&od_hp_alpha, 0.01f);
   float32_t hp_output = input - overdrive.hp_state;
   overdrive.hp_state = input - hp_alpha * hp_output;
 
@@ -116,7 +152,9 @@ float32_t Apply_Overdrive(float32_t input)
     }
   }
 
-  float32_t lp_alpha = 0.3f + overdrive.tone * 0.6f;
+  Meter_Drive(gained, clipped);
+
+  float32_t lp_alpha = Rate_Alpha(&od_lp_alpha, 0.3f + overdrive.tone * 0.6f);
   overdrive.lp_state = lp_alpha * clipped + (1.0f - lp_alpha) * overdrive.lp_state;
 
   float32_t output = overdrive.mix * overdrive.lp_state + (1.0f - overdrive.mix) * input;
@@ -136,16 +174,37 @@ float32_t Apply_Delay(float32_t input)
 {
   if (!delay_effect.enabled) return input;
 
-  int32_t delay_read_index = (int32_t)delay_write_index - (int32_t)delay_effect.delay_samples;
+  // The echo shares delay_buffer with other delay-line effects (delay_mem.c)
+  int16_t *line = delay_mem[DELAY_MEM_ECHO].base;
+  uint32_t span = delay_mem[DELAY_MEM_ECHO].length;
+
+  // Ping-pong: the halves are the left and right lines; left repeats move
+  // to the right line, right repeats feed back into the left
+  if (delay_effect.pingpong)
+  {
+    span /= 2;
+    if (delay_write_index >= span) delay_write_index = 0;
+  }
+  uint32_t distance = (delay_effect.delay_samples < span) ? delay_effect.delay_samples : span;
+
+  int32_t delay_read_index = (int32_t)delay_write_index - (int32_t)distance;
   while (delay_read_index < 0)
   {
-    delay_read_index += DELAY_BUFFER_SIZE;
+    delay_read_index += span;
   }
 
-  float32_t delayed_sample = delay_buffer[delay_read_index];
+  float32_t delayed_sample = (float32_t)line[delay_read_index] / 32768.0f;
+  float32_t returning = delayed_sample;
+
+  if (delay_effect.pingpong)
+  {
+    returning = (float32_t)line[span + delay_read_index] / 32768.0f;
+    line[span + delay_write_index] = (int16_t)(delayed_sample * delay_effect.feedback * 32768.0f);
+    delay_effect.side = (returning - delayed_sample) * delay_effect.mix;
+  }
 
-  float32_t tone_alpha = 0.2f + delay_effect.tone * 0.7f;
-  delay_effect.lp_state = tone_alpha * delayed_sample + (1.0f - tone_alpha) * delay_effect.lp_state;
+  float32_t tone_alpha = Rate_Alpha(&dly_tone_alpha, 0.2f + delay_effect.tone * 0.7f);
+  delay_effect.lp_state = tone_alpha * returning + (1.0f - tone_alpha) * delay_effect.lp_state;
 
   float32_t filtered_delay = delay_effect.lp_state;
 
@@ -155,15 +214,20 @@ float32_t Apply_Delay(float32_t input)
   else if (feedback_signal < -0.95f)
     feedback_signal = -0.95f;
 
-  delay_buffer[delay_write_index] = input + feedback_signal;
+  float32_t write_sample = input + feedback_signal;
+
+  if (write_sample > 1.0f)
+    write_sample = 1.0f;
+  else if (write_sample < -1.0f)
+    write_sample = -1.0f;
 
-  if (delay_buffer[delay_write_index] > 1.0f)
-    delay_buffer[delay_write_index] = 1.0f;
-  else if (delay_buffer[delay_write_index] < -1.0f)
-    delay_buffer[delay_write_index] = -1.0f;
+  // Q15 at the same scale as the read, so repeats keep their gain
+  int32_t q15 = (int32_t)(write_sample * 32768.0f);
+  if (q15 > 32767) q15 = 32767;
+  line[delay_write_index] = (int16_t)q15;
 
   delay_write_index++;
-  if (delay_write_index >= DELAY_BUFFER_SIZE)
+  if (delay_write_index >= span)
   {
     delay_write_index = 0;
   }
@@ -180,8 +244,8 @@ float32_t Apply_NoiseGate(float32_t input)
 
   float32_t input_level = fabsf(input);
 
-  float32_t attack_coeff = 1.0f - (1.0f / (noise_gate.attack_time * SAMPLE_RATE));
-  float32_t release_coeff = 1.0f - (1.0f / (noise_gate.release_time * SAMPLE_RATE));
+  float32_t attack_coeff = 1.0f - (1.0f / (noise_gate.attack_time * sample_rate_hz));
+  float32_t release_coeff = 1.0f - (1.0f / (noise_gate.release_time * sample_rate_hz));
 
   if (attack_coeff < 0.0f) attack_coeff = 0.0f;
   if (attack_coeff >= 1.0f) attack_coeff = 0.999f;
@@ -214,5 +278,112 @@ float32_t Apply_NoiseGate(float32_t input)
     gate_gain = position * position * (3.0f - 2.0f * position);
   }
 
+  Meter_Gate(gate_gain);
+
   return input * gate_gain;
 }
+
+void Effects_Get_Params(EffectParams_t *params)
+{
+  // Mask the audio interrupt so a block-boundary update cannot tear the copy
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  params->volume = output_volume;
+  params->od_gain = overdrive.gain;
+  params->od_threshold = overdrive.threshold;
+  params->od_tone = overdrive.tone;
+  params->od_mix = overdrive.mix;
+  params->dly_feedback = delay_effect.feedback;
+  params->dly_mix = delay_effect.mix;
+  params->dly_tone = delay_effect.tone;
+  params->gate_threshold = noise_gate.threshold;
+  params->gate_attack = noise_gate.attack_time;
+  params->gate_release = noise_gate.release_time;
+  params->dly_samples = delay_effect.delay_samples;
+  params->od_mode = overdrive.mode;
+  params->od_enabled = overdrive.enabled;
+  params->dly_enabled = delay_effect.enabled;
+  params->gate_enabled = noise_gate.enabled;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Check every field against the ranges accepted by the UART commands
+  * @retval 1 if the whole state is valid, 0 otherwise (nothing is partially applied)
+  */
+uint8_t Effects_Validate_Params(const EffectParams_t *params)
+{
+  if (!(params->volume >= 0.0f && params->volume <= 1.0f)) return 0;
+  if (!(params->od_gain >= 1.0f && params->od_gain <= 100.0f)) return 0;
+  if (!(params->od_threshold >= 0.1f && params->od_threshold <= 0.95f)) return 0;
+  if (!(params->od_tone >= 0.0f && params->od_tone <= 1.0f)) return 0;
+  if (!(params->od_mix >= 0.0f && params->od_mix <= 1.0f)) return 0;
+  if (params->od_mode > 2) return 0;
+  if (params->dly_samples == 0 || params->dly_samples > DELAY_BUFFER_SIZE) return 0;
+  if (!(params->dly_feedback >= 0.0f && params->dly_feedback <= 0.95f)) return 0;
+  if (!(params->dly_mix >= 0.0f && params->dly_mix <= 1.0f)) return 0;
+  if (!(params->dly_tone >= 0.0f && params->dly_tone <= 1.0f)) return 0;
+  if (!(params->gate_threshold >= 0.001f && params->gate_threshold <= 0.5f)) return 0;
+  if (!(params->gate_attack >= 0.0001f && params->gate_attack <= 0.1f)) return 0;
+  if (!(params->gate_release >= 0.01f && params->gate_release <= 1.0f)) return 0;
+  if (params->od_enabled > 1 || params->dly_enabled > 1 || params->gate_enabled > 1) return 0;
+  return 1;
+}
+
+/**
+  * @brief  Hand a validated state to the audio interrupt (main loop side)
+  * @note   A state queued before the previous one was applied replaces it.
+  */
+void Effects_Queue_Params(const EffectParams_t *params)
+{
+  params_pending = 0;
+  __DMB();
+  pending_params = *params;
+  __DMB();
+  params_pending = 1;
+}
+
+/**
+  * @brief  Apply a queued state in one go (audio interrupt, block boundary)
+  */
+void Effects_Apply_Pending(void)
+{
+  if (!params_pending) return;
+
+  output_volume = pending_params.volume;
+  overdrive.gain = pending_params.od_gain;
+  overdrive.threshold = pending_params.od_threshold;
+  overdrive.tone = pending_params.od_tone;
+  overdrive.mix = pending_params.od_mix;
+  overdrive.mode = pending_params.od_mode;
+  overdrive.enabled = pending_params.od_enabled;
+  delay_effect.delay_samples = pending_params.dly_samples;
+  delay_effect.feedback = pending_params.dly_feedback;
+  delay_effect.mix = pending_params.dly_mix;
+  delay_effect.tone = pending_params.dly_tone;
+  delay_effect.enabled = pending_params.dly_enabled;
+  noise_gate.threshold = pending_params.gate_threshold;
+  noise_gate.attack_time = pending_params.gate_attack;
+  noise_gate.release_time = pending_params.gate_release;
+  noise_gate.enabled = pending_params.gate_enabled;
+
+  params_pending = 0;
+}
+
+/**
+  * @brief  Whether a queued state still waits for its block boundary
+  * @note   Commands read the live state, so the main loop holds further
+  *         lines until a SETALL is in (one buffer at most).
+  */
+uint8_t Effects_Params_Pending(void)
+{
+  return params_pending;
+}
+
+/**
+  * @brief  CRC-32 of the canonical state (struct bytes, little endian, no padding)
+  */
+uint32_t Effects_Params_Digest(const EffectParams_t *params)
+{
+  return CRC32_Calculate(params, sizeof(EffectParams_t));
+}
@@ -0,0 +1,131 @@
+/* eq.c
+ * Parametric EQ biquad cascade
+ *
+ * Coefficients come from the RBJ audio-EQ cookbook and are computed in
+ * the main loop into whichever of two banks the filter is not using;
+ * publishing the new bank is a single pointer store, so the interrupt
+ * never sees a half-written band and the filter state carries over.
+ *
+ * The dry chain runs per sample in the TIM1 interrupt, so Apply_EQ feeds
+ * the cascade one sample at a time at the selected position rather than
+ * adding a block of latency in front of the overdrive.
+ */
+
+#include "main.h"
+#include "eq.h"
+#include <math.h>
+#include <string.h>
+
+static float32_t eq_coeffs[2][5 * EQ_BANDS];
+static float32_t eq_state[2 * EQ_BANDS];
+static uint8_t eq_bank = 0;
+static arm_biquad_cascade_df2T_instance_f32 eq_filter;
+
+Eq_t eq = {
+  .enabled = 0,
+  .position = EQ_POS_POST,
+  .band = {
+    { EQ_TYPE_LOW_SHELF, 100.0f, 0.0f, 0.7f },
+    { EQ_TYPE_PEAK, 400.0f, 0.0f, 1.0f },
+    { EQ_TYPE_PEAK, 1000.0f, 0.0f, 1.0f },
+    { EQ_TYPE_PEAK, 3000.0f, 0.0f, 1.0f },
+    { EQ_TYPE_HIGH_SHELF, 6000.0f, 0.0f, 0.7f }
+  }
+};
+
+/**
+  * @brief  RBJ cookbook biquad, stored as {b0, b1, b2, -a1, -a2} / a0
+  */
+static void EQ_Band_Coeffs(const EqBand_t *band, float32_t *c)
+{
+  float32_t A = powf(10.0f, band->gain_db / 40.0f);
+  float32_t freq = band->freq;
+  float32_t w0;
+  float32_t cw;
+  float32_t alpha;
+
+  // A band set at a higher rate may now be past Nyquist
+  if (freq > 0.45f * sample_rate_hz) freq = 0.45f * sample_rate_hz;
+  w0 = 2.0f * PI * freq / sample_rate_hz;
+  cw = cosf(w0);
+  alpha = sinf(w0) / (2.0f * band->q);
+  float32_t b0, b1, b2, a0, a1, a2;
+
+  if (band->type == EQ_TYPE_LOW_SHELF || band->type == EQ_TYPE_HIGH_SHELF)
+  {
+    float32_t s = (band->type == EQ_TYPE_LOW_SHELF) ? 1.0f : -1.0f;
+    float32_t k = 2.0f * sqrtf(A) * alpha;
+    b0 = A * ((A + 1.0f) - s * (A - 1.0f) * cw + k);
+    b1 = s * 2.0f * A * ((A - 1.0f) - s * (A + 1.0f) * cw);
+    b2 = A * ((A + 1.0f) - s * (A - 1.0f) * cw - k);
+    a0 = (A + 1.0f) + s * (A - 1.0f) * cw + k;
+    a1 = -s * 2.0f * ((A - 1.0f) + s * (A + 1.0f) * cw);
+    a2 = (A + 1.0f) + s * (A - 1.0f) * cw - k;
+  }
+  else
+  {
+    b0 = 1.0f + alpha * A;
+    b1 = -2.0f * cw;
+    b2 = 1.0f - alpha * A;
+    a0 = 1.0f + alpha / A;
+    a1 = -2.0f * cw;
+    a2 = 1.0f - alpha / A;
+  }
+
+  c[0] = b0 / a0;
+  c[1] = b1 / a0;
+  c[2] = b2 / a0;
+  c[3] = -a1 / a0;
+  c[4] = -a2 / a0;
+}
+
+void EQ_Init(void)
+{
+  memset(eq_state, 0, sizeof(eq_state));
+  eq_bank = 0;
+  for (uint8_t i = 0; i < EQ_BANDS; i++)
+  {
+    EQ_Band_Coeffs(&eq.band[i], &eq_coeffs[eq_bank][5 * i]);
+  }
+  arm_biquad_cascade_df2T_init_f32(&eq_filter, EQ_BANDS, eq_coeffs[eq_bank], eq_state);
+}
+
+uint8_t EQ_Set_Band(uint8_t index, uint8_t type, float32_t freq, float32_t gain_db, float32_t q)
+{
+  if (index >= EQ_BANDS || type > EQ_TYPE_HIGH_SHELF) return 0;
+  if (freq < 20.0f || freq > 0.45f * sample_rate_hz) return 0;
+  if (gain_db < -15.0f || gain_db > 15.0f) return 0;
+  if (q < 0.1f || q > 10.0f) return 0;
+
+  eq.band[index].type = type;
+  eq.band[index].freq = freq;
+  eq.band[index].gain_db = gain_db;
+  eq.band[index].q = q;
+  EQ_Recompute();
+  return 1;
+}
+
+/**
+  * @brief  Recompute all bands into the idle bank and publish it
+  * @note   Main loop only
+  */
+void EQ_Recompute(void)
+{
+  uint8_t next = eq_bank ^ 1U;
+
+  for (uint8_t i = 0; i < EQ_BANDS; i++)
+  {
+    EQ_Band_Coeffs(&eq.band[i], &eq_coeffs[next][5 * i]);
+  }
+  eq_filter.pCoeffs = eq_coeffs[next];
+  eq_bank = next;
+}
+
+float32_t Apply_EQ(float32_t input)
+{
+  float32_t output;
+
+  if (!eq.enabled) return input;
+  arm_biquad_cascade_df2T_f32(&eq_filter, &input, &output, 1);
+  return output;
+}
@@ -13,12 +13,15 @@ uint16_t dac_buffer[BUFFER_SIZE];
 volatile uint8_t process_audio_flag = 0;
 volatile uint16_t buffer_index = 0;
 
+/* Real audio rate, set by SampleRate_Init/SampleRate_Set */
+float32_t sample_rate_hz = (float32_t)SAMPLE_RATE;
+
 /* ADC monitoring */
 volatile uint16_t max_adc_deviation = 0;
 volatile uint16_t current_adc_value = 0;
 
 /* Delay buffer and index */
-float32_t delay_buffer[DELAY_BUFFER_SIZE];
+int16_t delay_buffer[DELAY_BUFFER_SIZE];
 uint32_t delay_write_index = 0;
 
 /* UART comm buffers */
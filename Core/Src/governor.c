@@ -0,0 +1,300 @@
+/* governor.c
+ * CPU-load governor for the audio path
+ *
+ * Every half buffer the main loop reports the cycles it spent in block
+ * work; the timer interrupt reports its own per-half total. Their sum
+ * against the cycles available per half (SystemCoreClock / sample_rate_hz
+ * per sample) is the load. Sustained load over GOV_HIGH_PERMILLE, or any
+ * block overrun, steps quality down one level; sustained load under
+ * GOV_LOW_PERMILLE steps it back up one level at a time.
+ *
+ * Levels are ordered by how audible they are: skipping stages whose
+ * output is inaudible anyway costs nothing, then the cabinet IR and the
+ * reverb tail are shortened.
+ *
+ * With SR:AUTO the sample rate comes first: at full quality a long run
+ * of low load (projected to the next rate up) raises the rate, and an
+ * overload above SR_AUTO_FLOOR lowers it before any level is dropped.
+ *
+ * Each level or rate change is reported to the ESP32 as a governor frame.
+ */
+
+#include "main.h"
+#include "governor.h"
+#include "dsp_core.h"
+#include "cabinet.h"
+#include "reverb.h"
+#include "eq.h"
+#include "modulation.h"
+#include "sample_rate.h"
+#include "looper.h"
+#include "compressor.h"
+#include "tuner.h"
+#include "effects.h"
+#include "uart_comm.h"
+
+Governor_t governor = {
+  .level = GOV_LEVEL_FULL,
+  .forced = GOV_LEVEL_AUTO,
+  .skip = 0,
+  .restore_shift = 0
+};
+
+static uint16_t gov_seq = 0;
+static uint32_t gov_last_overruns = 0;
+static uint32_t gov_since_restore = 0xFFFFFFFFU;
+static uint8_t gov_settle = 0;
+
+void Governor_Init(void)
+{
+  governor.budget_cycles = (uint32_t)((float32_t)SystemCoreClock / sample_rate_hz * (BUFFER_SIZE / 2));
+  governor.restore_halves = (uint32_t)(sample_rate_hz * (GOV_RESTORE_MS / 1000.0f) / (BUFFER_SIZE / 2));
+  governor.over_count = 0;
+  governor.under_count = 0;
+  gov_last_overruns = audio_block_overruns;
+}
+
+static uint8_t Governor_Idle_Stages(void)
+{
+  uint8_t skip = 0;
+  uint8_t flat = 1;
+
+  for (uint8_t i = 0; i < EQ_BANDS; i++)
+  {
+    if (eq.band[i].gain_db > 0.05f || eq.band[i].gain_db < -0.05f) flat = 0;
+  }
+  if (flat) skip |= GOV_SKIP_EQ;
+  // Not the flanger: its output runs a block late, skipping it would jump the latency
+  if (modulation.mode == MOD_CHORUS && modulation.mix < GOV_IDLE_MIX) skip |= GOV_SKIP_MODULATION;
+  if (reverb.mix < GOV_IDLE_MIX) skip |= GOV_SKIP_REVERB;
+  return skip;
+}
+
+/**
+  * @brief  Push the settings of a quality level to the stages
+  */
+static void Governor_Apply(uint8_t level)
+{
+  uint16_t cab_limit = 0;
+  uint8_t combs = REVERB_COMBS;
+
+  if (level >= GOV_LEVEL_SHORT_IR)
+  {
+    cab_limit = cabinet.taps / 2;
+    if (cab_limit < CAB_PARTITION) cab_limit = CAB_PARTITION;
+  }
+  if (level >= GOV_LEVEL_SHORT_REVERB) combs = REVERB_COMBS / 2;
+  if (level >= GOV_LEVEL_MINIMAL)
+  {
+    cab_limit = CAB_PARTITION;
+    combs = 1;
+  }
+
+  if (cab_limit != cabinet.tap_limit) Cabinet_Set_Tap_Limit(cab_limit);
+  if (combs != reverb.active_combs) Reverb_Set_Active_Combs(combs);
+  governor.skip = (level >= GOV_LEVEL_SKIP_IDLE) ? Governor_Idle_Stages() : 0;
+}
+
+static void Governor_Send_Frame(uint8_t previous, uint16_t load)
+{
+  GovernorFrame_t frame;
+
+  frame.seq = gov_seq++;
+  frame.level = governor.level;
+  frame.previous = previous;
+  frame.load_permille = load;
+  frame.peak_permille = governor.peak_permille;
+  frame.overruns = (uint16_t)audio_block_overruns;
+  frame.skip = governor.skip;
+  frame.forced = (governor.forced != GOV_LEVEL_AUTO);
+  frame.sample_rate = sample_rate.nominal;
+  Send_UART_Frame(UART_FRAME_GOVERNOR, (const uint8_t*)&frame, sizeof(frame));
+}
+
+static void Governor_Change(uint8_t level, uint16_t load)
+{
+  uint8_t previous = governor.level;
+
+  if (level == previous) return;
+  governor.level = level;
+  governor.changes++;
+  governor.over_count = 0;
+  governor.under_count = 0;
+  Governor_Apply(level);
+  Governor_Send_Frame(previous, load);
+}
+
+/**
+  * @brief  SR:AUTO may move the rate (not while a loop is held: it would be lost)
+  */
+static inline uint8_t Governor_Rate_Free(void)
+{
+  return sample_rate.auto_rate && looper.state == LOOP_CLEAR;
+}
+
+/**
+  * @brief  Move to another sample rate (SR:AUTO) and let the load settle
+  */
+static void Governor_Rate_Change(uint32_t rate_hz, uint16_t load)
+{
+  if (!SampleRate_Set(rate_hz)) return;
+  governor.changes++;
+  gov_settle = GOV_SETTLE_HALVES;
+  Governor_Send_Frame(governor.level, load);
+}
+
+/**
+  * @brief  Account one half buffer and step quality if needed
+  * @param  isr_cycles: interrupt cycles spent during the half
+  * @param  block_cycles: main-loop block work for the half, interrupts excluded
+  * @note   Main loop only, after Process_Guitar_Signal's stages
+  */
+void Governor_Update(uint32_t isr_cycles, uint32_t block_cycles)
+{
+  uint64_t used = (uint64_t)isr_cycles + block_cycles;
+  uint32_t load = governor.budget_cycles ? (uint32_t)((used * 1000U) / governor.budget_cycles) : 0;
+  uint32_t overruns = audio_block_overruns;
+  uint8_t overrun = (overruns != gov_last_overruns);
+  uint32_t hold = governor.restore_halves << governor.restore_shift;
+
+  if (load > 0xFFFFU) load = 0xFFFFU;
+  gov_last_overruns = overruns;
+  governor.load_permille = (uint16_t)load;
+  if (load > governor.peak_permille) governor.peak_permille = (uint16_t)load;
+  if (gov_since_restore < 0xFFFFFFFFU) gov_since_restore++;
+
+  // A restore that held for twice its wait resets the back-off
+  if (governor.restore_shift && gov_since_restore > 2U * hold) governor.restore_shift = 0;
+
+  // The halves around a rate change are not representative
+  if (gov_settle)
+  {
+    gov_settle--;
+    return;
+  }
+
+  if (governor.forced != GOV_LEVEL_AUTO)
+  {
+    Governor_Change(governor.forced, (uint16_t)load);
+  }
+  else if (overrun || load > GOV_HIGH_PERMILLE)
+  {
+    uint32_t lower = Governor_Rate_Free() ? SampleRate_Neighbour(-1) : 0;
+
+    governor.under_count = 0;
+    if (overrun || ++governor.over_count >= GOV_DEGRADE_HALVES)
+    {
+      if (governor.level == GOV_LEVEL_FULL && lower)
+      {
+        if (gov_since_restore < hold && governor.restore_shift < GOV_RESTORE_MAX_SHIFT)
+        {
+          governor.restore_shift++;
+        }
+        Governor_Rate_Change(lower, (uint16_t)load);
+      }
+      else if (governor.level < GOV_LEVEL_MAX)
+      {
+        // Stepping down soon after a restore: wait longer next time
+        if (gov_since_restore < hold && governor.restore_shift < GOV_RESTORE_MAX_SHIFT)
+        {
+          governor.restore_shift++;
+        }
+        Governor_Change(governor.level + 1, (uint16_t)load);
+      }
+      governor.over_count = 0;
+    }
+  }
+  else if (load < GOV_LOW_PERMILLE)
+  {
+    uint32_t higher = Governor_Rate_Free() ? SampleRate_Neighbour(1) : 0;
+
+    governor.over_count = 0;
+    if (governor.level > GOV_LEVEL_FULL)
+    {
+      if (++governor.under_count >= hold)
+      {
+        gov_since_restore = 0;
+        Governor_Change(governor.level - 1, (uint16_t)load);
+      }
+    }
+    else if (higher && (uint64_t)load * higher < (uint64_t)GOV_LOW_PERMILLE * sample_rate.nominal)
+    {
+      // Cost scales with the rate: only go up if it would still be light
+      if (++governor.under_count >= GOV_RATE_UP_FACTOR * hold)
+      {
+        gov_since_restore = 0;
+        Governor_Rate_Change(higher, (uint16_t)load);
+      }
+    }
+    else
+    {
+      governor.under_count = 0;
+    }
+  }
+  else
+  {
+    governor.over_count = 0;
+    governor.under_count = 0;
+  }
+
+  // Idle stages and a reloaded IR are re-evaluated every half
+  Governor_Apply(governor.level);
+}
+
+/**
+  * @brief  Pin a quality level (GOV_LEVEL_AUTO hands control back)
+  */
+void Governor_Force(uint8_t level)
+{
+  if (level != GOV_LEVEL_AUTO && level > GOV_LEVEL_MAX) level = GOV_LEVEL_MAX;
+  governor.forced = level;
+  governor.over_count = 0;
+  governor.under_count = 0;
+}
+
+uint16_t Governor_Take_Peak(void)
+{
+  uint16_t peak = governor.peak_permille;
+  governor.peak_permille = 0;
+  return peak;
+}
+
+/**
+  * @brief  Describe the live chain to the cost model, at full quality
+  */
+void Governor_Cost_Config(CostConfig_t *config)
+{
+  config->core_hz = SystemCoreClock;
+  config->sample_rate_hz = sample_rate.nominal;
+  config->gate = noise_gate.enabled;
+  config->od = overdrive.enabled;
+  config->od_mode = overdrive.mode;
+  config->delay = delay_effect.enabled;
+  config->pingpong = delay_effect.pingpong;
+  config->eq_bands = eq.enabled ? EQ_BANDS : 0;
+  config->cab = cabinet.enabled;
+  config->cab_low_latency = (cabinet.mode == CAB_MODE_LOW_LATENCY);
+  config->cab_taps = cabinet.taps;
+  config->mod = modulation.mode;
+  config->rvb_combs = reverb.enabled ? REVERB_COMBS : 0;
+  config->comp = compressor.enabled;
+  config->comp_lookahead = compressor.lookahead;
+  config->looper = looper.state;
+  config->tuner = tuner.enabled;
+}
+
+/**
+  * @brief  Cabinet latency mode for CAB:MODE,AUTO: low latency as long as
+  *         the predicted load with it stays under COST_WARN_PERMILLE
+  */
+uint8_t Governor_Pick_Cab_Mode(void)
+{
+  CostConfig_t config;
+  CostEstimate_t estimate;
+
+  Governor_Cost_Config(&config);
+  config.cab = 1;
+  config.cab_low_latency = 1;
+  CostModel_Predict(&config, &estimate);
+  return (estimate.permille <= COST_WARN_PERMILLE) ? CAB_MODE_LOW_LATENCY : CAB_MODE_FFT;
+}
@@ -0,0 +1,359 @@
+/* looper.c
+ * Looper on IMA-ADPCM blocks in a slice of delay_buffer
+ *
+ * The timer interrupt box-filters the signal down by LOOP_DECIMATION
+ * into loop_in[] and plays loop_out[] back with linear interpolation;
+ * the main loop encodes and decodes the half the interrupt just left,
+ * LOOP_HALF_SAMPLES at a time, straight into the ADPCM blocks. The loop
+ * repeats every looper.length samples; playback trails the take by the
+ * BUFFER_SIZE of block latency.
+ *
+ * Overdub adds the input to the chunk that was playing while it came
+ * in, which is still in loop_out[], and re-encodes that chunk two halves
+ * behind the one being decoded, so each layer lines up with what was
+ * heard. The encoder tracks what the decoder will reconstruct, and every
+ * block header restarts the decoder, so leaving overdub mid-block can
+ * only disturb the rest of that block.
+ *
+ * LOOP:REC leaves the echo its running delay (both lines in ping-pong)
+ * and room for the modulation line, unless that would leave the loop
+ * less than LOOP_RESERVE_SAMPLES; LOOP? reports what it would get.
+ *
+ * Cost per half: LOOP_HALF_SAMPLES encodes or decodes (about 20 cycles
+ * each), twice in overdub; the interrupt adds an accumulate and an
+ * interpolation per sample.
+ */
+
+#include "main.h"
+#include "looper.h"
+#include "delay_mem.h"
+#include "effects.h"
+#include "modulation.h"
+#include <string.h>
+
+#if (LOOP_BLOCK_SAMPLES % LOOP_HALF_SAMPLES) != 0
+#error "LOOP_BLOCK_SAMPLES must be a multiple of LOOP_HALF_SAMPLES"
+#endif
+
+static const int16_t ima_step[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+static const int8_t ima_index[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+Looper_t looper = {
+  .state = LOOP_CLEAR,
+  .blocks = 0,
+  .length = 0,
+  .position = 0,
+  .level = LOOP_LEVEL
+};
+
+// Shared with the audio interrupt (one half each at any time), decimated
+static int16_t loop_in[2 * LOOP_HALF_SAMPLES];
+static int16_t loop_out[2 * LOOP_HALF_SAMPLES];
+
+// Interrupt side
+static float32_t loop_acc = 0.0f;
+static float32_t loop_prev = 0.0f;
+
+// Main-loop side
+static AdpcmState_t loop_enc;
+static AdpcmState_t loop_dec;
+static AdpcmState_t loop_dec_before[2];  // decoder state before each half of loop_out
+static uint8_t loop_out_decoded = 0;     // bit per half: loop_out holds a decoded chunk
+static uint8_t loop_enc_synced = 0;
+
+static inline int16_t Adpcm_Step(AdpcmState_t *s, uint8_t code)
+{
+  int32_t step = ima_step[s->index];
+  int32_t delta = step >> 3;
+  int32_t pred = s->predictor;
+  int32_t index = s->index + ima_index[code & 7];
+
+  if (code & 4) delta += step;
+  if (code & 2) delta += step >> 1;
+  if (code & 1) delta += step >> 2;
+  pred += (code & 8) ? -delta : delta;
+
+  if (pred > 32767) pred = 32767;
+  if (pred < -32768) pred = -32768;
+  if (index < 0) index = 0;
+  if (index > 88) index = 88;
+  s->predictor = (int16_t)pred;
+  s->index = (uint8_t)index;
+  return s->predictor;
+}
+
+static inline uint8_t Adpcm_Encode(AdpcmState_t *s, int16_t sample)
+{
+  int32_t step = ima_step[s->index];
+  int32_t diff = (int32_t)sample - s->predictor;
+  uint8_t code = 0;
+
+  if (diff < 0)
+  {
+    code = 8;
+    diff = -diff;
+  }
+  if (diff >= step) { code |= 4; diff -= step; }
+  step >>= 1;
+  if (diff >= step) { code |= 2; diff -= step; }
+  step >>= 1;
+  if (diff >= step) code |= 1;
+
+  // Follow the decoder exactly so both stay in step
+  Adpcm_Step(s, code);
+  return code;
+}
+
+void Looper_Encode_Block(AdpcmState_t *state, const int16_t *in, uint8_t *block,
+                         uint16_t offset, uint16_t count)
+{
+  uint8_t *codes = block + LOOP_BLOCK_HEADER;
+
+  if (offset == 0)
+  {
+    block[0] = (uint8_t)((uint16_t)state->predictor & 0xFFU);
+    block[1] = (uint8_t)((uint16_t)state->predictor >> 8);
+    block[2] = state->index;
+  }
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint16_t n = offset + i;
+    uint8_t code = Adpcm_Encode(state, in[i]);
+    if (n & 1U) codes[n >> 1] = (uint8_t)((codes[n >> 1] & 0x0FU) | (code << 4));
+    else codes[n >> 1] = (uint8_t)((codes[n >> 1] & 0xF0U) | code);
+  }
+}
+
+void Looper_Decode_Block(AdpcmState_t *state, const uint8_t *block, int16_t *out,
+                         uint16_t offset, uint16_t count)
+{
+  const uint8_t *codes = block + LOOP_BLOCK_HEADER;
+
+  if (offset == 0)
+  {
+    state->predictor = (int16_t)((uint16_t)block[0] | ((uint16_t)block[1] << 8));
+    state->index = (block[2] > 88) ? 88 : block[2];
+  }
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint16_t n = offset + i;
+    uint8_t code = (n & 1U) ? (codes[n >> 1] >> 4) : (codes[n >> 1] & 0x0FU);
+    out[i] = Adpcm_Step(state, code);
+  }
+}
+
+void Looper_Init(void)
+{
+  memset(loop_out, 0, sizeof(loop_out));
+  looper.state = LOOP_CLEAR;
+}
+
+float32_t Looper_Seconds(uint32_t samples)
+{
+  return (float32_t)samples * LOOP_DECIMATION / sample_rate_hz;
+}
+
+/**
+  * @brief  delay_buffer samples a new loop may take (loop slice released)
+  */
+static uint32_t Looper_Space(void)
+{
+  uint32_t echo = delay_effect.enabled ? delay_effect.delay_samples : 0;
+  uint32_t available = DelayMem_Available(DELAY_MEM_LOOP);
+  uint32_t keep;
+
+  if (delay_effect.pingpong) echo *= 2;
+  keep = (echo > DELAY_MEM_ECHO_MIN) ? echo - DELAY_MEM_ECHO_MIN : 0;
+  if (delay_mem[DELAY_MEM_MOD].length == 0) keep += MOD_LINE_SAMPLES;
+  if (available >= keep + LOOP_RESERVE_SAMPLES) return available - keep;
+  // A long echo would leave nothing: take the reserve from its line
+  return (available > LOOP_RESERVE_SAMPLES) ? LOOP_RESERVE_SAMPLES : available;
+}
+
+/**
+  * @brief  Loop samples held, or that LOOP:REC would get right now
+  */
+uint32_t Looper_Capacity(void)
+{
+  uint32_t blocks = looper.blocks;
+
+  if (looper.state == LOOP_CLEAR)
+  {
+    blocks = (Looper_Space() * sizeof(int16_t)) / LOOP_BLOCK_BYTES;
+  }
+  return blocks * LOOP_BLOCK_SAMPLES;
+}
+
+/**
+  * @brief  Move the looper to LOOP_REC, LOOP_PLAY, LOOP_OVERDUB or LOOP_CLEAR
+  * @note   Main loop only. REC always starts a new loop in what
+  *         delay_buffer can spare (Looper_Space).
+  * @retval 1 if accepted, 0 if there is no loop to play/overdub or no memory
+  */
+uint8_t Looper_Command(uint8_t state)
+{
+  uint32_t samples;
+
+  switch (state)
+  {
+    case LOOP_REC:
+      looper.state = LOOP_CLEAR;
+      DelayMem_Release(DELAY_MEM_LOOP);
+      samples = Looper_Space();
+      looper.blocks = (uint16_t)((samples * sizeof(int16_t)) / LOOP_BLOCK_BYTES);
+      if (looper.blocks == 0) return 0;
+      if (!DelayMem_Request(DELAY_MEM_LOOP, (looper.blocks * LOOP_BLOCK_BYTES + 1) / 2)) return 0;
+      memset(loop_out, 0, sizeof(loop_out));
+      memset(&loop_enc, 0, sizeof(loop_enc));
+      loop_out_decoded = 0;
+      looper.length = 0;
+      looper.position = 0;
+      looper.state = LOOP_REC;
+      return 1;
+
+    case LOOP_PLAY:
+      if (looper.state == LOOP_REC)
+      {
+        if (looper.position == 0) return 0;
+        looper.length = looper.position;
+        looper.position = 0;
+      }
+      else if (looper.state == LOOP_CLEAR)
+      {
+        return 0;
+      }
+      looper.state = LOOP_PLAY;
+      return 1;
+
+    case LOOP_OVERDUB:
+      if (looper.state == LOOP_REC)
+      {
+        if (looper.position == 0) return 0;
+        looper.length = looper.position;
+        looper.position = 0;
+      }
+      else if (looper.state == LOOP_CLEAR)
+      {
+        return 0;
+      }
+      loop_enc_synced = 0;
+      looper.state = LOOP_OVERDUB;
+      return 1;
+
+    case LOOP_CLEAR:
+      looper.state = LOOP_CLEAR;
+      looper.length = 0;
+      looper.position = 0;
+      DelayMem_Release(DELAY_MEM_LOOP);
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+/**
+  * @brief  Decimate the sample for the block path and add the loop playback
+  * @note   Called from the TIM1 interrupt before buffer_index advances
+  */
+float32_t Apply_Looper(float32_t input)
+{
+  uint16_t slot, phase;
+  float32_t next, played;
+  int32_t q;
+
+  if (looper.state == LOOP_CLEAR) return input;
+
+  slot = buffer_index / LOOP_DECIMATION;
+  phase = buffer_index % LOOP_DECIMATION;
+  next = (float32_t)loop_out[slot] * (1.0f / 32768.0f);
+  played = loop_prev + (next - loop_prev) * (float32_t)(phase + 1) * (1.0f / LOOP_DECIMATION);
+
+  loop_acc += input;
+  if (phase == LOOP_DECIMATION - 1)
+  {
+    q = (int32_t)(loop_acc * (32768.0f / LOOP_DECIMATION));
+    if (q > 32767) q = 32767;
+    if (q < -32768) q = -32768;
+    loop_in[slot] = (int16_t)q;
+    loop_acc = 0.0f;
+    loop_prev = next;
+  }
+
+  return input + played * looper.level;
+}
+
+/**
+  * @brief  Encode/decode the decimated half the interrupt just filled
+  */
+void Looper_Process_Half(uint8_t half)
+{
+  const int16_t *in = &loop_in[half ? LOOP_HALF_SAMPLES : 0];
+  int16_t *out = &loop_out[half ? LOOP_HALF_SAMPLES : 0];
+  uint8_t *store = (uint8_t *)delay_mem[DELAY_MEM_LOOP].base;
+  uint32_t pos = looper.position;
+  uint8_t *block = &store[(pos / LOOP_BLOCK_SAMPLES) * LOOP_BLOCK_BYTES];
+  uint16_t offset = (uint16_t)(pos % LOOP_BLOCK_SAMPLES);
+  uint8_t bit = (uint8_t)(1U << half);
+  int16_t mixed[LOOP_HALF_SAMPLES];
+
+  if (looper.state == LOOP_CLEAR || delay_mem[DELAY_MEM_LOOP].length == 0) return;
+
+  if (looper.state == LOOP_REC)
+  {
+    Looper_Encode_Block(&loop_enc, in, block, offset, LOOP_HALF_SAMPLES);
+    memset(out, 0, LOOP_HALF_SAMPLES * sizeof(int16_t));
+    loop_out_decoded &= (uint8_t)~bit;
+    pos += LOOP_HALF_SAMPLES;
+    // Memory full: close the loop and play it
+    if (pos >= (uint32_t)looper.blocks * LOOP_BLOCK_SAMPLES)
+    {
+      looper.length = pos;
+      pos = 0;
+      looper.state = LOOP_PLAY;
+    }
+    looper.position = pos;
+    return;
+  }
+
+  // out still holds the chunk the interrupt played while in was recorded,
+  // two halves back; right after REC it holds silence and is skipped
+  if (looper.state == LOOP_OVERDUB && (loop_out_decoded & bit))
+  {
+    uint32_t back = (2U * LOOP_HALF_SAMPLES) % looper.length;
+    uint32_t wpos = (pos + looper.length - back) % looper.length;
+    uint8_t *wblock = &store[(wpos / LOOP_BLOCK_SAMPLES) * LOOP_BLOCK_BYTES];
+
+    // Mid-block entry: continue from the state the decoder had there
+    if (!loop_enc_synced)
+    {
+      loop_enc = loop_dec_before[half];
+      loop_enc_synced = 1;
+    }
+    for (uint16_t i = 0; i < LOOP_HALF_SAMPLES; i++)
+    {
+      int32_t sum = (int32_t)out[i] + in[i];
+      if (sum > 32767) sum = 32767;
+      if (sum < -32768) sum = -32768;
+      mixed[i] = (int16_t)sum;
+    }
+    Looper_Encode_Block(&loop_enc, mixed, wblock, (uint16_t)(wpos % LOOP_BLOCK_SAMPLES), LOOP_HALF_SAMPLES);
+  }
+
+  loop_dec_before[half] = loop_dec;
+  Looper_Decode_Block(&loop_dec, block, out, offset, LOOP_HALF_SAMPLES);
+  loop_out_decoded |= bit;
+
+  pos += LOOP_HALF_SAMPLES;
+  if (pos >= looper.length) pos = 0;
+  looper.position = pos;
+}
@@ -32,7 +32,21 @@
 #include "dsp_core.h"
 #include "effects.h"
 #include "uart_comm.h"
+#include "telemetry.h"
+#include "scope.h"
+#include "crc32.h"
+#include "reverb.h"
+#include "cabinet.h"
+#include "eq.h"
+#include "delay_mem.h"
+#include "modulation.h"
+#include "compressor.h"
+#include "tuner.h"
+#include "governor.h"
+#include "sample_rate.h"
+#include "looper.h"
 #include "io.h"
+#include "dac_out.h"
 /* USER CODE END Includes */
 
 /*
@@ -215,36 +229,58 @@ int main(void)
   MX_TIM1_Init();
   MX_USART2_UART_Init();
   MX_USART3_UART_Init();
+  CRC32_Init();
+  SampleRate_Init();  // rate-dependent setup below needs sample_rate_hz
+  DSP_Cycle_Counter_Init();
+  DSP_Flush_To_Zero_Init();
+  Reverb_Init();
+  Cabinet_Init();
+  EQ_Init();
+  DelayMem_Init();
+  Modulation_Init();
+  Compressor_Init();
+  Looper_Init();
+  Governor_Init();
 
   // Start DAC and OPAMP
-  HAL_DAC_Start(&hdac1, DAC_CHANNEL_1);
   HAL_OPAMP_Start(&hopamp1);
 
   TIM1_Config_For_Sampling();
+  DacOut_Start();
   HAL_TIM_Base_Start_IT(&htim1);
 
   HAL_UART_Receive_IT(&huart3, &uart_rx_byte, 1);
 
+  uint32_t blink_tick = HAL_GetTick();
+
   while (1)
   {
-    if (uart_command_ready)
+    // Lines after a SETALL wait for its swap: they would read (HASH?)
+    // or change (VOL:, ...) the state it is about to replace
+    while (!Effects_Params_Pending() && UART_Take_Line())
     {
       Parse_UART_Command();
-      uart_command_ready = 0;
     }
 
     if (process_audio_flag)
     {
-      Process_Guitar_Signal();
       process_audio_flag = 0;
+      Process_Guitar_Signal();
     }
 
-    if (command_blink_counter)
+    Telemetry_Process();
+    Scope_Process();
+    Tuner_Process();
+
+#if !DAC_DUAL_OUTPUT
+    // Blink without blocking: a HAL_Delay here would hold up the block work
+    if (command_blink_counter && HAL_GetTick() - blink_tick >= 50)
     {
-      HAL_Delay(50);
+      blink_tick = HAL_GetTick();
       HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);
       command_blink_counter--;
     }
+#endif
   }
 }
 
@@ -0,0 +1,179 @@
+/* modulation.c
+ * Modulated-delay effects processed in half-buffer blocks
+ *
+ * The main loop writes each finished half into the line and reads it
+ * back at the swept delay with linear interpolation; the interrupt mixes
+ * that wet half in BUFFER_SIZE samples later. For chorus and vibrato the
+ * sweep is computed BUFFER_SIZE samples short so the audible delay is
+ * exactly the mode's range, which is why those ranges start above
+ * BUFFER_SIZE. The flanger needs to sweep down to a fraction of a
+ * millisecond, so its block renders the dry signal as well and the
+ * interrupt plays the whole mix one block late: dry, tap and feedback
+ * then line up at the swept delay, at the cost of BUFFER_SIZE samples
+ * of latency while it is on.
+ *
+ * The LFO is a sine table walked by a 32-bit phase accumulator: the top
+ * MOD_LFO_TABLE_BITS bits pick the entry, the next 16 interpolate.
+ *
+ * Cost: table step, one interpolated line read and one Q15 store per
+ * sample, kept under MOD_CYCLE_BUDGET cycles/sample on the target so a
+ * mode can run next to the overdrive; MOD? reports the measured figure.
+ */
+
+#include "main.h"
+#include "modulation.h"
+#include "delay_mem.h"
+#include <math.h>
+#include <string.h>
+
+/* Sweep centre and half-width per mode, milliseconds */
+static const float32_t mod_center_ms[4] = { 0.0f, 14.0f, 2.6f, 6.0f };
+static const float32_t mod_width_ms[4] = { 0.0f, 5.0f, 2.4f, 3.0f };
+
+static int16_t mod_lfo_table[MOD_LFO_TABLE_SIZE + 1];
+
+// Shared with the audio interrupt (one half each at any time)
+static int16_t mod_in[BUFFER_SIZE];
+static int16_t mod_wet[BUFFER_SIZE];
+
+Modulation_t modulation = {
+  .mode = MOD_OFF,
+  .rate_hz = 0.8f,
+  .depth = 0.5f,
+  .mix = 0.5f,
+  .feedback = 0.0f
+};
+
+static inline int16_t Mod_Q15_Sat(float32_t x)
+{
+  int32_t v = (int32_t)(x * 32768.0f);
+  if (v > 32767) v = 32767;
+  if (v < -32768) v = -32768;
+  return (int16_t)v;
+}
+
+void Modulation_Init(void)
+{
+  for (uint32_t i = 0; i <= MOD_LFO_TABLE_SIZE; i++)
+  {
+    mod_lfo_table[i] = Mod_Q15_Sat(0.99997f * sinf(2.0f * PI * (float32_t)i / MOD_LFO_TABLE_SIZE));
+  }
+  memset(mod_wet, 0, sizeof(mod_wet));
+}
+
+/**
+  * @brief  Select a mode (or MOD_OFF) and its parameters
+  * @note   Main loop only; takes or returns the slice of delay_buffer
+  * @retval 1 if accepted, 0 if out of range or no memory
+  */
+uint8_t Modulation_Set(uint8_t mode, float32_t rate_hz, float32_t depth, float32_t mix, float32_t feedback)
+{
+  if (mode > MOD_VIBRATO) return 0;
+  if (rate_hz < 0.05f || rate_hz > 10.0f) return 0;
+  if (depth < 0.0f || depth > 1.0f || mix < 0.0f || mix > 1.0f) return 0;
+  if (feedback < 0.0f || feedback > 0.9f) return 0;
+
+  if (mode == MOD_OFF)
+  {
+    modulation.mode = MOD_OFF;
+    DelayMem_Release(DELAY_MEM_MOD);
+  }
+  else if (modulation.mode == MOD_OFF)
+  {
+    if (!DelayMem_Request(DELAY_MEM_MOD, MOD_LINE_SAMPLES)) return 0;
+    modulation.write_pos = 0;
+    memset(mod_wet, 0, sizeof(mod_wet));
+  }
+
+  modulation.rate_hz = rate_hz;
+  modulation.depth = depth;
+  modulation.mix = mix;
+  modulation.feedback = (mode == MOD_FLANGER) ? feedback : 0.0f;
+  modulation.phase_inc = (uint32_t)(rate_hz / sample_rate_hz * 4294967296.0f);
+  modulation.mode = mode;
+  return 1;
+}
+
+/**
+  * @brief  Render the wet signal for one block
+  * @param  in: Q15 input block
+  * @param  wet: Q15 wet block (flanger: dry and wet mixed), read by the
+  *         interrupt BUFFER_SIZE samples later
+  */
+void Modulation_Process_Block(const int16_t *in, int16_t *wet, uint16_t length)
+{
+  int16_t *line = delay_mem[DELAY_MEM_MOD].base;
+  uint32_t span = delay_mem[DELAY_MEM_MOD].length;
+  float32_t ms_to_samples = sample_rate_hz / 1000.0f;
+  uint8_t flanger = (modulation.mode == MOD_FLANGER);
+  float32_t center = mod_center_ms[modulation.mode] * ms_to_samples - (flanger ? 0.0f : (float32_t)BUFFER_SIZE);
+  float32_t width = mod_width_ms[modulation.mode] * modulation.depth * ms_to_samples;
+  float32_t feedback = modulation.feedback;
+  float32_t mix = modulation.mix;
+  uint32_t phase = modulation.phase;
+  uint32_t inc = modulation.phase_inc;
+  uint32_t pos = modulation.write_pos;
+  float32_t last = 0.0f;
+
+  if (span == 0) return;
+  // At high rates the sweep can outgrow the line: keep the read behind the block
+  if (center + width > (float32_t)(span - length - 2))
+  {
+    center = (float32_t)(span - length - 2) - width;
+  }
+  if (center - width < 1.0f)
+  {
+    if (width > (float32_t)(span - length - 4) / 2.0f) width = (float32_t)(span - length - 4) / 2.0f;
+    center = width + 1.0f;
+  }
+
+  for (uint16_t i = 0; i < length; i++)
+  {
+    uint32_t idx = phase >> (32 - MOD_LFO_TABLE_BITS);
+    float32_t frac = (float32_t)((phase >> (16 - MOD_LFO_TABLE_BITS)) & 0xFFFFU) * (1.0f / 65536.0f);
+    float32_t a = mod_lfo_table[idx];
+    float32_t lfo = (a + ((float32_t)mod_lfo_table[idx + 1] - a) * frac) * (1.0f / 32768.0f);
+    phase += inc;
+
+    // Read position behind the write head, split into whole and fraction
+    float32_t d = center + width * lfo;
+    uint32_t whole = (uint32_t)d;
+    float32_t f = d - (float32_t)whole;
+    uint32_t r0 = (pos >= whole) ? pos - whole : pos + span - whole;
+    uint32_t r1 = (r0 == 0) ? span - 1 : r0 - 1;
+    float32_t s0 = line[r0];
+    last = (s0 + ((float32_t)line[r1] - s0) * f) * (1.0f / 32768.0f);
+
+    float32_t dry = (float32_t)in[i] * (1.0f / 32768.0f);
+    line[pos] = Mod_Q15_Sat(dry + last * feedback);
+    wet[i] = Mod_Q15_Sat(flanger ? dry * (1.0f - mix) + last * mix : last);
+    if (++pos >= span) pos = 0;
+  }
+
+  modulation.phase = phase;
+  modulation.write_pos = pos;
+}
+
+/**
+  * @brief  Hand the sample to the block path and mix the wet signal
+  * @note   Called from the TIM1 interrupt before buffer_index advances
+  */
+float32_t Apply_Modulation(float32_t input)
+{
+  float32_t wet;
+
+  if (modulation.mode == MOD_OFF) return input;
+
+  mod_in[buffer_index] = Mod_Q15_Sat(input);
+  wet = (float32_t)mod_wet[buffer_index] * (1.0f / 32768.0f);
+  if (modulation.mode != MOD_CHORUS) return wet;
+  return input * (1.0f - modulation.mix) + wet * modulation.mix;
+}
+
+void Modulation_Process_Half(uint8_t half)
+{
+  uint16_t offset = half ? (BUFFER_SIZE / 2) : 0;
+
+  if (modulation.mode == MOD_OFF) return;
+  Modulation_Process_Block(&mod_in[offset], &mod_wet[offset], BUFFER_SIZE / 2);
+}
@@ -4,6 +4,7 @@
 
 #include "main.h"
 #include "peripherals.h"
+#include "sample_rate.h"
 
 /**
   * @brief ADC1 Initialization Function
@@ -81,6 +82,13 @@ void MX_DAC1_Init(void)
   {
     Error_Handler();
   }
+#if DAC_DUAL_OUTPUT
+  // Second output, loaded together with channel 1 through DHR12RD (dac_out.c)
+  if (HAL_DAC_ConfigChannel(&hdac1, &sConfig, DAC_CHANNEL_2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif
 }
 
 /**
@@ -214,6 +222,10 @@ void MX_GPIO_Init(void)
   __HAL_RCC_GPIOF_CLK_ENABLE();
   __HAL_RCC_GPIOA_CLK_ENABLE();
 
+#if DAC_DUAL_OUTPUT
+  // PA5 is DAC1_OUT2 (HAL_DAC_MspInit), not the LED
+  (void)GPIO_InitStruct;
+#else
   HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);
 
   GPIO_InitStruct.Pin = GPIO_PIN_5;
@@ -221,17 +233,19 @@ void MX_GPIO_Init(void)
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+#endif
 }
 
 /**
-  * @brief  Configure Timer1 for audio sampling rate (48kHz)
+  * @brief  Configure Timer1 for the audio sample rate
+  * @note   Period comes from SampleRate_Init (timer clock / rate, rounded)
   */
 void TIM1_Config_For_Sampling(void)
 {
   htim1.Instance = TIM1;
   htim1.Init.Prescaler = 0;
   htim1.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim1.Init.Period = 3541;  // 48kHz sampling rate
+  htim1.Init.Period = sample_rate.period;
   htim1.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim1.Init.RepetitionCounter = 0;
   htim1.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
@@ -0,0 +1,225 @@
+/* presets.c
+ * Flash preset storage
+ *
+ * Records are appended to the active bank; a load takes the newest valid
+ * record for the slot from either bank. When the active bank is full, the
+ * other bank is erased and the newest record of every slot is copied over
+ * before the new one is appended, so each page is erased only once per
+ * (records per bank - PRESET_SLOTS) saves.
+ *
+ * Note: the G431 has a single flash bank, so code fetches (including the
+ * audio interrupt) stall whenever the flash is busy. Every save glitches:
+ * each of the 16 double words of a record holds the interrupt off for the
+ * programming time (about 82 us, four samples at 48 kHz). A save that
+ * triggers a bank swap also erases pages (about 22 ms each), a clear
+ * dropout. Loads never touch the flash controller.
+ */
+
+#include "main.h"
+#include "presets.h"
+#include "crc32.h"
+#include <stddef.h>
+#include <string.h>
+
+#define RECORDS_PER_BANK (PRESET_BANK_SIZE / PRESET_RECORD_SIZE)
+
+typedef char preset_record_size_check[(sizeof(PresetRecord_t) == PRESET_RECORD_SIZE) ? 1 : -1];
+
+static uint32_t Record_Address(uint8_t bank, uint32_t index)
+{
+  return PRESET_FLASH_BASE + bank * PRESET_BANK_SIZE + index * PRESET_RECORD_SIZE;
+}
+
+static const PresetRecord_t *Record_At(uint8_t bank, uint32_t index)
+{
+  return (const PresetRecord_t*)(uintptr_t)Record_Address(bank, index);
+}
+
+static uint32_t Record_Crc(const PresetRecord_t *rec)
+{
+  return CRC32_Calculate(rec, offsetof(PresetRecord_t, crc));
+}
+
+static uint8_t Record_Valid(const PresetRecord_t *rec)
+{
+  if (rec->magic != PRESET_MAGIC) return 0;
+  if (rec->version != PRESET_VERSION || rec->size != sizeof(EffectParams_t)) return 0;
+  if (rec->slot >= PRESET_SLOTS) return 0;
+  return Record_Crc(rec) == rec->crc;
+}
+
+static uint8_t Record_Erased(const PresetRecord_t *rec)
+{
+  const uint32_t *words = (const uint32_t*)rec;
+  for (uint32_t i = 0; i < PRESET_RECORD_SIZE / 4; i++)
+  {
+    if (words[i] != 0xFFFFFFFFU) return 0;
+  }
+  return 1;
+}
+
+/* Newest valid record for a slot across both banks, or NULL */
+static const PresetRecord_t *Find_Latest(uint8_t slot)
+{
+  const PresetRecord_t *best = NULL;
+
+  for (uint8_t bank = 0; bank < 2; bank++)
+  {
+    for (uint32_t i = 0; i < RECORDS_PER_BANK; i++)
+    {
+      const PresetRecord_t *rec = Record_At(bank, i);
+      if (rec->magic == 0xFFFFFFFFU) break;  // rest of the bank is erased
+      if (rec->slot == slot && Record_Valid(rec) && (best == NULL || rec->seq > best->seq))
+      {
+        best = rec;
+      }
+    }
+  }
+  return best;
+}
+
+/* Bank holding the newest record and the highest sequence number seen */
+static uint8_t Find_Active_Bank(uint32_t *max_seq)
+{
+  uint8_t active = 0;
+  *max_seq = 0;
+
+  for (uint8_t bank = 0; bank < 2; bank++)
+  {
+    for (uint32_t i = 0; i < RECORDS_PER_BANK; i++)
+    {
+      const PresetRecord_t *rec = Record_At(bank, i);
+      if (rec->magic == 0xFFFFFFFFU) break;
+      if (Record_Valid(rec) && rec->seq > *max_seq)
+      {
+        *max_seq = rec->seq;
+        active = bank;
+      }
+    }
+  }
+  return active;
+}
+
+static uint8_t Program_Record(uint32_t address, const PresetRecord_t *rec)
+{
+  const uint8_t *src = (const uint8_t*)rec;
+  uint64_t dword;
+
+  for (uint32_t offset = 0; offset < PRESET_RECORD_SIZE; offset += 8)
+  {
+    memcpy(&dword, src + offset, 8);
+    if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address + offset, dword) != HAL_OK)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static uint8_t Erase_Bank(uint8_t bank)
+{
+  FLASH_EraseInitTypeDef erase = {0};
+  uint32_t page_error = 0;
+
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.Banks = FLASH_BANK_1;
+  erase.Page = (PRESET_FLASH_BASE + bank * PRESET_BANK_SIZE - FLASH_BASE) / FLASH_PAGE_SIZE;
+  erase.NbPages = PRESET_BANK_PAGES;
+  return HAL_FLASHEx_Erase(&erase, &page_error) == HAL_OK;
+}
+
+/**
+  * @brief  Store the live effect state in a slot
+  * @retval 1 on success, 0 on invalid slot or flash error
+  */
+uint8_t Preset_Save(uint8_t slot)
+{
+  PresetRecord_t rec;
+  uint32_t max_seq;
+  uint8_t active;
+  uint32_t index;
+  uint8_t ok = 1;
+
+  if (slot >= PRESET_SLOTS) return 0;
+
+  memset(&rec, 0xFF, sizeof(rec));
+  rec.magic = PRESET_MAGIC;
+  rec.slot = slot;
+  rec.version = PRESET_VERSION;
+  rec.size = sizeof(EffectParams_t);
+  Effects_Get_Params(&rec.params);
+
+  active = Find_Active_Bank(&max_seq);
+  rec.seq = max_seq + 1;
+  rec.crc = Record_Crc(&rec);
+
+  for (index = 0; index < RECORDS_PER_BANK; index++)
+  {
+    if (Record_Erased(Record_At(active, index))) break;
+  }
+
+  HAL_FLASH_Unlock();
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+  if (index >= RECORDS_PER_BANK)
+  {
+    // Active bank full: compact the newest record of every other slot
+    uint8_t target = active ^ 1;
+    ok = Erase_Bank(target);
+    index = 0;
+    for (uint8_t s = 0; ok && s < PRESET_SLOTS; s++)
+    {
+      const PresetRecord_t *latest;
+      if (s == slot) continue;
+      latest = Find_Latest(s);
+      if (latest != NULL)
+      {
+        PresetRecord_t copy = *latest;
+        ok = Program_Record(Record_Address(target, index), &copy);
+        index++;
+      }
+    }
+    active = target;
+  }
+
+  if (ok)
+  {
+    ok = Program_Record(Record_Address(active, index), &rec);
+  }
+
+  HAL_FLASH_Lock();
+  return ok;
+}
+
+/**
+  * @brief  Queue a stored preset for the next block boundary
+  * @retval 1 on success, 0 if the slot is empty or its record is invalid
+  */
+uint8_t Preset_Load(uint8_t slot)
+{
+  const PresetRecord_t *rec;
+
+  if (slot >= PRESET_SLOTS) return 0;
+  rec = Find_Latest(slot);
+  if (rec == NULL) return 0;
+  if (!Effects_Validate_Params(&rec->params)) return 0;
+
+  Effects_Queue_Params(&rec->params);
+  // Records hold samples only: keep the echo time they meant at this rate
+  delay_effect.time_ms = (float32_t)rec->params.dly_samples * 1000.0f / sample_rate_hz;
+  return 1;
+}
+
+/**
+  * @brief  Bit n set when slot n holds a valid preset
+  */
+uint32_t Preset_List(void)
+{
+  uint32_t mask = 0;
+
+  for (uint8_t slot = 0; slot < PRESET_SLOTS; slot++)
+  {
+    if (Find_Latest(slot) != NULL) mask |= (1U << slot);
+  }
+  return mask;
+}
@@ -0,0 +1,274 @@
+/* reverb.c
+ * Q15 comb/allpass reverb processed in half-buffer blocks
+ *
+ * Line lengths start from the Freeverb tunings (rescaled to 48 kHz), are
+ * scaled down together until their sum fits REVERB_RAM_BYTES and are then
+ * rounded down to distinct primes so the combs never echo in step.
+ *
+ * The timer interrupt only stores the delay output into reverb_in[] and
+ * mixes reverb_wet[] back in; the combs and allpasses run from the main
+ * loop on the half the interrupt has just finished. The wet path is
+ * therefore BUFFER_SIZE samples late, which is inaudible as pre-delay.
+ *
+ * Cost: a comb step is a Q15 load, the damping low-pass, a saturating
+ * Q15 store and the wrap check; an allpass step is a little less. The
+ * measured figure on the target is reported by RVB? in cycles/sample.
+ *
+ * The block engine has no HAL dependency so host/reverb_tune builds it.
+ */
+
+#include "main.h"
+#include "reverb.h"
+#include <math.h>
+#include <string.h>
+
+#define Q15_SCALE 32768.0f
+
+/* Input attenuation into the comb bank and allpass coefficient */
+#define REVERB_INPUT_GAIN 0.2f
+#define REVERB_ALLPASS_FEEDBACK 0.5f
+#define REVERB_WET_GAIN 1.5f
+
+static const uint16_t comb_base[REVERB_COMBS] = { 1215, 1293, 1390, 1476 };
+static const uint16_t allpass_base[REVERB_ALLPASSES] = { 605, 480 };
+
+static int16_t reverb_pool[REVERB_RAM_BYTES / sizeof(int16_t)];
+
+// Shared with the audio interrupt (one half each at any time)
+static int16_t reverb_in[BUFFER_SIZE];
+static int16_t reverb_wet[BUFFER_SIZE];
+
+Reverb_t reverb = {
+  .room_size = 0.5f,
+  .damping = 0.5f,
+  .mix = 0.25f,
+  .enabled = 0,
+  .active_combs = REVERB_COMBS
+};
+
+static uint8_t Is_Prime(uint16_t n)
+{
+  if (n < 2) return 0;
+  if ((n & 1U) == 0) return n == 2;
+  for (uint32_t d = 3; d * d <= n; d += 2)
+  {
+    if (n % d == 0) return 0;
+  }
+  return 1;
+}
+
+static uint16_t Prime_At_Or_Below(uint16_t n, const uint16_t *taken, uint8_t count)
+{
+  while (n > 2)
+  {
+    uint8_t used = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (taken[i] == n) used = 1;
+    }
+    if (!used && Is_Prime(n)) return n;
+    n--;
+  }
+  return 2;
+}
+
+static inline int16_t To_Q15_Sat(float32_t x)
+{
+  int32_t v = (int32_t)(x * Q15_SCALE);
+  if (v > 32767) v = 32767;
+  if (v < -32768) v = -32768;
+  return (int16_t)v;
+}
+
+static void Assign_Line(ReverbLine_t *line, uint16_t base, uint32_t capacity, uint32_t base_total,
+                        uint16_t *lengths, uint8_t *count, int16_t **next)
+{
+  uint32_t scaled = base;
+  if (capacity < base_total)
+  {
+    scaled = ((uint32_t)base * capacity) / base_total;
+  }
+  lengths[*count] = Prime_At_Or_Below((uint16_t)scaled, lengths, *count);
+  line->buf = *next;
+  line->length = lengths[*count];
+  *next += lengths[*count];
+  (*count)++;
+}
+
+/**
+  * @brief  Size the delay lines to the RAM budget and clear them
+  */
+void Reverb_Init(void)
+{
+  uint32_t base_total = 0;
+  uint32_t capacity = REVERB_RAM_BYTES / sizeof(int16_t);
+  uint16_t lengths[REVERB_COMBS + REVERB_ALLPASSES];
+  uint8_t count = 0;
+  int16_t *next = reverb_pool;
+  uint8_t i;
+
+  for (i = 0; i < REVERB_COMBS; i++) base_total += comb_base[i];
+  for (i = 0; i < REVERB_ALLPASSES; i++) base_total += allpass_base[i];
+
+  for (i = 0; i < REVERB_COMBS; i++)
+  {
+    Assign_Line(&reverb.comb[i], comb_base[i], capacity, base_total, lengths, &count, &next);
+  }
+  for (i = 0; i < REVERB_ALLPASSES; i++)
+  {
+    Assign_Line(&reverb.allpass[i], allpass_base[i], capacity, base_total, lengths, &count, &next);
+  }
+
+  Reverb_Clear();
+  Reverb_Set_Params(reverb.room_size, reverb.damping, reverb.mix);
+}
+
+void Reverb_Set_Params(float32_t room_size, float32_t damping, float32_t mix)
+{
+  reverb.room_size = room_size;
+  reverb.damping = damping;
+  reverb.mix = mix;
+  // Tunings are per sample at SAMPLE_RATE; keep the decay time at other rates
+  float32_t per_sample = (float32_t)SAMPLE_RATE / sample_rate_hz;
+  reverb.feedback = powf(0.70f + room_size * 0.28f, per_sample);
+  reverb.damp_pole = powf(damping * 0.4f, per_sample);
+}
+
+/**
+  * @brief  Run only the first combs (shorter, thinner tail), used by the governor
+  * @note   Main loop only; combs rejoining the bank start from silence
+  */
+void Reverb_Set_Active_Combs(uint8_t combs)
+{
+  if (combs < 1) combs = 1;
+  if (combs > REVERB_COMBS) combs = REVERB_COMBS;
+
+  for (uint8_t i = reverb.active_combs; i < combs; i++)
+  {
+    memset(reverb.comb[i].buf, 0, reverb.comb[i].length * sizeof(int16_t));
+    reverb.comb[i].filter_state = 0.0f;
+  }
+  reverb.active_combs = combs;
+}
+
+void Reverb_Clear(void)
+{
+  uint8_t i;
+  memset(reverb_pool, 0, sizeof(reverb_pool));
+  memset(reverb_wet, 0, sizeof(reverb_wet));
+  for (i = 0; i < REVERB_COMBS; i++)
+  {
+    reverb.comb[i].index = 0;
+    reverb.comb[i].filter_state = 0.0f;
+  }
+  for (i = 0; i < REVERB_ALLPASSES; i++)
+  {
+    reverb.allpass[i].index = 0;
+  }
+}
+
+uint32_t Reverb_Memory_Used(void)
+{
+  uint32_t samples = 0;
+  uint8_t i;
+  for (i = 0; i < REVERB_COMBS; i++) samples += reverb.comb[i].length;
+  for (i = 0; i < REVERB_ALLPASSES; i++) samples += reverb.allpass[i].length;
+  return samples * sizeof(int16_t);
+}
+
+/**
+  * @brief  Render the reverb tail for one block (comb-major, then allpass-major)
+  * @param  in: Q15 input block
+  * @param  wet: Q15 output block, may not alias in
+  * @param  length: samples in the block
+  */
+void Reverb_Process_Block(const int16_t *in, int16_t *wet, uint16_t length)
+{
+  float32_t acc[BUFFER_SIZE / 2];
+  float32_t damp = reverb.damp_pole;
+  float32_t damp_inv = 1.0f - damp;
+  float32_t feedback = reverb.feedback;
+  float32_t input_gain = REVERB_INPUT_GAIN / Q15_SCALE;
+  uint8_t combs = reverb.active_combs;
+  // Comb outputs are roughly uncorrelated: keep the wet power when combs drop
+  float32_t wet_gain = REVERB_WET_GAIN * sqrtf((float32_t)REVERB_COMBS / (float32_t)combs);
+  uint16_t done = 0;
+
+  // Work in chunks of the scratch size so the host tool can pass any length
+  while (done < length)
+  {
+    uint16_t n = length - done;
+    uint16_t i;
+    uint8_t k;
+    if (n > BUFFER_SIZE / 2) n = BUFFER_SIZE / 2;
+
+    memset(acc, 0, n * sizeof(float32_t));
+
+    for (k = 0; k < combs; k++)
+    {
+      ReverbLine_t *line = &reverb.comb[k];
+      int16_t *buf = line->buf;
+      uint16_t idx = line->index;
+      uint16_t len = line->length;
+      float32_t store = line->filter_state;
+
+      for (i = 0; i < n; i++)
+      {
+        float32_t out = (float32_t)buf[idx] / Q15_SCALE;
+        store = out * damp_inv + store * damp;
+        acc[i] += out;
+        buf[idx] = To_Q15_Sat((float32_t)in[done + i] * input_gain + store * feedback);
+        if (++idx >= len) idx = 0;
+      }
+      line->index = idx;
+      line->filter_state = store;
+    }
+
+    for (k = 0; k < REVERB_ALLPASSES; k++)
+    {
+      ReverbLine_t *line = &reverb.allpass[k];
+      int16_t *buf = line->buf;
+      uint16_t idx = line->index;
+      uint16_t len = line->length;
+
+      for (i = 0; i < n; i++)
+      {
+        float32_t delayed = (float32_t)buf[idx] / Q15_SCALE;
+        float32_t x = acc[i];
+        acc[i] = delayed - x;
+        buf[idx] = To_Q15_Sat(x + delayed * REVERB_ALLPASS_FEEDBACK);
+        if (++idx >= len) idx = 0;
+      }
+      line->index = idx;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      wet[done + i] = To_Q15_Sat(acc[i] * wet_gain);
+    }
+    done += n;
+  }
+}
+
+/**
+  * @brief  Store the dry sample for the block engine and mix the wet tail
+  * @note   Called from the TIM1 interrupt before buffer_index advances
+  */
+float32_t Apply_Reverb(float32_t input)
+{
+  if (!reverb.enabled) return input;
+
+  reverb_in[buffer_index] = To_Q15_Sat(input);
+  return input * (1.0f - reverb.mix) + ((float32_t)reverb_wet[buffer_index] / Q15_SCALE) * reverb.mix;
+}
+
+/**
+  * @brief  Render the half of the shared buffer the interrupt just filled
+  */
+void Reverb_Process_Half(uint8_t half)
+{
+  uint16_t offset = half ? (BUFFER_SIZE / 2) : 0;
+
+  if (!reverb.enabled) return;
+  Reverb_Process_Block(&reverb_in[offset], &reverb_wet[offset], BUFFER_SIZE / 2);
+}
@@ -0,0 +1,160 @@
+/* sample_rate.c
+ * Runtime sample-rate selection
+ *
+ * TIM1 runs from the APB2 timer clock (PCLK2, doubled when APB2 is
+ * divided). The period is the nearest whole number of timer ticks, and
+ * sample_rate_hz holds the rate that period really gives: at 170 MHz,
+ * "48 kHz" is 170e6 / 3542 = 47995.5 Hz. Everything that converts time
+ * or frequency to samples uses sample_rate_hz, not the nominal rate.
+ *
+ * A change stops the timer, recomputes the rate-dependent settings of
+ * every stage, realigns the buffer halves and restarts. The output drops
+ * out for a few milliseconds. Lengths kept in samples (delay_buffer, the
+ * reverb lines, the cabinet IR) are not resized, so at 96 kHz the echo
+ * reaches half as far and a cabinet IR recorded at 48 kHz plays an
+ * octave up until one for the new rate is loaded. A recorded loop is
+ * cleared.
+ */
+
+#include "main.h"
+#include "sample_rate.h"
+#include "peripherals.h"
+#include "effects.h"
+#include "eq.h"
+#include "modulation.h"
+#include "compressor.h"
+#include "reverb.h"
+#include "governor.h"
+#include "looper.h"
+#include "dsp_core.h"
+
+const uint32_t sample_rate_table[SR_RATE_COUNT] = { 32000, 44100, 48000, 96000 };
+
+SampleRate_t sample_rate = {
+  .nominal = SAMPLE_RATE,
+  .timer_clock = 0,
+  .period = 0,
+  .auto_rate = 0,
+  .changes = 0
+};
+
+static uint32_t SampleRate_Timer_Clock(void)
+{
+  uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+
+  // Timers on a divided APB bus run at twice the bus clock
+  if (RCC->CFGR & RCC_CFGR_PPRE2_2) return 2U * pclk2;
+  return pclk2;
+}
+
+static uint32_t SampleRate_Period(uint32_t rate_hz)
+{
+  return (sample_rate.timer_clock + rate_hz / 2U) / rate_hz - 1U;
+}
+
+static uint8_t SampleRate_Valid(uint32_t rate_hz)
+{
+  for (uint8_t i = 0; i < SR_RATE_COUNT; i++)
+  {
+    if (sample_rate_table[i] == rate_hz) return 1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Derive the TIM1 period for the default rate
+  * @note   Call after SystemClock_Config and before TIM1_Config_For_Sampling
+  */
+void SampleRate_Init(void)
+{
+  sample_rate.timer_clock = SampleRate_Timer_Clock();
+  sample_rate.period = SampleRate_Period(sample_rate.nominal);
+  sample_rate_hz = (float32_t)sample_rate.timer_clock / (float32_t)(sample_rate.period + 1U);
+}
+
+/**
+  * @brief  Bring every stage in line with a new sample_rate_hz
+  */
+static void SampleRate_Recompute(void)
+{
+  // Keep the echo time, worked out from the stored ms exactly as DLY and
+  // SETALL do, so the bridge's copy of the state (and HASH?) agrees; the
+  // line itself does not grow
+  uint32_t samples = (uint32_t)((delay_effect.time_ms / 1000.0f) * sample_rate_hz);
+
+  if (samples == 0 || samples > DELAY_BUFFER_SIZE) samples = DELAY_BUFFER_SIZE;
+  delay_effect.delay_samples = samples;
+
+  EQ_Recompute();
+  if (modulation.mode != MOD_OFF)
+  {
+    Modulation_Set(modulation.mode, modulation.rate_hz, modulation.depth,
+                   modulation.mix, modulation.feedback);
+  }
+  Compressor_Set(compressor.threshold_db, compressor.ratio, compressor.attack_ms,
+                 compressor.release_ms, compressor.makeup_db);
+  Reverb_Set_Params(reverb.room_size, reverb.damping, reverb.mix);
+  Governor_Init();
+  // The loop is stored at the old rate; it would play back at the wrong pitch
+  Looper_Command(LOOP_CLEAR);
+  // Gate times and the overdrive/echo filter alphas follow sample_rate_hz
+  // on their own (effects.c)
+}
+
+/**
+  * @brief  Switch the audio path to another rate from sample_rate_table
+  * @note   Main loop only
+  * @retval 1 if the rate is supported (or already active), 0 otherwise
+  */
+uint8_t SampleRate_Set(uint32_t rate_hz)
+{
+  if (!SampleRate_Valid(rate_hz)) return 0;
+  if (rate_hz == sample_rate.nominal) return 1;
+
+  HAL_TIM_Base_Stop_IT(&htim1);
+
+  sample_rate.timer_clock = SampleRate_Timer_Clock();
+  sample_rate.period = SampleRate_Period(rate_hz);
+  sample_rate.nominal = rate_hz;
+  sample_rate.changes++;
+  sample_rate_hz = (float32_t)sample_rate.timer_clock / (float32_t)(sample_rate.period + 1U);
+
+  __HAL_TIM_SET_AUTORELOAD(&htim1, sample_rate.period);
+  __HAL_TIM_SET_COUNTER(&htim1, 0);
+
+  SampleRate_Recompute();
+
+  // Restart on a half boundary so the block stages stay aligned
+  buffer_index = 0;
+  process_audio_flag = 0;
+
+  HAL_TIM_Base_Start_IT(&htim1);
+  return 1;
+}
+
+/**
+  * @brief  Let the governor pick the rate (on), or keep the current one (off)
+  */
+void SampleRate_Set_Auto(uint8_t on)
+{
+  sample_rate.auto_rate = on ? 1 : 0;
+  if (on && sample_rate.nominal < SR_AUTO_FLOOR) SampleRate_Set(SR_AUTO_FLOOR);
+}
+
+/**
+  * @brief  Next rate up (direction > 0) or down within the SR:AUTO range
+  * @retval The rate, or 0 if already at that end of the range
+  */
+uint32_t SampleRate_Neighbour(int8_t direction)
+{
+  uint32_t best = 0;
+
+  for (uint8_t i = 0; i < SR_RATE_COUNT; i++)
+  {
+    uint32_t r = sample_rate_table[i];
+    if (r < SR_AUTO_FLOOR) continue;
+    if (direction > 0 && r > sample_rate.nominal && (best == 0 || r < best)) best = r;
+    if (direction < 0 && r < sample_rate.nominal && r > best) best = r;
+  }
+  return best;
+}
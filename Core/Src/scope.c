@@ -0,0 +1,133 @@
+/* scope.c
+ * Scope capture: the audio path only copies samples into the capture
+ * buffer, the main loop sends the finished capture as binary frames
+ */
+
+#include "main.h"
+#include "scope.h"
+#include "uart_comm.h"
+#include <string.h>
+
+/* Keep this much TX queue free for ACK lines and telemetry */
+#define SCOPE_TX_RESERVE 160
+
+Scope_t scope = {
+  .state = SCOPE_IDLE,
+  .decimation = 1
+};
+
+static int16_t scope_input[SCOPE_MAX_SAMPLES];
+static int16_t scope_output[SCOPE_MAX_SAMPLES];
+
+static int16_t Float_To_Q15(float32_t x)
+{
+  if (x >= 1.0f) return 32767;
+  if (x <= -1.0f) return -32768;
+  return (int16_t)(x * 32767.0f);
+}
+
+/**
+  * @brief  Audio interrupt side of the capture (only called while armed)
+  */
+void Scope_Capture(float32_t input, float32_t output)
+{
+  if (scope.state == SCOPE_ARMED)
+  {
+    uint8_t crossed = (scope.last_input < scope.trigger_level) && (input >= scope.trigger_level);
+    scope.last_input = input;
+    if (scope.trigger_level > 0.0f && !crossed) return;
+    scope.state = SCOPE_CAPTURING;
+    scope.decim_counter = 0;
+  }
+
+  if (scope.decim_counter == 0)
+  {
+    scope_input[scope.count] = Float_To_Q15(input);
+    scope_output[scope.count] = Float_To_Q15(output);
+    scope.count++;
+    if (scope.count >= scope.length)
+    {
+      scope.state = SCOPE_READY;
+      return;
+    }
+  }
+  scope.decim_counter++;
+  if (scope.decim_counter >= scope.decimation) scope.decim_counter = 0;
+}
+
+uint8_t Scope_Arm(uint16_t length, float32_t trigger_level, uint16_t decimation)
+{
+  if (length == 0 || length > SCOPE_MAX_SAMPLES) return 0;
+  if (decimation == 0 || decimation > SCOPE_MAX_DECIMATION) return 0;
+  if (trigger_level < 0.0f || trigger_level >= 1.0f) return 0;
+
+  // Stop the audio path from touching the buffer while it is reconfigured
+  scope.state = SCOPE_IDLE;
+  scope.length = length;
+  scope.decimation = decimation;
+  scope.trigger_level = trigger_level;
+  scope.count = 0;
+  scope.decim_counter = 0;
+  scope.last_input = 1.0f;  // requires a real rising crossing after arming
+  scope.sent = 0;
+  scope.header_sent = 0;
+  scope.state = SCOPE_ARMED;
+  return 1;
+}
+
+void Scope_Cancel(void)
+{
+  scope.state = SCOPE_IDLE;
+}
+
+/**
+  * @brief  Send the finished capture, one frame per call (main loop)
+  * @note   Frames are only queued when the TX queue has room to spare so
+  *         ACKs and telemetry are never starved by a capture dump.
+  */
+void Scope_Process(void)
+{
+  uint8_t payload[2 + SCOPE_CHUNK_SAMPLES * 4];
+  uint16_t n;
+  uint16_t i;
+
+  if (scope.state != SCOPE_READY) return;
+
+  if (!scope.header_sent)
+  {
+    ScopeHeader_t header;
+    if (UART_TX_Free() < sizeof(header) + UART_FRAME_OVERHEAD + SCOPE_TX_RESERVE) return;
+    header.samples = scope.count;
+    header.decimation = scope.decimation;
+    header.trigger_level = Float_To_Q15(scope.trigger_level);
+    header.chunk_samples = SCOPE_CHUNK_SAMPLES;
+    if (Send_UART_Frame(UART_FRAME_SCOPE_HEADER, (const uint8_t*)&header, sizeof(header)))
+    {
+      scope.header_sent = 1;
+    }
+    return;
+  }
+
+  if (scope.sent >= scope.count)
+  {
+    scope.state = SCOPE_IDLE;
+    return;
+  }
+
+  n = scope.count - scope.sent;
+  if (n > SCOPE_CHUNK_SAMPLES) n = SCOPE_CHUNK_SAMPLES;
+  if (UART_TX_Free() < 2 + n * 4 + UART_FRAME_OVERHEAD + SCOPE_TX_RESERVE) return;
+
+  // Data frame: sample offset, then interleaved input/output pairs (Q15, LE)
+  payload[0] = (uint8_t)(scope.sent & 0xFF);
+  payload[1] = (uint8_t)(scope.sent >> 8);
+  for (i = 0; i < n; i++)
+  {
+    memcpy(&payload[2 + i * 4], &scope_input[scope.sent + i], 2);
+    memcpy(&payload[4 + i * 4], &scope_output[scope.sent + i], 2);
+  }
+  if (Send_UART_Frame(UART_FRAME_SCOPE_DATA, payload, 2 + n * 4))
+  {
+    scope.sent += n;
+  }
+}
@@ -21,6 +21,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 /* USER CODE BEGIN Includes */
+#include "dac_out.h"
 
 /* USER CODE END Includes */
 
@@ -183,6 +184,11 @@ void HAL_DAC_MspInit(DAC_HandleTypeDef* hdac)
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
     /* USER CODE BEGIN DAC1_MspInit 1 */
+#if DAC_DUAL_OUTPUT
+    // PA5 ------> DAC1_OUT2
+    GPIO_InitStruct.Pin = GPIO_PIN_5;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+#endif
 
     /* USER CODE END DAC1_MspInit 1 */
 
@@ -212,6 +218,9 @@ void HAL_DAC_MspDeInit(DAC_HandleTypeDef* hdac)
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_4);
 
     /* USER CODE BEGIN DAC1_MspDeInit 1 */
+#if DAC_DUAL_OUTPUT
+    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_5);
+#endif
 
     /* USER CODE END DAC1_MspDeInit 1 */
   }
@@ -297,6 +306,27 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base)
   HAL_NVIC_SetPriority(TIM1_UP_TIM16_IRQn, 1, 0);
     HAL_NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
 
+#if DAC_DUAL_OUTPUT
+    /* TIM1_UP DMA: one word per update from the output ring to DAC1
+     * DHR12RD, both channels at once. Circular, no interrupts. */
+    __HAL_RCC_DMAMUX1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdma_tim1_up.Instance = DMA1_Channel1;
+    hdma_tim1_up.Init.Request = DMA_REQUEST_TIM1_UP;
+    hdma_tim1_up.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_tim1_up.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_tim1_up.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_tim1_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma_tim1_up.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma_tim1_up.Init.Mode = DMA_CIRCULAR;
+    hdma_tim1_up.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    if (HAL_DMA_Init(&hdma_tim1_up) != HAL_OK)
+    {
+      Error_Handler();
+    }
+    __HAL_LINKDMA(htim_base, hdma[TIM_DMA_ID_UPDATE], hdma_tim1_up);
+#endif
+
     /* USER CODE END TIM1_MspInit 1 */
 
   }
@@ -319,6 +349,9 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* htim_base)
     /* Peripheral clock disable */
     __HAL_RCC_TIM1_CLK_DISABLE();
     /* USER CODE BEGIN TIM1_MspDeInit 1 */
+#if DAC_DUAL_OUTPUT
+    HAL_DMA_DeInit(htim_base->hdma[TIM_DMA_ID_UPDATE]);
+#endif
 
     /* USER CODE END TIM1_MspDeInit 1 */
   }
@@ -0,0 +1,103 @@
+/* telemetry.c
+ * Meter accumulation across audio blocks and telemetry frame output
+ */
+
+#include "main.h"
+#include "telemetry.h"
+#include "uart_comm.h"
+#include "compressor.h"
+#include <math.h>
+#include <string.h>
+
+MeterBlock_t meter_block = {
+  .gate_gain_min = 1.0f
+};
+
+volatile uint8_t telemetry_rate_hz = 0;
+
+// Window accumulated from completed blocks until the next frame is sent
+static MeterBlock_t meter_window = {
+  .gate_gain_min = 1.0f
+};
+static uint32_t meter_window_samples = 0;
+static uint32_t telemetry_last_tick = 0;
+static uint16_t telemetry_seq = 0;
+
+static uint16_t To_Q15(float32_t x)
+{
+  if (x <= 0.0f) return 0;
+  if (x >= 1.0f) return 32767;
+  return (uint16_t)(x * 32767.0f);
+}
+
+/**
+  * @brief  Fold the finished block into the telemetry window (audio interrupt)
+  */
+void Meter_Block_End(void)
+{
+  if (meter_block.out_peak > meter_window.out_peak) meter_window.out_peak = meter_block.out_peak;
+  if (meter_block.drive_peak > meter_window.drive_peak) meter_window.drive_peak = meter_block.drive_peak;
+  if (meter_block.clip_peak > meter_window.clip_peak) meter_window.clip_peak = meter_block.clip_peak;
+  if (meter_block.gate_gain_min < meter_window.gate_gain_min) meter_window.gate_gain_min = meter_block.gate_gain_min;
+  meter_window.in_sumsq += meter_block.in_sumsq;
+  meter_window.out_sumsq += meter_block.out_sumsq;
+  meter_window.in_clips += meter_block.in_clips;
+  meter_window.out_clips += meter_block.out_clips;
+  meter_window_samples += BUFFER_SIZE;
+
+  memset(&meter_block, 0, sizeof(meter_block));
+  meter_block.gate_gain_min = 1.0f;
+}
+
+void Telemetry_Set_Rate(uint8_t hz)
+{
+  if (hz > TELEMETRY_MAX_RATE_HZ) hz = TELEMETRY_MAX_RATE_HZ;
+  telemetry_rate_hz = hz;
+  telemetry_last_tick = HAL_GetTick();
+}
+
+/**
+  * @brief  Send a telemetry frame when the configured interval has elapsed
+  * @note   Called from the main loop; the audio interrupt is only masked
+  *         while the window is copied and reset.
+  */
+void Telemetry_Process(void)
+{
+  MeterBlock_t window;
+  uint32_t samples;
+  uint16_t in_peak;
+  TelemetryFrame_t frame;
+
+  if (telemetry_rate_hz == 0) return;
+  if ((HAL_GetTick() - telemetry_last_tick) < (1000U / telemetry_rate_hz)) return;
+  telemetry_last_tick = HAL_GetTick();
+
+  __disable_irq();
+  window = meter_window;
+  samples = meter_window_samples;
+  in_peak = max_adc_deviation;
+  memset(&meter_window, 0, sizeof(meter_window));
+  meter_window.gate_gain_min = 1.0f;
+  meter_window_samples = 0;
+  max_adc_deviation = 0;
+  __enable_irq();
+
+  if (samples == 0) return;
+
+  frame.seq = telemetry_seq++;
+  frame.in_peak = To_Q15((float32_t)in_peak / 2048.0f);
+  frame.in_rms = To_Q15(sqrtf(window.in_sumsq / (float32_t)samples));
+  frame.out_peak = To_Q15(window.out_peak);
+  frame.out_rms = To_Q15(sqrtf(window.out_sumsq / (float32_t)samples));
+  frame.gate_gain = To_Q15(window.gate_gain_min);
+  frame.drive_gr_cdb = 0;
+  if (window.clip_peak > 1e-6f && window.drive_peak > window.clip_peak)
+  {
+    frame.drive_gr_cdb = (uint16_t)(2000.0f * log10f(window.drive_peak / window.clip_peak));
+  }
+  frame.in_clips = window.in_clips;
+  frame.out_clips = window.out_clips;
+  frame.comp_gr_cdb = (uint16_t)(Compressor_Take_GR_Peak() * 100.0f);
+
+  Send_UART_Frame(UART_FRAME_TELEMETRY, (const uint8_t*)&frame, sizeof(frame));
+}
@@ -0,0 +1,207 @@
+/* tuner.c
+ * YIN pitch detection outside the audio path
+ *
+ * Process_Guitar_Signal hands each finished half of adc_buffer to
+ * Tuner_Collect, which box-filters and decimates it into a frame
+ * borrowed from delay_buffer (the echo is shorter while the tuner is
+ * on). Once a frame is full collection pauses and Tuner_Process walks
+ * the YIN lags a few at a time whenever no audio block is waiting, so
+ * the detector never delays block processing by more than one slice.
+ * A new estimate is sent as a tuner frame roughly every 90 ms.
+ */
+
+#include "main.h"
+#include "tuner.h"
+#include "delay_mem.h"
+#include "dsp_core.h"
+#include "uart_comm.h"
+#include <math.h>
+
+#define TUNER_RATE (sample_rate_hz / TUNER_DECIMATION)
+
+typedef enum {
+  TUNER_COLLECTING = 0,
+  TUNER_ANALYSING
+} TunerState_t;
+
+Tuner_t tuner = {
+  .enabled = 0,
+  .mute = 0
+};
+
+static TunerState_t tuner_state = TUNER_COLLECTING;
+static uint16_t tuner_fill = 0;
+static int32_t tuner_acc = 0;
+static uint8_t tuner_acc_count = 0;
+static uint16_t tuner_seq = 0;
+
+// YIN walk state
+static uint16_t yin_lag;
+static uint16_t yin_lag_min;
+static uint16_t yin_lag_max;
+static float32_t yin_running_sum;
+static float32_t yin_prev[2];          // d' at lag-2 and lag-1
+static float32_t yin_best_value;
+static float32_t yin_best_lag;
+static uint8_t yin_found;
+
+// CPU share over one-second windows
+static uint32_t tuner_busy_cycles = 0;
+static uint32_t tuner_window_start = 0;
+
+uint8_t Tuner_Enable(uint8_t on, uint8_t mute)
+{
+  if (on && !tuner.enabled)
+  {
+    if (!DelayMem_Request(DELAY_MEM_TUNER, TUNER_FRAME)) return 0;
+    tuner_state = TUNER_COLLECTING;
+    tuner_fill = 0;
+    tuner_acc = 0;
+    tuner_acc_count = 0;
+    tuner.freq_hz = 0.0f;
+    tuner.note = 0;
+    tuner.cents = 0;
+    tuner.confidence = 0;
+    tuner_busy_cycles = 0;
+    tuner_window_start = HAL_GetTick();
+  }
+  else if (!on && tuner.enabled)
+  {
+    tuner.enabled = 0;
+    DelayMem_Release(DELAY_MEM_TUNER);
+  }
+  tuner.mute = mute;
+  tuner.enabled = on;
+  return 1;
+}
+
+/**
+  * @brief  Decimate raw ADC samples into the analysis frame (main loop)
+  */
+void Tuner_Collect(const uint16_t *adc, uint16_t length)
+{
+  int16_t *frame = delay_mem[DELAY_MEM_TUNER].base;
+
+  if (!tuner.enabled || tuner_state != TUNER_COLLECTING) return;
+
+  for (uint16_t i = 0; i < length && tuner_fill < TUNER_FRAME; i++)
+  {
+    tuner_acc += (int32_t)adc[i] - 2048;
+    if (++tuner_acc_count == TUNER_DECIMATION)
+    {
+      frame[tuner_fill++] = (int16_t)((tuner_acc * 16) / TUNER_DECIMATION);
+      tuner_acc = 0;
+      tuner_acc_count = 0;
+    }
+  }
+
+  if (tuner_fill >= TUNER_FRAME)
+  {
+    yin_lag_min = (uint16_t)(TUNER_RATE / TUNER_MAX_HZ);
+    yin_lag_max = (uint16_t)(TUNER_RATE / TUNER_MIN_HZ);
+    if (yin_lag_max > TUNER_FRAME - TUNER_WINDOW - 1) yin_lag_max = TUNER_FRAME - TUNER_WINDOW - 1;
+    yin_lag = 1;
+    yin_running_sum = 0.0f;
+    yin_prev[0] = yin_prev[1] = 1.0f;
+    yin_best_value = 1.0f;
+    yin_best_lag = 0.0f;
+    yin_found = 0;
+    tuner_state = TUNER_ANALYSING;
+  }
+}
+
+static float32_t Yin_Difference(const int16_t *x, uint16_t lag)
+{
+  float32_t sum = 0.0f;
+  for (uint16_t j = 0; j < TUNER_WINDOW; j++)
+  {
+    float32_t d = (float32_t)(x[j] - x[j + lag]);
+    sum += d * d;
+  }
+  return sum;
+}
+
+static void Tuner_Publish(void)
+{
+  TunerFrame_t frame;
+
+  tuner.note = 0;
+  tuner.cents = 0;
+  if (tuner.freq_hz > 0.0f)
+  {
+    float32_t midi = 69.0f + 12.0f * log2f(tuner.freq_hz / 440.0f);
+    float32_t nearest = floorf(midi + 0.5f);
+    tuner.note = (uint8_t)nearest;
+    tuner.cents = (int8_t)((midi - nearest) * 100.0f);
+  }
+
+  frame.seq = tuner_seq++;
+  frame.freq_dhz = (uint16_t)(tuner.freq_hz * 10.0f);
+  frame.note = tuner.note;
+  frame.cents = tuner.cents;
+  frame.confidence = tuner.confidence;
+  frame.muted = tuner.mute;
+  frame.cpu_permille = tuner.cpu_permille;
+  Send_UART_Frame(UART_FRAME_TUNER, (const uint8_t*)&frame, sizeof(frame));
+}
+
+/**
+  * @brief  Evaluate the next few YIN lags (main loop, lowest priority)
+  */
+void Tuner_Process(void)
+{
+  const int16_t *x = delay_mem[DELAY_MEM_TUNER].base;
+  uint32_t start;
+  uint16_t n;
+
+  if (!tuner.enabled) return;
+
+  if ((HAL_GetTick() - tuner_window_start) >= 1000U)
+  {
+    tuner.cpu_permille = (uint16_t)(tuner_busy_cycles / (SystemCoreClock / 1000U));
+    tuner_busy_cycles = 0;
+    tuner_window_start = HAL_GetTick();
+  }
+
+  // Audio blocks always go first
+  if (tuner_state != TUNER_ANALYSING || process_audio_flag) return;
+
+  start = DWT->CYCCNT;
+  for (n = 0; n < TUNER_LAGS_PER_SLICE && !yin_found && yin_lag <= yin_lag_max; n++, yin_lag++)
+  {
+    // Cumulative-mean-normalised difference d'(lag)
+    float32_t d = Yin_Difference(x, yin_lag);
+    float32_t dn;
+    yin_running_sum += d;
+    dn = (yin_running_sum > 0.0f) ? d * (float32_t)yin_lag / yin_running_sum : 1.0f;
+
+    if (yin_lag > yin_lag_min + 1)
+    {
+      // yin_prev[1] is a local minimum at lag-1
+      if (yin_prev[1] <= yin_prev[0] && yin_prev[1] <= dn)
+      {
+        float32_t denom = yin_prev[0] - 2.0f * yin_prev[1] + dn;
+        float32_t shift = (fabsf(denom) > 1e-9f) ? 0.5f * (yin_prev[0] - dn) / denom : 0.0f;
+        if (yin_prev[1] < yin_best_value)
+        {
+          yin_best_value = yin_prev[1];
+          yin_best_lag = (float32_t)(yin_lag - 1) + shift;
+        }
+        if (yin_prev[1] < TUNER_YIN_THRESHOLD) yin_found = 1;
+      }
+    }
+    yin_prev[0] = yin_prev[1];
+    yin_prev[1] = dn;
+  }
+
+  if (yin_found || yin_lag > yin_lag_max)
+  {
+    tuner.confidence = (uint8_t)((1.0f - fminf(yin_best_value, 1.0f)) * 255.0f);
+    tuner.freq_hz = (yin_best_lag > 0.0f && yin_best_value < 0.5f) ? TUNER_RATE / yin_best_lag : 0.0f;
+    Tuner_Publish();
+    tuner_fill = 0;
+    tuner_state = TUNER_COLLECTING;
+  }
+
+  tuner_busy_cycles += DWT->CYCCNT - start;
+}
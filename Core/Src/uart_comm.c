@@ -5,6 +5,22 @@
 #include "main.h"
 #include "uart_comm.h"
 #include "effects.h"
+#include "telemetry.h"
+#include "scope.h"
+#include "presets.h"
+#include "reverb.h"
+#include "cabinet.h"
+#include "eq.h"
+#include "modulation.h"
+#include "delay_mem.h"
+#include "compressor.h"
+#include "tuner.h"
+#include "governor.h"
+#include "sample_rate.h"
+#include "looper.h"
+#include "dac_out.h"
+#include "crc32.h"
+#include "dsp_core.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,12 +30,94 @@
 extern UART_HandleTypeDef huart3;
 extern UART_HandleTypeDef huart2;
 
+/* Transmit queue for USART3: ACK lines and binary frames share the link,
+ * so everything is copied here and drained by the TX complete callback. */
+static uint8_t uart_tx_queue[UART_TX_QUEUE_SIZE];
+static volatile uint16_t uart_tx_head = 0;
+static volatile uint16_t uart_tx_tail = 0;
+static volatile uint16_t uart_tx_inflight = 0;
+
+/* Receive side: the interrupt assembles a line in the slot at the head,
+ * the main loop copies the oldest into uart_rx_buffer. A line arriving
+ * with every slot full is dropped whole. A line longer than the slot is
+ * kept cut short but marked, so it is refused rather than half-applied. */
+static uint8_t uart_rx_lines[UART_RX_LINES][UART_RX_BUFFER_SIZE];
+static uint8_t uart_rx_line_overlong[UART_RX_LINES];
+static volatile uint8_t uart_rx_line_head = 0;
+static volatile uint8_t uart_rx_line_tail = 0;
+static volatile uint32_t uart_rx_lines_dropped = 0;
+static volatile uint32_t uart_rx_lines_overlong = 0;
+static uint8_t uart_rx_overflow = 0;    // bytes lost from the line being assembled
+static uint8_t uart_rx_taken_overlong = 0;  // the line in uart_rx_buffer was cut short
+
+/* Reply tag of the command being parsed ("#<seq> <command>"): text lines
+ * sent while it is set go out as "#<seq> <line>" */
+static uint32_t uart_reply_seq = 0;
+static uint8_t uart_reply_tagged = 0;
+static uint8_t uart_reply_sent = 0;
+
+static void UART_Start_Next_Transmit(void)
+{
+  uint16_t head = uart_tx_head;
+  uint16_t tail = uart_tx_tail;
+  uint16_t len;
+
+  if (uart_tx_inflight || head == tail) return;
+
+  len = (head > tail) ? (head - tail) : (UART_TX_QUEUE_SIZE - tail);
+  uart_tx_inflight = len;
+  if (HAL_UART_Transmit_IT(&huart3, &uart_tx_queue[tail], len) != HAL_OK)
+  {
+    // Peripheral busy: data stays queued and is retried on the next send
+    uart_tx_inflight = 0;
+  }
+}
+
+/**
+ * @brief Move the oldest received line into uart_rx_buffer
+ * @retval 1 if there was one, 0 if none is waiting
+ */
+uint8_t UART_Take_Line(void)
+{
+  uint8_t tail = uart_rx_line_tail;
+
+  if (tail == uart_rx_line_head)
+  {
+    uart_command_ready = 0;
+    return 0;
+  }
+  memcpy(uart_rx_buffer, uart_rx_lines[tail], UART_RX_BUFFER_SIZE);
+  uart_rx_taken_overlong = uart_rx_line_overlong[tail];
+  uart_rx_line_tail = (uint8_t)((tail + 1) % UART_RX_LINES);
+  return 1;
+}
+
 void Parse_UART_Command(void)
 {
   char* cmd = (char*)uart_rx_buffer;
   uint8_t command_received = 0;
+
+  // Pipelined senders tag commands so replies can be matched out of band
+  if (cmd[0] == '#')
+  {
+    char *end = NULL;
+    uint32_t seq = (uint32_t)strtoul(cmd + 1, &end, 10);
+    if (end != cmd + 1 && *end == ' ')
+    {
+      uart_reply_seq = seq;
+      uart_reply_tagged = 1;
+      uart_reply_sent = 0;
+      cmd = end + 1;
+    }
+  }
   
-  if (strncmp(cmd, "VOL:", 4) == 0)
+  if (uart_rx_taken_overlong)
+  {
+    // Only the head of the line arrived: a SETALL cut mid-field would still
+    // parse, so nothing is applied and a tagged sender gets NAK
+    uart_rx_lines_overlong++;
+  }
+  else if (strncmp(cmd, "VOL:", 4) == 0)
   {
     float vol = atof(cmd + 4);
     if (vol >= 0.0f && vol <= 1.0f)
@@ -27,11 +125,7 @@ void Parse_UART_Command(void)
       output_volume = vol;
       command_received = 1;
       snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:VOL=%.2f\n", vol);
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer)) != HAL_OK)
-      {
-        // fallback to blocking transmit if IT transmit not available
-        HAL_UART_Transmit(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer), 100);
-      }
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
     }
   }
   else if (strncmp(cmd, "OVR:", 4) == 0)
@@ -41,20 +135,14 @@ void Parse_UART_Command(void)
       overdrive.enabled = 1;
       command_received = 1;
       const char *msg = "ACK:OVR=ON\n";
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)msg, strlen(msg)) != HAL_OK)
-      {
-        HAL_UART_Transmit(&huart3, (uint8_t*)msg, strlen(msg), 100);
-      }
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
     }
     else if (strncmp(cmd + 4, "OFF", 3) == 0)
     {
       overdrive.enabled = 0;
       command_received = 1;
       const char *msg = "ACK:OVR=OFF\n";
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)msg, strlen(msg)) != HAL_OK)
-      {
-        HAL_UART_Transmit(&huart3, (uint8_t*)msg, strlen(msg), 100);
-      }
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
     }
     else
     {
@@ -113,10 +201,7 @@ void Parse_UART_Command(void)
         snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
                  "ACK:OVR=%.1f,%.2f,%.2f,%.2f,%d\n",
                  overdrive.gain, overdrive.threshold, overdrive.tone, overdrive.mix, overdrive.mode);
-        if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer)) != HAL_OK)
-        {
-          HAL_UART_Transmit(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer), 100);
-        }
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
       }
     }
   }
@@ -127,20 +212,14 @@ void Parse_UART_Command(void)
       delay_effect.enabled = 1;
       command_received = 1;
       const char *msg = "ACK:DLY=ON\n";
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)msg, strlen(msg)) != HAL_OK)
-      {
-        HAL_UART_Transmit(&huart3, (uint8_t*)msg, strlen(msg), 100);
-      }
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
     }
     else if (strncmp(cmd + 4, "OFF", 3) == 0)
     {
       delay_effect.enabled = 0;
       command_received = 1;
       const char *msg = "ACK:DLY=OFF\n";
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)msg, strlen(msg)) != HAL_OK)
-      {
-        HAL_UART_Transmit(&huart3, (uint8_t*)msg, strlen(msg), 100);
-      }
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
     }
     else
     {
@@ -151,7 +230,7 @@ void Parse_UART_Command(void)
       char *saveptr = NULL;
       char *token = strtok_r(params, ",", &saveptr);
       uint8_t parsed = 0;
-      float time_ms = (float)delay_effect.delay_samples * (1000.0f / SAMPLE_RATE);
+      float time_ms = delay_effect.time_ms;
       float feedback = delay_effect.feedback;
       float mix = delay_effect.mix;
       float tone = delay_effect.tone;
@@ -182,7 +261,7 @@ void Parse_UART_Command(void)
 
       if (parsed >= 3)
       {
-        uint32_t samples = (uint32_t)((time_ms / 1000.0f) * SAMPLE_RATE);
+        uint32_t samples = (uint32_t)((time_ms / 1000.0f) * sample_rate_hz);
         if (samples > 0 && samples <= DELAY_BUFFER_SIZE)
         {
           delay_effect.delay_samples = samples;
@@ -191,6 +270,7 @@ void Parse_UART_Command(void)
         {
           delay_effect.delay_samples = DELAY_BUFFER_SIZE;
         }
+        delay_effect.time_ms = time_ms;
         if (feedback >= 0.0f && feedback <= 0.95f) delay_effect.feedback = feedback;
         if (mix >= 0.0f && mix <= 1.0f) delay_effect.mix = mix;
         if (parsed >= 4 && tone >= 0.0f && tone <= 1.0f) delay_effect.tone = tone;
@@ -199,10 +279,7 @@ void Parse_UART_Command(void)
         snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
                  "ACK:DLY=%.0fms,%.2f,%.2f,%.2f\n",
                  time_ms, delay_effect.feedback, delay_effect.mix, delay_effect.tone);
-        if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer)) != HAL_OK)
-        {
-          HAL_UART_Transmit(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer), 100);
-        }
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
       }
     }
   }
@@ -213,20 +290,14 @@ void Parse_UART_Command(void)
       noise_gate.enabled = 1;
       command_received = 1;
       const char *msg = "ACK:GATE=ON\n";
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)msg, strlen(msg)) != HAL_OK)
-      {
-        HAL_UART_Transmit(&huart3, (uint8_t*)msg, strlen(msg), 100);
-      }
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
     }
     else if (strncmp(cmd + 5, "OFF", 3) == 0)
     {
       noise_gate.enabled = 0;
       command_received = 1;
       const char *msg = "ACK:GATE=OFF\n";
-      if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)msg, strlen(msg)) != HAL_OK)
-      {
-        HAL_UART_Transmit(&huart3, (uint8_t*)msg, strlen(msg), 100);
-      }
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
     }
     else
     {
@@ -269,31 +340,796 @@ void Parse_UART_Command(void)
         snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
                  "ACK:GATE=%.3f,%.4f,%.2f\n",
                  noise_gate.threshold, noise_gate.attack_time, noise_gate.release_time);
-        if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer)) != HAL_OK)
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+  }
+  else if (strncmp(cmd, "TLM:", 4) == 0)
+  {
+    // atoi would read "TLM:abc" as 0 and switch telemetry off; refuse it
+    char *end = NULL;
+    long rate = strtol(cmd + 4, &end, 10);
+    if (end != cmd + 4 && *end == '\0' && rate >= 0 && rate <= TELEMETRY_MAX_RATE_HZ)
+    {
+      Telemetry_Set_Rate((uint8_t)rate);
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:TLM=%ld\n", rate);
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "SCOPE:", 6) == 0)
+  {
+    if (strncmp(cmd + 6, "OFF", 3) == 0)
+    {
+      Scope_Cancel();
+      command_received = 1;
+      const char *msg = "ACK:SCOPE=OFF\n";
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
+    }
+    else
+    {
+      char params[UART_RX_BUFFER_SIZE];
+      strncpy(params, cmd + 6, sizeof(params));
+      params[sizeof(params) - 1] = '\0';
+
+      char *saveptr = NULL;
+      char *token = strtok_r(params, ",", &saveptr);
+      int length = 0;
+      float level = 0.0f;
+      int decimation = 1;
+
+      if (token)
+      {
+        length = atoi(token);
+        token = strtok_r(NULL, ",", &saveptr);
+      }
+      if (token)
+      {
+        level = atof(token);
+        token = strtok_r(NULL, ",", &saveptr);
+      }
+      if (token)
+      {
+        decimation = atoi(token);
+      }
+
+      if (length > 0 && decimation > 0 &&
+          Scope_Arm((uint16_t)length, level, (uint16_t)decimation))
+      {
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
+                 "ACK:SCOPE=%d,%.3f,%d\n", length, level, decimation);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+  }
+  else if (strncmp(cmd, "PRESET:", 7) == 0)
+  {
+    if (strncmp(cmd + 7, "SAVE ", 5) == 0)
+    {
+      int slot = atoi(cmd + 12);
+      if (slot >= 0 && slot < PRESET_SLOTS && Preset_Save((uint8_t)slot))
+      {
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:PRESET=SAVE,%d\n", slot);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else if (strncmp(cmd + 7, "LOAD ", 5) == 0)
+    {
+      int slot = atoi(cmd + 12);
+      if (slot >= 0 && slot < PRESET_SLOTS && Preset_Load((uint8_t)slot))
+      {
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:PRESET=LOAD,%d\n", slot);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else if (strncmp(cmd + 7, "LIST", 4) == 0)
+    {
+      uint32_t mask = Preset_List();
+      char *p = uart_tx_buffer;
+      p += snprintf(p, UART_TX_BUFFER_SIZE, "ACK:PRESET=LIST,");
+      for (uint8_t slot = 0; slot < PRESET_SLOTS; slot++)
+      {
+        *p++ = (mask & (1U << slot)) ? '1' : '0';
+      }
+      *p++ = '\n';
+      *p = '\0';
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "SETALL:", 7) == 0)
+  {
+    // vol,od_gain,od_thr,od_tone,od_mix,od_mode,od_en,
+    // dly_ms,dly_fb,dly_mix,dly_tone,dly_en,gate_thr,gate_atk,gate_rel,gate_en
+    char params[UART_RX_BUFFER_SIZE];
+    float values[16];
+    uint8_t parsed = 0;
+    strncpy(params, cmd + 7, sizeof(params));
+    params[sizeof(params) - 1] = '\0';
+
+    char *saveptr = NULL;
+    char *token = strtok_r(params, ",", &saveptr);
+    while (token && parsed < 16)
+    {
+      values[parsed++] = atof(token);
+      token = strtok_r(NULL, ",", &saveptr);
+    }
+
+    if (parsed == 16 && token == NULL)
+    {
+      EffectParams_t state;
+      state.volume = values[0];
+      state.od_gain = values[1];
+      state.od_threshold = values[2];
+      state.od_tone = values[3];
+      state.od_mix = values[4];
+      state.od_mode = (uint8_t)values[5];
+      state.od_enabled = (uint8_t)values[6];
+      state.dly_samples = (uint32_t)((values[7] / 1000.0f) * sample_rate_hz);
+      // Same clamp as DLY: (presets ask for longer echoes than the line holds)
+      if (state.dly_samples > DELAY_BUFFER_SIZE) state.dly_samples = DELAY_BUFFER_SIZE;
+      state.dly_feedback = values[8];
+      state.dly_mix = values[9];
+      state.dly_tone = values[10];
+      state.dly_enabled = (uint8_t)values[11];
+      state.gate_threshold = values[12];
+      state.gate_attack = values[13];
+      state.gate_release = values[14];
+      state.gate_enabled = (uint8_t)values[15];
+
+      // All fields are checked before anything changes; the audio
+      // interrupt swaps the whole state in at the next block boundary
+      if (values[5] >= 0.0f && values[6] >= 0.0f && values[11] >= 0.0f && values[15] >= 0.0f &&
+          Effects_Validate_Params(&state))
+      {
+        Effects_Queue_Params(&state);
+        delay_effect.time_ms = values[7];
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:SETALL=%08lX\n",
+                 (unsigned long)Effects_Params_Digest(&state));
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+  }
+  else if (strncmp(cmd, "RVB?", 4) == 0)
+  {
+    // Block cost normalised to cycles per sample, then restart the peak
+    uint32_t block = BUFFER_SIZE / 2;
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
+             "ACK:RVB=%.2f,%.2f,%.2f,%d,CYC=%lu/%lu,MEM=%lu,OVR=%lu\n",
+             reverb.room_size, reverb.damping, reverb.mix, reverb.enabled,
+             (unsigned long)(reverb_cycles.last / block), (unsigned long)(reverb_cycles.peak / block),
+             (unsigned long)Reverb_Memory_Used(), (unsigned long)audio_block_overruns);
+    reverb_cycles.peak = 0;
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "RVB:", 4) == 0)
+  {
+    if (strncmp(cmd + 4, "ON", 2) == 0)
+    {
+      if (!reverb.enabled) Reverb_Clear();
+      reverb.enabled = 1;
+      command_received = 1;
+      const char *msg = "ACK:RVB=ON\n";
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
+    }
+    else if (strncmp(cmd + 4, "OFF", 3) == 0)
+    {
+      reverb.enabled = 0;
+      command_received = 1;
+      const char *msg = "ACK:RVB=OFF\n";
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
+    }
+    else
+    {
+      char params[UART_RX_BUFFER_SIZE];
+      strncpy(params, cmd + 4, sizeof(params));
+      params[sizeof(params) - 1] = '\0';
+
+      char *saveptr = NULL;
+      char *token = strtok_r(params, ",", &saveptr);
+      uint8_t parsed = 0;
+      float size = reverb.room_size;
+      float damp = reverb.damping;
+      float mix = reverb.mix;
+
+      if (token)
+      {
+        size = atof(token);
+        parsed++;
+        token = strtok_r(NULL, ",", &saveptr);
+      }
+      if (token)
+      {
+        damp = atof(token);
+        parsed++;
+        token = strtok_r(NULL, ",", &saveptr);
+      }
+      if (token)
+      {
+        mix = atof(token);
+        parsed++;
+      }
+
+      if (parsed >= 1 && size >= 0.0f && size <= 1.0f &&
+          damp >= 0.0f && damp <= 1.0f && mix >= 0.0f && mix <= 1.0f)
+      {
+        Reverb_Set_Params(size, damp, mix);
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
+                 "ACK:RVB=%.2f,%.2f,%.2f\n", reverb.room_size, reverb.damping, reverb.mix);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+  }
+  else if (strncmp(cmd, "CAB?", 4) == 0)
+  {
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
+             "ACK:CAB=%d,%s,%u,%u,BLK=%lu/%lu,ISR=%lu/%lu\n",
+             cabinet.enabled, (cabinet.mode == CAB_MODE_LOW_LATENCY) ? "LL" : "FFT",
+             cabinet.taps, cabinet.partitions,
+             (unsigned long)cabinet_cycles.last, (unsigned long)cabinet_cycles.peak,
+             (unsigned long)cabinet_isr_cycles.last, (unsigned long)cabinet_isr_cycles.peak);
+    cabinet_cycles.peak = 0;
+    cabinet_isr_cycles.peak = 0;
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "CAB:", 4) == 0)
+  {
+    const char *arg = cmd + 4;
+    if (strncmp(arg, "ON", 2) == 0)
+    {
+      if (!cabinet.enabled) Cabinet_Clear();
+      cabinet.enabled = 1;
+      command_received = 1;
+      const char *msg = "ACK:CAB=ON\n";
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
+    }
+    else if (strncmp(arg, "OFF", 3) == 0)
+    {
+      cabinet.enabled = 0;
+      command_received = 1;
+      const char *msg = "ACK:CAB=OFF\n";
+      Send_UART_Data((const uint8_t*)msg, strlen(msg));
+    }
+    else if (strncmp(arg, "MODE,", 5) == 0)
+    {
+      // AUTO: low latency unless the cost model says the chain would not fit
+      uint8_t automatic = (strncmp(arg + 5, "AUTO", 4) == 0);
+      uint8_t low_latency = automatic ? (Governor_Pick_Cab_Mode() == CAB_MODE_LOW_LATENCY)
+                                      : (strncmp(arg + 5, "LL", 2) == 0);
+      if (automatic || low_latency || strncmp(arg + 5, "FFT", 3) == 0)
+      {
+        Cabinet_Set_Mode(low_latency ? CAB_MODE_LOW_LATENCY : CAB_MODE_FFT);
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:CAB=MODE,%s\n", low_latency ? "LL" : "FFT");
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else if (strncmp(arg, "LOAD,", 5) == 0)
+    {
+      int taps = atoi(arg + 5);
+      if (taps > 0 && taps <= CAB_MAX_TAPS && Cabinet_Load_Begin((uint16_t)taps))
+      {
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:CAB=LOAD,%d\n", taps);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else if (strncmp(arg, "DATA,", 5) == 0)
+    {
+      // DATA,<offset>,<4 hex digits per tap, two's complement Q15>
+      char *hex = NULL;
+      long offset = strtol(arg + 5, &hex, 10);
+      int16_t taps[CAB_CHUNK_MAX_TAPS];
+      uint16_t count = 0;
+      uint8_t valid = (hex != NULL && *hex == ',' && offset >= 0);
+
+      if (valid) hex++;
+      while (valid && *hex && count < CAB_CHUNK_MAX_TAPS)
+      {
+        char digits[5];
+        char *end = NULL;
+        if (strnlen(hex, 4) < 4)
         {
-          HAL_UART_Transmit(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer), 100);
+          valid = 0;
+          break;
         }
+        memcpy(digits, hex, 4);
+        digits[4] = '\0';
+        taps[count++] = (int16_t)strtoul(digits, &end, 16);
+        if (end != digits + 4) valid = 0;
+        hex += 4;
+      }
+      if (valid && *hex) valid = 0;
+
+      if (valid && count > 0 && Cabinet_Load_Data((uint16_t)offset, taps, count))
+      {
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:CAB=DATA,%ld\n", offset + count);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else if (strncmp(arg, "END,", 4) == 0)
+    {
+      // CRC-32/MPEG-2 of the taps as little-endian int16, same as HASH?
+      uint32_t expected = strtoul(arg + 4, NULL, 16);
+      if (cabinet.loading &&
+          CRC32_Calculate(Cabinet_IR(), (uint32_t)cabinet.taps * sizeof(int16_t)) == expected)
+      {
+        Cabinet_Load_End();
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:CAB=END,%u\n", cabinet.taps);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
       }
     }
   }
-  else if (strncmp(cmd, "STATUS", 6) == 0)
+  else if (strncmp(cmd, "EQ?", 3) == 0)
+  {
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:EQ=%d,%s,CYC=%lu/%lu\n",
+             eq.enabled, (eq.position == EQ_POS_PRE) ? "PRE" : "POST",
+             (unsigned long)eq_cycles.last, (unsigned long)eq_cycles.peak);
+    eq_cycles.peak = 0;
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "EQ:", 3) == 0)
+  {
+    const char *arg = cmd + 3;
+    if (strncmp(arg, "ON", 2) == 0 || strncmp(arg, "OFF", 3) == 0)
+    {
+      eq.enabled = (arg[1] == 'N');
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:EQ=%s\n", eq.enabled ? "ON" : "OFF");
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+    else if (strncmp(arg, "POS,", 4) == 0)
+    {
+      uint8_t pre = (strncmp(arg + 4, "PRE", 3) == 0);
+      if (pre || strncmp(arg + 4, "POST", 4) == 0)
+      {
+        eq.position = pre ? EQ_POS_PRE : EQ_POS_POST;
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:EQ=POS,%s\n", pre ? "PRE" : "POST");
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else
+    {
+      // EQ:<band>,<PK|LS|HS>,<freq>,<gain_db>,<q>
+      char params[UART_RX_BUFFER_SIZE];
+      strncpy(params, arg, sizeof(params));
+      params[sizeof(params) - 1] = '\0';
+
+      char *saveptr = NULL;
+      char *fields[5];
+      uint8_t parsed = 0;
+      char *token = strtok_r(params, ",", &saveptr);
+      while (token && parsed < 5)
+      {
+        fields[parsed++] = token;
+        token = strtok_r(NULL, ",", &saveptr);
+      }
+
+      if (parsed == 5)
+      {
+        int band = atoi(fields[0]);
+        int type = -1;
+        if (strcmp(fields[1], "PK") == 0) type = EQ_TYPE_PEAK;
+        else if (strcmp(fields[1], "LS") == 0) type = EQ_TYPE_LOW_SHELF;
+        else if (strcmp(fields[1], "HS") == 0) type = EQ_TYPE_HIGH_SHELF;
+
+        if (band >= 0 && type >= 0 &&
+            EQ_Set_Band((uint8_t)band, (uint8_t)type, atof(fields[2]), atof(fields[3]), atof(fields[4])))
+        {
+          command_received = 1;
+          snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:EQ=%d,%s,%.0f,%.1f,%.2f\n",
+                   band, fields[1], eq.band[band].freq, eq.band[band].gain_db, eq.band[band].q);
+          Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+        }
+      }
+    }
+  }
+  else if (strncmp(cmd, "MOD?", 4) == 0)
   {
+    uint32_t block = BUFFER_SIZE / 2;
+    uint32_t peak = modulation_cycles.peak / block;
     snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
-             "VOL:%.2f,OVR:%d,DLY:%d,GATE:%d\n",
-             output_volume, overdrive.enabled, delay_effect.enabled, noise_gate.enabled);
-    if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer)) != HAL_OK)
+             "ACK:MOD=%d,%.2f,%.2f,%.2f,%.2f,CYC=%lu/%lu,BUDGET=%d%s,ECHO=%lu\n",
+             modulation.mode, modulation.rate_hz, modulation.depth, modulation.mix, modulation.feedback,
+             (unsigned long)(modulation_cycles.last / block), (unsigned long)peak,
+             MOD_CYCLE_BUDGET, (peak > MOD_CYCLE_BUDGET) ? "!" : "",
+             (unsigned long)delay_mem[DELAY_MEM_ECHO].length);
+    modulation_cycles.peak = 0;
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "MOD:", 4) == 0)
+  {
+    // MOD:OFF or MOD:<CHORUS|FLANGER|VIBRATO>[,rate_hz[,depth[,mix[,feedback]]]]
+    char params[UART_RX_BUFFER_SIZE];
+    strncpy(params, cmd + 4, sizeof(params));
+    params[sizeof(params) - 1] = '\0';
+
+    char *saveptr = NULL;
+    char *token = strtok_r(params, ",", &saveptr);
+    int mode = -1;
+    float values[4] = { modulation.rate_hz, modulation.depth, modulation.mix, modulation.feedback };
+
+    if (token)
+    {
+      if (strcmp(token, "OFF") == 0) mode = MOD_OFF;
+      else if (strcmp(token, "CHORUS") == 0) mode = MOD_CHORUS;
+      else if (strcmp(token, "FLANGER") == 0) mode = MOD_FLANGER;
+      else if (strcmp(token, "VIBRATO") == 0) mode = MOD_VIBRATO;
+      token = strtok_r(NULL, ",", &saveptr);
+    }
+    for (uint8_t i = 0; i < 4 && token; i++)
+    {
+      values[i] = atof(token);
+      token = strtok_r(NULL, ",", &saveptr);
+    }
+
+    if (mode >= 0 && Modulation_Set((uint8_t)mode, values[0], values[1], values[2], values[3]))
+    {
+      static const char *const mod_names[] = { "OFF", "CHORUS", "FLANGER", "VIBRATO" };
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:MOD=%s,%.2f,%.2f,%.2f,%.2f\n",
+               mod_names[modulation.mode], modulation.rate_hz, modulation.depth,
+               modulation.mix, modulation.feedback);
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "COMP?", 5) == 0)
+  {
+    uint32_t block = BUFFER_SIZE / 2;
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
+             "ACK:COMP=%d,%s,%.1f,%.1f,%.1f,%.0f,%.1f,LA=%d,GR=%.1f,CYC=%lu/%lu\n",
+             compressor.enabled, (compressor.mode == COMP_MODE_LIMIT) ? "LIMIT" : "COMP",
+             compressor.threshold_db, compressor.ratio, compressor.attack_ms, compressor.release_ms,
+             compressor.makeup_db, compressor.lookahead, compressor.gr_db,
+             (unsigned long)(compressor_cycles.last / block), (unsigned long)(compressor_cycles.peak / block));
+    compressor_cycles.peak = 0;
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "COMP:", 5) == 0)
+  {
+    const char *arg = cmd + 5;
+    if (strncmp(arg, "ON", 2) == 0 || strncmp(arg, "OFF", 3) == 0)
+    {
+      compressor.enabled = (arg[1] == 'N');
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:COMP=%s\n", compressor.enabled ? "ON" : "OFF");
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+    else if (strncmp(arg, "MODE,", 5) == 0)
+    {
+      uint8_t limit = (strncmp(arg + 5, "LIMIT", 5) == 0);
+      if (limit || strncmp(arg + 5, "COMP", 4) == 0)
+      {
+        compressor.mode = limit ? COMP_MODE_LIMIT : COMP_MODE_COMPRESS;
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:COMP=MODE,%s\n", limit ? "LIMIT" : "COMP");
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else if (strncmp(arg, "LA,", 3) == 0)
+    {
+      uint8_t on = (strncmp(arg + 3, "ON", 2) == 0);
+      if (on || strncmp(arg + 3, "OFF", 3) == 0)
+      {
+        Compressor_Set_Lookahead(on);
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:COMP=LA,%s\n", on ? "ON" : "OFF");
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+    else
+    {
+      // COMP:<threshold_db>,<ratio>,<attack_ms>,<release_ms>,<makeup_db>
+      char params[UART_RX_BUFFER_SIZE];
+      strncpy(params, arg, sizeof(params));
+      params[sizeof(params) - 1] = '\0';
+
+      char *saveptr = NULL;
+      char *token = strtok_r(params, ",", &saveptr);
+      float values[5];
+      uint8_t parsed = 0;
+      while (token && parsed < 5)
+      {
+        values[parsed++] = atof(token);
+        token = strtok_r(NULL, ",", &saveptr);
+      }
+
+      if (parsed == 5 && Compressor_Set(values[0], values[1], values[2], values[3], values[4]))
+      {
+        command_received = 1;
+        snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:COMP=%.1f,%.1f,%.1f,%.0f,%.1f\n",
+                 compressor.threshold_db, compressor.ratio, compressor.attack_ms,
+                 compressor.release_ms, compressor.makeup_db);
+        Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+      }
+    }
+  }
+  else if (strncmp(cmd, "TUNER?", 6) == 0)
+  {
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:TUNER=%d,%d,%.2f,%d,%d,CPU=%u.%u%%\n",
+             tuner.enabled, tuner.mute, tuner.freq_hz, tuner.note, tuner.cents,
+             tuner.cpu_permille / 10, tuner.cpu_permille % 10);
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "TUNER:", 6) == 0)
+  {
+    const char *arg = cmd + 6;
+    int on = -1;
+    uint8_t mute = 0;
+    if (strncmp(arg, "ON", 2) == 0) on = 1;
+    else if (strncmp(arg, "MUTE", 4) == 0) { on = 1; mute = 1; }
+    else if (strncmp(arg, "OFF", 3) == 0) on = 0;
+
+    if (on >= 0 && Tuner_Enable((uint8_t)on, mute))
+    {
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:TUNER=%s\n",
+               !on ? "OFF" : (mute ? "MUTE" : "ON"));
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "GOV?", 4) == 0)
+  {
+    uint16_t peak = Governor_Take_Peak();
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:GOV=%d,%s,LOAD=%u/%u,SKIP=%02X,CHG=%lu,OVR=%lu\n",
+             governor.level, (governor.forced == GOV_LEVEL_AUTO) ? "AUTO" : "FIXED",
+             governor.load_permille, peak, governor.skip,
+             (unsigned long)governor.changes, (unsigned long)audio_block_overruns);
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "COST?", 5) == 0)
+  {
+    // Predicted load of the live chain at full quality against the measured one
+    CostConfig_t config;
+    CostEstimate_t estimate;
+    Governor_Cost_Config(&config);
+    CostModel_Predict(&config, &estimate);
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:COST=%lu,%u,ISR=%lu/%lu,BLK=%lu,BUDGET=%lu\n",
+             (unsigned long)estimate.permille, governor.load_permille,
+             (unsigned long)estimate.isr_per_sample, (unsigned long)(audio_isr_cycles / (BUFFER_SIZE / 2)),
+             (unsigned long)estimate.block_per_half, (unsigned long)estimate.budget_per_half);
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "GOV:", 4) == 0)
+  {
+    const char *arg = cmd + 4;
+    int level = -1;
+    if (strncmp(arg, "AUTO", 4) == 0) level = GOV_LEVEL_AUTO;
+    else if (arg[0] >= '0' && arg[0] <= '0' + GOV_LEVEL_MAX) level = arg[0] - '0';
+
+    if (level >= 0)
+    {
+      Governor_Force((uint8_t)level);
+      command_received = 1;
+      if (level == GOV_LEVEL_AUTO) snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:GOV=AUTO\n");
+      else snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:GOV=%d\n", level);
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "LOOP?", 5) == 0)
+  {
+    static const char *const loop_names[] = { "CLEAR", "REC", "PLAY", "OVERDUB" };
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:LOOP=%s,%.2f/%.2fs,POS=%.2f,CYC=%lu/%lu\n",
+             loop_names[looper.state], Looper_Seconds(looper.length),
+             Looper_Seconds(Looper_Capacity()), Looper_Seconds(looper.position),
+             (unsigned long)looper_cycles.last, (unsigned long)looper_cycles.peak);
+    looper_cycles.peak = 0;
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "LOOP:", 5) == 0)
+  {
+    const char *arg = cmd + 5;
+    int state = -1;
+    if (strncmp(arg, "REC", 3) == 0) state = LOOP_REC;
+    else if (strncmp(arg, "PLAY", 4) == 0) state = LOOP_PLAY;
+    else if (strncmp(arg, "OVERDUB", 7) == 0) state = LOOP_OVERDUB;
+    else if (strncmp(arg, "CLEAR", 5) == 0) state = LOOP_CLEAR;
+
+    if (state >= 0 && Looper_Command((uint8_t)state))
+    {
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:LOOP=%s,%.2fs\n",
+               arg, Looper_Seconds(looper.length));
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "SR?", 3) == 0)
+  {
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:SR=%lu,%.4f,%s\n",
+             (unsigned long)sample_rate.nominal, sample_rate_hz,
+             sample_rate.auto_rate ? "AUTO" : "FIXED");
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "SR:", 3) == 0)
+  {
+    const char *arg = cmd + 3;
+    uint8_t ok = 0;
+
+    if (strncmp(arg, "AUTO", 4) == 0)
+    {
+      SampleRate_Set_Auto(1);
+      ok = 1;
+    }
+    else
+    {
+      // Hz, or kHz when written as 44.1 / 48 / 96
+      float rate = atof(arg);
+      uint32_t rate_hz = (uint32_t)((rate < 1000.0f) ? rate * 1000.0f + 0.5f : rate + 0.5f);
+      if (SampleRate_Set(rate_hz))
+      {
+        SampleRate_Set_Auto(0);
+        ok = 1;
+      }
+    }
+
+    if (ok)
     {
-      HAL_UART_Transmit(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer), 100);
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:SR=%lu,%.4f,%s\n",
+               (unsigned long)sample_rate.nominal, sample_rate_hz,
+               sample_rate.auto_rate ? "AUTO" : "FIXED");
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
     }
   }
+  else if (strncmp(cmd, "OUT?", 4) == 0)
+  {
+    static const char *const out_names[] = { "MONO", "SPLIT", "PINGPONG" };
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:OUT=%s,%s\n",
+             out_names[dac_out.mode], dac_out.dual ? "DUAL" : "SINGLE");
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "OUT:", 4) == 0)
+  {
+    // OUT:<MONO|SPLIT|PINGPONG>; a single-output build only takes MONO
+    const char *arg = cmd + 4;
+    int mode = -1;
+    if (strncmp(arg, "MONO", 4) == 0) mode = OUT_MONO;
+    else if (strncmp(arg, "SPLIT", 5) == 0) mode = OUT_SPLIT;
+    else if (strncmp(arg, "PINGPONG", 8) == 0) mode = OUT_PINGPONG;
+
+    if (mode >= 0 && DacOut_Set_Mode((uint8_t)mode))
+    {
+      command_received = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:OUT=%s\n", arg);
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "HASH?", 5) == 0)
+  {
+    EffectParams_t state;
+    Effects_Get_Params(&state);
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:HASH=%08lX\n",
+             (unsigned long)Effects_Params_Digest(&state));
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
+  else if (strncmp(cmd, "DUMP?", 5) == 0)
+  {
+    // Canonical EffectParams_t bytes; the frame checksum guards transport,
+    // HASH? over the same bytes identifies the state
+    EffectParams_t state;
+    Effects_Get_Params(&state);
+    if (Send_UART_Frame(UART_FRAME_STATE_DUMP, (const uint8_t*)&state, sizeof(state)))
+    {
+      // The frame is the reply, but frames carry no tag: a tagged sender
+      // matches this line instead
+      uart_reply_sent = 1;
+      snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "ACK:DUMP=%u\n", (unsigned)sizeof(state));
+      Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+    }
+  }
+  else if (strncmp(cmd, "STATUS", 6) == 0)
+  {
+    snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE,
+             "VOL:%.2f,OVR:%d,DLY:%d,GATE:%d,RXDROP:%lu,RXLONG:%lu\n",
+             output_volume, overdrive.enabled, delay_effect.enabled, noise_gate.enabled,
+             (unsigned long)uart_rx_lines_dropped, (unsigned long)uart_rx_lines_overlong);
+    Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
+  }
 
   if (command_received)
   {
     command_blink_counter = 6;
   }
 
+  // A tagged command always gets an answer, so the sender need not time out.
+  // An applied command whose reply did not fit in the queue still ACKs.
+  if (uart_reply_tagged && !uart_reply_sent)
+  {
+    const char *msg = command_received ? "ACK:\n" : "NAK\n";
+    Send_UART_Data((const uint8_t*)msg, strlen(msg));
+  }
+  uart_reply_tagged = 0;
+
   memset(uart_rx_buffer, 0, UART_RX_BUFFER_SIZE);
-  uart_rx_index = 0;
+}
+
+/**
+ * @brief Queue raw bytes for transmission to the ESP32
+ * @retval 1 if queued, 0 if the queue had no room (message dropped whole)
+ */
+uint8_t Send_UART_Data(const uint8_t *data, uint16_t len)
+{
+  uint16_t used;
+  uint16_t head;
+  uint32_t primask;
+  char tag[14];
+  uint16_t tag_len = 0;
+
+  // Text replies to a tagged command carry its tag; binary frames never do
+  if (uart_reply_tagged && len && data[0] != UART_FRAME_SYNC0)
+  {
+    tag_len = (uint16_t)snprintf(tag, sizeof(tag), "#%lu ", (unsigned long)uart_reply_seq);
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  head = uart_tx_head;
+  used = (uint16_t)((head + UART_TX_QUEUE_SIZE - uart_tx_tail) % UART_TX_QUEUE_SIZE);
+  if (len + tag_len >= (uint16_t)(UART_TX_QUEUE_SIZE - used))
+  {
+    __set_PRIMASK(primask);
+    return 0;
+  }
+  for (uint16_t i = 0; i < tag_len; i++)
+  {
+    uart_tx_queue[head] = (uint8_t)tag[i];
+    head = (head + 1) % UART_TX_QUEUE_SIZE;
+  }
+  if (tag_len) uart_reply_sent = 1;
+  for (uint16_t i = 0; i < len; i++)
+  {
+    uart_tx_queue[head] = data[i];
+    head = (head + 1) % UART_TX_QUEUE_SIZE;
+  }
+  uart_tx_head = head;
+  UART_Start_Next_Transmit();
+  __set_PRIMASK(primask);
+  return 1;
+}
+
+/**
+ * @brief Free space in the TX queue (bytes), for senders that must not starve ACKs
+ */
+uint16_t UART_TX_Free(void)
+{
+  uint16_t used = (uint16_t)((uart_tx_head + UART_TX_QUEUE_SIZE - uart_tx_tail) % UART_TX_QUEUE_SIZE);
+  return (uint16_t)(UART_TX_QUEUE_SIZE - 1 - used);
+}
+
+/**
+ * @brief Send a binary frame: sync (2), type (1), length (2, LE), payload, XOR checksum (1)
+ * @note  The checksum covers type, length and payload bytes.
+ */
+uint8_t Send_UART_Frame(uint8_t type, const uint8_t *payload, uint16_t len)
+{
+  uint8_t frame[UART_FRAME_MAX_PAYLOAD + UART_FRAME_OVERHEAD];
+  uint8_t checksum;
+  uint16_t i;
+
+  if (len > UART_FRAME_MAX_PAYLOAD) return 0;
+
+  frame[0] = UART_FRAME_SYNC0;
+  frame[1] = UART_FRAME_SYNC1;
+  frame[2] = type;
+  frame[3] = (uint8_t)(len & 0xFF);
+  frame[4] = (uint8_t)(len >> 8);
+  memcpy(&frame[5], payload, len);
+
+  checksum = 0;
+  for (i = 2; i < 5 + len; i++)
+  {
+    checksum ^= frame[i];
+  }
+  frame[5 + len] = checksum;
+
+  return Send_UART_Data(frame, len + UART_FRAME_OVERHEAD);
 }
 
 void Send_UART_Response(const char* msg)
@@ -301,43 +1137,60 @@ void Send_UART_Response(const char* msg)
   /* Prefer sending responses back to the ESP32 on USART3 (huart3).
    * huart2 is left available for host/console messages if needed. */
   snprintf(uart_tx_buffer, UART_TX_BUFFER_SIZE, "%s\n", msg);
-  if (HAL_UART_Transmit_IT(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer)) != HAL_OK)
-  {
-    HAL_UART_Transmit(&huart3, (uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer), 100);
-  }
+  Send_UART_Data((const uint8_t*)uart_tx_buffer, strlen(uart_tx_buffer));
 }
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
   if (huart->Instance == USART3)
   {
+    uint8_t *line = uart_rx_lines[uart_rx_line_head];
+
     if (uart_rx_byte == '\n' || uart_rx_byte == '\r')
     {
       if (uart_rx_index > 0)
       {
-        uart_rx_buffer[uart_rx_index] = '\0';
-        uart_command_ready = 1;
+        uint8_t next = (uint8_t)((uart_rx_line_head + 1) % UART_RX_LINES);
+        line[uart_rx_index] = '\0';
+        uart_rx_line_overlong[uart_rx_line_head] = uart_rx_overflow;
+        if (next != uart_rx_line_tail)
+        {
+          uart_rx_line_head = next;
+          uart_command_ready = 1;
+        }
+        else
+        {
+          uart_rx_lines_dropped++;
+        }
+        uart_rx_index = 0;
       }
+      uart_rx_overflow = 0;
     }
     else if (uart_rx_index < UART_RX_BUFFER_SIZE - 1)
     {
-      uart_rx_buffer[uart_rx_index++] = uart_rx_byte;
+      line[uart_rx_index++] = uart_rx_byte;
+    }
+    else
+    {
+      uart_rx_overflow = 1;
     }
     HAL_UART_Receive_IT(&huart3, &uart_rx_byte, 1);
   }
 }
 
 /**
- * @brief Called when UART transmit completes (ACK sent)
- * Disabled: TX callback LED blinks were causing spurious LED activity
+ * @brief Called when UART transmit completes: release the sent chunk and
+ * start the next one from the TX queue.
+ * LED blinks were removed from here: they caused spurious LED activity
  * when powered via USB (likely from noise/enumeration signals).
- * Keeping callback present but empty for future diagnostics if needed.
  */
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
   if (huart->Instance == USART3)
   {
-    /* TX complete - no action */
+    uart_tx_tail = (uint16_t)((uart_tx_tail + uart_tx_inflight) % UART_TX_QUEUE_SIZE);
+    uart_tx_inflight = 0;
+    UART_Start_Next_Transmit();
   }
 }
 
@@ -2,9 +2,15 @@
  * ESP32 DSP Bridge - Connects STM32 DSP to Node.js Backend via WiFi
  * 
  * This sketch allows the ESP32 to:
- * 1. Communicate with STM32 via UART (Serial2)
- * 2. Connect to a backend Node.js API and forward commands
- * 3. Act as a WiFi bridge between Flutter app -> Backend -> ESP32 -> STM32
+ * 1. Communicate with STM32 via UART (Serial2), from a FreeRTOS task of its
+ *    own: loop() queues commands and never waits on the link
+ * 2. Connect to a backend Node.js API and forward commands (pushed over a
+ *    server-sent event stream, polled only while the stream is down)
+ * 3. Serve the backend's effect endpoints itself (HTTP + WebSocket on port
+ *    80, advertised over mDNS as dsp-pedal.local), so the app can talk to
+ *    the pedal directly: Flutter app -> ESP32 -> STM32. The backend is
+ *    optional; with backend_url set, its changes are applied too.
+ *    Needs the ESPAsyncWebServer and AsyncTCP libraries.
  * 
  * Hardware Connection:
  * ESP32 TX (GPIO17) -> STM32 RX (PA3)
@@ -18,14 +24,46 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPmDNS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 
 // WiFi Configuration
 const char* ssid = "iPhone";           // Change this
 const char* password = "pfku67812";    // Change this
 
-// Backend API Configuration
+// Backend API Configuration ("" to run without a backend)
 const char* backend_url = "http://192.168.1.100:3000";  // Change to your backend IP
-const int poll_interval_ms = 500;  // Poll backend every 500ms for updates
+const int poll_interval_ms = 500;  // Fallback poll while the event stream is down
+const int events_connect_timeout_ms = 500;
+const int events_retry_min_ms = 1000;      // reconnect backoff, doubled per failure
+const int events_retry_max_ms = 16000;
+const int events_idle_timeout_ms = 35000;  // backend sends a heartbeat every 15 s
+const int sync_check_interval_ms = 5000;  // Compare state digests with STM32
+const int state_dump_timeout_ms = 1000;   // DUMP? after a mismatch, then resend all
+const int backend_forward_interval_ms = 100;  // local changes go to the backend at most this often
+
+// Local control server: same /api/effects, /api/volume, /api/overdrive,
+// /api/delay and /api/gate shapes as backend/server.js, plus /ws, a
+// WebSocket that takes the POST /api/effects body and pushes
+// {"type":"state","effects":{...}} after every flush, and
+// {"type":"meters",...} for each STM32 telemetry frame. POST /api/scope
+// arms a capture; its frames go to /ws as binary messages: the frame type
+// (0x02 header, 0x03 data) followed by the STM32's payload as sent.
+// POST /api/tuner {"enabled":true,"mute":false} starts the tuner, whose
+// readings go to /ws as {"type":"tuner",...}. Effect changes made here are
+// forwarded to the backend's POST /api/effects. Backend values for those
+// sections are ignored until then, and afterwards when they come from an
+// older revision (e.g. the state sent when the event stream reconnects).
+const char* mdns_hostname = "dsp-pedal";  // http://dsp-pedal.local/
+#define LOCAL_HTTP_PORT 80
+#define LOCAL_BODY_MAX 1024
+#define LOCAL_STATE_MAX 384
+#define LOCAL_METER_RATE_HZ 10      // TLM rate asked for while /ws has clients
+const int meters_restart_ms = 3000; // no frame for this long: ask again
 
 // UART to STM32 (Serial2)
 // Using USART3 on STM32 (PC10/PC11) instead of USART2 to avoid ST-LINK conflict
@@ -33,6 +71,59 @@ const int poll_interval_ms = 500;  // Poll backend every 500ms for updates
 #define STM32_TX_PIN 17  // ESP32 TX -> STM32 RX (PC11 - USART3_RX)
 #define STM32_BAUD 115200
 
+// STM32 link task: commands go out as "#<seq> <command>" and the STM32
+// answers "#<seq> ACK:..." (or "#<seq> NAK"), so several can be in flight
+#define UART_MAX_INFLIGHT 4       // UART_RX_LINES on the STM32
+#define UART_COMMAND_MAX 112
+#define UART_QUEUE_DEPTH 24
+const int uart_ack_timeout_ms = 300;
+const int uart_max_attempts = 3;
+
+// Replies loop() wants back (all others are only matched and logged)
+enum ReplyKind : uint8_t { REPLY_NONE, REPLY_SETALL, REPLY_RATE, REPLY_HASH };
+
+struct UartCommand {
+  char line[UART_COMMAND_MAX];
+  uint8_t reply;
+};
+
+struct UartReply {
+  uint8_t kind;
+  bool ok;                     // false: NAK, or no ACK after every attempt
+  char line[UART_COMMAND_MAX];
+};
+
+QueueHandle_t uartCommandQueue = NULL;  // loop() -> uartTask
+QueueHandle_t uartReplyQueue = NULL;    // uartTask -> loop()
+volatile uint8_t uartInFlight = 0;      // commands awaiting their ACK
+bool syncCheckPending = false;          // SR?/HASH? queued, HASH? not answered
+
+// Coalescing: backend changes only mark their parameter group dirty in
+// `dirtyGroups`; flushEffectChanges() sends the latest values at most every
+// uart_flush_interval_ms, and only while the link has drained, so a slider
+// drag costs one command per flush instead of one per POST. 25 ms leaves
+// 115200 baud (~11.5 bytes/ms) over half idle with a SETALL (~100 bytes)
+// every flush.
+enum EffectGroup : uint8_t {
+  GROUP_VOLUME, GROUP_OVR, GROUP_OVR_SWITCH, GROUP_DLY, GROUP_DLY_SWITCH,
+  GROUP_GATE, GROUP_GATE_SWITCH, GROUP_COUNT
+};
+const int uart_flush_interval_ms = 25;
+const int uart_command_overhead = 24;   // "#<seq> " out, the ACK line back
+uint8_t dirtyGroups = 0;                // 1 << EffectGroup
+
+// Local changes not yet on the backend, by POST /api/effects section
+enum EffectSection : uint8_t { SECTION_VOLUME, SECTION_OVERDRIVE, SECTION_DELAY, SECTION_GATE, SECTION_COUNT };
+uint8_t unsentSections = 0;             // 1 << EffectSection
+// Backend revision that took each section's last forwarded local change
+double forwardedRevision[SECTION_COUNT] = {};
+
+// The web server's handlers run in the async_tcp task, so `effects` and
+// `dirtyGroups` are only touched with this held
+SemaphoreHandle_t effectsLock = NULL;
+AsyncWebServer localServer(LOCAL_HTTP_PORT);
+AsyncWebSocket localSocket("/ws");
+
 // Effect parameters (updated for optimized STM32 effects)
 struct EffectParams {
   float volume;
@@ -72,12 +163,128 @@ EffectParams effects = {
   .gate_release = 0.15
 };
 
+// Binary frames from STM32 (sync A5 5A, type, len LE, payload, XOR checksum)
+#define FRAME_SYNC0 0xA5
+#define FRAME_SYNC1 0x5A
+#define FRAME_MAX_PAYLOAD 64
+#define FRAME_TELEMETRY 0x01
+#define FRAME_SCOPE_HEADER 0x02
+#define FRAME_SCOPE_DATA 0x03
+#define FRAME_STATE_DUMP 0x04
+#define FRAME_TUNER 0x05
+#define FRAME_GOVERNOR 0x06
+
+// Canonical DSP state, byte-identical to EffectParams_t on the STM32
+struct __attribute__((packed)) DspState {
+  float volume;
+  float od_gain;
+  float od_threshold;
+  float od_tone;
+  float od_mix;
+  float dly_feedback;
+  float dly_mix;
+  float dly_tone;
+  float gate_threshold;
+  float gate_attack;
+  float gate_release;
+  uint32_t dly_samples;
+  uint8_t od_mode;
+  uint8_t od_enabled;
+  uint8_t dly_enabled;
+  uint8_t gate_enabled;
+};
+
+// Telemetry payload as sent by STM32 (levels in Q15 full scale)
+struct __attribute__((packed)) TelemetryFrame {
+  uint16_t seq;
+  uint16_t in_peak;
+  uint16_t in_rms;
+  uint16_t out_peak;
+  uint16_t out_rms;
+  uint16_t gate_gain;
+  uint16_t drive_gr_cdb;   // overdrive gain reduction in 0.01 dB
+  uint16_t in_clips;
+  uint16_t out_clips;
+  uint16_t comp_gr_cdb;    // compressor/limiter gain reduction in 0.01 dB
+};
+
+// Tuner reading as sent by STM32 while TUNER:ON
+struct __attribute__((packed)) TunerFrame {
+  uint16_t seq;
+  uint16_t freq_dhz;       // 0.1 Hz, 0 if no pitch
+  uint8_t note;            // MIDI note, 0 if no pitch
+  int8_t cents;
+  uint8_t confidence;
+  uint8_t muted;
+  uint16_t cpu_permille;
+};
+
+// CPU-load governor level change (0 = full quality, 4 = minimal)
+struct __attribute__((packed)) GovernorFrame {
+  uint16_t seq;
+  uint8_t level;
+  uint8_t previous;
+  uint16_t load_permille;
+  uint16_t peak_permille;
+  uint16_t overruns;
+  uint8_t skip;            // stages skipped as idle (bit 0 EQ, 1 mod, 2 reverb)
+  uint8_t forced;
+  uint32_t sample_rate;    // nominal Hz after the change
+};
+
+TunerFrame latestTuner = {};
+GovernorFrame latestGovernor = {};
+TelemetryFrame latestTelemetry = {};
+unsigned long latestTelemetryMs = 0;
+bool metersRequested = false;  // TLM:<LOCAL_METER_RATE_HZ> sent, not TLM:0
+DspState lastDumpedState = {};
+bool stateDumpPending = false;          // DUMP? sent after a digest mismatch
+volatile bool stateDumpReady = false;   // lastDumpedState filled, not yet compared
+unsigned long stateDumpRequestedMs = 0;
+// Backend event stream (GET /api/events)
+WiFiClient eventsClient;
+bool eventsStreaming = false;  // response headers done, events flowing
+bool backendReachable = false; // last event stream connect got through
+String backendEtag = "";        // revision of the last poll answer, as its ETag
+// Real STM32 sample rate (SR? reply); delay ms -> samples uses it
+float stm32SampleRate = 48000.0f;
+#define STM32_DELAY_BUFFER_SIZE 4800  // DELAY_BUFFER_SIZE in globals.h
+#define STM32_SCOPE_MAX_SAMPLES 512   // SCOPE_MAX_SAMPLES in scope.h
+#define STM32_SCOPE_MAX_DECIMATION 64
+
 // Function prototypes
-void sendToSTM32(String command);
-String receiveFromSTM32(int timeout_ms = 500);
-bool sendCommandAndWaitForAck(String command, int timeout_ms = 1000);
+bool feedFrameParser(uint8_t c);
+void handleFrame(uint8_t type, const uint8_t* payload, uint16_t len);
+int formatSetAll(char* out, size_t size);
+int formatGroup(uint8_t group, char* out, size_t size);
+void flushEffectChanges();
+void expectedState(DspState& s);
+uint32_t expectedStateDigest();
+void serviceStateDump();
+void checkSTM32Sync();
+bool queueSTM32Command(const char* command, uint8_t reply = REPLY_NONE);
+void uartTask(void* parameters);
+void serviceSTM32Replies();
+void sendStateAsSeparateCommands();
 void pollBackendForUpdates();
-void applyEffectsFromJson(JsonObject effects);
+bool parseBackendUrl(String& host, uint16_t& port);
+void serviceEventStream();
+void handleBackendEvent(const String& data);
+bool applyEffectsFromJson(JsonObject effects, uint8_t skipSections = 0);
+uint8_t staleSections(JsonVariant doc);
+void applyLocalEffects(JsonObject effects);
+void forwardLocalChanges();
+bool applyVolume(float volume);
+bool applyOverdrive(JsonObject ovr);
+bool applyDelay(JsonObject dly);
+bool applyGate(JsonObject gate);
+int formatOverdriveJson(char* out, size_t size);
+int formatDelayJson(char* out, size_t size);
+int formatGateJson(char* out, size_t size);
+int formatEffectsJson(char* out, size_t size);
+void pushMeters();
+void pushTuner();
+void startLocalServer();
 void reconnectWiFi();
 bool waitForSTM32Ready(uint32_t timeout_ms = 5000);
 
@@ -85,6 +292,7 @@ void setup() {
   // Start Serial for debugging
   Serial.begin(115200);
   Serial.println("\n\nESP32 DSP Bridge Starting...");
+  effectsLock = xSemaphoreCreateMutex();
   
   // Start Serial2 for STM32 communication
   Serial2.begin(STM32_BAUD, SERIAL_8N1, STM32_RX_PIN, STM32_TX_PIN);
@@ -127,54 +335,25 @@ void setup() {
   waitForSTM32Ready(5000);
   delay(200);
   
-  // Initialize STM32 with default settings (with validation)
-  Serial.println("Setting volume...");
-  if (!sendCommandAndWaitForAck("VOL:" + String(effects.volume, 2), 800)) {
-    Serial.println("WARNING: Volume command not acknowledged");
-  }
-  delay(100);
-  
-  Serial.println("Setting overdrive parameters...");
-  if (!sendCommandAndWaitForAck("OVR:" + String(effects.overdrive_gain, 1) + "," + 
-                                String(effects.overdrive_threshold, 2) + "," + 
-                                String(effects.overdrive_tone, 2) + "," +
-                                String(effects.overdrive_mix, 2) + "," +
-                                String(effects.overdrive_mode), 800)) {
-    Serial.println("WARNING: Overdrive parameters not acknowledged");
-  }
-  delay(100);
+  // From here on only uartTask touches Serial2
+  uartCommandQueue = xQueueCreate(UART_QUEUE_DEPTH, sizeof(UartCommand));
+  uartReplyQueue = xQueueCreate(UART_QUEUE_DEPTH, sizeof(UartReply));
+  xTaskCreatePinnedToCore(uartTask, "stm32_uart", 4096, NULL, 2, NULL, 1);
   
-  Serial.println("Enabling overdrive...");
-  if (!sendCommandAndWaitForAck(effects.overdrive_enabled ? "OVR:ON" : "OVR:OFF", 800)) {
-    Serial.println("WARNING: Overdrive toggle not acknowledged");
-  }
-  delay(100);
+  // Initialize STM32 with the full state in one atomic command
+  // (a NAK or timeout falls back to one command per group, in loop())
+  Serial.println("Sending full effect state...");
+  char cmd[UART_COMMAND_MAX];
+  formatSetAll(cmd, sizeof(cmd));
+  queueSTM32Command(cmd, REPLY_SETALL);
   
-  Serial.println("Setting delay parameters...");
-  if (!sendCommandAndWaitForAck("DLY:" + String(effects.delay_time_ms, 0) + "," + 
-                                String(effects.delay_feedback, 2) + "," + 
-                                String(effects.delay_mix, 2) + "," +
-                                String(effects.delay_tone, 2), 800)) {
-    Serial.println("WARNING: Delay parameters not acknowledged");
-  }
-  delay(100);
-  
-  Serial.println("Setting noise gate...");
-  if (!sendCommandAndWaitForAck("GATE:" + String(effects.gate_threshold, 3) + "," + 
-                                String(effects.gate_attack, 4) + "," + 
-                                String(effects.gate_release, 2), 800)) {
-    Serial.println("WARNING: Gate parameters not acknowledged");
-  }
-  delay(100);
-  
-  if (!sendCommandAndWaitForAck(effects.gate_enabled ? "GATE:ON" : "GATE:OFF", 800)) {
-    Serial.println("WARNING: Gate toggle not acknowledged");
-  }
-  delay(100);
+  startLocalServer();
   
   Serial.println("\n=== Setup complete! ===");
-  Serial.println("ESP32 is ready to bridge commands from backend to STM32");
-  Serial.println("Waiting for commands from: " + String(backend_url));
+  Serial.println("ESP32 is ready to bridge commands to STM32");
+  if (backend_url[0] != '\0') {
+    Serial.println("Waiting for commands from: " + String(backend_url));
+  }
   Serial.println();
 }
 
@@ -189,78 +368,83 @@ void loop() {
     lastWiFiCheck = millis();
   }
   
-  // Poll backend for effect updates
-  static unsigned long lastPoll = 0;
-  if (millis() - lastPoll > poll_interval_ms) {
-    if (WiFi.status() == WL_CONNECTED) {
-      pollBackendForUpdates();
+  // Backend pushes changes over the event stream; poll only while it is
+  // down but the backend answers (a missing one must not stall the loop)
+  if (backend_url[0] != '\0') {
+    serviceEventStream();
+    static unsigned long lastPoll = 0;
+    if (!eventsStreaming && backendReachable && millis() - lastPoll > poll_interval_ms) {
+      if (WiFi.status() == WL_CONNECTED) {
+        pollBackendForUpdates();
+      }
+      lastPoll = millis();
+    }
+    static unsigned long lastForward = 0;
+    if (unsentSections && backendReachable && WiFi.status() == WL_CONNECTED &&
+        millis() - lastForward >= (unsigned long)backend_forward_interval_ms) {
+      forwardLocalChanges();
+      lastForward = millis();
     }
-    lastPoll = millis();
   }
   
-  // Listen for ACK messages from STM32 (don't spam Serial Monitor)
-  static String stm32_buffer = "";
-  while (Serial2.available()) {
-    char c = Serial2.read();
-    if (c == '\n') {
-      // Complete message received - only print ACK messages, not debug spam
-      if (stm32_buffer.length() > 0 && stm32_buffer.startsWith("ACK:")) {
-        Serial.print("<- STM32: ");
-        Serial.println(stm32_buffer);
+  // Send what changed since the last flush, latest values only, and show
+  // the new state to local WebSocket clients
+  static unsigned long lastFlush = 0;
+  if (millis() - lastFlush >= (unsigned long)uart_flush_interval_ms &&
+      uxQueueMessagesWaiting(uartCommandQueue) == 0 && uartInFlight < 2) {
+    char state[LOCAL_STATE_MAX + 32];
+    bool flushed = false;
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    if (dirtyGroups) {
+      flushEffectChanges();
+      flushed = true;
+      int n = snprintf(state, sizeof(state), "{\"type\":\"state\",\"effects\":");
+      n += formatEffectsJson(state + n, sizeof(state) - n);
+      snprintf(state + n, sizeof(state) - n, "}");
+    }
+    xSemaphoreGive(effectsLock);
+    if (flushed) {
+      lastFlush = millis();
+      if (localSocket.count() > 0) {
+        localSocket.textAll(state);
       }
-      stm32_buffer = "";  // Clear buffer
-    } else if (c >= 32 && c <= 126) {  // Printable ASCII
-      stm32_buffer += c;
     }
   }
-}
-
-/**
- * Send command to STM32 via UART
- */
-void sendToSTM32(String command) {
-  // Clear any pending data before sending
-  while (Serial2.available()) {
-    Serial2.read();
-  }
   
-  // Send command (no serial spam)
-  Serial2.print(command);
-  Serial2.print('\n');
-  Serial2.flush();
+  // Verify the STM32 still holds the state we last sent (e.g. after a reset)
+  static unsigned long lastSyncCheck = 0;
+  if (millis() - lastSyncCheck > sync_check_interval_ms) {
+    checkSTM32Sync();
+    lastSyncCheck = millis();
+  }
   
-  delay(10);  // Small delay to ensure transmission
-}
-
-/**
- * Receive response from STM32 with timeout
- */
-String receiveFromSTM32(int timeout_ms) {
-  String response = "";
-  unsigned long startTime = millis();
+  // Act on the STM32 replies uartTask hands back
+  serviceSTM32Replies();
+  serviceStateDump();
   
-  while (millis() - startTime < timeout_ms) {
-    if (Serial2.available()) {
-      char c = Serial2.read();
-      if (c == '\n' || c == '\r') {
-        if (response.length() > 0) {
-          break;
-        }
-      } else if (c >= 32 && c <= 126) {
-        response += c;
+  static unsigned long lastCleanup = 0;
+  if (millis() - lastCleanup > 1000) {
+    localSocket.cleanupClients();
+    lastCleanup = millis();
+    
+    // Meter frames only while someone watches; ask again when they stop
+    // coming (e.g. after an STM32 reset)
+    bool watching = localSocket.count() > 0;
+    if (watching != metersRequested ||
+        (watching && millis() - latestTelemetryMs > (unsigned long)meters_restart_ms)) {
+      char cmd[16];
+      snprintf(cmd, sizeof(cmd), "TLM:%d", watching ? LOCAL_METER_RATE_HZ : 0);
+      if (queueSTM32Command(cmd)) {
+        metersRequested = watching;
+        latestTelemetryMs = millis();
       }
     }
-    delay(1);
   }
-  
-  return response;
 }
 
 /**
- * Send command and wait for ACK from STM32
- * Returns true if ACK received, false if timeout
+ * Wait for the STM32's boot line (setup() only, before uartTask owns Serial2)
  */
-
 bool waitForSTM32Ready(uint32_t timeout_ms) {
   unsigned long start = millis();
   String line = "";
@@ -287,57 +471,518 @@ bool waitForSTM32Ready(uint32_t timeout_ms) {
   Serial.println("WARNING: STM32 READY message not received (timeout)");
   return false;
 }
-bool sendCommandAndWaitForAck(String command, int timeout_ms) {
-  // Clear buffer
-  while (Serial2.available()) {
-    Serial2.read();
+
+/**
+ * Queue a command for the STM32; never blocks
+ * Returns false if the queue is full (command dropped)
+ */
+bool queueSTM32Command(const char* command, uint8_t reply) {
+  UartCommand cmd;
+
+  if (strlen(command) >= UART_COMMAND_MAX) {
+    Serial.println("✗ Command too long: " + String(command));
+    return false;
   }
-  
-  // Send command
-  Serial2.print(command);
-  Serial2.print('\n');
-  Serial2.flush();
-  
-  // Wait for ACK response
-  unsigned long startTime = millis();
-  String response = "";
-  
-  while (millis() - startTime < timeout_ms) {
-    if (Serial2.available()) {
+  strcpy(cmd.line, command);
+  cmd.reply = reply;
+  if (xQueueSend(uartCommandQueue, &cmd, 0) != pdPASS) {
+    Serial.println("✗ STM32 queue full, dropped: " + String(command));
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Commands that set the same thing: a newer one makes an older one's
+ * retry wrong (it would undo the newer value). SETALL sets everything.
+ */
+static bool sameTarget(const char* older, const char* newer) {
+  if (strncmp(older, "SETALL:", 7) == 0 || strncmp(newer, "SETALL:", 7) == 0) {
+    return true;
+  }
+  const char* a = strchr(older, ':');
+  const char* b = strchr(newer, ':');
+  if (a == NULL || b == NULL || (a - older) != (b - newer) || strncmp(older, newer, a - older) != 0) {
+    return false;
+  }
+  // "OVR:ON" and "OVR:OFF" are one switch, "OVR:<params>" another
+  return (isalpha((unsigned char)a[1]) != 0) == (isalpha((unsigned char)b[1]) != 0);
+}
+
+struct InFlight {
+  bool used;
+  bool superseded;     // a newer command set the same thing: no retry
+  uint8_t attempts;
+  uint32_t seq;
+  unsigned long sentMs;
+  UartCommand cmd;
+};
+
+static void sendTagged(const InFlight& slot) {
+  Serial2.print("#" + String((unsigned long)slot.seq) + " " + String(slot.cmd.line) + "\n");
+}
+
+static void finishCommand(InFlight& slot, bool ok, const String& line) {
+  if (slot.cmd.reply != REPLY_NONE) {
+    UartReply reply;
+    reply.kind = slot.cmd.reply;
+    reply.ok = ok;
+    strncpy(reply.line, line.c_str(), UART_COMMAND_MAX - 1);
+    reply.line[UART_COMMAND_MAX - 1] = '\0';
+    xQueueSend(uartReplyQueue, &reply, 0);
+  }
+  slot.used = false;
+}
+
+/**
+ * One line from the STM32: a tagged reply completes its command
+ */
+static void handleSTM32Line(InFlight* slots, const String& line) {
+  if (!line.startsWith("#")) {
+    if (line.equals("STM32_READY")) {
+      Serial.println("STM32 restarted");  // the next sync check resends the state
+    } else if (line.startsWith("ACK:")) {
+      Serial.println("<- STM32: " + line);
+    }
+    return;
+  }
+
+  int space = line.indexOf(' ');
+  uint32_t seq = strtoul(line.c_str() + 1, NULL, 10);
+  String reply = (space > 0) ? line.substring(space + 1) : String();
+  for (int i = 0; i < UART_MAX_INFLIGHT; i++) {
+    if (slots[i].used && slots[i].seq == seq) {
+      bool ok = reply.startsWith("ACK:");
+      if (!ok) {
+        Serial.println("✗ STM32 rejected: " + String(slots[i].cmd.line));
+      }
+      finishCommand(slots[i], ok, reply);
+      return;
+    }
+  }
+}
+
+/**
+ * STM32 link task: sends queued commands with up to UART_MAX_INFLIGHT
+ * awaiting their ACK, matches ACKs by sequence number, resends on timeout
+ * and feeds binary frames to the frame parser
+ */
+void uartTask(void* parameters) {
+  static InFlight slots[UART_MAX_INFLIGHT];
+  uint32_t nextSeq = 1;
+  String line = "";
+
+  for (;;) {
+    // Fill free slots, oldest command first
+    for (int i = 0; i < UART_MAX_INFLIGHT; i++) {
+      if (slots[i].used || xQueueReceive(uartCommandQueue, &slots[i].cmd, 0) != pdPASS) {
+        continue;
+      }
+      for (int j = 0; j < UART_MAX_INFLIGHT; j++) {
+        if (j != i && slots[j].used && sameTarget(slots[j].cmd.line, slots[i].cmd.line)) {
+          slots[j].superseded = true;
+        }
+      }
+      slots[i].used = true;
+      slots[i].superseded = false;
+      slots[i].attempts = 1;
+      slots[i].seq = nextSeq++;
+      slots[i].sentMs = millis();
+      sendTagged(slots[i]);
+    }
+
+    while (Serial2.available()) {
       char c = Serial2.read();
+      if (feedFrameParser((uint8_t)c)) {
+        continue;  // Byte belongs to a binary frame
+      }
       if (c == '\n' || c == '\r') {
-        if (response.length() > 0) {
-          // Check if response starts with "ACK:"
-          if (response.startsWith("ACK:")) {
-            return true;  // Success - no need to print every ACK
-          }
+        if (line.length() > 0) {
+          handleSTM32Line(slots, line);
         }
-        response = "";  // Reset for next line
-      } else if (c >= 32 && c <= 126) {
-        response += c;
+        line = "";
+      } else if (c >= 32 && c <= 126 && line.length() < UART_COMMAND_MAX) {
+        line += c;
       }
     }
-    // Don't use delay(1) - wastes time. Just yield()
-    yield();
+
+    for (int i = 0; i < UART_MAX_INFLIGHT; i++) {
+      if (!slots[i].used || millis() - slots[i].sentMs < (unsigned long)uart_ack_timeout_ms) {
+        continue;
+      }
+      if (slots[i].attempts < uart_max_attempts && !slots[i].superseded) {
+        slots[i].attempts++;
+        slots[i].sentMs = millis();
+        sendTagged(slots[i]);
+      } else {
+        if (!slots[i].superseded) {
+          Serial.println("✗ ACK timeout for: " + String(slots[i].cmd.line));
+        }
+        finishCommand(slots[i], false, String());
+      }
+    }
+
+    uint8_t used = 0;
+    for (int i = 0; i < UART_MAX_INFLIGHT; i++) {
+      used += slots[i].used ? 1 : 0;
+    }
+    uartInFlight = used;
+
+    vTaskDelay(1);
   }
-  
-  // Only print errors to reduce serial spam
-  Serial.print("✗ ACK timeout for: ");
-  Serial.println(command);
+}
+
+/**
+ * Replies loop() asked for: SETALL fallback and the sync check
+ */
+void serviceSTM32Replies() {
+  UartReply reply;
+
+  while (xQueueReceive(uartReplyQueue, &reply, 0) == pdPASS) {
+    String line = String(reply.line);
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    if (reply.kind == REPLY_SETALL) {
+      if (!reply.ok) {
+        Serial.println("WARNING: SETALL not acknowledged, sending parameters one by one");
+        sendStateAsSeparateCommands();
+      }
+    } else if (reply.kind == REPLY_RATE) {
+      int comma = line.indexOf(',');
+      if (reply.ok && line.startsWith("ACK:SR=") && comma > 0) {
+        stm32SampleRate = strtof(line.substring(comma + 1).c_str(), NULL);
+      }
+    } else if (reply.kind == REPLY_HASH) {
+      syncCheckPending = false;
+      // No answer (older firmware or busy link): try again at the next check
+      // (changes still waiting for a flush would read as a mismatch)
+      // On a mismatch, serviceStateDump() finds what differs from the dump
+      if (reply.ok && dirtyGroups == 0 && !stateDumpPending && line.startsWith("ACK:HASH=") &&
+          strtoul(line.substring(9).c_str(), NULL, 16) != expectedStateDigest()) {
+        stateDumpReady = false;
+        stateDumpPending = queueSTM32Command("DUMP?");
+        stateDumpRequestedMs = millis();
+      }
+    }
+    xSemaphoreGive(effectsLock);
+  }
+}
+
+/**
+ * Format the SETALL command carrying the complete effect state; returns
+ * its length. Field order matches Parse_UART_Command on the STM32.
+ */
+int formatSetAll(char* out, size_t size) {
+  return snprintf(out, size,
+                  "SETALL:%.2f,%.1f,%.2f,%.2f,%.2f,%d,%d,%.0f,%.2f,%.2f,%.2f,%d,%.3f,%.4f,%.2f,%d",
+                  effects.volume, effects.overdrive_gain, effects.overdrive_threshold,
+                  effects.overdrive_tone, effects.overdrive_mix, effects.overdrive_mode,
+                  effects.overdrive_enabled ? 1 : 0, effects.delay_time_ms, effects.delay_feedback,
+                  effects.delay_mix, effects.delay_tone, effects.delay_enabled ? 1 : 0,
+                  effects.gate_threshold, effects.gate_attack, effects.gate_release,
+                  effects.gate_enabled ? 1 : 0);
+}
+
+/**
+ * Format the command that sets one parameter group (the commands firmware
+ * without SETALL understands); returns its length
+ */
+int formatGroup(uint8_t group, char* out, size_t size) {
+  switch (group) {
+    case GROUP_VOLUME:
+      return snprintf(out, size, "VOL:%.2f", effects.volume);
+    case GROUP_OVR:
+      return snprintf(out, size, "OVR:%.1f,%.2f,%.2f,%.2f,%d", effects.overdrive_gain,
+                      effects.overdrive_threshold, effects.overdrive_tone,
+                      effects.overdrive_mix, effects.overdrive_mode);
+    case GROUP_OVR_SWITCH:
+      return snprintf(out, size, "OVR:%s", effects.overdrive_enabled ? "ON" : "OFF");
+    case GROUP_DLY:
+      return snprintf(out, size, "DLY:%.0f,%.2f,%.2f,%.2f", effects.delay_time_ms,
+                      effects.delay_feedback, effects.delay_mix, effects.delay_tone);
+    case GROUP_DLY_SWITCH:
+      return snprintf(out, size, "DLY:%s", effects.delay_enabled ? "ON" : "OFF");
+    case GROUP_GATE:
+      return snprintf(out, size, "GATE:%.3f,%.4f,%.2f", effects.gate_threshold,
+                      effects.gate_attack, effects.gate_release);
+    case GROUP_GATE_SWITCH:
+      return snprintf(out, size, "GATE:%s", effects.gate_enabled ? "ON" : "OFF");
+  }
+  out[0] = '\0';
+  return 0;
+}
+
+/**
+ * Send the dirty groups as one command: a single group as its own command,
+ * several as one SETALL once that is no longer than the separate commands
+ * with their tags and ACKs (SETALL also lands in a single audio block)
+ */
+void flushEffectChanges() {
+  char cmd[UART_COMMAND_MAX];
+  char setall[UART_COMMAND_MAX];
+  int separate = 0;
+  int groups = 0;
+
+  for (uint8_t g = 0; g < GROUP_COUNT; g++) {
+    if (dirtyGroups & (1 << g)) {
+      separate += formatGroup(g, cmd, sizeof(cmd)) + 1;
+      groups++;
+    }
+  }
+
+  int setallLength = formatSetAll(setall, sizeof(setall));
+  if (groups > 1 && setallLength <= separate + (groups - 1) * uart_command_overhead) {
+    queueSTM32Command(setall, REPLY_SETALL);
+  } else {
+    for (uint8_t g = 0; g < GROUP_COUNT; g++) {
+      if (dirtyGroups & (1 << g)) {
+        formatGroup(g, cmd, sizeof(cmd));
+        queueSTM32Command(cmd);
+      }
+    }
+  }
+  dirtyGroups = 0;
+}
+
+/**
+ * Initialize STM32 one parameter group at a time (firmware without SETALL)
+ */
+void sendStateAsSeparateCommands() {
+  char cmd[UART_COMMAND_MAX];
+
+  for (uint8_t g = 0; g < GROUP_COUNT; g++) {
+    formatGroup(g, cmd, sizeof(cmd));
+    queueSTM32Command(cmd);
+  }
+}
+
+/**
+ * Feed one byte from STM32 into the binary frame parser.
+ * Returns true if the byte was consumed by a frame (caller must skip it).
+ */
+bool feedFrameParser(uint8_t c) {
+  static uint8_t state = 0;
+  static uint8_t type = 0;
+  static uint16_t len = 0;
+  static uint16_t pos = 0;
+  static uint8_t checksum = 0;
+  static uint8_t payload[FRAME_MAX_PAYLOAD];
+
+  switch (state) {
+    case 0:
+      if (c == FRAME_SYNC0) { state = 1; return true; }
+      return false;
+    case 1:
+      if (c == FRAME_SYNC1) { state = 2; return true; }
+      state = 0;
+      return false;
+    case 2:
+      type = c; checksum = c; state = 3;
+      return true;
+    case 3:
+      len = c; checksum ^= c; state = 4;
+      return true;
+    case 4:
+      len |= (uint16_t)c << 8; checksum ^= c; pos = 0;
+      state = (len > FRAME_MAX_PAYLOAD) ? 0 : (len == 0 ? 6 : 5);
+      return true;
+    case 5:
+      payload[pos++] = c; checksum ^= c;
+      if (pos >= len) state = 6;
+      return true;
+    case 6:
+      state = 0;
+      if (c == checksum) {
+        handleFrame(type, payload, len);
+      }
+      return true;
+  }
+  state = 0;
   return false;
 }
 
+/**
+ * Dispatch a validated binary frame from STM32
+ */
+void handleFrame(uint8_t type, const uint8_t* payload, uint16_t len) {
+  if (type == FRAME_TELEMETRY && len == sizeof(TelemetryFrame)) {
+    memcpy(&latestTelemetry, payload, sizeof(TelemetryFrame));
+    latestTelemetryMs = millis();
+    pushMeters();
+  } else if (type == FRAME_TUNER && len == sizeof(TunerFrame)) {
+    memcpy(&latestTuner, payload, sizeof(TunerFrame));
+    pushTuner();
+  } else if (type == FRAME_GOVERNOR && len == sizeof(GovernorFrame)) {
+    uint32_t previousRate = latestGovernor.sample_rate;
+    memcpy(&latestGovernor, payload, sizeof(GovernorFrame));
+    if (previousRate != 0 && latestGovernor.sample_rate != previousRate) {
+      Serial.printf("STM32 sample rate now %lu Hz (load %u.%u%%)\n",
+                    (unsigned long)latestGovernor.sample_rate,
+                    latestGovernor.load_permille / 10, latestGovernor.load_permille % 10);
+    } else if (latestGovernor.level > latestGovernor.previous) {
+      Serial.printf("WARNING: STM32 CPU load %u.%u%%, quality reduced to level %u\n",
+                    latestGovernor.load_permille / 10, latestGovernor.load_permille % 10,
+                    latestGovernor.level);
+    } else {
+      Serial.printf("STM32 quality restored to level %u\n", latestGovernor.level);
+    }
+  } else if (type == FRAME_SCOPE_HEADER || type == FRAME_SCOPE_DATA) {
+    uint8_t msg[1 + FRAME_MAX_PAYLOAD];
+    msg[0] = type;
+    memcpy(msg + 1, payload, len);
+    if (localSocket.count() > 0) {
+      localSocket.binaryAll(msg, 1 + len);
+    }
+  } else if (type == FRAME_STATE_DUMP && len == sizeof(DspState) && !stateDumpReady) {
+    memcpy(&lastDumpedState, payload, sizeof(DspState));
+    stateDumpReady = true;  // loop() reads it, then clears this
+  }
+}
+
+/**
+ * CRC-32/MPEG-2 (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection),
+ * same as the STM32 hardware CRC unit
+ */
+uint32_t crc32Mpeg2(const uint8_t* data, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint32_t)data[i] << 24;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+ * State the STM32 should hold for what we send.
+ * Parses our own SETALL text back the way the STM32 does, so every
+ * float is rounded identically.
+ */
+void expectedState(DspState& s) {
+  char cmd[UART_COMMAND_MAX];
+  float v[16];
+  const char* field = cmd + 7;  // after "SETALL:"
+  formatSetAll(cmd, sizeof(cmd));
+  for (int i = 0; i < 16; i++) {
+    v[i] = (float)atof(field);
+    field = strchr(field, ',');
+    field = field ? field + 1 : "";
+  }
+
+  memset(&s, 0, sizeof(s));
+  s.volume = v[0];
+  s.od_gain = v[1];
+  s.od_threshold = v[2];
+  s.od_tone = v[3];
+  s.od_mix = v[4];
+  s.od_mode = (uint8_t)v[5];
+  s.od_enabled = (uint8_t)v[6];
+  s.dly_samples = (uint32_t)((v[7] / 1000.0f) * stm32SampleRate);
+  if (s.dly_samples > STM32_DELAY_BUFFER_SIZE) s.dly_samples = STM32_DELAY_BUFFER_SIZE;
+  s.dly_feedback = v[8];
+  s.dly_mix = v[9];
+  s.dly_tone = v[10];
+  s.dly_enabled = (uint8_t)v[11];
+  s.gate_threshold = v[12];
+  s.gate_attack = v[13];
+  s.gate_release = v[14];
+  s.gate_enabled = (uint8_t)v[15];
+}
+
+/**
+ * Digest the STM32 should report for the state we send
+ */
+uint32_t expectedStateDigest() {
+  DspState s;
+  expectedState(s);
+  return crc32Mpeg2((const uint8_t*)&s, sizeof(s));
+}
+
+/**
+ * After a digest mismatch: compare the STM32's DUMP? frame with what we
+ * sent and mark only the groups that differ for the next flush. Without a
+ * dump (older firmware, lost frame) everything is resent.
+ */
+void serviceStateDump() {
+  if (!stateDumpPending) {
+    return;
+  }
+  if (!stateDumpReady && millis() - stateDumpRequestedMs < (unsigned long)state_dump_timeout_ms) {
+    return;
+  }
+
+  uint8_t groups = (1 << GROUP_COUNT) - 1;
+  xSemaphoreTake(effectsLock, portMAX_DELAY);
+  if (stateDumpReady) {
+    const DspState& got = lastDumpedState;
+    DspState want;
+    expectedState(want);
+    groups = 0;
+    if (got.volume != want.volume) groups |= 1 << GROUP_VOLUME;
+    if (got.od_gain != want.od_gain || got.od_threshold != want.od_threshold ||
+        got.od_tone != want.od_tone || got.od_mix != want.od_mix || got.od_mode != want.od_mode) {
+      groups |= 1 << GROUP_OVR;
+    }
+    if (got.od_enabled != want.od_enabled) groups |= 1 << GROUP_OVR_SWITCH;
+    if (got.dly_samples != want.dly_samples || got.dly_feedback != want.dly_feedback ||
+        got.dly_mix != want.dly_mix || got.dly_tone != want.dly_tone) {
+      groups |= 1 << GROUP_DLY;
+    }
+    if (got.dly_enabled != want.dly_enabled) groups |= 1 << GROUP_DLY_SWITCH;
+    if (got.gate_threshold != want.gate_threshold || got.gate_attack != want.gate_attack ||
+        got.gate_release != want.gate_release) {
+      groups |= 1 << GROUP_GATE;
+    }
+    if (got.gate_enabled != want.gate_enabled) groups |= 1 << GROUP_GATE_SWITCH;
+    if (groups != 0) {  // none: the STM32 caught up after the HASH?
+      Serial.printf("STM32 state out of sync (groups %02X), resending them\n", groups);
+    }
+  } else {
+    Serial.println("STM32 state out of sync and no state dump, resending full state");
+  }
+  dirtyGroups |= groups;
+  xSemaphoreGive(effectsLock);
+
+  stateDumpPending = false;
+  stateDumpReady = false;
+}
+
+/**
+ * Ask the STM32 for its sample rate and state digest; the answers come
+ * back through serviceSTM32Replies(), which resends everything on mismatch
+ */
+void checkSTM32Sync() {
+  if (syncCheckPending) {
+    return;  // Last check not answered yet
+  }
+  syncCheckPending = queueSTM32Command("SR?", REPLY_RATE) &&
+                     queueSTM32Command("HASH?", REPLY_HASH);
+}
+
 /**
  * Poll backend for effect updates and apply them to STM32
  */
 void pollBackendForUpdates() {
   HTTPClient http;
-  http.begin(String(backend_url) + "/api/effects");
+  const char* headerKeys[] = { "ETag" };
+  
+  // After the first answer ask only for what changed since its revision
+  // (the ETag is that revision in quotes); 304 when nothing did
+  String url = String(backend_url) + "/api/effects";
+  if (backendEtag.length() > 2) {
+    url += "?since=" + backendEtag.substring(1, backendEtag.length() - 1);
+  }
+  http.begin(url);
+  if (backendEtag.length() > 2) {
+    http.addHeader("If-None-Match", backendEtag);
+  }
+  http.collectHeaders(headerKeys, 1);
   http.setTimeout(2000);
   
   int httpCode = http.GET();
   
   if (httpCode == HTTP_CODE_OK) {
+    backendEtag = http.header("ETag");
     String payload = http.getString();
     StaticJsonDocument<1024> doc;
     
@@ -345,9 +990,11 @@ void pollBackendForUpdates() {
     
     if (!error && doc.containsKey("effects")) {
       JsonObject effectsObj = doc["effects"].as<JsonObject>();
-      applyEffectsFromJson(effectsObj);
+      xSemaphoreTake(effectsLock, portMAX_DELAY);
+      applyEffectsFromJson(effectsObj, staleSections(doc.as<JsonObject>()));
+      xSemaphoreGive(effectsLock);
     }
-  } else if (httpCode > 0) {
+  } else if (httpCode > 0 && httpCode != HTTP_CODE_NOT_MODIFIED) {
     Serial.print("Backend HTTP error: ");
     Serial.println(httpCode);
   }
@@ -356,165 +1003,633 @@ void pollBackendForUpdates() {
 }
 
 /**
- * Apply effects from JSON received from backend
+ * Split backend_url ("http://host:port") into host and port
  */
-void applyEffectsFromJson(JsonObject json) {
-  static EffectParams lastEffects = effects;  // Track changes
-  bool changed = false;
-  
-  // Check volume
-  if (json.containsKey("volume")) {
-    float newVol = json["volume"];
-    if (abs(newVol - lastEffects.volume) > 0.01) {
-      effects.volume = newVol;
-      sendCommandAndWaitForAck("VOL:" + String(effects.volume, 2), 1000);
-      Serial.println("-> Volume: " + String(effects.volume * 100) + "%");
-      lastEffects.volume = effects.volume;
-      changed = true;
+bool parseBackendUrl(String& host, uint16_t& port) {
+  String url = String(backend_url);
+  String rest = url.startsWith("http://") ? url.substring(7) : url;
+  int slash = rest.indexOf('/');
+  String authority = (slash < 0) ? rest : rest.substring(0, slash);
+  int colon = authority.indexOf(':');
+
+  host = (colon < 0) ? authority : authority.substring(0, colon);
+  port = (colon < 0) ? 80 : (uint16_t)authority.substring(colon + 1).toInt();
+  return host.length() > 0;
+}
+
+/**
+ * Keep the backend event stream open and apply what it pushes.
+ * Reconnects with exponential backoff. The request is HTTP/1.0 so the
+ * stream comes back unchunked: plain "data:" lines, blank line per event.
+ */
+void serviceEventStream() {
+  static unsigned long lastAttempt = 0;
+  static unsigned long retryMs = 0;
+  static unsigned long lastByteMs = 0;
+  static bool inHeaders = false;
+  static String line = "";
+  static String data = "";
+
+  if (!eventsClient.connected()) {
+    if (eventsStreaming) {
+      Serial.println("Backend event stream lost, polling until it is back");
     }
-  }
-  
-  // Check overdrive
-  if (json.containsKey("overdrive")) {
-    JsonObject ovr = json["overdrive"];
-    bool paramsChanged = false;
-    
-    if (ovr.containsKey("gain") && abs(ovr["gain"].as<float>() - lastEffects.overdrive_gain) > 0.1) {
-      effects.overdrive_gain = ovr["gain"];
-      paramsChanged = true;
+    eventsStreaming = false;
+    inHeaders = false;
+    if (WiFi.status() != WL_CONNECTED || millis() - lastAttempt < retryMs) {
+      return;
     }
-    if (ovr.containsKey("threshold") && abs(ovr["threshold"].as<float>() - lastEffects.overdrive_threshold) > 0.01) {
-      effects.overdrive_threshold = ovr["threshold"];
-      paramsChanged = true;
+    lastAttempt = millis();
+
+    String host;
+    uint16_t port;
+    backendReachable = parseBackendUrl(host, port) &&
+                       eventsClient.connect(host.c_str(), port, events_connect_timeout_ms);
+    if (!backendReachable) {
+      retryMs = (retryMs == 0) ? events_retry_min_ms : retryMs * 2;
+      if (retryMs > events_retry_max_ms) retryMs = events_retry_max_ms;
+      return;
     }
-    if (ovr.containsKey("tone") && abs(ovr["tone"].as<float>() - lastEffects.overdrive_tone) > 0.01) {
-      effects.overdrive_tone = ovr["tone"];
-      paramsChanged = true;
+    eventsClient.print("GET /api/events HTTP/1.0\r\nHost: " + host + "\r\nAccept: text/event-stream\r\n\r\n");
+    inHeaders = true;
+    line = "";
+    data = "";
+    lastByteMs = millis();
+    return;
+  }
+
+  while (eventsClient.available()) {
+    char c = eventsClient.read();
+    lastByteMs = millis();
+    if (c == '\r') {
+      continue;
     }
-    if (ovr.containsKey("mix") && abs(ovr["mix"].as<float>() - lastEffects.overdrive_mix) > 0.01) {
-      effects.overdrive_mix = ovr["mix"];
-      paramsChanged = true;
+    if (c != '\n') {
+      line += c;
+      if (line.length() > 2048) {
+        eventsClient.stop();  // Not an event stream
+        return;
+      }
+      continue;
     }
-    if (ovr.containsKey("mode") && ovr["mode"].as<int>() != lastEffects.overdrive_mode) {
-      effects.overdrive_mode = ovr["mode"];
-      paramsChanged = true;
+
+    if (inHeaders) {
+      if (line.startsWith("HTTP/") && line.indexOf(" 200") < 0) {
+        Serial.println("Backend has no event stream (" + line + "), polling");
+        eventsClient.stop();
+        retryMs = events_retry_max_ms;
+        return;
+      }
+      if (line.length() == 0) {
+        inHeaders = false;
+        eventsStreaming = true;
+        retryMs = 0;
+        Serial.println("Backend event stream connected");
+      }
+    } else if (line.length() == 0) {
+      // Blank line ends an event; "state" and "delta" share one shape
+      if (data.length() > 0) {
+        handleBackendEvent(data);
+      }
+      data = "";
+    } else if (line.startsWith("data:")) {
+      data += line.substring(line.startsWith("data: ") ? 6 : 5);
     }
-    
-    if (paramsChanged && effects.overdrive_enabled) {
-      String cmd = "OVR:" + String(effects.overdrive_gain, 1) + "," + 
-                   String(effects.overdrive_threshold, 2) + "," + 
-                   String(effects.overdrive_tone, 2) + "," +
-                   String(effects.overdrive_mix, 2) + "," +
-                   String(effects.overdrive_mode);
-      sendCommandAndWaitForAck(cmd, 1500);
-      Serial.println("-> Overdrive params updated");
-      lastEffects.overdrive_gain = effects.overdrive_gain;
-      lastEffects.overdrive_threshold = effects.overdrive_threshold;
-      lastEffects.overdrive_tone = effects.overdrive_tone;
-      lastEffects.overdrive_mix = effects.overdrive_mix;
-      lastEffects.overdrive_mode = effects.overdrive_mode;
-      changed = true;
-      delay(100);
+    // "event:" names and ":" heartbeats need no handling
+    line = "";
+  }
+
+  if (millis() - lastByteMs > events_idle_timeout_ms) {
+    Serial.println("Backend event stream silent, reconnecting");
+    eventsClient.stop();
+  }
+}
+
+/**
+ * Apply one pushed event: {"revision": n, "effects": {...}} with the whole
+ * state or only the fields that changed
+ */
+void handleBackendEvent(const String& data) {
+  StaticJsonDocument<1024> doc;
+
+  DeserializationError error = deserializeJson(doc, data);
+  if (!error && doc.containsKey("effects")) {
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    applyEffectsFromJson(doc["effects"].as<JsonObject>(), staleSections(doc.as<JsonObject>()));
+    xSemaphoreGive(effectsLock);
+  }
+}
+
+/**
+ * Sections a backend answer or event must not overwrite: local changes not
+ * forwarded yet, and forwarded ones the answer's revision predates.
+ * Callers hold effectsLock.
+ */
+uint8_t staleSections(JsonVariant doc) {
+  double revision = doc["revision"].as<double>();
+  uint8_t stale = unsentSections;
+
+  for (uint8_t s = 0; s < SECTION_COUNT; s++) {
+    if (revision < forwardedRevision[s]) {
+      stale |= 1 << s;
     }
-    
-    if (ovr.containsKey("enabled") && ovr["enabled"].as<bool>() != lastEffects.overdrive_enabled) {
-      effects.overdrive_enabled = ovr["enabled"];
-      sendCommandAndWaitForAck(effects.overdrive_enabled ? "OVR:ON" : "OVR:OFF", 1000);
-      Serial.println("-> Overdrive " + String(effects.overdrive_enabled ? "ON" : "OFF"));
-      lastEffects.overdrive_enabled = effects.overdrive_enabled;
-      changed = true;
+  }
+  return stale;
+}
+
+/**
+ * Send the sections changed by local clients to the backend's POST
+ * /api/effects, so it and its other clients follow. The revision it
+ * answers marks older backend state as stale for those sections. A
+ * refused change (422, over the DSP budget) is dropped; anything else is
+ * retried.
+ */
+void forwardLocalChanges() {
+  char body[LOCAL_STATE_MAX];
+  char part[LOCAL_STATE_MAX / 2];
+  uint8_t sections;
+  int n;
+
+  xSemaphoreTake(effectsLock, portMAX_DELAY);
+  sections = unsentSections;
+  unsentSections = 0;
+  n = snprintf(body, sizeof(body), "{");
+  if (sections & (1 << SECTION_VOLUME)) {
+    n += snprintf(body + n, sizeof(body) - n, "\"volume\":%.2f,", effects.volume);
+  }
+  if (sections & (1 << SECTION_OVERDRIVE)) {
+    formatOverdriveJson(part, sizeof(part));
+    n += snprintf(body + n, sizeof(body) - n, "\"overdrive\":%s,", part);
+  }
+  if (sections & (1 << SECTION_DELAY)) {
+    formatDelayJson(part, sizeof(part));
+    n += snprintf(body + n, sizeof(body) - n, "\"delay\":%s,", part);
+  }
+  if (sections & (1 << SECTION_GATE)) {
+    formatGateJson(part, sizeof(part));
+    n += snprintf(body + n, sizeof(body) - n, "\"gate\":%s,", part);
+  }
+  xSemaphoreGive(effectsLock);
+  if (n < 2 || n >= (int)sizeof(body)) {
+    return;
+  }
+  body[n - 1] = '}';  // over the last comma
+
+  HTTPClient http;
+  http.begin(String(backend_url) + "/api/effects");
+  http.addHeader("Content-Type", "application/json");
+  http.setTimeout(2000);
+  int httpCode = http.POST(String(body));
+  String answer = (httpCode == HTTP_CODE_OK) ? http.getString() : String();
+  http.end();
+
+  if (httpCode == HTTP_CODE_OK) {
+    StaticJsonDocument<1024> doc;
+    if (!deserializeJson(doc, answer) && doc.containsKey("revision")) {
+      double revision = doc["revision"].as<double>();
+      xSemaphoreTake(effectsLock, portMAX_DELAY);
+      for (uint8_t s = 0; s < SECTION_COUNT; s++) {
+        if (sections & (1 << s)) {
+          forwardedRevision[s] = revision;
+        }
+      }
+      xSemaphoreGive(effectsLock);
     }
+    return;
+  }
+  if (httpCode == 422) {
+    Serial.println("WARNING: backend refused a local change (over the DSP budget)");
+    return;
+  }
+  xSemaphoreTake(effectsLock, portMAX_DELAY);
+  unsentSections |= sections;
+  xSemaphoreGive(effectsLock);
+}
+
+/**
+ * Take obj[key] into `value` if it is there, inside [lo, hi] (the ranges
+ * backend/server.js accepts) and more than `step` away from the current value
+ */
+static bool takeParam(JsonObject obj, const char* key, float lo, float hi, float step, float& value) {
+  if (!obj.containsKey(key)) {
+    return false;
   }
+  float v = obj[key].as<float>();
+  if (v < lo || v > hi || abs(v - value) <= step) {
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+/**
+ * Per-group appliers: changed values go into `effects` and mark their group
+ * for the next flushEffectChanges(). Callers hold effectsLock.
+ */
+bool applyVolume(float volume) {
+  if (volume < 0.0f || volume > 1.0f || abs(volume - effects.volume) <= 0.01f) {
+    return false;
+  }
+  effects.volume = volume;
+  dirtyGroups |= 1 << GROUP_VOLUME;
+  Serial.println("-> Volume: " + String(effects.volume * 100) + "%");
+  return true;
+}
+
+bool applyOverdrive(JsonObject ovr) {
+  bool changed = false;
+  bool paramsChanged = false;
   
-  // Check delay
-  if (json.containsKey("delay")) {
-    JsonObject dly = json["delay"];
-    bool paramsChanged = false;
-    
-    if (dly.containsKey("time_ms") && abs(dly["time_ms"].as<float>() - lastEffects.delay_time_ms) > 1.0) {
-      effects.delay_time_ms = dly["time_ms"];
-      paramsChanged = true;
-    }
-    if (dly.containsKey("feedback") && abs(dly["feedback"].as<float>() - lastEffects.delay_feedback) > 0.01) {
-      effects.delay_feedback = dly["feedback"];
-      paramsChanged = true;
-    }
-    if (dly.containsKey("mix") && abs(dly["mix"].as<float>() - lastEffects.delay_mix) > 0.01) {
-      effects.delay_mix = dly["mix"];
-      paramsChanged = true;
-    }
-    if (dly.containsKey("tone") && abs(dly["tone"].as<float>() - lastEffects.delay_tone) > 0.01) {
-      effects.delay_tone = dly["tone"];
-      paramsChanged = true;
+  paramsChanged |= takeParam(ovr, "gain", 1.0f, 100.0f, 0.1f, effects.overdrive_gain);
+  paramsChanged |= takeParam(ovr, "threshold", 0.1f, 0.95f, 0.01f, effects.overdrive_threshold);
+  paramsChanged |= takeParam(ovr, "tone", 0.0f, 1.0f, 0.01f, effects.overdrive_tone);
+  paramsChanged |= takeParam(ovr, "mix", 0.0f, 1.0f, 0.01f, effects.overdrive_mix);
+  if (ovr.containsKey("mode") && ovr["mode"].as<int>() != effects.overdrive_mode &&
+      ovr["mode"].as<int>() >= 0 && ovr["mode"].as<int>() <= 2) {
+    effects.overdrive_mode = ovr["mode"];
+    paramsChanged = true;
+  }
+  
+  if (paramsChanged) {
+    dirtyGroups |= 1 << GROUP_OVR;
+    Serial.println("-> Overdrive params updated");
+    changed = true;
+  }
+  
+  if (ovr.containsKey("enabled") && ovr["enabled"].as<bool>() != effects.overdrive_enabled) {
+    effects.overdrive_enabled = ovr["enabled"];
+    dirtyGroups |= 1 << GROUP_OVR_SWITCH;
+    Serial.println("-> Overdrive " + String(effects.overdrive_enabled ? "ON" : "OFF"));
+    changed = true;
+  }
+  return changed;
+}
+
+bool applyDelay(JsonObject dly) {
+  bool changed = false;
+  bool paramsChanged = false;
+  
+  paramsChanged |= takeParam(dly, "time_ms", 20.0f, 500.0f, 1.0f, effects.delay_time_ms);
+  paramsChanged |= takeParam(dly, "feedback", 0.0f, 0.95f, 0.01f, effects.delay_feedback);
+  paramsChanged |= takeParam(dly, "mix", 0.0f, 1.0f, 0.01f, effects.delay_mix);
+  paramsChanged |= takeParam(dly, "tone", 0.0f, 1.0f, 0.01f, effects.delay_tone);
+  
+  if (paramsChanged) {
+    dirtyGroups |= 1 << GROUP_DLY;
+    Serial.println("-> Delay params updated");
+    changed = true;
+  }
+  
+  if (dly.containsKey("enabled") && dly["enabled"].as<bool>() != effects.delay_enabled) {
+    effects.delay_enabled = dly["enabled"];
+    dirtyGroups |= 1 << GROUP_DLY_SWITCH;
+    Serial.println("-> Delay " + String(effects.delay_enabled ? "ON" : "OFF"));
+    changed = true;
+  }
+  return changed;
+}
+
+bool applyGate(JsonObject gate) {
+  bool changed = false;
+  bool paramsChanged = false;
+  
+  paramsChanged |= takeParam(gate, "threshold", 0.001f, 0.5f, 0.001f, effects.gate_threshold);
+  paramsChanged |= takeParam(gate, "attack", 0.0001f, 0.1f, 0.0001f, effects.gate_attack);
+  paramsChanged |= takeParam(gate, "release", 0.01f, 1.0f, 0.01f, effects.gate_release);
+  
+  if (paramsChanged) {
+    dirtyGroups |= 1 << GROUP_GATE;
+    Serial.println("-> Gate params updated");
+    changed = true;
+  }
+  
+  if (gate.containsKey("enabled") && gate["enabled"].as<bool>() != effects.gate_enabled) {
+    effects.gate_enabled = gate["enabled"];
+    dirtyGroups |= 1 << GROUP_GATE_SWITCH;
+    Serial.println("-> Gate " + String(effects.gate_enabled ? "ON" : "OFF"));
+    changed = true;
+  }
+  return changed;
+}
+
+/**
+ * Apply an effects object ({"volume": .., "overdrive": {..}, ...}, whole or
+ * partial) from the backend, leaving out `skipSections` (1 << EffectSection).
+ * Callers hold effectsLock.
+ */
+bool applyEffectsFromJson(JsonObject json, uint8_t skipSections) {
+  bool changed = false;
+  
+  if (json.containsKey("volume") && !(skipSections & (1 << SECTION_VOLUME))) {
+    changed |= applyVolume(json["volume"].as<float>());
+  }
+  if (json.containsKey("overdrive") && !(skipSections & (1 << SECTION_OVERDRIVE))) {
+    changed |= applyOverdrive(json["overdrive"].as<JsonObject>());
+  }
+  if (json.containsKey("delay") && !(skipSections & (1 << SECTION_DELAY))) {
+    changed |= applyDelay(json["delay"].as<JsonObject>());
+  }
+  if (json.containsKey("gate") && !(skipSections & (1 << SECTION_GATE))) {
+    changed |= applyGate(json["gate"].as<JsonObject>());
+  }
+  
+  if (changed) {
+    Serial.println("✓ Effects updated");
+  }
+  return changed;
+}
+
+/**
+ * Apply an effects object from a local client and mark what changed for
+ * forwardLocalChanges(). Callers hold effectsLock.
+ */
+void applyLocalEffects(JsonObject json) {
+  if (json.containsKey("volume") && applyVolume(json["volume"].as<float>())) {
+    unsentSections |= 1 << SECTION_VOLUME;
+  }
+  if (json.containsKey("overdrive") && applyOverdrive(json["overdrive"].as<JsonObject>())) {
+    unsentSections |= 1 << SECTION_OVERDRIVE;
+  }
+  if (json.containsKey("delay") && applyDelay(json["delay"].as<JsonObject>())) {
+    unsentSections |= 1 << SECTION_DELAY;
+  }
+  if (json.containsKey("gate") && applyGate(json["gate"].as<JsonObject>())) {
+    unsentSections |= 1 << SECTION_GATE;
+  }
+}
+
+/**
+ * Effect state as the backend's JSON (GET /api/effects shapes).
+ * Callers hold effectsLock.
+ */
+int formatOverdriveJson(char* out, size_t size) {
+  return snprintf(out, size, "{\"enabled\":%s,\"gain\":%.1f,\"threshold\":%.2f,\"tone\":%.2f,\"mix\":%.2f,\"mode\":%d}",
+                  effects.overdrive_enabled ? "true" : "false", effects.overdrive_gain,
+                  effects.overdrive_threshold, effects.overdrive_tone, effects.overdrive_mix,
+                  effects.overdrive_mode);
+}
+
+int formatDelayJson(char* out, size_t size) {
+  return snprintf(out, size, "{\"enabled\":%s,\"time_ms\":%.0f,\"feedback\":%.2f,\"mix\":%.2f,\"tone\":%.2f}",
+                  effects.delay_enabled ? "true" : "false", effects.delay_time_ms,
+                  effects.delay_feedback, effects.delay_mix, effects.delay_tone);
+}
+
+int formatGateJson(char* out, size_t size) {
+  return snprintf(out, size, "{\"enabled\":%s,\"threshold\":%.3f,\"attack\":%.4f,\"release\":%.2f}",
+                  effects.gate_enabled ? "true" : "false", effects.gate_threshold,
+                  effects.gate_attack, effects.gate_release);
+}
+
+int formatEffectsJson(char* out, size_t size) {
+  char ovr[128], dly[128], gate[128];
+
+  formatOverdriveJson(ovr, sizeof(ovr));
+  formatDelayJson(dly, sizeof(dly));
+  formatGateJson(gate, sizeof(gate));
+  return snprintf(out, size, "{\"volume\":%.2f,\"overdrive\":%s,\"delay\":%s,\"gate\":%s}",
+                  effects.volume, ovr, dly, gate);
+}
+
+/**
+ * Show the latest telemetry frame to /ws clients (called on the UART task).
+ * Levels are linear full scale, gain reductions in dB.
+ */
+void pushMeters() {
+  const TelemetryFrame& t = latestTelemetry;
+  char msg[256];
+
+  if (localSocket.count() == 0) {
+    return;
+  }
+  snprintf(msg, sizeof(msg),
+           "{\"type\":\"meters\",\"seq\":%u,"
+           "\"in\":{\"peak\":%.4f,\"rms\":%.4f,\"clips\":%u},"
+           "\"out\":{\"peak\":%.4f,\"rms\":%.4f,\"clips\":%u},"
+           "\"gate_gain\":%.3f,\"drive_gr_db\":%.2f,\"comp_gr_db\":%.2f}",
+           t.seq, t.in_peak / 32767.0f, t.in_rms / 32767.0f, t.in_clips,
+           t.out_peak / 32767.0f, t.out_rms / 32767.0f, t.out_clips,
+           t.gate_gain / 32767.0f, t.drive_gr_cdb / 100.0f, t.comp_gr_cdb / 100.0f);
+  localSocket.textAll(msg);
+}
+
+/**
+ * Show the latest tuner reading to /ws clients (called on the UART task).
+ * note is the MIDI note number, 0 (and freq 0) while there is no pitch.
+ */
+void pushTuner() {
+  const TunerFrame& t = latestTuner;
+  char msg[160];
+
+  if (localSocket.count() == 0) {
+    return;
+  }
+  snprintf(msg, sizeof(msg),
+           "{\"type\":\"tuner\",\"seq\":%u,\"note\":%u,\"cents\":%d,\"freq\":%.1f,"
+           "\"confidence\":%.2f,\"muted\":%s}",
+           t.seq, t.note, t.cents, t.freq_dhz / 10.0f, t.confidence / 255.0f,
+           t.muted ? "true" : "false");
+  localSocket.textAll(msg);
+}
+
+void sendJson(AsyncWebServerRequest* request, int code, const char* body) {
+  request->send(code, "application/json", body);
+}
+
+void sendJsonError(AsyncWebServerRequest* request, int code, const char* message) {
+  char body[128];
+  snprintf(body, sizeof(body), "{\"success\":false,\"message\":\"%s\"}", message);
+  sendJson(request, code, body);
+}
+
+/**
+ * Body callback: gather the request body in request->_tempObject (freed
+ * with the request); bodies over LOCAL_BODY_MAX are dropped
+ */
+void collectBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+  if (total > LOCAL_BODY_MAX) {
+    return;
+  }
+  if (index == 0) {
+    request->_tempObject = calloc(total + 1, 1);
+  }
+  if (request->_tempObject != NULL) {
+    memcpy((char*)request->_tempObject + index, data, len);
+  }
+}
+
+/**
+ * POST /api/effects, /api/volume, /api/overdrive, /api/delay, /api/gate:
+ * same bodies, ranges and answers as backend/server.js. The change reaches
+ * the STM32 at the next flush. The `dsp` field of POST /api/effects is
+ * ignored: only the backend costs requests.
+ */
+void handleLocalPost(AsyncWebServerRequest* request) {
+  StaticJsonDocument<LOCAL_BODY_MAX> doc;
+  char part[LOCAL_STATE_MAX];
+  char reply[LOCAL_STATE_MAX + 96];
+  const char* body = (const char*)request->_tempObject;
+  String url = request->url();
+
+  if (request->contentLength() > LOCAL_BODY_MAX) {
+    sendJsonError(request, 413, "Body too large");
+    return;
+  }
+  if (body == NULL || deserializeJson(doc, body) || doc.as<JsonObject>().isNull()) {
+    sendJsonError(request, 400, "Body must be a JSON object");
+    return;
+  }
+  JsonObject json = doc.as<JsonObject>();
+
+  if (url == "/api/scope") {
+    // {"samples":n,"trigger":level,"decimation":d} arms, {"enabled":false} cancels
+    char cmd[48];
+    int samples = json.containsKey("samples") ? json["samples"].as<int>() : STM32_SCOPE_MAX_SAMPLES;
+    float trigger = json.containsKey("trigger") ? json["trigger"].as<float>() : 0.0f;
+    int decimation = json.containsKey("decimation") ? json["decimation"].as<int>() : 1;
+    if (json.containsKey("enabled") && !json["enabled"].as<bool>()) {
+      snprintf(cmd, sizeof(cmd), "SCOPE:OFF");
+    } else if (samples < 1 || samples > STM32_SCOPE_MAX_SAMPLES || trigger < 0.0f || trigger > 1.0f ||
+               decimation < 1 || decimation > STM32_SCOPE_MAX_DECIMATION) {
+      sendJsonError(request, 400, "Scope needs samples 1-512, trigger 0-1, decimation 1-64");
+      return;
+    } else {
+      snprintf(cmd, sizeof(cmd), "SCOPE:%d,%.3f,%d", samples, trigger, decimation);
     }
-    
-    if (paramsChanged && effects.delay_enabled) {
-      String cmd = "DLY:" + String(effects.delay_time_ms, 0) + "," + 
-                   String(effects.delay_feedback, 2) + "," + 
-                   String(effects.delay_mix, 2) + "," +
-                   String(effects.delay_tone, 2);
-      sendCommandAndWaitForAck(cmd, 1500);
-      Serial.println("-> Delay params updated");
-      lastEffects.delay_time_ms = effects.delay_time_ms;
-      lastEffects.delay_feedback = effects.delay_feedback;
-      lastEffects.delay_mix = effects.delay_mix;
-      lastEffects.delay_tone = effects.delay_tone;
-      changed = true;
-      delay(100);
+    if (!queueSTM32Command(cmd)) {
+      sendJsonError(request, 503, "STM32 link busy");
+      return;
     }
-    
-    if (dly.containsKey("enabled") && dly["enabled"].as<bool>() != lastEffects.delay_enabled) {
-      effects.delay_enabled = dly["enabled"];
-      sendCommandAndWaitForAck(effects.delay_enabled ? "DLY:ON" : "DLY:OFF", 1000);
-      Serial.println("-> Delay " + String(effects.delay_enabled ? "ON" : "OFF"));
-      lastEffects.delay_enabled = effects.delay_enabled;
-      changed = true;
+    sendJson(request, 200, "{\"success\":true,\"message\":\"Scope request sent, frames follow on /ws\"}");
+    return;
+  }
+
+  if (url == "/api/tuner") {
+    // {"enabled":true,"mute":true} mutes the output while tuning
+    bool enabled = json.containsKey("enabled") ? json["enabled"].as<bool>() : true;
+    bool mute = json.containsKey("mute") ? json["mute"].as<bool>() : false;
+    if (!queueSTM32Command(!enabled ? "TUNER:OFF" : (mute ? "TUNER:MUTE" : "TUNER:ON"))) {
+      sendJsonError(request, 503, "STM32 link busy");
+      return;
     }
+    sendJson(request, 200, enabled ? "{\"success\":true,\"message\":\"Tuner on, readings follow on /ws\"}"
+                                   : "{\"success\":true,\"message\":\"Tuner off\"}");
+    return;
   }
   
-  // Check noise gate
-  if (json.containsKey("gate")) {
-    JsonObject gate = json["gate"];
-    bool paramsChanged = false;
-    
-    if (gate.containsKey("threshold") && abs(gate["threshold"].as<float>() - lastEffects.gate_threshold) > 0.001) {
-      effects.gate_threshold = gate["threshold"];
-      paramsChanged = true;
-    }
-    if (gate.containsKey("attack") && abs(gate["attack"].as<float>() - lastEffects.gate_attack) > 0.0001) {
-      effects.gate_attack = gate["attack"];
-      paramsChanged = true;
-    }
-    if (gate.containsKey("release") && abs(gate["release"].as<float>() - lastEffects.gate_release) > 0.01) {
-      effects.gate_release = gate["release"];
-      paramsChanged = true;
+  if (url == "/api/volume") {
+    float volume = json["volume"].as<float>();
+    if (!json.containsKey("volume") || volume < 0.0f || volume > 1.0f) {
+      sendJsonError(request, 400, "Volume must be between 0 and 1");
+      return;
     }
-    
-    if (paramsChanged && effects.gate_enabled) {
-      String cmd = "GATE:" + String(effects.gate_threshold, 3) + "," + 
-                   String(effects.gate_attack, 4) + "," + 
-                   String(effects.gate_release, 2);
-      sendCommandAndWaitForAck(cmd, 1500);
-      Serial.println("-> Gate params updated");
-      lastEffects.gate_threshold = effects.gate_threshold;
-      lastEffects.gate_attack = effects.gate_attack;
-      lastEffects.gate_release = effects.gate_release;
-      changed = true;
-      delay(100);
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    if (applyVolume(volume)) unsentSections |= 1 << SECTION_VOLUME;
+    snprintf(reply, sizeof(reply), "{\"success\":true,\"message\":\"Volume set to %.0f%%\",\"volume\":%.2f}",
+             effects.volume * 100, effects.volume);
+  } else if (url == "/api/overdrive") {
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    if (applyOverdrive(json)) unsentSections |= 1 << SECTION_OVERDRIVE;
+    formatOverdriveJson(part, sizeof(part));
+    snprintf(reply, sizeof(reply), "{\"success\":true,\"message\":\"Overdrive updated\",\"overdrive\":%s}", part);
+  } else if (url == "/api/delay") {
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    if (applyDelay(json)) unsentSections |= 1 << SECTION_DELAY;
+    formatDelayJson(part, sizeof(part));
+    snprintf(reply, sizeof(reply), "{\"success\":true,\"message\":\"Delay updated\",\"delay\":%s}", part);
+  } else if (url == "/api/gate") {
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    if (applyGate(json)) unsentSections |= 1 << SECTION_GATE;
+    formatGateJson(part, sizeof(part));
+    snprintf(reply, sizeof(reply), "{\"success\":true,\"message\":\"Noise gate updated\",\"gate\":%s}", part);
+  } else {
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    applyLocalEffects(json);
+    formatEffectsJson(part, sizeof(part));
+    snprintf(reply, sizeof(reply), "{\"success\":true,\"message\":\"Effects updated successfully\",\"effects\":%s}", part);
+  }
+  xSemaphoreGive(effectsLock);
+  sendJson(request, 200, reply);
+}
+
+/**
+ * /ws: a new client gets the state at once; a text message is a POST
+ * /api/effects body, answered by the state push after the next flush
+ */
+void onLocalSocketEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                        void* arg, uint8_t* data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    char state[LOCAL_STATE_MAX + 32];
+    int n = snprintf(state, sizeof(state), "{\"type\":\"state\",\"effects\":");
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    n += formatEffectsJson(state + n, sizeof(state) - n);
+    xSemaphoreGive(effectsLock);
+    snprintf(state + n, sizeof(state) - n, "}");
+    client->text(state);
+    Serial.printf("Local client #%u connected\n", (unsigned)client->id());
+  } else if (type == WS_EVT_DATA) {
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT || len > LOCAL_BODY_MAX) {
+      return;  // Only whole text messages; the app sends small ones
     }
-    
-    if (gate.containsKey("enabled") && gate["enabled"].as<bool>() != lastEffects.gate_enabled) {
-      effects.gate_enabled = gate["enabled"];
-      sendCommandAndWaitForAck(effects.gate_enabled ? "GATE:ON" : "GATE:OFF", 1000);
-      Serial.println("-> Gate " + String(effects.gate_enabled ? "ON" : "OFF"));
-      lastEffects.gate_enabled = effects.gate_enabled;
-      changed = true;
+    char body[LOCAL_BODY_MAX + 1];
+    StaticJsonDocument<LOCAL_BODY_MAX> doc;
+    memcpy(body, data, len);
+    body[len] = '\0';
+    if (!deserializeJson(doc, body)) {
+      xSemaphoreTake(effectsLock, portMAX_DELAY);
+      applyLocalEffects(doc.as<JsonObject>());
+      xSemaphoreGive(effectsLock);
     }
   }
-  
-  if (changed) {
-    Serial.println("✓ Effects synced from backend");
+}
+
+/**
+ * Start the local control server and advertise it over mDNS
+ */
+void startLocalServer() {
+  DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
+  DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+  DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type");
+
+  localServer.on("/api/health", HTTP_GET, [](AsyncWebServerRequest* request) {
+    char body[160];
+    snprintf(body, sizeof(body),
+             "{\"status\":\"ok\",\"uptime_ms\":%lu,\"architecture\":\"Flutter -> ESP32 -> STM32\",\"backend\":%s}",
+             (unsigned long)millis(), eventsStreaming ? "true" : "false");
+    sendJson(request, 200, body);
+  });
+  localServer.on("/api/effects", HTTP_GET, [](AsyncWebServerRequest* request) {
+    char part[LOCAL_STATE_MAX];
+    char body[LOCAL_STATE_MAX + 32];
+    xSemaphoreTake(effectsLock, portMAX_DELAY);
+    formatEffectsJson(part, sizeof(part));
+    xSemaphoreGive(effectsLock);
+    snprintf(body, sizeof(body), "{\"success\":true,\"effects\":%s}", part);
+    sendJson(request, 200, body);
+  });
+  const char* posts[] = { "/api/effects", "/api/volume", "/api/overdrive", "/api/delay", "/api/gate",
+                          "/api/scope", "/api/tuner" };
+  for (const char* path : posts) {
+    localServer.on(path, HTTP_POST, handleLocalPost, NULL, collectBody);
+  }
+  localServer.onNotFound([](AsyncWebServerRequest* request) {
+    if (request->method() == HTTP_OPTIONS) {
+      request->send(204);  // CORS preflight
+    } else {
+      sendJsonError(request, 404, "Not found");
+    }
+  });
+  localSocket.onEvent(onLocalSocketEvent);
+  localServer.addHandler(&localSocket);
+  localServer.begin();
+
+  if (MDNS.begin(mdns_hostname)) {
+    MDNS.addService("http", "tcp", LOCAL_HTTP_PORT);
+    MDNS.addServiceTxt("http", "tcp", "api", "/api");
   }
+  Serial.println("Local control: http://" + String(mdns_hostname) + ".local/api/effects (ws://" +
+                 String(mdns_hostname) + ".local/ws)");
 }
 
 /**
@@ -49,7 +49,7 @@ class _SettingsScreenState extends State<SettingsScreen> {
     setState(() {
       _testResult = success
           ? 'Connection successful!'
-          : 'Connection failed. Check the URL and make sure the backend is running.';
+          : 'Connection failed. Check the URL and make sure the pedal (or the backend) is running.';
       _isTesting = false;
     });
   }
@@ -90,7 +90,7 @@ class _SettingsScreenState extends State<SettingsScreen> {
             ),
             const SizedBox(height: 8),
             const Text(
-              'Enter the URL of your Node.js backend server',
+              'Enter the pedal\'s address (http://dsp-pedal.local) or your Node.js backend server',
               style: TextStyle(
                 fontSize: 14,
                 color: Colors.white70,
@@ -201,11 +201,11 @@ class _SettingsScreenState extends State<SettingsScreen> {
             ),
             _buildInstruction(
               '2',
-              'Start the Node.js backend server on your computer',
+              'Enter http://dsp-pedal.local, or the ESP32\'s IP address if your phone does not resolve .local names',
             ),
             _buildInstruction(
               '3',
-              'Find your computer\'s IP address and enter it above with port 3000',
+              'To go through the Node.js backend instead, start it and enter your computer\'s IP address with port 3000',
             ),
             _buildInstruction(
               '4',
@@ -225,7 +225,7 @@ class _SettingsScreenState extends State<SettingsScreen> {
                   SizedBox(width: 12),
                   Expanded(
                     child: Text(
-                      'The backend server acts as a bridge between your Flutter app and the STM32/ESP32 hardware.',
+                      'The ESP32 serves the same API as the backend, so the backend is optional: talking to the pedal directly saves a hop.',
                       style: TextStyle(color: Colors.blueAccent, fontSize: 12),
                     ),
                   ),
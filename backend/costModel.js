@@ -0,0 +1,216 @@
+/**
+ * DSP chain cost model
+ *
+ * Same arithmetic as CostModel_Predict() in Core/Src/cost_model.c, on the
+ * table in cost_table.json (generated from Core/Inc/cost_model.h with
+ * `make cost-table` in host/). `make cost` in host/ pipes the C results
+ * through `node costModel.js --check` to prove the two agree.
+ *
+ * The backend only owns volume, overdrive, delay and gate; the rest of the
+ * chain (reverb, cabinet, EQ, modulation, compressor, looper, tuner, sample
+ * rate) is described by a `dsp` object so a request can be costed against
+ * what the STM32 is actually running:
+ *
+ *   {
+ *     sample_rate: 48000,
+ *     pingpong: false,
+ *     eq: { enabled: false },
+ *     cabinet: { enabled: false, taps: 256, mode: 'fft' | 'low_latency' | 'auto' },
+ *     modulation: { mode: 'off' | 'chorus' | 'flanger' | 'vibrato' },
+ *     reverb: { enabled: false },
+ *     compressor: { enabled: false, lookahead: false },
+ *     looper: { state: 'clear' | 'rec' | 'play' | 'overdub' },
+ *     tuner: { enabled: false }
+ *   }
+ */
+
+const fs = require('fs');
+const path = require('path');
+
+const table = JSON.parse(fs.readFileSync(path.join(__dirname, 'cost_table.json'), 'utf8'));
+
+const HALF = table.buffer_size / 2;
+const EQ_BANDS = 5;
+const REVERB_COMBS = 4;
+const MOD_MODES = { off: 0, chorus: 1, flanger: 2, vibrato: 3 };
+const LOOPER_STATES = { clear: 0, rec: 1, play: 2, overdub: 3 };
+
+const defaultDsp = {
+  sample_rate: 48000,
+  pingpong: false,
+  eq: { enabled: false },
+  cabinet: { enabled: false, taps: 256, mode: 'fft' },
+  modulation: { mode: 'off' },
+  reverb: { enabled: false },
+  compressor: { enabled: false, lookahead: false },
+  looper: { state: 'clear' },
+  tuner: { enabled: false }
+};
+
+function overdriveCost(mode) {
+  if (mode === 0) return table.od_soft;
+  if (mode === 1) return table.od_hard;
+  return table.od_asym;
+}
+
+function looperCost(state) {
+  if (state === 1) return table.loop_rec;
+  if (state === 2) return table.loop_play;
+  if (state === 3) return table.loop_overdub;
+  return 0;
+}
+
+function cabinetBlockCost(c) {
+  const tailStart = c.cab_low_latency ? table.cab_head_taps : 0;
+  if (c.cab_taps <= tailStart) return 0;
+  const parts = Math.floor((c.cab_taps - tailStart + table.cab_partition_taps - 1) / table.cab_partition_taps);
+  return table.cab_fft + parts * table.cab_partition;
+}
+
+/**
+ * Predict the cost of a configuration in the C struct's terms
+ * (CostConfig_t field names, stages off are 0)
+ */
+function predict(c) {
+  let isr = table.isr_base;
+  let block = table.block_base;
+
+  if (c.gate) isr += table.gate;
+  if (c.od) isr += overdriveCost(c.od_mode);
+  if (c.delay) isr += c.pingpong ? table.delay_pingpong : table.delay;
+  if (c.eq_bands) isr += table.eq_base + c.eq_bands * table.eq_band;
+  if (c.cab && c.cab_taps) {
+    let head = 0;
+    if (c.cab_low_latency) head = Math.min(c.cab_taps, table.cab_head_taps);
+    isr += table.cab_isr + head * table.cab_head_tap;
+    block += cabinetBlockCost(c);
+  }
+  if (c.mod) {
+    isr += table.mod_isr;
+    block += table.mod_block;
+  }
+  if (c.rvb_combs) {
+    isr += table.rvb_isr;
+    block += c.rvb_combs * table.rvb_comb + table.rvb_allpasses;
+  }
+  if (c.comp) {
+    isr += table.comp_isr;
+    block += table.comp_block + (c.comp_lookahead ? table.comp_lookahead : 0);
+  }
+  if (c.looper) {
+    isr += table.loop_isr;
+    block += looperCost(c.looper);
+  }
+  if (c.tuner) block += table.tuner;
+
+  const budget = Math.floor(c.core_hz * HALF / (c.sample_rate_hz || 1));
+  const total = isr * HALF + block;
+  return {
+    isr_per_sample: isr,
+    block_per_half: block,
+    total_per_half: total,
+    budget_per_half: budget,
+    permille: budget ? Math.floor(total * 1000 / budget) : 0xFFFFFFFF
+  };
+}
+
+/**
+ * Merge a partial dsp description over the defaults, one level deep
+ */
+function mergeDsp(base, update) {
+  const merged = { ...defaultDsp, ...base };
+  for (const [key, value] of Object.entries(update || {})) {
+    if (value !== null && typeof value === 'object' && !Array.isArray(value)) {
+      merged[key] = { ...merged[key], ...value };
+    } else {
+      merged[key] = value;
+    }
+  }
+  return merged;
+}
+
+/**
+ * Build a CostConfig_t-shaped object from the backend's effects and a dsp
+ * description; cabinet mode 'auto' must be resolved first
+ */
+function configFromEffects(effects, dsp) {
+  const d = mergeDsp({}, dsp);
+  return {
+    core_hz: table.core_hz,
+    sample_rate_hz: d.sample_rate,
+    gate: effects.gate && effects.gate.enabled ? 1 : 0,
+    od: effects.overdrive && effects.overdrive.enabled ? 1 : 0,
+    od_mode: effects.overdrive ? effects.overdrive.mode || 0 : 0,
+    delay: effects.delay && effects.delay.enabled ? 1 : 0,
+    pingpong: d.pingpong ? 1 : 0,
+    eq_bands: d.eq.enabled ? EQ_BANDS : 0,
+    cab: d.cabinet.enabled ? 1 : 0,
+    cab_low_latency: d.cabinet.mode === 'low_latency' ? 1 : 0,
+    cab_taps: d.cabinet.taps || 0,
+    mod: MOD_MODES[d.modulation.mode] || 0,
+    rvb_combs: d.reverb.enabled ? REVERB_COMBS : 0,
+    comp: d.compressor.enabled ? 1 : 0,
+    comp_lookahead: d.compressor.lookahead ? 1 : 0,
+    looper: LOOPER_STATES[d.looper.state] || 0,
+    tuner: d.tuner.enabled ? 1 : 0
+  };
+}
+
+/**
+ * Cost a request: resolves cabinet mode 'auto' the way CAB:MODE,AUTO does
+ * on the STM32 (low latency while the chain stays under warn_permille) and
+ * classifies the result as ok, warn (over warn_permille, the governor will
+ * start dropping quality) or refuse (over max_permille, blocks will overrun)
+ */
+function evaluate(effects, dsp) {
+  const d = mergeDsp({}, dsp);
+  let cabinetMode = d.cabinet.mode;
+
+  if (cabinetMode === 'auto') {
+    const lowLatency = predict(configFromEffects(effects, mergeDsp(d, {
+      cabinet: { enabled: true, mode: 'low_latency' }
+    })));
+    cabinetMode = lowLatency.permille <= table.warn_permille ? 'low_latency' : 'fft';
+  }
+
+  const prediction = predict(configFromEffects(effects, mergeDsp(d, { cabinet: { mode: cabinetMode } })));
+  const warnings = [];
+  let verdict = 'ok';
+
+  if (prediction.permille > table.max_permille) {
+    verdict = 'refuse';
+  } else if (prediction.permille > table.warn_permille) {
+    verdict = 'warn';
+    warnings.push(`Predicted DSP load ${(prediction.permille / 10).toFixed(1)}% is over ` +
+                  `${table.warn_permille / 10}%: the STM32 will shorten the cabinet and reverb to keep up`);
+  }
+
+  return { verdict, warnings, cabinet_mode: cabinetMode, prediction };
+}
+
+/**
+ * --check: read cost_check output on stdin and compare every prediction
+ */
+function check() {
+  const lines = fs.readFileSync(0, 'utf8').split('\n').filter(line => line.trim());
+  let failures = 0;
+
+  for (const line of lines) {
+    const vector = JSON.parse(line);
+    const got = predict(vector.config);
+    for (const key of Object.keys(got)) {
+      if (got[key] !== vector[key]) {
+        if (failures < 10) console.log(`MISMATCH ${key}: C ${vector[key]}, JS ${got[key]} for ${JSON.stringify(vector.config)}`);
+        failures++;
+      }
+    }
+  }
+  console.log(`${lines.length} configurations, ${failures} mismatches`);
+  process.exitCode = (failures || !lines.length) ? 1 : 0;
+}
+
+if (require.main === module && process.argv.includes('--check')) {
+  check();
+}
+
+module.exports = { table, defaultDsp, predict, mergeDsp, configFromEffects, evaluate };
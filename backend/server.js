@@ -5,11 +5,18 @@
  * The ESP32 polls this server for updates and forwards commands to STM32 via UART.
  * 
  * Architecture:
- * Flutter App -> Backend API (this server) <- ESP32 (polls) -> STM32 (UART)
+ * Flutter App -> Backend API (this server) -> ESP32 (event stream) -> STM32 (UART)
+ * The ESP32 holds GET /api/events open and gets every change pushed the
+ * moment it is made; it falls back to polling GET /api/effects while the
+ * stream is down.
  * 
  * Endpoints:
- * - GET  /api/effects       - Get current effect settings (ESP32 polls this)
- * - POST /api/effects       - Update all effect settings
+ * - GET  /api/events        - Server-sent events: full state, then changes (ESP32)
+ * - GET  /api/effects       - Get current effect settings (ESP32 fallback poll;
+ *                             ETag/If-None-Match, ?since=<revision> for a delta)
+ * - POST /api/effects       - Update all effect settings (refused if the chain would not fit;
+ *                             answers the revision that holds them)
+ * - GET  /api/cost          - Predicted DSP load of the current settings
  * - POST /api/volume        - Set output volume
  * - POST /api/overdrive     - Configure overdrive effect
  * - POST /api/delay         - Configure delay effect
@@ -22,6 +29,7 @@ const express = require('express');
 const cors = require('cors');
 const bodyParser = require('body-parser');
 require('dotenv').config();
+const costModel = require('./costModel');
 
 const app = express();
 const PORT = process.env.PORT || 3000;
@@ -57,6 +65,138 @@ let currentEffects = {
   }
 };
 
+// Rest of the STM32 chain, as last reported by the app; only used to cost
+// requests (kept out of currentEffects so the ESP32 poll stays small)
+let currentDsp = costModel.mergeDsp({}, {});
+
+// State revision, bumped by every change. It starts at the boot time in ms
+// so it keeps growing across restarts, and it is the ETag of GET /api/effects.
+let stateRevision = Date.now();
+const REVISION_HISTORY = 64;       // revisions a ?since= delta can start from
+const revisionHistory = new Map(); // revision -> copy of currentEffects then
+
+// GET /api/effects bodies built at stateRevision, dropped by the next change
+let cachedEffectsBody = null;
+const cachedDeltaBodies = new Map(); // since -> body
+
+// Event stream clients (ESP32 bridges)
+const eventClients = new Set();
+const EVENT_HEARTBEAT_MS = 15000;  // the ESP32 drops a stream silent for 35 s
+
+/**
+ * Fields of `after` that differ from `before`, nested like the state;
+ * undefined if nothing changed
+ */
+function diffState(before, after) {
+  let delta;
+  for (const [key, value] of Object.entries(after)) {
+    const old = before ? before[key] : undefined;
+    let changed;
+    if (value !== null && typeof value === 'object' && !Array.isArray(value)) {
+      changed = diffState(old, value);
+    } else if (value !== old) {
+      changed = value;
+    }
+    if (changed !== undefined) {
+      delta = delta || {};
+      delta[key] = changed;
+    }
+  }
+  return delta;
+}
+
+function sendEvent(client, name, data) {
+  client.write(`event: ${name}\ndata: ${JSON.stringify(data)}\n\n`);
+}
+
+/**
+ * Push what changed since `before` (a copy of currentEffects taken before
+ * the mutation) to every event stream and start a new revision
+ */
+function publishChanges(before) {
+  const delta = diffState(before, currentEffects);
+  if (!delta) return;
+  stateRevision++;
+  rememberRevision();
+  cachedEffectsBody = null;
+  cachedDeltaBodies.clear();
+  for (const client of eventClients) {
+    sendEvent(client, 'delta', { revision: stateRevision, effects: delta });
+  }
+}
+
+function snapshot() {
+  return JSON.parse(JSON.stringify(currentEffects));
+}
+
+function rememberRevision() {
+  revisionHistory.set(stateRevision, snapshot());
+  if (revisionHistory.size > REVISION_HISTORY) {
+    revisionHistory.delete(revisionHistory.keys().next().value);
+  }
+}
+
+rememberRevision();
+
+/**
+ * GET /api/effects body: the whole state, or only the fields that differ
+ * from revision `since` while that one is still in the history
+ */
+function effectsBody(since) {
+  const base = revisionHistory.get(since);
+  if (!base) {
+    if (!cachedEffectsBody) {
+      cachedEffectsBody = Buffer.from(JSON.stringify({
+        success: true,
+        revision: stateRevision,
+        effects: currentEffects
+      }));
+    }
+    return cachedEffectsBody;
+  }
+  let body = cachedDeltaBodies.get(since);
+  if (!body) {
+    body = Buffer.from(JSON.stringify({
+      success: true,
+      revision: stateRevision,
+      since,
+      effects: diffState(base, currentEffects) || {}
+    }));
+    cachedDeltaBodies.set(since, body);
+  }
+  return body;
+}
+
+/**
+ * Cost `next` on the chain `dsp` describes. A chain the STM32 cannot run in
+ * real time is answered with 422 here and null is returned: the caller must
+ * not change anything.
+ */
+function costOrRefuse(res, what, next, dsp) {
+  const cost = costModel.evaluate(next, dsp);
+  if (cost.verdict !== 'refuse') {
+    return cost;
+  }
+  console.log(`✗ ${what} refused: predicted load ${cost.prediction.permille}‰`);
+  res.status(422).json({
+    success: false,
+    message: `Predicted DSP load ${(cost.prediction.permille / 10).toFixed(1)}% exceeds the STM32 budget`,
+    cost
+  });
+  return null;
+}
+
+/** The cost fields every successful update answers with */
+function costFields(cost) {
+  return { cost, ...(cost.warnings.length ? { warnings: cost.warnings } : {}) };
+}
+
+setInterval(() => {
+  for (const client of eventClients) {
+    client.write(': ping\n\n');
+  }
+}, EVENT_HEARTBEAT_MS);
+
 // Presets - complete effect configurations
 const presets = {
   clean: {
@@ -102,44 +242,91 @@ app.get('/api/health', (req, res) => {
   });
 });
 
-// Get current effects settings (ESP32 polls this endpoint)
-app.get('/api/effects', (req, res) => {
-  res.json({
-    success: true,
-    effects: currentEffects
+// Event stream: the whole state once, then only what changes
+app.get('/api/events', (req, res) => {
+  req.socket.setTimeout(0);
+  req.socket.setNoDelay(true);
+  res.writeHead(200, {
+    'Content-Type': 'text/event-stream',
+    'Cache-Control': 'no-cache',
+    'Connection': 'keep-alive'
+  });
+  sendEvent(res, 'state', { revision: stateRevision, effects: currentEffects });
+  eventClients.add(res);
+  console.log(`✓ Event stream opened (${eventClients.size} connected)`);
+  
+  req.on('close', () => {
+    eventClients.delete(res);
+    console.log(`✓ Event stream closed (${eventClients.size} connected)`);
   });
 });
 
+// Get current effects settings (ESP32 polls this while its event stream is down).
+// A poll that names the current revision in If-None-Match gets an empty 304;
+// ?since=<revision> answers with only the fields changed after it (the whole
+// state, without "since", if that revision is too old or unknown).
+app.get('/api/effects', (req, res) => {
+  res.set('ETag', `"${stateRevision}"`);
+  res.set('Cache-Control', 'no-cache');
+  if (req.fresh) {
+    return res.status(304).end();
+  }
+  
+  const since = req.query.since !== undefined ? Number(req.query.since) : undefined;
+  res.type('json').send(effectsBody(since));
+});
+
 // Update all effects settings
 app.post('/api/effects', (req, res) => {
-  const { volume, overdrive, delay, gate } = req.body;
+  const { volume, overdrive, delay, gate, dsp } = req.body;
+  const next = { ...currentEffects };
   
   // Update volume
   if (volume !== undefined) {
-    currentEffects.volume = volume;
+    next.volume = volume;
   }
   
   // Update overdrive
   if (overdrive) {
-    currentEffects.overdrive = { ...currentEffects.overdrive, ...overdrive };
+    next.overdrive = { ...currentEffects.overdrive, ...overdrive };
   }
   
   // Update delay
   if (delay) {
-    currentEffects.delay = { ...currentEffects.delay, ...delay };
+    next.delay = { ...currentEffects.delay, ...delay };
   }
   
   // Update gate
   if (gate) {
-    currentEffects.gate = { ...currentEffects.gate, ...gate };
+    next.gate = { ...currentEffects.gate, ...gate };
   }
   
-  console.log('✓ Effects updated:', { volume, overdrive, delay, gate });
+  // Refuse a chain the STM32 cannot run in real time, before anything changes
+  const nextDsp = costModel.mergeDsp(currentDsp, dsp);
+  const cost = costOrRefuse(res, 'Effects', next, nextDsp);
+  if (!cost) return;
+  
+  const before = currentEffects;
+  currentEffects = next;
+  currentDsp = nextDsp;
+  publishChanges(before);
+  console.log('✓ Effects updated:', { volume, overdrive, delay, gate, dsp });
   
   res.json({
     success: true,
     message: 'Effects updated successfully',
-    effects: currentEffects
+    revision: stateRevision,
+    effects: currentEffects,
+    ...costFields(cost)
+  });
+});
+
+// Predicted DSP load of the current settings
+app.get('/api/cost', (req, res) => {
+  res.json({
+    success: true,
+    dsp: currentDsp,
+    cost: costModel.evaluate(currentEffects, currentDsp)
   });
 });
 
@@ -154,13 +341,19 @@ app.post('/api/volume', (req, res) => {
     });
   }
   
+  const cost = costOrRefuse(res, 'Volume', { ...currentEffects, volume }, currentDsp);
+  if (!cost) return;
+  
+  const before = snapshot();
   currentEffects.volume = volume;
+  publishChanges(before);
   console.log(`✓ Volume set to ${(volume * 100).toFixed(0)}%`);
   
   res.json({
     success: true,
     message: `Volume set to ${(volume * 100).toFixed(0)}%`,
-    volume: currentEffects.volume
+    volume: currentEffects.volume,
+    ...costFields(cost)
   });
 });
 
@@ -176,13 +369,20 @@ app.post('/api/overdrive', (req, res) => {
   if (mix !== undefined && mix >= 0.0 && mix <= 1.0) overdriveData.mix = mix;
   if (mode !== undefined && mode >= 0 && mode <= 2) overdriveData.mode = mode;
   
-  currentEffects.overdrive = { ...currentEffects.overdrive, ...overdriveData };
+  const next = { ...currentEffects, overdrive: { ...currentEffects.overdrive, ...overdriveData } };
+  const cost = costOrRefuse(res, 'Overdrive', next, currentDsp);
+  if (!cost) return;
+  
+  const before = snapshot();
+  currentEffects.overdrive = next.overdrive;
+  publishChanges(before);
   console.log('✓ Overdrive updated:', overdriveData);
   
   res.json({
     success: true,
     message: 'Overdrive updated',
-    overdrive: currentEffects.overdrive
+    overdrive: currentEffects.overdrive,
+    ...costFields(cost)
   });
 });
 
@@ -197,13 +397,20 @@ app.post('/api/delay', (req, res) => {
   if (mix !== undefined && mix >= 0.0 && mix <= 1.0) delayData.mix = mix;
   if (tone !== undefined && tone >= 0.0 && tone <= 1.0) delayData.tone = tone;
   
-  currentEffects.delay = { ...currentEffects.delay, ...delayData };
+  const next = { ...currentEffects, delay: { ...currentEffects.delay, ...delayData } };
+  const cost = costOrRefuse(res, 'Delay', next, currentDsp);
+  if (!cost) return;
+  
+  const before = snapshot();
+  currentEffects.delay = next.delay;
+  publishChanges(before);
   console.log('✓ Delay updated:', delayData);
   
   res.json({
     success: true,
     message: 'Delay updated',
-    delay: currentEffects.delay
+    delay: currentEffects.delay,
+    ...costFields(cost)
   });
 });
 
@@ -217,13 +424,20 @@ app.post('/api/gate', (req, res) => {
   if (attack !== undefined && attack >= 0.0001 && attack <= 0.1) gateData.attack = attack;
   if (release !== undefined && release >= 0.01 && release <= 1.0) gateData.release = release;
   
-  currentEffects.gate = { ...currentEffects.gate, ...gateData };
+  const next = { ...currentEffects, gate: { ...currentEffects.gate, ...gateData } };
+  const cost = costOrRefuse(res, 'Noise gate', next, currentDsp);
+  if (!cost) return;
+  
+  const before = snapshot();
+  currentEffects.gate = next.gate;
+  publishChanges(before);
   console.log('✓ Noise gate updated:', gateData);
   
   res.json({
     success: true,
     message: 'Noise gate updated',
-    gate: currentEffects.gate
+    gate: currentEffects.gate,
+    ...costFields(cost)
   });
 });
 
@@ -250,9 +464,13 @@ app.post('/api/presets/:name', (req, res) => {
   }
   
   const preset = presets[name];
+  const cost = costOrRefuse(res, `Preset '${name}'`, preset, currentDsp);
+  if (!cost) return;
   
   // Update current effects with preset values
+  const before = currentEffects;
   currentEffects = JSON.parse(JSON.stringify(preset));
+  publishChanges(before);
   
   console.log(`✓ Preset '${name}' loaded`);
   
@@ -260,7 +478,8 @@ app.post('/api/presets/:name', (req, res) => {
     success: true,
     message: `Preset '${name}' loaded`,
     preset: name,
-    effects: currentEffects
+    effects: currentEffects,
+    ...costFields(cost)
   });
 });
 
@@ -287,8 +506,10 @@ app.listen(PORT, () => {
   console.log(`\n🌐 Server running on port ${PORT}`);
   console.log(`\n📋 API Endpoints:`);
   console.log(`   GET  http://localhost:${PORT}/api/health`);
-  console.log(`   GET  http://localhost:${PORT}/api/effects     (ESP32 polls this)`);
+  console.log(`   GET  http://localhost:${PORT}/api/events      (ESP32 event stream)`);
+  console.log(`   GET  http://localhost:${PORT}/api/effects     (ESP32 fallback poll, ?since=<rev>)`);
   console.log(`   POST http://localhost:${PORT}/api/effects`);
+  console.log(`   GET  http://localhost:${PORT}/api/cost`);
   console.log(`   POST http://localhost:${PORT}/api/volume`);
   console.log(`   POST http://localhost:${PORT}/api/overdrive`);
   console.log(`   POST http://localhost:${PORT}/api/delay`);
@@ -296,7 +517,7 @@ app.listen(PORT, () => {
   console.log(`   GET  http://localhost:${PORT}/api/presets`);
   console.log(`   POST http://localhost:${PORT}/api/presets/:name`);
   console.log(`\n✓ Ready to accept commands from Flutter app`);
-  console.log(`✓ ESP32 should poll GET /api/effects every 500ms\n`);
+  console.log(`✓ ESP32 should hold GET /api/events open (polls /api/effects while it is down)\n`);
 });
 
 // Export for testing
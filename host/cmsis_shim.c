@@ -0,0 +1,186 @@
+/* cmsis_shim.c
+ * Reference implementations of the CMSIS-DSP calls used by the firmware,
+ * matching the library's packing and scaling
+ */
+
+#include "arm_math.h"
+#include <math.h>
+#include <string.h>
+
+/* Longest real FFT the shim takes */
+#define SHIM_FFT_MAX 4096
+
+static float32_t shim_cos[SHIM_FFT_MAX / 2];
+static float32_t shim_sin[SHIM_FFT_MAX / 2];
+static uint32_t shim_twiddle_n = 0;
+static float32_t shim_work[SHIM_FFT_MAX];
+
+void arm_biquad_cascade_df2T_init_f32(arm_biquad_cascade_df2T_instance_f32 *S, uint8_t numStages,
+                                      const float32_t *pCoeffs, float32_t *pState)
+{
+  S->numStages = numStages;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+  memset(pState, 0, 2U * numStages * sizeof(float32_t));
+}
+
+/* Coefficients per stage {b0, b1, b2, a1, a2} with the feedback terms
+ * already negated, as CMSIS expects */
+void arm_biquad_cascade_df2T_f32(const arm_biquad_cascade_df2T_instance_f32 *S, const float32_t *pSrc,
+                                 float32_t *pDst, uint32_t blockSize)
+{
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    float32_t x = pSrc[n];
+    for (uint8_t st = 0; st < S->numStages; st++)
+    {
+      const float32_t *c = &S->pCoeffs[5 * st];
+      float32_t *d = &S->pState[2 * st];
+      float32_t y = c[0] * x + d[0];
+      d[0] = c[1] * x + c[3] * y + d[1];
+      d[1] = c[2] * x + c[4] * y;
+      x = y;
+    }
+    pDst[n] = x;
+  }
+}
+
+void arm_abs_q15(const q15_t *pSrc, q15_t *pDst, uint32_t blockSize)
+{
+  for (uint32_t i = 0; i < blockSize; i++)
+  {
+    pDst[i] = (pSrc[i] == INT16_MIN) ? INT16_MAX : (q15_t)(pSrc[i] < 0 ? -pSrc[i] : pSrc[i]);
+  }
+}
+
+void arm_max_q15(const q15_t *pSrc, uint32_t blockSize, q15_t *pResult, uint32_t *pIndex)
+{
+  *pResult = pSrc[0];
+  *pIndex = 0;
+  for (uint32_t i = 1; i < blockSize; i++)
+  {
+    if (pSrc[i] > *pResult)
+    {
+      *pResult = pSrc[i];
+      *pIndex = i;
+    }
+  }
+}
+
+void arm_rms_q15(const q15_t *pSrc, uint32_t blockSize, q15_t *pResult)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < blockSize; i++) sum += (int32_t)pSrc[i] * pSrc[i];
+  double rms = sqrt((double)sum / blockSize);
+  *pResult = (rms >= 32767.0) ? 32767 : (q15_t)rms;
+}
+
+arm_status arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32 *S, uint16_t fftLen)
+{
+  if (fftLen < 32 || fftLen > SHIM_FFT_MAX || (fftLen & (fftLen - 1)) != 0) return ARM_MATH_ARGUMENT_ERROR;
+  S->fftLenRFFT = fftLen;
+  return ARM_MATH_SUCCESS;
+}
+
+/* W_n^k = cos - i sin(2 pi k / n) for k < n / 2, built for the last length used */
+static void Shim_Twiddles(uint32_t n)
+{
+  if (n == shim_twiddle_n) return;
+  for (uint32_t k = 0; k < n / 2; k++)
+  {
+    shim_cos[k] = (float32_t)cos(2.0 * M_PI * k / n);
+    shim_sin[k] = (float32_t)sin(2.0 * M_PI * k / n);
+  }
+  shim_twiddle_n = n;
+}
+
+/* In-place radix-2 FFT of n / 2 interleaved complex points, unscaled */
+static void Shim_Cfft(float32_t *z, uint32_t n, uint8_t inverse)
+{
+  uint32_t m = n / 2;
+
+  for (uint32_t i = 1, j = 0; i < m; i++)
+  {
+    uint32_t bit = m >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j)
+    {
+      float32_t re = z[2 * i], im = z[2 * i + 1];
+      z[2 * i] = z[2 * j];
+      z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = re;
+      z[2 * j + 1] = im;
+    }
+  }
+  for (uint32_t len = 2; len <= m; len <<= 1)
+  {
+    uint32_t step = n / len;
+    for (uint32_t i = 0; i < m; i += len)
+    {
+      for (uint32_t k = 0; k < len / 2; k++)
+      {
+        float32_t wr = shim_cos[k * step];
+        float32_t wi = inverse ? shim_sin[k * step] : -shim_sin[k * step];
+        float32_t *a = &z[2 * (i + k)];
+        float32_t *b = &z[2 * (i + k + len / 2)];
+        float32_t tr = b[0] * wr - b[1] * wi;
+        float32_t ti = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - tr;
+        b[1] = a[1] - ti;
+        a[0] += tr;
+        a[1] += ti;
+      }
+    }
+  }
+}
+
+/* Forward: pOut = [Re X0, Re X(N/2), Re X1, Im X1, ...], unscaled.
+ * Inverse: p holds that layout, pOut gets the real signal scaled by 1/N.
+ * Both go through an N/2-point complex FFT of the even/odd samples, as
+ * the library does. */
+void arm_rfft_fast_f32(arm_rfft_fast_instance_f32 *S, float32_t *p, float32_t *pOut, uint8_t ifftFlag)
+{
+  const uint32_t n = S->fftLenRFFT;
+  const uint32_t m = n / 2;
+
+  Shim_Twiddles(n);
+
+  if (!ifftFlag)
+  {
+    memcpy(shim_work, p, n * sizeof(float32_t));
+    Shim_Cfft(shim_work, n, 0);
+    pOut[0] = shim_work[0] + shim_work[1];
+    pOut[1] = shim_work[0] - shim_work[1];
+    for (uint32_t k = 1; k < m; k++)
+    {
+      // Even half E = (Z[k] + conj Z[m-k]) / 2, odd half O = (Z[k] - conj Z[m-k]) / 2i
+      float32_t er = 0.5f * (shim_work[2 * k] + shim_work[2 * (m - k)]);
+      float32_t ei = 0.5f * (shim_work[2 * k + 1] - shim_work[2 * (m - k) + 1]);
+      float32_t odr = 0.5f * (shim_work[2 * k + 1] + shim_work[2 * (m - k) + 1]);
+      float32_t odi = -0.5f * (shim_work[2 * k] - shim_work[2 * (m - k)]);
+      pOut[2 * k] = er + shim_cos[k] * odr + shim_sin[k] * odi;
+      pOut[2 * k + 1] = ei + shim_cos[k] * odi - shim_sin[k] * odr;
+    }
+  }
+  else
+  {
+    const float32_t scale = 1.0f / (float32_t)m;
+
+    shim_work[0] = 0.5f * (p[0] + p[1]);
+    shim_work[1] = 0.5f * (p[0] - p[1]);
+    for (uint32_t k = 1; k < m; k++)
+    {
+      float32_t xr = p[2 * k], xi = p[2 * k + 1];
+      float32_t cr = p[2 * (m - k)], ci = -p[2 * (m - k) + 1];
+      float32_t dr = 0.5f * (xr - cr), di = 0.5f * (xi - ci);
+      float32_t odr = dr * shim_cos[k] - di * shim_sin[k];
+      float32_t odi = dr * shim_sin[k] + di * shim_cos[k];
+      // Z = E + iO
+      shim_work[2 * k] = 0.5f * (xr + cr) - odi;
+      shim_work[2 * k + 1] = 0.5f * (xi + ci) + odr;
+    }
+    Shim_Cfft(shim_work, n, 1);
+    for (uint32_t t = 0; t < n; t++) pOut[t] = shim_work[t] * scale;
+  }
+}
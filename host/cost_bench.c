@@ -0,0 +1,512 @@
+/* cost_bench.c
+ * Host timing of the entries in the cost model table (cost_model.h)
+ *
+ * Usage: cost_bench [-r repeats] [-k cycles_per_ns]
+ *   Links the firmware the way the simulator does (sim/fake_hal.c) and
+ *   runs every stage as the timer interrupt and the block engine call it,
+ *   with the worst-case setting its entry stands for: full-length IR, all
+ *   combs, a loud plucked-string input. Each figure is the time with the
+ *   stage on minus the same calls with it off, over BENCH_HALVES halves,
+ *   fastest of -r repeats (default 100). Prints the measured cycles next
+ *   to the table's; exit status 1 if an entry is under BENCH_TOLERANCE of
+ *   what was measured. The block entries are differences of long runs and
+ *   move by a third from run to run on a busy host: the table takes the
+ *   median of nine runs per entry.
+ *
+ * The firmware is built at -O0 like the Debug configuration the board
+ * runs.
+ * -k turns host ns into Cortex-M4 cycles (default BENCH_CYCLES_PER_NS):
+ * llvm-mca -mcpu=cortex-m4 puts Apply_NoiseGate, Apply_Overdrive and
+ * Apply_Delay from the Debug listing at 720 cycles, every instruction
+ * counted, and the same three functions built -O0 took 37.2 ns on the
+ * host the table was made on. Time them again to calibrate another host.
+ *
+ * The loop in the listing's Process_Guitar_Signal, Apply_Distortion call
+ * included, gives the same ratio (170 cycles against 8.8 ns a sample).
+ *
+ * Not timed here: the ADC conversion the interrupt polls for and the HAL
+ * drivers around it (BENCH_ISR_HARDWARE), added to the firmware's own
+ * part of COST_ISR_BASE, and the CMSIS-DSP calls (BENCH_LIB_*), whose
+ * shim time is taken out of the stages that make them and replaced by a
+ * count: optimised library code does not run at the -O0 ratio.
+ */
+
+#include "main.h"
+#include "sim.h"
+#include "effects.h"
+#include "delay_mem.h"
+#include "eq.h"
+#include "cabinet.h"
+#include "modulation.h"
+#include "reverb.h"
+#include "compressor.h"
+#include "looper.h"
+#include "tuner.h"
+#include "telemetry.h"
+#include "scope.h"
+#include "sample_rate.h"
+#include "governor.h"
+#include "peripherals.h"
+#include "dsp_core.h"
+#include "cost_model.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_HALVES 64
+#define BENCH_SAMPLES (BENCH_HALVES * (BUFFER_SIZE / 2))
+#define BENCH_CYCLES_PER_NS (720.0 / 37.2)
+#define BENCH_TOLERANCE 0.9
+
+/* Halves the tuner stays in YIN after a full frame: lags 12 - 200 at 12 kHz,
+ * TUNER_LAGS_PER_SLICE at a time */
+#define TUNER_SLICES 16
+
+/* Per sample, outside the firmware's callback: ADC conversion polled for
+ * (92.5 + 12.5 ADC clocks at HCLK / 4 = 420), exception entry and return
+ * (2 x 12), and llvm-mca on the Debug listing for the HAL path
+ * (TIM1_UP_TIM16_IRQHandler 6, HAL_TIM_IRQHandler 281, HAL_ADC_Start 180,
+ * HAL_ADC_PollForConversion 223, HAL_ADC_GetValue 15, HAL_ADC_Stop 48) */
+#define BENCH_ISR_HARDWARE (420 + 24 + 753)
+
+/* CMSIS-DSP, counted for the M4 (single-cycle FPU ops, 2-cycle first
+ * load of a run, 1 after), in place of the shim's host time:
+ *   arm_biquad_cascade_df2T_f32, one sample: entry, loop set-up and
+ *   return 20, then 5 coefficient and 2 state loads, 4 multiply-adds,
+ *   a multiply and 2 state stores per stage, 16
+ *   arm_rfft_fast_f32 at CAB_FFT_SIZE, forward and inverse, counted as
+ *   radix-2 (the library's radix-8 stages do less): 192 butterflies of
+ *   22, 63 split steps of 25 and the reorder, 5900 each; the shim is an
+ *   FFT of the same shape but too slow on the host to subtract cleanly */
+#define BENCH_LIB_BIQUAD_CALL 20
+#define BENCH_LIB_BIQUAD_STAGE 16
+#define BENCH_LIB_RFFT_PAIR 11800
+
+typedef float32_t (*IsrStage_t)(float32_t input);
+typedef void (*HalfStage_t)(uint8_t half);
+
+typedef struct {
+  const char *name;
+  void (*on)(void);        // configure the stage on, before every repeat
+  void (*off)(void);
+  IsrStage_t isr;
+  HalfStage_t block;
+  uint32_t halves;         // per run, 0 = BENCH_HALVES
+} BenchStage_t;
+
+typedef struct {
+  double isr;              // cycles per sample
+  double block;            // cycles per half
+} BenchCost_t;
+
+static float32_t bench_input[BENCH_SAMPLES];
+static int repeats = 100;
+static double cycles_per_ns = BENCH_CYCLES_PER_NS;
+static volatile float32_t bench_sink;
+DWT_Type sim_dwt_frozen;
+static int failures = 0;
+
+/* Simulator hooks: nothing is driven through them here */
+float Sim_Input_Sample(uint64_t tick) { return 0.0f; }
+int Sim_Rx_Byte(uint64_t tick, uint8_t *byte) { return 0; }
+void Sim_Tx_Byte(uint64_t tick, uint8_t byte) { }
+void Sim_Output_Sample(uint64_t tick, uint16_t code) { }
+void Sim_Tick_End(uint64_t tick) { }
+
+static double Now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Decaying A2 pluck every 4096 samples with a little noise on top, so the
+ * gate stays open and the tuner never settles early */
+static void Make_Input(void)
+{
+  uint32_t seed = 4242;
+
+  for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+  {
+    float t = (float)(i % 4096) / (float)SAMPLE_RATE;
+    seed = seed * 1664525U + 1013904223U;
+    bench_input[i] = 0.8f * expf(-3.0f * t) * sinf(2.0f * (float)PI * 110.0f * t)
+                   + 0.05f * ((float)(seed >> 8) / 8388608.0f - 1.0f);
+  }
+  for (uint32_t i = 0; i < BUFFER_SIZE; i++)
+  {
+    adc_buffer[i] = (uint16_t)(2048.0f + 2000.0f * bench_input[i * 7 % BENCH_SAMPLES]);
+  }
+}
+
+static float32_t Bench_Pass(float32_t input)
+{
+  return input;
+}
+
+/* ns for one pass of halves halves: isr on every sample, then block on the half */
+static double Run(void (*setup)(void), IsrStage_t isr, HalfStage_t block, uint32_t halves)
+{
+  float32_t sum = 0.0f;
+  double t0;
+
+  setup();
+  t0 = Now_ns();
+  for (uint32_t h = 0; h < halves; h++)
+  {
+    uint16_t first = (h & 1U) ? (BUFFER_SIZE / 2) : 0;
+
+    for (uint16_t i = 0; i < BUFFER_SIZE / 2; i++)
+    {
+      buffer_index = first + i;
+      sum += isr(bench_input[h * (BUFFER_SIZE / 2) + i]);
+    }
+    if (block) block((uint8_t)(h & 1U));
+  }
+  t0 = Now_ns() - t0;
+  bench_sink = sum;
+  return t0;
+}
+
+/* On and off runs take turns, so a change of host clock hits both */
+static BenchCost_t Measure(const BenchStage_t *s)
+{
+  BenchCost_t c = { 0.0, 0.0 };
+  uint32_t halves = s->halves ? s->halves : BENCH_HALVES;
+  double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+
+  for (int r = 0; r < repeats; r++)
+  {
+    double t[4];
+
+    t[0] = Run(s->on, s->isr, NULL, halves);
+    t[1] = Run(s->off, s->isr, NULL, halves);
+    t[2] = s->block ? Run(s->on, s->isr, s->block, halves) : 0.0;
+    t[3] = s->block ? Run(s->off, s->isr, s->block, halves) : 0.0;
+    for (int k = 0; k < 4; k++)
+    {
+      if (t[k] < best[k]) best[k] = t[k];
+    }
+  }
+  s->off();
+
+  c.isr = (best[0] - best[1]) / (halves * (BUFFER_SIZE / 2)) * cycles_per_ns;
+  c.block = ((best[2] - best[0]) - (best[3] - best[1])) / halves * cycles_per_ns;
+  if (c.isr < 0.0) c.isr = 0.0;
+  if (c.block < 0.0) c.block = 0.0;
+  return c;
+}
+
+static void Report(const char *name, uint32_t table, double measured, const char *note)
+{
+  int low = (table < measured * BENCH_TOLERANCE);
+
+  if (low) failures++;
+  printf("%-20s %8lu %10.0f  %s%s\n", name, (unsigned long)table, measured,
+         low ? "LOW" : "ok", note);
+}
+
+/* Stage settings ---------------------------------------------------------------*/
+
+static void Gate_On(void) { noise_gate.enabled = 1; }
+static void Gate_Off(void) { noise_gate.enabled = 0; }
+
+static void Od_Soft(void) { overdrive.enabled = 1; overdrive.mode = 0; }
+static void Od_Hard(void) { overdrive.enabled = 1; overdrive.mode = 1; }
+static void Od_Asym(void) { overdrive.enabled = 1; overdrive.mode = 2; }
+static void Od_Off(void) { overdrive.enabled = 0; }
+
+static void Delay_On(void) { delay_effect.enabled = 1; delay_effect.pingpong = 0; delay_effect.delay_samples = 2400; }
+static void Delay_Pingpong(void) { Delay_On(); delay_effect.pingpong = 1; }
+static void Delay_Off(void) { delay_effect.enabled = 0; delay_effect.pingpong = 0; }
+
+static void Eq_On(void) { eq.enabled = 1; }
+static void Eq_Off(void) { eq.enabled = 0; }
+
+static void Cab_Load(uint8_t mode, uint16_t limit)
+{
+  int16_t chunk[CAB_CHUNK_MAX_TAPS];
+
+  if (cabinet.taps != CAB_MAX_TAPS)
+  {
+    Cabinet_Load_Begin(CAB_MAX_TAPS);
+    for (uint16_t at = 0; at < CAB_MAX_TAPS; at += CAB_CHUNK_MAX_TAPS)
+    {
+      uint16_t n = (CAB_MAX_TAPS - at < CAB_CHUNK_MAX_TAPS) ? CAB_MAX_TAPS - at : CAB_CHUNK_MAX_TAPS;
+      for (uint16_t k = 0; k < n; k++)
+      {
+        chunk[k] = (int16_t)(20000.0f * expf(-(float)(at + k) / 40.0f) * ((k & 1) ? -1.0f : 1.0f));
+      }
+      Cabinet_Load_Data(at, chunk, n);
+    }
+    Cabinet_Load_End();
+  }
+  Cabinet_Set_Mode(mode);
+  Cabinet_Set_Tap_Limit(limit);
+  cabinet.enabled = 1;
+}
+
+static void Cab_Fft(void) { Cab_Load(CAB_MODE_FFT, 0); }
+static void Cab_Fft_One(void) { Cab_Load(CAB_MODE_FFT, CAB_PARTITION); }
+static void Cab_Low_Latency(void) { Cab_Load(CAB_MODE_LOW_LATENCY, 0); }
+static void Cab_Off(void) { cabinet.enabled = 0; }
+
+static void Mod_Chorus(void) { Modulation_Set(MOD_CHORUS, 5.0f, 1.0f, 0.5f, 0.0f); }
+static void Mod_Flanger(void) { Modulation_Set(MOD_FLANGER, 5.0f, 1.0f, 0.5f, 0.9f); }
+static void Mod_Vibrato(void) { Modulation_Set(MOD_VIBRATO, 5.0f, 1.0f, 0.5f, 0.0f); }
+static void Mod_Off(void) { Modulation_Set(MOD_OFF, 5.0f, 1.0f, 0.5f, 0.0f); }
+
+static void Rvb_All(void) { reverb.enabled = 1; Reverb_Set_Active_Combs(REVERB_COMBS); }
+static void Rvb_One(void) { reverb.enabled = 1; Reverb_Set_Active_Combs(1); }
+static void Rvb_Off(void) { reverb.enabled = 0; Reverb_Set_Active_Combs(REVERB_COMBS); }
+
+static void Comp_On(void) { compressor.enabled = 1; Compressor_Set_Lookahead(0); }
+static void Comp_Lookahead(void) { compressor.enabled = 1; Compressor_Set_Lookahead(1); }
+static void Comp_Off(void) { Compressor_Set_Lookahead(0); compressor.enabled = 0; }
+
+/* PLAY and OVERDUB need a loop: record BENCH_HALVES halves first */
+static void Loop_Record_Halves(void)
+{
+  for (uint32_t h = 0; h < BENCH_HALVES; h++)
+  {
+    for (uint16_t i = 0; i < BUFFER_SIZE / 2; i++)
+    {
+      buffer_index = ((h & 1U) ? (BUFFER_SIZE / 2) : 0) + i;
+      bench_sink = Apply_Looper(bench_input[h * (BUFFER_SIZE / 2) + i]);
+    }
+    Looper_Process_Half((uint8_t)(h & 1U));
+  }
+}
+
+static void Loop_Rec(void) { Looper_Command(LOOP_REC); }
+static void Loop_Play(void) { Looper_Command(LOOP_REC); Loop_Record_Halves(); Looper_Command(LOOP_PLAY); }
+static void Loop_Overdub(void) { Loop_Play(); Looper_Command(LOOP_OVERDUB); }
+static void Loop_Off(void) { Looper_Command(LOOP_CLEAR); }
+
+/* A full frame of noisy input, so each of the next TUNER_SLICES halves
+ * gets one YIN slice */
+static void Tuner_On(void)
+{
+  Tuner_Enable(0, 0);
+  Tuner_Enable(1, 0);
+  for (uint16_t n = 0; n < TUNER_FRAME * TUNER_DECIMATION; n += BUFFER_SIZE)
+  {
+    Tuner_Collect(adc_buffer, BUFFER_SIZE);
+  }
+}
+static void Tuner_Off(void) { Tuner_Enable(0, 0); }
+
+static void Tuner_Half(uint8_t half)
+{
+  Tuner_Collect(&adc_buffer[half ? (BUFFER_SIZE / 2) : 0], BUFFER_SIZE / 2);
+  process_audio_flag = 0;
+  Tuner_Process();
+}
+
+/* CMSIS-DSP calls ----------------------------------------------------------------*/
+
+/* Host time of the EQ cascade in the shim, in cycles at the firmware's
+ * rate, to be taken back out of Apply_EQ: the shim is neither the
+ * library's code nor built like the firmware */
+static double Shim_Biquad(void)
+{
+  static float32_t coeffs[5 * EQ_BANDS];
+  static float32_t state[2 * EQ_BANDS];
+  arm_biquad_cascade_df2T_instance_f32 s;
+  double best = 1e30;
+
+  for (uint8_t i = 0; i < EQ_BANDS; i++)
+  {
+    coeffs[5 * i] = 0.9f;
+    coeffs[5 * i + 1] = -1.7f;
+    coeffs[5 * i + 2] = 0.8f;
+    coeffs[5 * i + 3] = 1.7f;
+    coeffs[5 * i + 4] = -0.75f;
+  }
+  arm_biquad_cascade_df2T_init_f32(&s, EQ_BANDS, coeffs, state);
+
+  for (int r = 0; r < repeats; r++)
+  {
+    double t0 = Now_ns();
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+      float32_t y;
+      arm_biquad_cascade_df2T_f32(&s, &bench_input[i], &y, 1);
+      bench_sink = y;
+    }
+    t0 = Now_ns() - t0;
+    if (t0 < best) best = t0;
+  }
+  return best / BENCH_SAMPLES * cycles_per_ns;
+}
+
+/* Interrupt and block engine with every stage off -----------------------------*/
+
+/* ns per call of fn */
+static double Time_Path(void (*fn)(void), uint32_t calls)
+{
+  double best = 1e30;
+
+  for (int r = 0; r < repeats; r++)
+  {
+    double t0 = Now_ns();
+    for (uint32_t i = 0; i < calls; i++) fn();
+    t0 = Now_ns() - t0;
+    if (t0 < best) best = t0;
+  }
+  return best / calls;
+}
+
+static void Isr_Tick(void)
+{
+  HAL_TIM_PeriodElapsedCallback(&htim1);
+}
+
+static void Block_Tick(void)
+{
+  static uint8_t half = 0;
+
+  audio_ready_half = half;
+  Process_Guitar_Signal();
+  Telemetry_Process();
+  Scope_Process();
+  half ^= 1U;
+}
+
+int main(int argc, char **argv)
+{
+  static const BenchStage_t gate = { "gate", Gate_On, Gate_Off, Apply_NoiseGate, NULL, 0 };
+  static const BenchStage_t od[3] = {
+    { "od_soft", Od_Soft, Od_Off, Apply_Overdrive, NULL, 0 },
+    { "od_hard", Od_Hard, Od_Off, Apply_Overdrive, NULL, 0 },
+    { "od_asym", Od_Asym, Od_Off, Apply_Overdrive, NULL, 0 }
+  };
+  static const BenchStage_t dly = { "delay", Delay_On, Delay_Off, Apply_Delay, NULL, 0 };
+  static const BenchStage_t pingpong = { "delay_pingpong", Delay_Pingpong, Delay_Off, Apply_Delay, NULL, 0 };
+  static const BenchStage_t eq_all = { "eq", Eq_On, Eq_Off, Apply_EQ, NULL, 0 };
+  static const BenchStage_t cab_fft = { "cab", Cab_Fft, Cab_Off, Apply_Cabinet, Cabinet_Process_Half, 0 };
+  static const BenchStage_t cab_one = { "cab", Cab_Fft_One, Cab_Off, Apply_Cabinet, Cabinet_Process_Half, 0 };
+  static const BenchStage_t cab_ll = { "cab", Cab_Low_Latency, Cab_Off, Apply_Cabinet, NULL, 0 };
+  static const BenchStage_t mod[3] = {
+    { "chorus", Mod_Chorus, Mod_Off, Apply_Modulation, Modulation_Process_Half, 0 },
+    { "flanger", Mod_Flanger, Mod_Off, Apply_Modulation, Modulation_Process_Half, 0 },
+    { "vibrato", Mod_Vibrato, Mod_Off, Apply_Modulation, Modulation_Process_Half, 0 }
+  };
+  static const BenchStage_t rvb_all = { "reverb", Rvb_All, Rvb_Off, Apply_Reverb, Reverb_Process_Half, 0 };
+  static const BenchStage_t rvb_one = { "reverb", Rvb_One, Rvb_Off, Apply_Reverb, Reverb_Process_Half, 0 };
+  static const BenchStage_t comp = { "comp", Comp_On, Comp_Off, Apply_Compressor, Compressor_Process_Half, 0 };
+  static const BenchStage_t comp_la = { "comp", Comp_Lookahead, Comp_Off, Apply_Compressor, Compressor_Process_Half, 0 };
+  static const BenchStage_t loop[3] = {
+    { "loop_rec", Loop_Rec, Loop_Off, Apply_Looper, Looper_Process_Half, 0 },
+    { "loop_play", Loop_Play, Loop_Off, Apply_Looper, Looper_Process_Half, 0 },
+    { "loop_overdub", Loop_Overdub, Loop_Off, Apply_Looper, Looper_Process_Half, 0 }
+  };
+  static const BenchStage_t tun = { "tuner", Tuner_On, Tuner_Off, Bench_Pass, Tuner_Half, TUNER_SLICES };
+  BenchCost_t c, c1, c2;
+  double mod_isr = 0.0, mod_block = 0.0, loop_isr = 0.0;
+
+  for (int a = 1; a < argc; a++)
+  {
+    if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) repeats = atoi(argv[++a]);
+    else if (strcmp(argv[a], "-k") == 0 && a + 1 < argc) cycles_per_ns = atof(argv[++a]);
+  }
+  if (repeats < 1) repeats = 1;
+
+  // The firmware's own start-up, as far as the DSP path needs it
+  SampleRate_Init();
+  DSP_Flush_To_Zero_Init();
+  Reverb_Init();
+  Cabinet_Init();
+  EQ_Init();
+  DelayMem_Init();
+  Modulation_Init();
+  Compressor_Init();
+  Looper_Init();
+  Governor_Init();
+  Reverb_Set_Params(0.9f, 0.2f, 0.4f);
+  Make_Input();
+
+  // Let the host clock ramp up before anything is timed
+  for (double end = Now_ns() + 3e8; Now_ns() < end;) bench_sink += 1.0f;
+
+  printf("cost_bench: %.2f M4 cycles per host ns, fastest of %d, %u Hz\n",
+         cycles_per_ns, repeats, (unsigned)(sample_rate_hz + 0.5f));
+  printf("%-20s %8s %10s\n", "entry", "table", "measured");
+
+  Report("isr_base", COST_ISR_BASE,
+         Time_Path(Isr_Tick, BENCH_SAMPLES) * cycles_per_ns + BENCH_ISR_HARDWARE,
+         "  (callback + ADC wait and HAL)");
+
+  c = Measure(&gate);
+  Report("gate", COST_GATE, c.isr, "");
+  c = Measure(&od[0]);
+  Report("od_soft", COST_OD_SOFT, c.isr, "");
+  c = Measure(&od[1]);
+  Report("od_hard", COST_OD_HARD, c.isr, "");
+  c = Measure(&od[2]);
+  Report("od_asym", COST_OD_ASYM, c.isr, "");
+  c = Measure(&dly);
+  Report("delay", COST_DELAY, c.isr, "");
+  c = Measure(&pingpong);
+  Report("delay_pingpong", COST_DELAY_PINGPONG, c.isr, "");
+
+  c = Measure(&eq_all);
+  Report("eq_base", COST_EQ_BASE, c.isr - Shim_Biquad() + BENCH_LIB_BIQUAD_CALL, "");
+  Report("eq_band", COST_EQ_BAND, BENCH_LIB_BIQUAD_STAGE, "  (CMSIS, counted)");
+
+  c = Measure(&cab_fft);
+  c1 = Measure(&cab_one);
+  c2 = Measure(&cab_ll);
+  Report("cab_isr", COST_CAB_ISR, c.isr, "");
+  Report("cab_head_tap", COST_CAB_HEAD_TAP, (c2.isr - c.isr) / CAB_HEAD_TAPS, "");
+  {
+    double partition = (c.block - c1.block) / (CAB_MAX_PARTITIONS - 1);
+    Report("cab_fft", COST_CAB_FFT, BENCH_LIB_RFFT_PAIR, "  (CMSIS, counted)");
+    Report("cab_partition", COST_CAB_PARTITION, partition, "");
+  }
+
+  for (int m = 0; m < 3; m++)
+  {
+    c = Measure(&mod[m]);
+    if (c.isr > mod_isr) mod_isr = c.isr;
+    if (c.block > mod_block) mod_block = c.block;
+  }
+  Report("mod_isr", COST_MOD_ISR, mod_isr, "");
+  Report("mod_block", COST_MOD_BLOCK, mod_block, "");
+
+  c = Measure(&rvb_all);
+  c1 = Measure(&rvb_one);
+  Report("rvb_isr", COST_RVB_ISR, c.isr, "");
+  Report("rvb_comb", COST_RVB_COMB, (c.block - c1.block) / (REVERB_COMBS - 1), "");
+  Report("rvb_allpasses", COST_RVB_ALLPASSES,
+         c1.block - (c.block - c1.block) / (REVERB_COMBS - 1), "");
+
+  c = Measure(&comp);
+  c1 = Measure(&comp_la);
+  Report("comp_isr", COST_COMP_ISR, (c.isr > c1.isr) ? c.isr : c1.isr, "");
+  Report("comp_block", COST_COMP_BLOCK, c.block, "");
+  Report("comp_lookahead", COST_COMP_LOOKAHEAD, c1.block - c.block, "");
+
+  {
+    static const uint32_t table[3] = { COST_LOOP_REC, COST_LOOP_PLAY, COST_LOOP_OVERDUB };
+    for (int s = 0; s < 3; s++)
+    {
+      c = Measure(&loop[s]);
+      if (c.isr > loop_isr) loop_isr = c.isr;
+      Report(loop[s].name, table[s], c.block, "");
+    }
+    Report("loop_isr", COST_LOOP_ISR, loop_isr, "");
+  }
+
+  c = Measure(&tun);
+  Report("tuner", COST_TUNER, c.block, "");
+
+  Report("block_base", COST_BLOCK_BASE,
+         Time_Path(Block_Tick, BENCH_HALVES * 4) * cycles_per_ns,
+         "  (Process_Guitar_Signal, telemetry, scope)");
+
+  printf("%d entries under %.0f%% of the measured cycles\n", failures, BENCH_TOLERANCE * 100.0);
+  return failures ? 1 : 0;
+}
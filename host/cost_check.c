@@ -0,0 +1,158 @@
+/* cost_check.c
+ * Cost model table export and cross-check against the backend copy
+ *
+ * Usage: cost_check [-t] [-n count]
+ *   -t  print the table in cost_model.h as JSON (backend/cost_table.json)
+ *   otherwise print -n (default 2000) configurations, one JSON object per
+ *   line with CostModel_Predict's result, for backend/costModel.js --check
+ *   to recompute and compare. The first ones are the corners (everything
+ *   off, everything on at each rate), the rest are random.
+ */
+
+#include "cost_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COST_TABLE(X)                                     \
+  X(core_hz, COST_CORE_HZ)                                \
+  X(buffer_size, BUFFER_SIZE)                             \
+  X(isr_base, COST_ISR_BASE)                              \
+  X(gate, COST_GATE)                                      \
+  X(od_soft, COST_OD_SOFT)                                \
+  X(od_hard, COST_OD_HARD)                                \
+  X(od_asym, COST_OD_ASYM)                                \
+  X(delay, COST_DELAY)                                    \
+  X(delay_pingpong, COST_DELAY_PINGPONG)                  \
+  X(eq_base, COST_EQ_BASE)                                \
+  X(eq_band, COST_EQ_BAND)                                \
+  X(cab_isr, COST_CAB_ISR)                                \
+  X(cab_head_tap, COST_CAB_HEAD_TAP)                      \
+  X(mod_isr, COST_MOD_ISR)                                \
+  X(rvb_isr, COST_RVB_ISR)                                \
+  X(comp_isr, COST_COMP_ISR)                              \
+  X(loop_isr, COST_LOOP_ISR)                              \
+  X(block_base, COST_BLOCK_BASE)                          \
+  X(cab_fft, COST_CAB_FFT)                                \
+  X(cab_partition, COST_CAB_PARTITION)                    \
+  X(mod_block, COST_MOD_BLOCK)                            \
+  X(rvb_comb, COST_RVB_COMB)                              \
+  X(rvb_allpasses, COST_RVB_ALLPASSES)                    \
+  X(comp_block, COST_COMP_BLOCK)                          \
+  X(comp_lookahead, COST_COMP_LOOKAHEAD)                  \
+  X(loop_rec, COST_LOOP_REC)                              \
+  X(loop_play, COST_LOOP_PLAY)                            \
+  X(loop_overdub, COST_LOOP_OVERDUB)                      \
+  X(tuner, COST_TUNER)                                    \
+  X(cab_partition_taps, COST_CAB_PARTITION_TAPS)          \
+  X(cab_head_taps, COST_CAB_HEAD_TAPS)                    \
+  X(warn_permille, COST_WARN_PERMILLE)                    \
+  X(max_permille, COST_MAX_PERMILLE)
+
+/* Rates SR: accepts (sample_rate.c) */
+static const uint32_t rates[] = { 32000, 44100, 48000, 96000 };
+
+static uint32_t seed = 12345;
+
+static uint32_t Random(uint32_t n)
+{
+  seed = seed * 1664525U + 1013904223U;
+  return (seed >> 8) % n;
+}
+
+static void Print_Table(void)
+{
+  const char *sep = "";
+
+  printf("{\n");
+#define X(name, value)                                                    \
+  printf("%s  \"%s\": %lu", sep, #name, (unsigned long)(value));         \
+  sep = ",\n";
+  COST_TABLE(X)
+#undef X
+  printf("\n}\n");
+}
+
+static void Print_Vector(const CostConfig_t *c)
+{
+  CostEstimate_t e;
+
+  CostModel_Predict(c, &e);
+  printf("{\"config\":{\"core_hz\":%lu,\"sample_rate_hz\":%lu,\"gate\":%u,\"od\":%u,\"od_mode\":%u,"
+         "\"delay\":%u,\"pingpong\":%u,\"eq_bands\":%u,\"cab\":%u,\"cab_low_latency\":%u,"
+         "\"cab_taps\":%u,\"mod\":%u,\"rvb_combs\":%u,\"comp\":%u,\"comp_lookahead\":%u,"
+         "\"looper\":%u,\"tuner\":%u},",
+         (unsigned long)c->core_hz, (unsigned long)c->sample_rate_hz, c->gate, c->od, c->od_mode,
+         c->delay, c->pingpong, c->eq_bands, c->cab, c->cab_low_latency, c->cab_taps, c->mod,
+         c->rvb_combs, c->comp, c->comp_lookahead, c->looper, c->tuner);
+  printf("\"isr_per_sample\":%lu,\"block_per_half\":%lu,\"total_per_half\":%lu,"
+         "\"budget_per_half\":%lu,\"permille\":%lu}\n",
+         (unsigned long)e.isr_per_sample, (unsigned long)e.block_per_half,
+         (unsigned long)e.total_per_half, (unsigned long)e.budget_per_half, (unsigned long)e.permille);
+}
+
+static void Full_Chain(CostConfig_t *c, uint32_t rate)
+{
+  c->core_hz = COST_CORE_HZ;
+  c->sample_rate_hz = rate;
+  c->gate = c->od = c->delay = c->pingpong = 1;
+  c->eq_bands = 5;
+  c->cab = c->cab_low_latency = 1;
+  c->cab_taps = 256;
+  c->mod = 2;
+  c->rvb_combs = 4;
+  c->comp = c->comp_lookahead = 1;
+  c->looper = 3;
+  c->tuner = 1;
+}
+
+int main(int argc, char **argv)
+{
+  int count = 2000;
+  int n = 0;
+  CostConfig_t c;
+
+  for (int a = 1; a < argc; a++)
+  {
+    if (strcmp(argv[a], "-t") == 0)
+    {
+      Print_Table();
+      return 0;
+    }
+    if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) count = atoi(argv[++a]);
+  }
+
+  for (uint32_t r = 0; r < sizeof(rates) / sizeof(rates[0]) && n < count; r++, n += 3)
+  {
+    memset(&c, 0, sizeof(c));
+    c.core_hz = COST_CORE_HZ;
+    c.sample_rate_hz = rates[r];
+    Print_Vector(&c);
+    Full_Chain(&c, rates[r]);
+    Print_Vector(&c);
+    c.cab_low_latency = 0;
+    Print_Vector(&c);
+  }
+  for (; n < count; n++)
+  {
+    c.core_hz = (Random(4) == 0) ? 150000000U : COST_CORE_HZ;
+    c.sample_rate_hz = rates[Random(4)];
+    c.gate = (uint8_t)Random(2);
+    c.od = (uint8_t)Random(2);
+    c.od_mode = (uint8_t)Random(3);
+    c.delay = (uint8_t)Random(2);
+    c.pingpong = (uint8_t)Random(2);
+    c.eq_bands = (uint8_t)Random(6);
+    c.cab = (uint8_t)Random(2);
+    c.cab_low_latency = (uint8_t)Random(2);
+    c.cab_taps = (uint16_t)Random(257);
+    c.mod = (uint8_t)Random(4);
+    c.rvb_combs = (uint8_t)Random(5);
+    c.comp = (uint8_t)Random(2);
+    c.comp_lookahead = (uint8_t)Random(2);
+    c.looper = (uint8_t)Random(4);
+    c.tuner = (uint8_t)Random(2);
+    Print_Vector(&c);
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+/* denormal_bench.c
+ * Cost of silence against signal through the feedback-heavy effects
+ *
+ * Usage: denormal_bench [-s seconds] [-r repeats]
+ *   Plays half a second of plucked notes and then -s seconds (default 3)
+ *   of digital silence through gate -> EQ -> overdrive -> delay -> reverb,
+ *   as the timer interrupt and block engine run them, and times every
+ *   BENCH_WINDOW. The filter states, the delay tone low-pass and the gate
+ *   envelope decay through the denormal range during the tail. It runs
+ *   once with FZ off (plain IEEE, as a host build without host_fpu.h) and
+ *   once with it on, keeping the fastest of -r repeats per window.
+ *
+ * Prints ns/sample for the signal, the slowest silence window and the
+ * number of windows that ended with a denormal state. Exit status 1 if
+ * with FZ on the silence costs more than BENCH_MAX_RATIO times the signal.
+ */
+
+#include "main.h"
+#include "effects.h"
+#include "delay_mem.h"
+#include "eq.h"
+#include "reverb.h"
+#include "telemetry.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Firmware globals referenced by effects.c, delay_mem.c and reverb.c
+float32_t sample_rate_hz = (float32_t)SAMPLE_RATE;
+int16_t delay_buffer[DELAY_BUFFER_SIZE];
+uint32_t delay_write_index = 0;
+volatile uint16_t buffer_index = 0;
+MeterBlock_t meter_block;
+
+uint32_t CRC32_Calculate(const void *data, uint32_t length)
+{
+  (void)data;
+  (void)length;
+  return 0;
+}
+
+#define BENCH_WINDOW (SAMPLE_RATE / 4)
+#define BENCH_SIGNAL_S 0.5f
+#define BENCH_MAX_SECONDS 30
+#define BENCH_MAX_WINDOWS (BENCH_MAX_SECONDS * SAMPLE_RATE / BENCH_WINDOW + 2)
+#define BENCH_MAX_RATIO 1.5
+
+typedef struct {
+  double ns_per_sample[BENCH_MAX_WINDOWS];
+  uint8_t denormal[BENCH_MAX_WINDOWS];
+} BenchRun_t;
+
+static double Now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint32_t Make_Input(float *out, float silence_s)
+{
+  uint32_t signal = (uint32_t)(BENCH_SIGNAL_S * SAMPLE_RATE);
+  uint32_t n = signal + (uint32_t)(silence_s * SAMPLE_RATE);
+  static float line[1024];
+  uint32_t seed = 4242;
+  uint32_t period = SAMPLE_RATE / 110;  // A2, Karplus-Strong
+
+  memset(out, 0, n * sizeof(float));
+  for (uint32_t i = 0; i < period; i++)
+  {
+    seed = seed * 1664525U + 1013904223U;
+    line[i] = 0.3f * ((float)(seed >> 8) / 8388608.0f - 1.0f);
+  }
+  for (uint32_t i = 0, p = 0; i < signal; i++)
+  {
+    uint32_t q = (p + 1 < period) ? p + 1 : 0;
+    out[i] = line[p];
+    line[p] = 0.996f * 0.5f * (line[p] + line[q]);
+    p = q;
+  }
+  return n;
+}
+
+static int Is_Denormal(float x)
+{
+  return fpclassify(x) == FP_SUBNORMAL;
+}
+
+static int Any_Denormal_State(void)
+{
+  int found = Is_Denormal(overdrive.hp_state) || Is_Denormal(overdrive.lp_state) ||
+              Is_Denormal(delay_effect.lp_state) || Is_Denormal(noise_gate.envelope);
+  for (uint8_t i = 0; i < REVERB_COMBS; i++) found |= Is_Denormal(reverb.comb[i].filter_state);
+  return found;
+}
+
+/**
+  * Every state the chain carries back to zero; parameters stay
+  */
+static void Reset_State(void)
+{
+  overdrive.hp_state = 0.0f;
+  overdrive.lp_state = 0.0f;
+  delay_effect.lp_state = 0.0f;
+  noise_gate.envelope = 0.0f;
+  memset(delay_buffer, 0, sizeof(delay_buffer));
+  delay_write_index = 0;
+  buffer_index = 0;
+  EQ_Init();
+  Reverb_Clear();
+}
+
+static void Setup_Chain(void)
+{
+  EffectParams_t params;
+
+  params.volume = 0.7f;
+  params.od_gain = 8.0f;
+  params.od_threshold = 0.7f;
+  params.od_tone = 0.5f;
+  params.od_mix = 0.8f;
+  params.dly_feedback = 0.5f;
+  params.dly_mix = 0.4f;
+  params.dly_tone = 0.6f;
+  params.gate_threshold = 0.015f;
+  params.gate_attack = 0.001f;
+  params.gate_release = 0.3f;
+  params.dly_samples = DELAY_BUFFER_SIZE / 2;
+  params.od_mode = 0;
+  params.od_enabled = 1;
+  params.dly_enabled = 1;
+  params.gate_enabled = 1;
+  Effects_Queue_Params(&params);
+  Effects_Apply_Pending();
+
+  DelayMem_Init();
+  EQ_Set_Band(0, EQ_TYPE_LOW_SHELF, 100.0f, 6.0f, 0.7f);
+  EQ_Set_Band(2, EQ_TYPE_PEAK, 800.0f, -4.0f, 1.0f);
+  eq.enabled = 1;
+  Reverb_Init();
+  Reverb_Set_Params(0.8f, 0.3f, 0.3f);
+  reverb.enabled = 1;
+}
+
+static void Run(const float *input, uint32_t n, BenchRun_t *run, int first)
+{
+  volatile float sink = 0.0f;
+  uint32_t windows = n / BENCH_WINDOW;
+
+  Reset_State();
+  for (uint32_t w = 0; w < windows; w++)
+  {
+    const float *in = &input[w * BENCH_WINDOW];
+    double start = Now_ns();
+    double ns;
+
+    for (uint32_t i = 0; i < BENCH_WINDOW; i++)
+    {
+      float32_t x = Apply_NoiseGate(in[i]);
+      x = Apply_EQ(x);
+      x = Apply_Overdrive(x);
+      x = Apply_Delay(x);
+      x = Apply_Reverb(x) * output_volume;
+      sink += x;
+
+      if (++buffer_index == BUFFER_SIZE / 2 || buffer_index == BUFFER_SIZE)
+      {
+        Reverb_Process_Half(buffer_index == BUFFER_SIZE);
+        if (buffer_index == BUFFER_SIZE) buffer_index = 0;
+      }
+    }
+    ns = (Now_ns() - start) / BENCH_WINDOW;
+    if (first || ns < run->ns_per_sample[w]) run->ns_per_sample[w] = ns;
+    if (first) run->denormal[w] = 0;
+    run->denormal[w] |= (uint8_t)Any_Denormal_State();
+  }
+  (void)sink;
+}
+
+static double Report(const char *name, const BenchRun_t *run, uint32_t windows)
+{
+  uint32_t signal_windows = (uint32_t)(BENCH_SIGNAL_S * SAMPLE_RATE) / BENCH_WINDOW;
+  double signal = 0.0, worst = 0.0;
+  uint32_t worst_at = 0, denormal = 0;
+
+  for (uint32_t w = 0; w < windows; w++)
+  {
+    if (w < signal_windows) signal += run->ns_per_sample[w];
+    else if (run->ns_per_sample[w] > worst)
+    {
+      worst = run->ns_per_sample[w];
+      worst_at = w;
+    }
+    denormal += run->denormal[w];
+  }
+  signal /= signal_windows;
+  printf("%-7s signal %6.1f ns/sample, worst silence %6.1f ns/sample at %5.2f s (x%.2f), "
+         "windows with denormal state %u/%u\n",
+         name, signal, worst, (double)worst_at * BENCH_WINDOW / SAMPLE_RATE, worst / signal,
+         denormal, windows);
+  return worst / signal;
+}
+
+int main(int argc, char **argv)
+{
+  float silence_s = 3.0f;
+  int repeats = 5;
+  static float input[BENCH_MAX_SECONDS * SAMPLE_RATE + SAMPLE_RATE];
+  static BenchRun_t off, on;
+  uint32_t n, windows;
+  double ratio;
+
+  for (int a = 1; a + 1 < argc; a += 2)
+  {
+    if (strcmp(argv[a], "-s") == 0) silence_s = (float)atof(argv[a + 1]);
+    else if (strcmp(argv[a], "-r") == 0) repeats = atoi(argv[a + 1]);
+  }
+  if (silence_s < 0.5f) silence_s = 0.5f;
+  if (silence_s > BENCH_MAX_SECONDS - 1) silence_s = BENCH_MAX_SECONDS - 1;
+  if (repeats < 1) repeats = 1;
+
+  n = Make_Input(input, silence_s);
+  windows = n / BENCH_WINDOW;
+  Setup_Chain();
+
+  for (int r = 0; r < repeats; r++)
+  {
+    __set_FPSCR(__get_FPSCR() & ~FPU_FPDSCR_FZ_Msk);
+    Run(input, n, &off, r == 0);
+    __set_FPSCR(__get_FPSCR() | FPU_FPDSCR_FZ_Msk);
+    Run(input, n, &on, r == 0);
+  }
+
+  Report("FZ off", &off, windows);
+  ratio = Report("FZ on", &on, windows);
+  if (ratio > BENCH_MAX_RATIO)
+  {
+    printf("FAIL: silence costs more than %.1fx the signal with FZ on\n", BENCH_MAX_RATIO);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
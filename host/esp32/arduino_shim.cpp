@@ -0,0 +1,571 @@
+/* arduino_shim.cpp
+ * Host implementations behind include/: time, String formatting, the
+ * serial ports, FreeRTOS tasks, queues and mutexes on pthreads, WiFiClient
+ * and HTTPClient over sockets and the JSON parser (the web server is in
+ * async_web_server.cpp)
+ */
+
+#include "Arduino.h"
+#include "ArduinoJson.h"
+#include "HTTPClient.h"
+#include "WiFi.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial(STDOUT_FILENO);
+HardwareSerial Serial2;
+WiFiClass WiFi;
+
+/* Time -----------------------------------------------------------------------*/
+static uint64_t Now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static const uint64_t start_us = Now_us();
+
+unsigned long millis(void) { return (unsigned long)((Now_us() - start_us) / 1000ULL); }
+
+void delay(unsigned long ms) { usleep((useconds_t)ms * 1000U); }
+
+// The sketch spins on yield() while waiting for bytes; leave the core to
+// the simulator, which runs in real time next to us
+void yield(void) { usleep(50); }
+
+/* String ---------------------------------------------------------------------*/
+static std::string Format_Integer(unsigned long long v, bool negative, unsigned char base) {
+  char buf[72];
+  int i = (int)sizeof(buf) - 1;
+  buf[i] = '\0';
+  if (base < 2 || base > 36) base = 10;
+  do {
+    buf[--i] = "0123456789abcdefghijklmnopqrstuvwxyz"[v % base];
+    v /= base;
+  } while (v);
+  if (negative) buf[--i] = '-';
+  return std::string(&buf[i]);
+}
+
+String::String(int v, unsigned char base) : String((long)v, base) {}
+String::String(unsigned int v, unsigned char base) : String((unsigned long)v, base) {}
+String::String(long v, unsigned char base)
+    : s_(Format_Integer(v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v, v < 0 && base == 10, base)) {}
+String::String(unsigned long v, unsigned char base) : s_(Format_Integer(v, false, base)) {}
+
+String::String(double v, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  s_ = buf;
+}
+
+void String::trim() {
+  size_t a = s_.find_first_not_of(" \t\r\n");
+  size_t b = s_.find_last_not_of(" \t\r\n");
+  s_ = (a == std::string::npos) ? std::string() : s_.substr(a, b - a + 1);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+/* Serial ports ---------------------------------------------------------------*/
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rx, int8_t tx) {
+  struct termios tio;
+
+  if (path_ == nullptr) return;  // the console is already open
+  fd_ = open(path_, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd_ < 0) {
+    perror(path_);
+    exit(2);
+  }
+  if (tcgetattr(fd_, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tcsetattr(fd_, TCSANOW, &tio);
+  }
+}
+
+int HardwareSerial::available() {
+  if (rx_pos_ >= rx_len_ && fd_ >= 0 && fd_ != STDOUT_FILENO) {
+    ssize_t n = ::read(fd_, rx_, sizeof(rx_));
+    rx_pos_ = 0;
+    rx_len_ = (n > 0) ? (size_t)n : 0;
+  }
+  return (int)(rx_len_ - rx_pos_);
+}
+
+int HardwareSerial::read() {
+  return available() ? rx_[rx_pos_++] : -1;
+}
+
+void HardwareSerial::flush() {
+  if (fd_ == STDOUT_FILENO) fflush(stdout);
+  else if (fd_ >= 0) tcdrain(fd_);
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+  size_t done = 0;
+
+  if (fd_ == STDOUT_FILENO) return fwrite(data, 1, len, stdout);
+  while (fd_ >= 0 && done < len) {
+    ssize_t n = ::write(fd_, data + done, len - done);
+    if (n > 0) done += (size_t)n;
+    else if (n < 0 && errno != EAGAIN) break;
+    else usleep(100);  // the UART FIFO is full
+  }
+  return done;
+}
+
+/* FreeRTOS -------------------------------------------------------------------*/
+struct TaskStart {
+  TaskFunction_t task;
+  void* parameters;
+};
+
+static void* Task_Thread(void* arg) {
+  TaskStart start = *(TaskStart*)arg;
+  delete (TaskStart*)arg;
+  start.task(start.parameters);
+  return nullptr;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack_depth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+  pthread_t thread;
+  TaskStart* start = new TaskStart{ task, parameters };
+
+  if (pthread_create(&thread, nullptr, Task_Thread, start) != 0) {
+    delete start;
+    return pdFAIL;
+  }
+  pthread_detach(thread);
+  if (handle) *handle = (TaskHandle_t)thread;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+struct QueueDefinition {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  uint8_t* items;
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t head;
+  UBaseType_t count;
+};
+
+/* Wait on cond until ready() or the ticks run out; called with the lock held */
+template <typename Ready>
+static bool Queue_Wait(QueueHandle_t q, pthread_cond_t* cond, TickType_t ticks, Ready ready) {
+  struct timespec until;
+
+  if (ticks != portMAX_DELAY) {
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += ticks / 1000;
+    until.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+  }
+  while (!ready()) {
+    if (ticks == 0) return false;
+    if (ticks == portMAX_DELAY) pthread_cond_wait(cond, &q->lock);
+    else if (pthread_cond_timedwait(cond, &q->lock, &until) != 0) return ready();
+  }
+  return true;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  QueueHandle_t q = new QueueDefinition;
+
+  pthread_mutex_init(&q->lock, nullptr);
+  pthread_cond_init(&q->not_empty, nullptr);
+  pthread_cond_init(&q->not_full, nullptr);
+  q->items = new uint8_t[length * item_size];
+  q->length = length;
+  q->item_size = item_size;
+  q->head = 0;
+  q->count = 0;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks_to_wait) {
+  pthread_mutex_lock(&q->lock);
+  if (!Queue_Wait(q, &q->not_full, ticks_to_wait, [q] { return q->count < q->length; })) {
+    pthread_mutex_unlock(&q->lock);
+    return pdFAIL;
+  }
+  memcpy(q->items + ((q->head + q->count) % q->length) * q->item_size, item, q->item_size);
+  q->count++;
+  pthread_cond_signal(&q->not_empty);
+  pthread_mutex_unlock(&q->lock);
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* buffer, TickType_t ticks_to_wait) {
+  pthread_mutex_lock(&q->lock);
+  if (!Queue_Wait(q, &q->not_empty, ticks_to_wait, [q] { return q->count > 0; })) {
+    pthread_mutex_unlock(&q->lock);
+    return pdFAIL;
+  }
+  memcpy(buffer, q->items + q->head * q->item_size, q->item_size);
+  q->head = (q->head + 1) % q->length;
+  q->count--;
+  pthread_cond_signal(&q->not_full);
+  pthread_mutex_unlock(&q->lock);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  pthread_mutex_lock(&q->lock);
+  UBaseType_t count = q->count;
+  pthread_mutex_unlock(&q->lock);
+  return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) { return q->length - uxQueueMessagesWaiting(q); }
+
+struct SemaphoreDefinition {
+  pthread_mutex_t lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  SemaphoreHandle_t s = new SemaphoreDefinition;
+  pthread_mutex_init(&s->lock, nullptr);
+  return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks_to_wait) {
+  struct timespec until;
+
+  if (ticks_to_wait == portMAX_DELAY) return pthread_mutex_lock(&s->lock) == 0 ? pdPASS : pdFAIL;
+  clock_gettime(CLOCK_REALTIME, &until);
+  until.tv_sec += ticks_to_wait / 1000;
+  until.tv_nsec += (long)(ticks_to_wait % 1000) * 1000000L;
+  if (until.tv_nsec >= 1000000000L) {
+    until.tv_sec++;
+    until.tv_nsec -= 1000000000L;
+  }
+  return pthread_mutex_timedlock(&s->lock, &until) == 0 ? pdPASS : pdFAIL;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pthread_mutex_unlock(&s->lock) == 0 ? pdPASS : pdFAIL; }
+
+/* WiFiClient -----------------------------------------------------------------*/
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeout_ms) {
+  struct addrinfo hints, *addr = nullptr;
+  char service[8];
+  int one = 1;
+
+  stop();
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &addr) != 0) return 0;
+  fd_ = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (fd_ < 0 || ::connect(fd_, addr->ai_addr, addr->ai_addrlen) != 0) {
+    freeaddrinfo(addr);
+    stop();
+    return 0;
+  }
+  freeaddrinfo(addr);
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  eof_ = false;
+  rx_len_ = rx_pos_ = 0;
+  return 1;
+}
+
+int WiFiClient::available() {
+  if (rx_pos_ >= rx_len_ && fd_ >= 0 && !eof_) {
+    ssize_t n = recv(fd_, rx_, sizeof(rx_), MSG_DONTWAIT);
+    rx_pos_ = 0;
+    rx_len_ = (n > 0) ? (size_t)n : 0;
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) eof_ = true;
+  }
+  return (int)(rx_len_ - rx_pos_);
+}
+
+size_t WiFiClient::write(const uint8_t* data, size_t len) {
+  ssize_t n = (fd_ >= 0) ? send(fd_, data, len, MSG_NOSIGNAL) : -1;
+  return (n > 0) ? (size_t)n : 0;
+}
+
+void WiFiClient::stop() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  eof_ = false;
+  rx_len_ = rx_pos_ = 0;
+}
+
+/* HTTPClient -----------------------------------------------------------------*/
+bool HTTPClient::begin(const String& url) {
+  String rest = url.startsWith("http://") ? url.substring(7) : url;
+  int slash = rest.indexOf('/');
+  String authority = (slash < 0) ? rest : rest.substring(0, slash);
+  int colon = authority.indexOf(':');
+
+  path_ = (slash < 0) ? String("/") : rest.substring(slash);
+  host_ = (colon < 0) ? authority : authority.substring(0, colon);
+  port_ = (colon < 0) ? 80 : (uint16_t)authority.substring(colon + 1).toInt();
+  headers_ = "";
+  response_headers_ = "";
+  body_ = "";
+  return host_.length() > 0;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+  headers_ += name + ": " + value + "\r\n";
+}
+
+String HTTPClient::header(const char* name) {
+  size_t n = strlen(name);
+  const char* line = response_headers_.c_str();
+
+  // The first line is the status line; header names are case-insensitive
+  while ((line = strchr(line, '\n')) != nullptr) {
+    line++;
+    if (strncasecmp(line, name, n) == 0 && line[n] == ':') {
+      const char* value = line + n + 1;
+      String result(std::string(value, strcspn(value, "\r\n")));
+      result.trim();
+      return result;
+    }
+  }
+  return String();
+}
+
+int HTTPClient::sendRequest(const char* method, const String& body) {
+  struct addrinfo hints, *addr = nullptr;
+  struct timeval tv = { timeout_ms_ / 1000, (timeout_ms_ % 1000) * 1000 };
+  char port[8];
+  std::string response;
+  char buf[1024];
+  int fd;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  snprintf(port, sizeof(port), "%u", port_);
+  if (getaddrinfo(host_.c_str(), port, &hints, &addr) != 0) return HTTPC_ERROR_CONNECTION_REFUSED;
+  fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (fd < 0 || connect(fd, addr->ai_addr, addr->ai_addrlen) != 0) {
+    freeaddrinfo(addr);
+    if (fd >= 0) close(fd);
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  freeaddrinfo(addr);
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  String request = String(method) + " " + path_ + " HTTP/1.1\r\nHost: " + host_ +
+                   "\r\nConnection: close\r\n" + headers_;
+  if (body.length() || strcmp(method, "POST") == 0) {
+    request += "Content-Length: " + String(body.length()) + "\r\n";
+  }
+  request += "\r\n" + body;
+  if (send(fd, request.c_str(), request.length(), MSG_NOSIGNAL) != (ssize_t)request.length()) {
+    close(fd);
+    return HTTPC_ERROR_SEND_HEADER_FAILED;
+  }
+
+  for (;;) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n > 0) response.append(buf, (size_t)n);
+    else if (n == 0) break;
+    else {
+      close(fd);
+      return HTTPC_ERROR_READ_TIMEOUT;
+    }
+  }
+  close(fd);
+
+  size_t head_end = response.find("\r\n\r\n");
+  if (response.compare(0, 5, "HTTP/") != 0 || head_end == std::string::npos) return HTTPC_ERROR_NOT_CONNECTED;
+  response_headers_ = String(response.substr(0, head_end));
+  std::string payload = response.substr(head_end + 4);
+
+  // Express answers res.json() with Content-Length; decode chunks anyway
+  if (header("Transfer-Encoding") == String("chunked")) {
+    std::string decoded;
+    size_t at = 0;
+    for (;;) {
+      size_t line_end = payload.find("\r\n", at);
+      if (line_end == std::string::npos) break;
+      size_t size = strtoul(payload.c_str() + at, nullptr, 16);
+      if (size == 0) break;
+      decoded.append(payload, line_end + 2, size);
+      at = line_end + 2 + size + 2;
+    }
+    payload = decoded;
+  }
+  body_ = String(payload);
+  return atoi(response.c_str() + response.find(' ') + 1);
+}
+
+/* JSON -----------------------------------------------------------------------*/
+const JsonNode* JsonVariant::Find(const char* key) const {
+  if (node_ == nullptr || node_->type != JsonNode::Object) return nullptr;
+  for (const auto& member : node_->members) {
+    if (member.first == key) return member.second;
+  }
+  return nullptr;
+}
+
+const char* DeserializationError::c_str() const {
+  static const char* const names[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory" };
+  return names[code_];
+}
+
+namespace {
+
+struct JsonParser {
+  const char* p;
+  const char* end;
+  JsonDocument* doc;
+  std::deque<JsonNode>* nodes;
+  int depth;
+
+  void Skip() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+  }
+
+  bool Literal(const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end - p) < n || strncmp(p, word, n) != 0) return false;
+    p += n;
+    return true;
+  }
+
+  DeserializationError::Code Text(std::string* out) {
+    p++;  // opening quote
+    while (p < end && *p != '"') {
+      char c = *p++;
+      if (c == '\\') {
+        if (p >= end) return DeserializationError::IncompleteInput;
+        c = *p++;
+        switch (c) {
+          case 'n': c = '\n'; break;
+          case 't': c = '\t'; break;
+          case 'r': c = '\r'; break;
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'u': {
+            if (end - p < 4) return DeserializationError::IncompleteInput;
+            unsigned long code = strtoul(std::string(p, 4).c_str(), nullptr, 16);
+            p += 4;
+            c = (code < 0x80) ? (char)code : '?';  // the bridge only needs ASCII
+            break;
+          }
+          default: break;  // \" \\ \/
+        }
+      }
+      out->push_back(c);
+    }
+    if (p >= end) return DeserializationError::IncompleteInput;
+    p++;
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code Value(JsonNode* node) {
+    DeserializationError::Code err;
+
+    Skip();
+    if (p >= end) return DeserializationError::IncompleteInput;
+    if (++depth > 10) return DeserializationError::NoMemory;  // ArduinoJson's nesting limit
+    if (*p == '{' || *p == '[') {
+      char close = (*p == '{') ? '}' : ']';
+      node->type = (*p == '{') ? JsonNode::Object : JsonNode::Array;
+      p++;
+      Skip();
+      if (p < end && *p == close) {
+        p++;
+        depth--;
+        return DeserializationError::Ok;
+      }
+      for (;;) {
+        std::string key;
+        Skip();
+        if (node->type == JsonNode::Object) {
+          if (p >= end) return DeserializationError::IncompleteInput;
+          if (*p != '"') return DeserializationError::InvalidInput;
+          if ((err = Text(&key)) != DeserializationError::Ok) return err;
+          Skip();
+          if (p >= end) return DeserializationError::IncompleteInput;
+          if (*p++ != ':') return DeserializationError::InvalidInput;
+        }
+        nodes->emplace_back();
+        JsonNode* child = &nodes->back();
+        if ((err = Value(child)) != DeserializationError::Ok) return err;
+        node->members.emplace_back(key, child);
+        Skip();
+        if (p >= end) return DeserializationError::IncompleteInput;
+        if (*p == ',') {
+          p++;
+          continue;
+        }
+        if (*p++ != close) return DeserializationError::InvalidInput;
+        break;
+      }
+    } else if (*p == '"') {
+      node->type = JsonNode::Text;
+      if ((err = Text(&node->text)) != DeserializationError::Ok) return err;
+    } else if (Literal("true")) {
+      node->type = JsonNode::Bool;
+      node->boolean = true;
+    } else if (Literal("false")) {
+      node->type = JsonNode::Bool;
+    } else if (Literal("null")) {
+      node->type = JsonNode::Null;
+    } else {
+      char* stop;
+      std::string number(p, (size_t)(end - p) < 64 ? (size_t)(end - p) : 64);
+      node->type = JsonNode::Number;
+      node->number = strtod(number.c_str(), &stop);
+      if (stop == number.c_str()) return DeserializationError::InvalidInput;
+      p += stop - number.c_str();
+    }
+    depth--;
+    return DeserializationError::Ok;
+  }
+};
+
+}  // namespace
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+  JsonParser parser = { input, input + length, &doc, &doc.nodes_, 0 };
+  DeserializationError::Code err;
+
+  doc.clear();
+  parser.Skip();
+  if (parser.p >= parser.end) return DeserializationError::EmptyInput;
+  doc.root_ = doc.NewNode();
+  err = parser.Value(doc.root_);
+  if (err != DeserializationError::Ok) doc.clear();
+  return err;
+}
@@ -0,0 +1,440 @@
+/* async_web_server.cpp
+ * Host implementations behind ESPAsyncWebServer.h and ESPmDNS.h: one
+ * server thread polls the listening socket and every connection, parses
+ * HTTP/1.1 requests and RFC 6455 frames and calls the sketch's handlers
+ * (without any lock held, so they may block on the sketch's own mutex)
+ */
+
+#include "ESPAsyncWebServer.h"
+#include "ESPmDNS.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WEB_BODY_MAX 65536u
+#define WEB_FRAME_MAX 65536u
+
+MDNSResponder MDNS;
+uint16_t AsyncWebServer::host_port_ = 0;
+
+// Guards WebSocket client lists and frame writes (textAll() comes from loop())
+static pthread_mutex_t web_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct AsyncWebServer::Connection {
+  int fd;
+  std::string in;
+  AsyncWebSocket* socket = nullptr;  // set once upgraded
+  AsyncWebSocketClient* client = nullptr;
+};
+
+/* mDNS -----------------------------------------------------------------------*/
+bool MDNSResponder::begin(const char* hostname) {
+  printf("[host] mDNS not available, %s.local is not advertised\n", hostname);
+  return true;
+}
+
+bool MDNSResponder::addService(const char* service, const char* proto, uint16_t port) { return true; }
+
+/* SHA-1 and base64 for the WebSocket handshake -------------------------------*/
+static uint32_t Rotl(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+static void Sha1(const std::string& message, uint8_t digest[20]) {
+  uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  std::string m = message;
+  uint64_t bits = (uint64_t)message.size() * 8;
+
+  m.push_back((char)0x80);
+  while (m.size() % 64 != 56) m.push_back('\0');
+  for (int i = 7; i >= 0; i--) m.push_back((char)(bits >> (i * 8)));
+
+  for (size_t block = 0; block < m.size(); block += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const uint8_t* p = (const uint8_t*)m.data() + block + i * 4;
+      w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+      else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+      else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+      else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+      uint32_t t = Rotl(a, 5) + f + e + k + w[i];
+      e = d; d = c; c = Rotl(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+  for (int i = 0; i < 20; i++) digest[i] = (uint8_t)(h[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static std::string Base64(const uint8_t* data, size_t len) {
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t v = (uint32_t)data[i] << 16 | (i + 1 < len ? (uint32_t)data[i + 1] << 8 : 0) |
+                 (i + 2 < len ? data[i + 2] : 0);
+    out.push_back(table[(v >> 18) & 63]);
+    out.push_back(table[(v >> 12) & 63]);
+    out.push_back(i + 1 < len ? table[(v >> 6) & 63] : '=');
+    out.push_back(i + 2 < len ? table[v & 63] : '=');
+  }
+  return out;
+}
+
+/* Socket helpers -------------------------------------------------------------*/
+static void Send_All(int fd, const void* data, size_t len) {
+  const char* p = (const char*)data;
+  while (len > 0) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    p += n;
+    len -= (size_t)n;
+  }
+}
+
+/* One unmasked frame (server to client); call with web_lock held */
+static void Send_Frame(int fd, uint8_t opcode, const void* data, size_t len) {
+  uint8_t head[10];
+  size_t n = 2;
+
+  head[0] = 0x80 | opcode;
+  if (len < 126) {
+    head[1] = (uint8_t)len;
+  } else if (len < 65536) {
+    head[1] = 126;
+    head[2] = (uint8_t)(len >> 8);
+    head[3] = (uint8_t)len;
+    n = 4;
+  } else {
+    head[1] = 127;
+    for (int i = 0; i < 8; i++) head[2 + i] = (uint8_t)((uint64_t)len >> (56 - i * 8));
+    n = 10;
+  }
+  Send_All(fd, head, n);
+  Send_All(fd, data, len);
+}
+
+static const char* Reason(int code) {
+  switch (code) {
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 422: return "Unprocessable Entity";
+    case 500: return "Internal Server Error";
+    default: return "Status";
+  }
+}
+
+/* Request --------------------------------------------------------------------*/
+DefaultHeaders& DefaultHeaders::Instance() {
+  static DefaultHeaders headers;
+  return headers;
+}
+
+void AsyncWebServerRequest::send(int code, const String& contentType, const String& content) {
+  if (sent_) return;
+  sent_ = true;
+
+  String response = "HTTP/1.1 " + String(code) + " " + Reason(code) + "\r\n";
+  if (contentType.length()) response += "Content-Type: " + contentType + "\r\n";
+  response += "Content-Length: " + String(content.length()) + "\r\n";
+  response += DefaultHeaders::Instance().text();
+  response += "Connection: close\r\n\r\n";
+  response += content;
+  Send_All(fd_, response.c_str(), response.length());
+}
+
+/* WebSocket ------------------------------------------------------------------*/
+void AsyncWebSocketClient::text(const char* message) {
+  pthread_mutex_lock(&web_lock);
+  Send_Frame(fd_, WS_TEXT, message, strlen(message));
+  pthread_mutex_unlock(&web_lock);
+}
+
+void AsyncWebSocketClient::close() {
+  pthread_mutex_lock(&web_lock);
+  Send_Frame(fd_, WS_DISCONNECT, "", 0);
+  shutdown(fd_, SHUT_RDWR);  // the server thread sees the end and drops us
+  pthread_mutex_unlock(&web_lock);
+}
+
+void AsyncWebSocket::textAll(const char* message) {
+  size_t len = strlen(message);
+
+  pthread_mutex_lock(&web_lock);
+  for (AsyncWebSocketClient* client : clients_) {
+    Send_Frame(client->fd_, WS_TEXT, message, len);
+  }
+  pthread_mutex_unlock(&web_lock);
+}
+
+void AsyncWebSocket::binaryAll(const uint8_t* message, size_t len) {
+  pthread_mutex_lock(&web_lock);
+  for (AsyncWebSocketClient* client : clients_) {
+    Send_Frame(client->fd_, WS_BINARY, message, len);
+  }
+  pthread_mutex_unlock(&web_lock);
+}
+
+size_t AsyncWebSocket::count() const {
+  pthread_mutex_lock(&web_lock);
+  size_t n = clients_.size();
+  pthread_mutex_unlock(&web_lock);
+  return n;
+}
+
+/* Server ---------------------------------------------------------------------*/
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                        ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+  routes_.push_back(Route{ String(uri), method, onRequest, onBody });
+}
+
+AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler) {
+  AsyncWebSocket* socket = dynamic_cast<AsyncWebSocket*>(handler);
+  if (socket) sockets_.push_back(socket);
+  return *handler;
+}
+
+void AsyncWebServer::begin() {
+  struct sockaddr_in addr;
+  uint16_t port = host_port_ ? host_port_ : port_;
+  int one = 1;
+  pthread_t thread;
+
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd_, 8) != 0) {
+    fprintf(stderr, "[host] web server on port %u: %s\n", port, strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return;
+  }
+  printf("[host] web server listening on port %u\n", port);
+  pthread_create(&thread, nullptr, Thread, this);
+  pthread_detach(thread);
+}
+
+void* AsyncWebServer::Thread(void* server) {
+  ((AsyncWebServer*)server)->Serve();
+  return nullptr;
+}
+
+void AsyncWebServer::Serve() {
+  std::vector<struct pollfd> fds;
+  char buf[2048];
+
+  for (;;) {
+    fds.assign(1, { listen_fd_, POLLIN, 0 });
+    for (Connection* c : connections_) fds.push_back({ c->fd, POLLIN, 0 });
+    if (poll(fds.data(), fds.size(), 100) <= 0) continue;
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        connections_.push_back(new Connection{ fd, std::string() });
+      }
+    }
+
+    // connections_ only grows at the end, so fds[i + 1] is connections_[i]
+    for (size_t i = fds.size() - 1; i >= 1; i--) {
+      Connection* c = connections_[i - 1];
+      bool keep = true;
+
+      if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      ssize_t n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (n > 0) {
+        c->in.append(buf, (size_t)n);
+        keep = c->socket ? Handle_WebSocket(c) : Handle_Http(c);
+      } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        keep = false;
+      }
+      if (!keep) {
+        Drop(c);
+        connections_.erase(connections_.begin() + (i - 1));
+      }
+    }
+  }
+}
+
+void AsyncWebServer::Drop(Connection* c) {
+  if (c->client) {
+    AsyncWebSocket* socket = c->socket;
+    pthread_mutex_lock(&web_lock);
+    for (size_t i = 0; i < socket->clients_.size(); i++) {
+      if (socket->clients_[i] == c->client) socket->clients_.erase(socket->clients_.begin() + i);
+    }
+    pthread_mutex_unlock(&web_lock);
+    if (socket->handler_) socket->handler_(socket, c->client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    delete c->client;
+  }
+  close(c->fd);
+  delete c;
+}
+
+/* Header value from a request head, case-insensitive; empty if absent */
+static std::string Header(const std::string& head, const char* name) {
+  size_t n = strlen(name);
+  size_t at = 0;
+
+  while ((at = head.find("\r\n", at)) != std::string::npos) {
+    at += 2;
+    if (strncasecmp(head.c_str() + at, name, n) == 0 && head[at + n] == ':') {
+      size_t start = head.find_first_not_of(' ', at + n + 1);
+      size_t end = head.find("\r\n", at);
+      return (start == std::string::npos || start >= end) ? std::string() : head.substr(start, end - start);
+    }
+  }
+  return std::string();
+}
+
+/* Returns false once the connection should close */
+bool AsyncWebServer::Handle_Http(Connection* c) {
+  size_t head_end = c->in.find("\r\n\r\n");
+  if (head_end == std::string::npos) return c->in.size() < 8192;
+
+  std::string head = c->in.substr(0, head_end);
+  size_t length = strtoul(Header(head, "Content-Length").c_str(), nullptr, 10);
+  if (length > WEB_BODY_MAX) {
+    AsyncWebServerRequest request;
+    request.fd_ = c->fd;
+    request.send(413);
+    return false;
+  }
+  if (c->in.size() < head_end + 4 + length) return true;  // body still arriving
+
+  size_t sp1 = head.find(' ');
+  size_t sp2 = head.find(' ', sp1 + 1);
+  std::string method = head.substr(0, sp1);
+  std::string target = head.substr(sp1 + 1, sp2 - sp1 - 1);
+  std::string path = target.substr(0, target.find('?'));
+
+  // WebSocket upgrade
+  std::string key = Header(head, "Sec-WebSocket-Key");
+  if (!key.empty() && strcasecmp(Header(head, "Upgrade").c_str(), "websocket") == 0) {
+    for (AsyncWebSocket* socket : sockets_) {
+      if (path != socket->url_.c_str()) continue;
+      uint8_t digest[20];
+      Sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+      std::string reply = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: " + Base64(digest, sizeof(digest)) + "\r\n\r\n";
+      Send_All(c->fd, reply.data(), reply.size());
+      c->in.erase(0, head_end + 4);
+      c->socket = socket;
+      c->client = new AsyncWebSocketClient;
+      c->client->fd_ = c->fd;
+      pthread_mutex_lock(&web_lock);
+      c->client->id_ = socket->next_id_++;
+      socket->clients_.push_back(c->client);
+      pthread_mutex_unlock(&web_lock);
+      if (socket->handler_) socket->handler_(socket, c->client, WS_EVT_CONNECT, nullptr, nullptr, 0);
+      return c->in.empty() || Handle_WebSocket(c);
+    }
+  }
+
+  AsyncWebServerRequest request;
+  static const char* const names[] = { "GET", "POST", "DELETE", "PUT", "PATCH", "HEAD", "OPTIONS" };
+  for (int i = 0; i < 7; i++) {
+    if (method == names[i]) request.method_ = (WebRequestMethodComposite)(1 << i);
+  }
+  request.fd_ = c->fd;
+  request.url_ = String(path);
+  request.content_length_ = length;
+
+  const Route* route = nullptr;
+  for (const Route& r : routes_) {
+    if ((r.method & request.method_) && path == r.uri.c_str()) {
+      route = &r;
+      break;
+    }
+  }
+  if (route) {
+    if (length && route->on_body) {
+      route->on_body(&request, (uint8_t*)&c->in[head_end + 4], length, 0, length);
+    }
+    if (route->on_request) route->on_request(&request);
+  } else if (not_found_) {
+    not_found_(&request);
+  } else {
+    request.send(404);
+  }
+  if (!request.sent_) request.send(500);
+  return false;
+}
+
+/* Returns false once the connection should close */
+bool AsyncWebServer::Handle_WebSocket(Connection* c) {
+  AsyncWebSocket* socket = c->socket;
+
+  for (;;) {
+    const uint8_t* p = (const uint8_t*)c->in.data();
+    size_t have = c->in.size();
+    size_t at = 2;
+    uint64_t len;
+    AwsFrameInfo info;
+
+    if (have < 2) return true;
+    memset(&info, 0, sizeof(info));
+    info.final = (p[0] & 0x80) ? 1 : 0;
+    info.opcode = p[0] & 0x0F;
+    info.masked = (p[1] & 0x80) ? 1 : 0;
+    len = p[1] & 0x7F;
+    if (len == 126) {
+      if (have < 4) return true;
+      len = (uint64_t)p[2] << 8 | p[3];
+      at = 4;
+    } else if (len == 127) {
+      if (have < 10) return true;
+      len = 0;
+      for (int i = 0; i < 8; i++) len = len << 8 | p[2 + i];
+      at = 10;
+    }
+    if (len > WEB_FRAME_MAX) return false;
+    if (info.masked) {
+      if (have < at + 4) return true;
+      memcpy(info.mask, p + at, 4);
+      at += 4;
+    }
+    if (have < at + len) return true;
+
+    std::string payload = c->in.substr(at, (size_t)len);
+    c->in.erase(0, at + (size_t)len);
+    if (info.masked) {
+      for (size_t i = 0; i < payload.size(); i++) payload[i] ^= (char)info.mask[i % 4];
+    }
+    info.len = len;
+    info.message_opcode = info.opcode;
+
+    if (info.opcode == WS_DISCONNECT) {
+      pthread_mutex_lock(&web_lock);
+      Send_Frame(c->fd, WS_DISCONNECT, "", 0);
+      pthread_mutex_unlock(&web_lock);
+      return false;
+    }
+    if (info.opcode == WS_PING) {
+      pthread_mutex_lock(&web_lock);
+      Send_Frame(c->fd, WS_PONG, payload.data(), payload.size());
+      pthread_mutex_unlock(&web_lock);
+    } else if (socket->handler_) {
+      AwsEventType type = (info.opcode == WS_PONG) ? WS_EVT_PONG : WS_EVT_DATA;
+      socket->handler_(socket, c->client, type, &info, (uint8_t*)&payload[0], payload.size());
+    }
+  }
+}
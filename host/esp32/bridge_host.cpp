@@ -0,0 +1,34 @@
+/* bridge_host.cpp
+ * ESP32/esp32_dsp_bridge built for Linux against the shims in include/
+ *
+ * Usage: esp32_bridge <tty> [backend_url] [http_port]
+ *   <tty> is the STM32 link, normally the PTY of ../sim/fil_sim -p,
+ *   backend_url replaces the sketch's (e.g. http://127.0.0.1:3000, or ""
+ *   to run without a backend) and http_port moves the local control server
+ *   off port 80. The sketch is compiled unchanged: setup() once, then
+ *   loop() forever.
+ */
+
+#include "Arduino.h"
+#include "../../ESP32/esp32_dsp_bridge/esp32_dsp_bridge.ino"
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <tty> [backend_url] [http_port]\n", argv[0]);
+    return 2;
+  }
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  Serial2.setPath(argv[1]);
+  if (argc > 2) {
+    backend_url = argv[2];
+  }
+  if (argc > 3) {
+    AsyncWebServer::setHostPort((uint16_t)atoi(argv[3]));
+  }
+
+  setup();
+  for (;;) {
+    loop();
+    yield();
+  }
+}
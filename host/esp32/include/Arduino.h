@@ -0,0 +1,114 @@
+/* Arduino.h
+ * Host shim of the Arduino-ESP32 core, as much of it as the DSP bridge
+ * sketch uses: String, Serial (stdout), Serial2 (a tty, normally the
+ * simulator's PTY), millis/delay/yield.
+ */
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using std::abs;  // abs(float) as on the target, not the C int version
+
+typedef bool boolean;
+
+unsigned long millis(void);
+void delay(unsigned long ms);
+void yield(void);
+
+class String {
+ public:
+  String(const char* s = "") : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = 10);
+  String(unsigned int v, unsigned char base = 10);
+  String(long v, unsigned char base = 10);
+  String(unsigned long v, unsigned char base = 10);
+  String(float v, unsigned int decimals = 2) : String((double)v, decimals) {}
+  String(double v, unsigned int decimals = 2);
+
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+
+  bool equals(const String& o) const { return s_ == o.s_; }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator!=(const String& o) const { return s_ != o.s_; }
+  bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const { return Pos(s_.find(c, from)); }
+  int indexOf(const String& p, unsigned int from = 0) const { return Pos(s_.find(p.s_, from)); }
+  String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return (from < to && from < s_.size()) ? String(s_.substr(from, to - from)) : String();
+  }
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+  void trim();
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+
+ private:
+  static int Pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  std::string s_;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  size_t write(uint8_t c) { return write(&c, 1); }
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned int v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+  size_t println() { return print('\n'); }
+  template <typename T>
+  size_t println(const T& v) { return print(v) + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#define SERIAL_8N1 0x800001cU
+
+/* Serial: the console (stdout). Serial2: the STM32 link, opened on the
+ * tty set with Serial2_Set_Path() before setup() runs */
+class HardwareSerial : public Print {
+ public:
+  explicit HardwareSerial(int fd = -1) : fd_(fd) {}
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1, int8_t tx = -1);
+  void setPath(const char* path) { path_ = path; }
+  int available();
+  int read();
+  void flush();
+  using Print::write;
+  size_t write(const uint8_t* data, size_t len) override;
+
+ private:
+  int fd_;
+  const char* path_ = nullptr;
+  uint8_t rx_[256];
+  size_t rx_len_ = 0;
+  size_t rx_pos_ = 0;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+#endif  // ARDUINO_H
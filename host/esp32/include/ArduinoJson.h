@@ -0,0 +1,120 @@
+/* ArduinoJson.h
+ * Host shim of the ArduinoJson 6 subset the bridge uses: parse into a
+ * document, walk it with JsonObject/JsonVariant, read scalars with as<T>()
+ * or implicit conversion. Capacity is not enforced.
+ */
+#ifndef ARDUINOJSON_H
+#define ARDUINOJSON_H
+
+#include "Arduino.h"
+#include <deque>
+#include <utility>
+#include <vector>
+
+struct JsonNode {
+  enum Type { Null, Bool, Number, Text, Array, Object } type = Null;
+  bool boolean = false;
+  double number = 0.0;
+  std::string text;
+  std::vector<std::pair<std::string, JsonNode*>> members;  // arrays: empty keys
+};
+
+class JsonObject;
+
+class JsonVariant {
+ public:
+  JsonVariant(const JsonNode* node = nullptr) : node_(node) {}
+  bool isNull() const { return node_ == nullptr || node_->type == JsonNode::Null; }
+  bool containsKey(const char* key) const { return Find(key) != nullptr; }
+  JsonVariant operator[](const char* key) const { return JsonVariant(Find(key)); }
+  template <typename T>
+  T as() const;
+  template <typename T>
+  operator T() const { return as<T>(); }
+
+ protected:
+  const JsonNode* Find(const char* key) const;
+  const JsonNode* node_;
+};
+
+class JsonObject : public JsonVariant {
+ public:
+  JsonObject(const JsonNode* node = nullptr)
+      : JsonVariant((node && node->type == JsonNode::Object) ? node : nullptr) {}
+};
+
+template <>
+inline double JsonVariant::as<double>() const {
+  if (node_ == nullptr) return 0.0;
+  if (node_->type == JsonNode::Bool) return node_->boolean ? 1.0 : 0.0;
+  return node_->type == JsonNode::Number ? node_->number : 0.0;
+}
+template <>
+inline float JsonVariant::as<float>() const { return (float)as<double>(); }
+template <>
+inline int JsonVariant::as<int>() const { return (int)as<double>(); }
+template <>
+inline long JsonVariant::as<long>() const { return (long)as<double>(); }
+template <>
+inline unsigned long JsonVariant::as<unsigned long>() const { return (unsigned long)as<double>(); }
+template <>
+inline bool JsonVariant::as<bool>() const {
+  if (node_ == nullptr) return false;
+  return node_->type == JsonNode::Bool ? node_->boolean : as<double>() != 0.0;
+}
+template <>
+inline const char* JsonVariant::as<const char*>() const {
+  return (node_ && node_->type == JsonNode::Text) ? node_->text.c_str() : nullptr;
+}
+template <>
+inline String JsonVariant::as<String>() const {
+  const char* s = as<const char*>();
+  return String(s ? s : "null");
+}
+template <>
+inline JsonObject JsonVariant::as<JsonObject>() const { return JsonObject(node_); }
+
+class DeserializationError {
+ public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory };
+  DeserializationError(Code code = Ok) : code_(code) {}
+  explicit operator bool() const { return code_ != Ok; }
+  Code code() const { return code_; }
+  const char* c_str() const;
+
+ private:
+  Code code_;
+};
+
+class JsonDocument {
+ public:
+  bool containsKey(const char* key) const { return JsonVariant(root_).containsKey(key); }
+  JsonVariant operator[](const char* key) const { return JsonVariant(root_)[key]; }
+  template <typename T>
+  T as() const { return JsonVariant(root_).as<T>(); }
+  void clear() { nodes_.clear(); root_ = nullptr; }
+
+ private:
+  friend DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length);
+  JsonNode* NewNode() { nodes_.emplace_back(); return &nodes_.back(); }
+  std::deque<JsonNode> nodes_;
+  JsonNode* root_ = nullptr;
+};
+
+template <size_t Capacity>
+class StaticJsonDocument : public JsonDocument {};
+
+class DynamicJsonDocument : public JsonDocument {
+ public:
+  explicit DynamicJsonDocument(size_t capacity) {}
+};
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length);
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+  return deserializeJson(doc, input, strlen(input));
+}
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+  return deserializeJson(doc, input.c_str(), input.length());
+}
+
+#endif  // ARDUINOJSON_H
@@ -0,0 +1,163 @@
+/* ESPAsyncWebServer.h
+ * Host shim of the ESPAsyncWebServer subset the bridge uses: routes with
+ * a body callback, a not-found handler, default headers and one WebSocket
+ * endpoint with text messages (binary ones only outgoing).
+ *
+ * As on the ESP32, callbacks run on a thread of their own (async_tcp
+ * there), not in loop(). Requests are answered with Connection: close;
+ * bodies arrive in one piece; WebSocket messages must fit in one frame.
+ */
+#ifndef ESPASYNCWEBSERVER_H
+#define ESPASYNCWEBSERVER_H
+
+#include "Arduino.h"
+#include <functional>
+#include <vector>
+
+typedef enum {
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_DELETE = 0b00000100,
+  HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000,
+  HTTP_HEAD = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY = 0b01111111
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServer;
+
+class AsyncWebServerRequest {
+ public:
+  ~AsyncWebServerRequest() { free(_tempObject); }
+  WebRequestMethodComposite method() const { return method_; }
+  const String& url() const { return url_; }
+  size_t contentLength() const { return content_length_; }
+  void send(int code, const String& contentType = String(), const String& content = String());
+
+  void* _tempObject = nullptr;  // the sketch's, free()d with the request
+
+ private:
+  friend class AsyncWebServer;
+  int fd_ = -1;
+  bool sent_ = false;
+  WebRequestMethodComposite method_ = 0;
+  String url_;
+  size_t content_length_ = 0;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool)>
+    ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+
+class AsyncWebHandler {
+ public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class DefaultHeaders {
+ public:
+  static DefaultHeaders& Instance();
+  void addHeader(const String& name, const String& value) { headers_ += name + ": " + value + "\r\n"; }
+  const String& text() const { return headers_; }
+
+ private:
+  String headers_;
+};
+
+#define WS_CONTINUATION 0x00
+#define WS_TEXT 0x01
+#define WS_BINARY 0x02
+#define WS_DISCONNECT 0x08
+#define WS_PING 0x09
+#define WS_PONG 0x0A
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+
+typedef struct {
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+ public:
+  uint32_t id() const { return id_; }
+  void text(const String& message) { text(message.c_str()); }
+  void text(const char* message);
+  void close();
+
+ private:
+  friend class AsyncWebSocket;
+  friend class AsyncWebServer;
+  int fd_ = -1;
+  uint32_t id_ = 0;
+};
+
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*, size_t)>
+    AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+ public:
+  explicit AsyncWebSocket(const String& url) : url_(url) {}
+  void onEvent(AwsEventHandler handler) { handler_ = handler; }
+  void textAll(const String& message) { textAll(message.c_str()); }
+  void textAll(const char* message);
+  void binaryAll(const uint8_t* message, size_t len);
+  size_t count() const;
+  void cleanupClients(uint16_t maxClients = 8) {}
+
+ private:
+  friend class AsyncWebServer;
+  String url_;
+  AwsEventHandler handler_;
+  std::vector<AsyncWebSocketClient*> clients_;
+  uint32_t next_id_ = 1;
+};
+
+class AsyncWebServer {
+ public:
+  explicit AsyncWebServer(uint16_t port) : port_(port) {}
+  void begin();
+  void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+          ArUploadHandlerFunction onUpload = nullptr, ArBodyHandlerFunction onBody = nullptr);
+  void onNotFound(ArRequestHandlerFunction handler) { not_found_ = handler; }
+  AsyncWebHandler& addHandler(AsyncWebHandler* handler);
+
+  // Host only: listen here instead of the sketch's port (80 needs root)
+  static void setHostPort(uint16_t port) { host_port_ = port; }
+
+ private:
+  struct Route {
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction on_request;
+    ArBodyHandlerFunction on_body;
+  };
+  struct Connection;
+
+  static void* Thread(void* server);
+  void Serve();
+  bool Handle_Http(Connection* c);
+  bool Handle_WebSocket(Connection* c);
+  void Drop(Connection* c);
+
+  uint16_t port_;
+  static uint16_t host_port_;
+  int listen_fd_ = -1;
+  std::vector<Route> routes_;
+  ArRequestHandlerFunction not_found_;
+  std::vector<AsyncWebSocket*> sockets_;
+  std::vector<Connection*> connections_;
+};
+
+#endif  // ESPASYNCWEBSERVER_H
@@ -0,0 +1,20 @@
+/* ESPmDNS.h
+ * Host shim: nothing is advertised, the calls are only logged (on Linux
+ * reach the bridge by address and port)
+ */
+#ifndef ESPMDNS_H
+#define ESPMDNS_H
+
+#include "Arduino.h"
+
+class MDNSResponder {
+ public:
+  bool begin(const char* hostname);
+  void end() {}
+  bool addService(const char* service, const char* proto, uint16_t port);
+  bool addServiceTxt(const char* service, const char* proto, const char* key, const char* value) { return true; }
+};
+
+extern MDNSResponder MDNS;
+
+#endif  // ESPMDNS_H
@@ -0,0 +1,40 @@
+/* HTTPClient.h
+ * Host shim of the ESP32 HTTPClient over a plain socket: one request per
+ * connection (Connection: close), plain http:// only
+ */
+#ifndef HTTPCLIENT_H
+#define HTTPCLIENT_H
+
+#include "Arduino.h"
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NOT_MODIFIED 304
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient {
+ public:
+  bool begin(const String& url);
+  void setTimeout(uint16_t timeout_ms) { timeout_ms_ = timeout_ms; }
+  void addHeader(const String& name, const String& value);
+  int GET() { return sendRequest("GET", String()); }
+  int POST(const String& body) { return sendRequest("POST", body); }
+  int sendRequest(const char* method, const String& body);
+  String getString() { return body_; }
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {}  // all are kept
+  String header(const char* name);
+  void end() {}
+
+ private:
+  String host_;
+  String path_;
+  uint16_t port_ = 80;
+  uint16_t timeout_ms_ = 5000;
+  String headers_;
+  String response_headers_;
+  String body_;
+};
+
+#endif  // HTTPCLIENT_H
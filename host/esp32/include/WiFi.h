@@ -0,0 +1,50 @@
+/* WiFi.h
+ * Host shim: the host network is always up; WiFiClient is a plain TCP
+ * socket whose reads never block
+ */
+#ifndef WIFI_H
+#define WIFI_H
+
+#include "Arduino.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+ public:
+  void begin(const char* ssid, const char* password) {}
+  void disconnect() {}
+  wl_status_t status() { return WL_CONNECTED; }
+  String localIP() { return String("127.0.0.1"); }
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Print {
+ public:
+  WiFiClient() {}
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+  ~WiFiClient() { stop(); }
+
+  int connect(const char* host, uint16_t port, int32_t timeout_ms = 3000);
+  // As on the ESP32: still "connected" while received bytes are unread
+  uint8_t connected() { return fd_ >= 0 && (!eof_ || available() > 0); }
+  int available();
+  int read() { return available() ? rx_[rx_pos_++] : -1; }
+  using Print::write;
+  size_t write(const uint8_t* data, size_t len) override;
+  void stop();
+
+ private:
+  int fd_ = -1;
+  bool eof_ = false;
+  uint8_t rx_[512];
+  size_t rx_len_ = 0;
+  size_t rx_pos_ = 0;
+};
+
+#endif  // WIFI_H
@@ -0,0 +1,442 @@
+/* golden_check.c
+ * Golden-output regression check for the effect chain (effects.c)
+ *
+ * Usage: golden_check [-g golden.txt] [-u] [-o dir] [-i di.raw]
+ *   Renders the reference signals through every backend preset with the
+ *   firmware gate -> overdrive -> delay -> volume chain, as the timer
+ *   interrupt runs it, and compares each GOLDEN_WINDOW of output against
+ *   the stored envelope: RMS level and brightness (RMS of the first
+ *   difference relative to the RMS), both in dB, within the preset's
+ *   tolerance. A window down at GOLDEN_FLOOR_DB checks nothing and fails
+ *   as well. Exit status 1 if any window is out.
+ *   -u  rewrite the golden file from this build instead of comparing
+ *   -o  also write every render as 16-bit raw (dir/<preset>_<signal>.raw)
+ *   -i  add a recorded DI take (16-bit mono raw at SAMPLE_RATE) to the
+ *       signals; it is rendered and written with -o but has no golden data
+ *       (no take is in the tree: "pluck" stands in for one)
+ *
+ * The envelope rather than the samples is stored so that a block,
+ * fixed-point or table rewrite of a stage can pass: it has to sound the
+ * same, not round the same.
+ */
+
+#include "main.h"
+#include "effects.h"
+#include "delay_mem.h"
+#include "telemetry.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Firmware globals referenced by effects.c and delay_mem.c
+float32_t sample_rate_hz = (float32_t)SAMPLE_RATE;
+int16_t delay_buffer[DELAY_BUFFER_SIZE];
+uint32_t delay_write_index = 0;
+MeterBlock_t meter_block;
+
+uint32_t CRC32_Calculate(const void *data, uint32_t length)
+{
+  (void)data;
+  (void)length;
+  return 0;
+}
+
+#define GOLDEN_WINDOW 512
+#define GOLDEN_FLOOR_DB -90.0f
+#define GOLDEN_MAX_SAMPLES (2 * SAMPLE_RATE)
+#define GOLDEN_MAX_LINES 4096
+
+/* Backend presets (backend/server.js), as the ESP32 sends them: delay time
+ * in ms at SAMPLE_RATE, clamped to DELAY_BUFFER_SIZE. tol_db is the allowed
+ * drift per window; high gain magnifies small changes before the clipper. */
+typedef struct {
+  const char *name;
+  float volume;
+  uint8_t od_enabled; float od_gain, od_threshold, od_tone, od_mix; uint8_t od_mode;
+  uint8_t dly_enabled; float dly_ms, dly_feedback, dly_mix, dly_tone;
+  uint8_t gate_enabled; float gate_threshold, gate_attack, gate_release;
+  float tol_db;
+} GoldenPreset_t;
+
+static const GoldenPreset_t presets[] = {
+  { "clean",   0.70f, 0,  1.0f, 0.80f, 0.70f, 0.20f, 0, 0, 100.0f, 0.30f, 0.25f, 0.6f, 1, 0.015f, 0.0010f, 0.15f, 0.25f },
+  { "crunch",  0.60f, 1,  8.0f, 0.70f, 0.55f, 0.65f, 2, 0,  75.0f, 0.25f, 0.30f, 0.5f, 1, 0.020f, 0.0010f, 0.10f, 0.5f },
+  { "lead",    0.55f, 1, 15.0f, 0.60f, 0.65f, 0.80f, 0, 1, 120.0f, 0.35f, 0.35f, 0.4f, 1, 0.012f, 0.0010f, 0.20f, 0.75f },
+  { "ambient", 0.65f, 1,  4.0f, 0.85f, 0.80f, 0.40f, 0, 1, 250.0f, 0.60f, 0.55f, 0.7f, 0, 0.010f, 0.0010f, 0.50f, 0.5f },
+  { "metal",   0.50f, 1, 20.0f, 0.40f, 0.30f, 0.90f, 1, 0,  50.0f, 0.20f, 0.25f, 0.3f, 1, 0.025f, 0.0005f, 0.05f, 1.0f },
+};
+#define PRESET_COUNT (sizeof(presets) / sizeof(presets[0]))
+
+typedef struct {
+  const char *name;
+  float *samples;
+  uint32_t length;
+  uint8_t golden;        // compared against the golden file
+  uint8_t gate;          // through the noise gate (else straight to the overdrive)
+} GoldenSignal_t;
+
+typedef struct {
+  char preset[16];
+  char signal[16];
+  uint32_t window;
+  float rms_db;
+  float bright_db;
+} GoldenLine_t;
+
+static GoldenLine_t golden[GOLDEN_MAX_LINES];
+static uint32_t golden_count = 0;
+
+static float Quantize_ADC(float x)
+{
+  // Same 12-bit grid the ADC delivers
+  float code = floorf(x * 2048.0f + 2048.0f + 0.5f);
+  if (code > 4095.0f) code = 4095.0f;
+  if (code < 0.0f) code = 0.0f;
+  return (code - 2048.0f) / 2048.0f;
+}
+
+static uint32_t Make_Impulse(float *out)
+{
+  // One impulse a window, so every window holds a response; rendered
+  // without the gate, which would swallow a single sample
+  uint32_t n = SAMPLE_RATE / 2;
+  memset(out, 0, n * sizeof(float));
+  for (uint32_t i = GOLDEN_WINDOW / 4; i < n; i += GOLDEN_WINDOW) out[i] = 0.5f;
+  return n;
+}
+
+static uint32_t Make_Sweep(float *out)
+{
+  // Exponential sine sweep, 40 Hz to 12 kHz in one second
+  const double f0 = 40.0, f1 = 12000.0, t1 = 1.0;
+  const double k = log(f1 / f0);
+  uint32_t n = (uint32_t)(t1 * SAMPLE_RATE);
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    double t = (double)i / SAMPLE_RATE;
+    double phase = 2.0 * M_PI * f0 * t1 / k * (exp(t / t1 * k) - 1.0);
+    out[i] = Quantize_ADC((float)(0.3 * sin(phase)));
+  }
+  return n;
+}
+
+static uint32_t Make_Pluck(float *out)
+{
+  /* Stand-in for a DI take: Karplus-Strong E2 and B2 plucks, a palm-muted
+   * chug and a held A3, with DI-like levels (peaks near -10 dBFS) */
+  static const struct { float start_s, freq, amp, decay; } notes[] = {
+    { 0.00f,  82.41f, 0.30f, 0.996f },
+    { 0.05f, 123.47f, 0.20f, 0.996f },
+    { 0.60f,  82.41f, 0.25f, 0.960f },
+    { 0.75f,  82.41f, 0.25f, 0.960f },
+    { 0.90f, 220.00f, 0.25f, 0.998f },
+  };
+  uint32_t n = (uint32_t)(1.5f * SAMPLE_RATE);
+  static float line[1024];
+  uint32_t seed = 12345;
+
+  memset(out, 0, n * sizeof(float));
+  for (uint32_t k = 0; k < sizeof(notes) / sizeof(notes[0]); k++)
+  {
+    uint32_t period = (uint32_t)(SAMPLE_RATE / notes[k].freq + 0.5f);
+    uint32_t start = (uint32_t)(notes[k].start_s * SAMPLE_RATE);
+
+    for (uint32_t i = 0; i < period; i++)
+    {
+      seed = seed * 1664525U + 1013904223U;
+      line[i] = notes[k].amp * ((float)(seed >> 8) / 8388608.0f - 1.0f);
+    }
+    for (uint32_t i = start, p = 0; i < n; i++)
+    {
+      uint32_t q = (p + 1 < period) ? p + 1 : 0;
+      out[i] += line[p];
+      line[p] = notes[k].decay * 0.5f * (line[p] + line[q]);
+      p = q;
+    }
+  }
+  for (uint32_t i = 0; i < n; i++) out[i] = Quantize_ADC(out[i]);
+  return n;
+}
+
+static uint32_t Load_Raw(const char *path, float *out)
+{
+  FILE *f = fopen(path, "rb");
+  int16_t s;
+  uint32_t n = 0;
+
+  if (!f)
+  {
+    perror(path);
+    exit(2);
+  }
+  while (n < GOLDEN_MAX_SAMPLES && fread(&s, sizeof(s), 1, f) == 1)
+  {
+    out[n++] = Quantize_ADC((float)s / 32768.0f);
+  }
+  fclose(f);
+  return n;
+}
+
+/**
+  * Load a preset through the same validate / queue / apply path a SETALL
+  * takes, and clear every piece of filter and line state
+  */
+static void Load_Preset(const GoldenPreset_t *p)
+{
+  EffectParams_t params;
+  uint32_t samples = (uint32_t)(p->dly_ms * SAMPLE_RATE / 1000.0f + 0.5f);
+
+  if (samples > DELAY_BUFFER_SIZE) samples = DELAY_BUFFER_SIZE;
+  if (samples == 0) samples = 1;
+
+  params.volume = p->volume;
+  params.od_gain = p->od_gain;
+  params.od_threshold = p->od_threshold;
+  params.od_tone = p->od_tone;
+  params.od_mix = p->od_mix;
+  params.dly_feedback = p->dly_feedback;
+  params.dly_mix = p->dly_mix;
+  params.dly_tone = p->dly_tone;
+  params.gate_threshold = p->gate_threshold;
+  params.gate_attack = p->gate_attack;
+  params.gate_release = p->gate_release;
+  params.dly_samples = samples;
+  params.od_mode = p->od_mode;
+  params.od_enabled = p->od_enabled;
+  params.dly_enabled = p->dly_enabled;
+  params.gate_enabled = p->gate_enabled;
+
+  if (!Effects_Validate_Params(&params))
+  {
+    fprintf(stderr, "preset %s rejected by Effects_Validate_Params\n", p->name);
+    exit(2);
+  }
+  Effects_Queue_Params(&params);
+  Effects_Apply_Pending();
+
+  memset(delay_buffer, 0, sizeof(delay_buffer));
+  DelayMem_Init();
+  delay_write_index = 0;
+  overdrive.hp_state = 0.0f;
+  overdrive.lp_state = 0.0f;
+  delay_effect.lp_state = 0.0f;
+  noise_gate.envelope = 0.0f;
+}
+
+static void Render(const float *in, float *out, uint32_t n, uint8_t gate)
+{
+  for (uint32_t i = 0; i < n; i++)
+  {
+    float32_t x = gate ? Apply_NoiseGate(in[i]) : in[i];
+    x = Apply_Overdrive(x);
+    x = Apply_Delay(x);
+    x *= output_volume;
+    if (x > 1.0f) x = 1.0f;
+    if (x < -1.0f) x = -1.0f;
+    out[i] = x;
+  }
+}
+
+static float To_dB(double power)
+{
+  float db = (float)(10.0 * log10(power + 1e-30));
+  return (db < GOLDEN_FLOOR_DB) ? GOLDEN_FLOOR_DB : db;
+}
+
+static void Window_Stats(const float *x, uint32_t start, float *rms_db, float *bright_db)
+{
+  double sumsq = 0.0, diffsq = 0.0;
+  float prev = start ? x[start - 1] : 0.0f;
+
+  for (uint32_t i = start; i < start + GOLDEN_WINDOW; i++)
+  {
+    sumsq += (double)x[i] * x[i];
+    diffsq += (double)(x[i] - prev) * (x[i] - prev);
+    prev = x[i];
+  }
+  *rms_db = To_dB(sumsq / GOLDEN_WINDOW);
+  // Silent windows have no meaningful brightness
+  *bright_db = (*rms_db > GOLDEN_FLOOR_DB) ? To_dB(diffsq / (sumsq + 1e-30)) : 0.0f;
+}
+
+static void Load_Golden(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  char line[128];
+
+  if (!f)
+  {
+    perror(path);
+    exit(2);
+  }
+  while (fgets(line, sizeof(line), f))
+  {
+    GoldenLine_t *g = &golden[golden_count];
+    if (line[0] == '#') continue;
+    if (golden_count >= GOLDEN_MAX_LINES) break;
+    if (sscanf(line, "%15s %15s %u %f %f", g->preset, g->signal, &g->window,
+               &g->rms_db, &g->bright_db) == 5)
+    {
+      golden_count++;
+    }
+  }
+  fclose(f);
+}
+
+static const GoldenLine_t *Find_Golden(const char *preset, const char *signal, uint32_t window)
+{
+  for (uint32_t i = 0; i < golden_count; i++)
+  {
+    if (golden[i].window == window && strcmp(golden[i].preset, preset) == 0 &&
+        strcmp(golden[i].signal, signal) == 0)
+    {
+      return &golden[i];
+    }
+  }
+  return NULL;
+}
+
+static void Write_Raw(const char *dir, const char *preset, const char *signal,
+                      const float *x, uint32_t n)
+{
+  char path[256];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s_%s.raw", dir, preset, signal);
+  f = fopen(path, "wb");
+  if (!f)
+  {
+    perror(path);
+    exit(2);
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    int16_t s = (int16_t)lrintf(x[i] * 32767.0f);
+    fwrite(&s, sizeof(s), 1, f);
+  }
+  fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+  const char *golden_path = "golden/presets.txt";
+  const char *raw_dir = NULL;
+  const char *di_path = NULL;
+  uint8_t update = 0;
+  static float inputs[4][GOLDEN_MAX_SAMPLES];
+  static float out[GOLDEN_MAX_SAMPLES];
+  GoldenSignal_t signals[4];
+  uint32_t signal_count = 0;
+  uint32_t failed_total = 0;
+  FILE *fg = NULL;
+
+  for (int a = 1; a < argc; a++)
+  {
+    if (strcmp(argv[a], "-u") == 0) update = 1;
+    else if (strcmp(argv[a], "-g") == 0 && a + 1 < argc) golden_path = argv[++a];
+    else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) raw_dir = argv[++a];
+    else if (strcmp(argv[a], "-i") == 0 && a + 1 < argc) di_path = argv[++a];
+    else
+    {
+      fprintf(stderr, "usage: %s [-g golden.txt] [-u] [-o dir] [-i di.raw]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  __set_FPSCR(__get_FPSCR() | FPU_FPDSCR_FZ_Msk);  // as DSP_Flush_To_Zero_Init on the target
+
+  signals[signal_count++] = (GoldenSignal_t){ "impulse", inputs[0], Make_Impulse(inputs[0]), 1, 0 };
+  signals[signal_count++] = (GoldenSignal_t){ "sweep", inputs[1], Make_Sweep(inputs[1]), 1, 1 };
+  signals[signal_count++] = (GoldenSignal_t){ "pluck", inputs[2], Make_Pluck(inputs[2]), 1, 1 };
+  if (di_path) signals[signal_count++] = (GoldenSignal_t){ "di", inputs[3], Load_Raw(di_path, inputs[3]), 0, 1 };
+
+  if (update)
+  {
+    fg = fopen(golden_path, "w");
+    if (!fg)
+    {
+      perror(golden_path);
+      return 2;
+    }
+    fprintf(fg, "# golden_check -u: preset signal window rms_db bright_db\n");
+    fprintf(fg, "# SAMPLE_RATE %d, window %d samples\n", SAMPLE_RATE, GOLDEN_WINDOW);
+  }
+  else
+  {
+    Load_Golden(golden_path);
+  }
+
+  printf("%-8s %-8s %8s %8s %s\n", "preset", "signal", "max_dB", "tol_dB", "result");
+  for (uint32_t p = 0; p < PRESET_COUNT; p++)
+  {
+    for (uint32_t s = 0; s < signal_count; s++)
+    {
+      const GoldenSignal_t *sig = &signals[s];
+      uint32_t windows = sig->length / GOLDEN_WINDOW;
+      uint32_t failed = 0, missing = 0, silent = 0;
+      float worst = 0.0f;
+
+      Load_Preset(&presets[p]);
+      Render(sig->samples, out, sig->length, sig->gate);
+      if (raw_dir) Write_Raw(raw_dir, presets[p].name, sig->name, out, sig->length);
+      if (!sig->golden) continue;
+
+      for (uint32_t w = 0; w < windows; w++)
+      {
+        float rms_db, bright_db;
+        const GoldenLine_t *g;
+
+        Window_Stats(out, w * GOLDEN_WINDOW, &rms_db, &bright_db);
+        if (rms_db <= GOLDEN_FLOOR_DB) silent++;
+        if (fg)
+        {
+          fprintf(fg, "%s %s %u %.2f %.2f\n", presets[p].name, sig->name, w, rms_db, bright_db);
+          continue;
+        }
+        g = Find_Golden(presets[p].name, sig->name, w);
+        if (!g)
+        {
+          missing++;
+          continue;
+        }
+        float d_rms = fabsf(rms_db - g->rms_db);
+        float d_bright = fabsf(bright_db - g->bright_db);
+        float d = (d_rms > d_bright) ? d_rms : d_bright;
+        if (d > worst) worst = d;
+        if (d > presets[p].tol_db)
+        {
+          if (failed == 0)
+          {
+            printf("  %s/%s window %u: rms %.2f (golden %.2f), bright %.2f (golden %.2f)\n",
+                   presets[p].name, sig->name, w, rms_db, g->rms_db, bright_db, g->bright_db);
+          }
+          failed++;
+        }
+      }
+
+      failed_total += silent;
+      if (fg)
+      {
+        if (silent) printf("%s/%s: %u of %u windows at the floor\n", presets[p].name, sig->name, silent, windows);
+        continue;
+      }
+      failed_total += failed + missing;
+      printf("%-8s %-8s %8.2f %8.2f %s", presets[p].name, sig->name, worst, presets[p].tol_db,
+             (failed + missing + silent) ? "FAIL" : "ok");
+      if (failed) printf(" (%u of %u windows)", failed, windows);
+      if (missing) printf(" (%u windows missing from golden)", missing);
+      if (silent) printf(" (%u of %u windows at the floor)", silent, windows);
+      printf("\n");
+    }
+  }
+
+  if (fg)
+  {
+    fclose(fg);
+    printf("golden data written to %s\n", golden_path);
+    return failed_total ? 1 : 0;
+  }
+  return failed_total ? 1 : 0;
+}
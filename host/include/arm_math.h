@@ -0,0 +1,45 @@
+/* arm_math.h (host shim)
+ * CMSIS-DSP types and the subset of functions the firmware calls,
+ * implemented in cmsis_shim.c with the same data layouts
+ */
+#ifndef ARM_MATH_H
+#define ARM_MATH_H
+
+#include <stdint.h>
+
+typedef float float32_t;
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+typedef enum {
+  ARM_MATH_SUCCESS = 0,
+  ARM_MATH_ARGUMENT_ERROR = -1
+} arm_status;
+
+typedef struct {
+  uint16_t fftLenRFFT;
+} arm_rfft_fast_instance_f32;
+
+typedef struct {
+  uint8_t numStages;
+  float32_t *pState;
+  const float32_t *pCoeffs;
+} arm_biquad_cascade_df2T_instance_f32;
+
+#ifndef PI
+#define PI 3.14159265358979f
+#endif
+
+void arm_biquad_cascade_df2T_init_f32(arm_biquad_cascade_df2T_instance_f32 *S, uint8_t numStages,
+                                      const float32_t *pCoeffs, float32_t *pState);
+void arm_biquad_cascade_df2T_f32(const arm_biquad_cascade_df2T_instance_f32 *S, const float32_t *pSrc,
+                                 float32_t *pDst, uint32_t blockSize);
+
+void arm_abs_q15(const q15_t *pSrc, q15_t *pDst, uint32_t blockSize);
+void arm_max_q15(const q15_t *pSrc, uint32_t blockSize, q15_t *pResult, uint32_t *pIndex);
+void arm_rms_q15(const q15_t *pSrc, uint32_t blockSize, q15_t *pResult);
+
+arm_status arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32 *S, uint16_t fftLen);
+void arm_rfft_fast_f32(arm_rfft_fast_instance_f32 *S, float32_t *p, float32_t *pOut, uint8_t ifftFlag);
+
+#endif // ARM_MATH_H
@@ -0,0 +1,60 @@
+/* host_fpu.h
+ * FPSCR.FZ for host builds: flush-to-zero and denormals-are-zero in MXCSR
+ * on x86, FZ in FPCR on AArch64
+ *
+ * A filter state decaying through silence spends thousands of samples as
+ * a denormal; on x86 every operation on one takes a microcode assist of
+ * ~100 cycles. The Cortex-M4 FPU runs them at full speed, so FZ there is
+ * about matching the host, not about speed.
+ */
+#ifndef HOST_FPU_H
+#define HOST_FPU_H
+
+#include <stdint.h>
+
+/* Same bit in FPSCR and FPDSCR on the Cortex-M4 (CMSIS name) */
+#ifndef FPU_FPDSCR_FZ_Msk
+#define FPU_FPDSCR_FZ_Msk (1UL << 24)
+#endif
+
+#if defined(__x86_64__) || defined(__SSE__)
+#include <xmmintrin.h>
+
+#define HOST_MXCSR_FTZ_DAZ 0x8040U
+
+static inline uint32_t Host_Get_FZ(void)
+{
+  return (_mm_getcsr() & HOST_MXCSR_FTZ_DAZ) ? FPU_FPDSCR_FZ_Msk : 0U;
+}
+
+static inline void Host_Set_FZ(uint32_t fpscr)
+{
+  uint32_t csr = _mm_getcsr();
+  _mm_setcsr((fpscr & FPU_FPDSCR_FZ_Msk) ? (csr | HOST_MXCSR_FTZ_DAZ) : (csr & ~HOST_MXCSR_FTZ_DAZ));
+}
+
+#elif defined(__aarch64__)
+
+static inline uint32_t Host_Get_FZ(void)
+{
+  uint64_t fpcr;
+  __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+  return (uint32_t)fpcr & FPU_FPDSCR_FZ_Msk;  // FZ is bit 24 here too
+}
+
+static inline void Host_Set_FZ(uint32_t fpscr)
+{
+  uint64_t fpcr;
+  __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+  fpcr = (fpcr & ~(uint64_t)FPU_FPDSCR_FZ_Msk) | (fpscr & FPU_FPDSCR_FZ_Msk);
+  __asm__ volatile("msr fpcr, %0" : : "r"(fpcr));
+}
+
+#else
+
+static inline uint32_t Host_Get_FZ(void) { return 0; }
+static inline void Host_Set_FZ(uint32_t fpscr) { (void)fpscr; }
+
+#endif
+
+#endif // HOST_FPU_H
@@ -0,0 +1,22 @@
+/* stm32g4xx_hal.h (host shim)
+ * Just enough of the HAL for DSP modules to compile on a desktop
+ */
+#ifndef STM32G4XX_HAL_H
+#define STM32G4XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "host_fpu.h"
+
+/* Interrupt masking is a no-op: host tools are single threaded */
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) { }
+static inline void __enable_irq(void) { }
+static inline void __DMB(void) { }
+
+/* Only FZ is modelled, on the host FPU (host_fpu.h) */
+static inline uint32_t __get_FPSCR(void) { return Host_Get_FZ(); }
+static inline void __set_FPSCR(uint32_t fpscr) { Host_Set_FZ(fpscr); }
+
+#endif // STM32G4XX_HAL_H
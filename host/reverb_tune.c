@@ -0,0 +1,128 @@
+/* reverb_tune.c
+ * Host build of the reverb block engine for tuning by ear and by numbers
+ *
+ * Usage: reverb_tune [-s size] [-d damp] [-m mix] [-i in.raw] [-o out.raw] [-n seconds]
+ *   in/out are mono 16-bit little-endian raw at SAMPLE_RATE. Without -i an
+ *   impulse is rendered; the tool prints the line lengths, the RT60 estimate
+ *   from the impulse decay and the host cost per sample.
+ */
+
+#include "main.h"
+#include "reverb.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Firmware globals referenced by reverb.c
+volatile uint16_t buffer_index = 0;
+float32_t sample_rate_hz = (float32_t)SAMPLE_RATE;
+
+#define BLOCK (BUFFER_SIZE / 2)
+
+static double Now_Seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+  float size = reverb.room_size;
+  float damp = reverb.damping;
+  float mix = reverb.mix;
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  float seconds = 3.0f;
+  FILE *fin = NULL;
+  FILE *fout = NULL;
+  int16_t in[BLOCK];
+  int16_t wet[BLOCK];
+  uint32_t total = 0;
+  uint32_t last_loud = 0;
+  double peak_energy = 0.0;
+  double elapsed = 0.0;
+
+  for (int a = 1; a + 1 < argc; a += 2)
+  {
+    if (strcmp(argv[a], "-s") == 0) size = (float)atof(argv[a + 1]);
+    else if (strcmp(argv[a], "-d") == 0) damp = (float)atof(argv[a + 1]);
+    else if (strcmp(argv[a], "-m") == 0) mix = (float)atof(argv[a + 1]);
+    else if (strcmp(argv[a], "-i") == 0) in_path = argv[a + 1];
+    else if (strcmp(argv[a], "-o") == 0) out_path = argv[a + 1];
+    else if (strcmp(argv[a], "-n") == 0) seconds = (float)atof(argv[a + 1]);
+  }
+
+  __set_FPSCR(__get_FPSCR() | FPU_FPDSCR_FZ_Msk);  // as DSP_Flush_To_Zero_Init on the target
+  Reverb_Init();
+  Reverb_Set_Params(size, damp, mix);
+  reverb.enabled = 1;
+
+  printf("budget %d bytes, used %lu bytes\n", REVERB_RAM_BYTES, (unsigned long)Reverb_Memory_Used());
+  for (int k = 0; k < REVERB_COMBS; k++) printf("comb[%d] %u\n", k, reverb.comb[k].length);
+  for (int k = 0; k < REVERB_ALLPASSES; k++) printf("allpass[%d] %u\n", k, reverb.allpass[k].length);
+
+  if (in_path && (fin = fopen(in_path, "rb")) == NULL)
+  {
+    perror(in_path);
+    return 1;
+  }
+  if (out_path && (fout = fopen(out_path, "wb")) == NULL)
+  {
+    perror(out_path);
+    return 1;
+  }
+
+  uint32_t limit = (uint32_t)(seconds * SAMPLE_RATE);
+  while (total < limit)
+  {
+    size_t n = BLOCK;
+    if (fin)
+    {
+      n = fread(in, sizeof(int16_t), BLOCK, fin);
+      if (n == 0) break;
+    }
+    else
+    {
+      memset(in, 0, sizeof(in));
+      if (total == 0) in[0] = 32767;
+    }
+
+    double t0 = Now_Seconds();
+    Reverb_Process_Block(in, wet, (uint16_t)n);
+    elapsed += Now_Seconds() - t0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+      double e = (double)wet[i] * wet[i];
+      if (e > peak_energy) peak_energy = e;
+      // -60 dB relative to the loudest wet sample so far
+      if (e > peak_energy * 1e-6) last_loud = total + (uint32_t)i;
+
+      if (fout)
+      {
+        float y = (float)in[i] * (1.0f - mix) + (float)wet[i] * mix;
+        if (y > 32767.0f) y = 32767.0f;
+        if (y < -32768.0f) y = -32768.0f;
+        int16_t s = (int16_t)y;
+        fwrite(&s, sizeof(s), 1, fout);
+      }
+    }
+    total += (uint32_t)n;
+  }
+
+  if (fin) fclose(fin);
+  if (fout) fclose(fout);
+
+  if (!in_path)
+  {
+    printf("rt60 ~ %.2f s\n", (double)last_loud / SAMPLE_RATE);
+  }
+  if (total > 0)
+  {
+    printf("host cost %.1f ns/sample over %lu samples\n", elapsed * 1e9 / total, (unsigned long)total);
+  }
+  return 0;
+}
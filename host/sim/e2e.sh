@@ -0,0 +1,89 @@
+#!/bin/sh
+# End-to-end control path on one Linux box:
+#   curl (standing in for the app) -> backend/server.js -> esp32_bridge
+#   (the ESP32 sketch on Arduino shims) -> PTY -> fil_sim (the firmware)
+# Posts a volume sweep and prints, per value, the wall time from the POST
+# to the STM32's ACK line; then a second sweep straight to the bridge's own
+# server (the app without the backend); then a chain over the cost model's
+# budget, which the backend must refuse; then the simulator's report.
+#   PORT=3300 LOCAL_PORT=3380 STEPS="0.31 0.42" sh sim/e2e.sh   (from host/)
+
+PORT=${PORT:-3300}
+LOCAL_PORT=${LOCAL_PORT:-3380}
+STEPS=${STEPS:-"0.31 0.42 0.53 0.64 0.75 0.56 0.47"}
+LOCAL_STEPS=${LOCAL_STEPS:-"0.22 0.33 0.44 0.55"}
+WORK=$(mktemp -d /tmp/e2e.XXXXXX)
+LINK=$WORK/usart3
+BACKEND=http://127.0.0.1:$PORT
+
+cleanup() {
+  kill $BRIDGE $NODE 2>/dev/null
+  [ -n "$SIM" ] && kill -INT $SIM 2>/dev/null && wait $SIM 2>/dev/null
+}
+trap cleanup EXIT INT TERM
+
+now_ms() { echo $(($(date +%s%N) / 1000000)); }
+
+# Wait up to $2 seconds for command $1 to succeed
+wait_for() {
+  i=0
+  while ! eval "$1" >/dev/null 2>&1; do
+    i=$((i + 1))
+    [ $i -gt $(($2 * 100)) ] && return 1
+    sleep 0.01
+  done
+}
+
+./fil_sim -p "$LINK" -t 0 -l "$WORK/uart.log" > "$WORK/sim.txt" 2>&1 &
+SIM=$!
+wait_for "test -e $LINK" 5 || { echo "fil_sim did not start"; cat "$WORK/sim.txt"; exit 1; }
+
+(cd ../backend && PORT=$PORT exec node server.js) > "$WORK/backend.log" 2>&1 &
+NODE=$!
+wait_for "curl -sf $BACKEND/api/health" 10 || { echo "backend did not start"; cat "$WORK/backend.log"; exit 1; }
+
+./esp32_bridge "$LINK" "$BACKEND" $LOCAL_PORT > "$WORK/bridge.log" 2>&1 &
+BRIDGE=$!
+echo "waiting for the bridge to initialise the STM32 (it waits 5 s for STM32_READY)"
+wait_for "grep -q 'Setup complete' $WORK/bridge.log" 20 || { echo "bridge setup failed"; cat "$WORK/bridge.log"; exit 1; }
+
+status=0
+# sweep <url> <label> <values>
+sweep() {
+  for v in $3; do
+    t0=$(now_ms)
+    curl -sf -X POST -H 'Content-Type: application/json' -d "{\"volume\":$v}" "$1/api/volume" > /dev/null
+    if wait_for "grep -q 'ACK:VOL=$v' $WORK/uart.log" 5; then
+      echo "VOL $v: $(($(now_ms) - t0)) ms from POST to STM32 ACK ($2)"
+    else
+      echo "VOL $v: no ACK within 5 s ($2)"
+      status=1
+    fi
+  done
+}
+sweep "$BACKEND" backend "$STEPS"
+sweep "http://127.0.0.1:$LOCAL_PORT" "bridge, no backend hop" "$LOCAL_STEPS"
+
+# Every stage on at 96 kHz: 422, and the backend keeps the chain it had
+# (GET /api/cost; the bridge may still be syncing the volume back)
+FULL='{"overdrive":{"enabled":true},"delay":{"enabled":true},"dsp":{"sample_rate":96000,
+"eq":{"enabled":true},"cabinet":{"enabled":true,"taps":256,"mode":"fft"},
+"modulation":{"mode":"flanger"},"reverb":{"enabled":true},
+"compressor":{"enabled":true,"lookahead":true},"looper":{"state":"overdub"},"tuner":{"enabled":true}}}'
+before=$(curl -sf "$BACKEND/api/cost")
+code=$(curl -s -o "$WORK/refused.json" -w '%{http_code}' -X POST -H 'Content-Type: application/json' \
+  -d "$FULL" "$BACKEND/api/effects")
+if [ "$code" = 422 ] && [ "$(curl -sf "$BACKEND/api/cost")" = "$before" ]; then
+  echo "full chain at 96 kHz: refused ($(sed 's/.*"message":"\([^"]*\)".*/\1/' "$WORK/refused.json"))"
+else
+  echo "full chain at 96 kHz: HTTP $code, expected a 422 with the state unchanged"
+  status=1
+fi
+
+cleanup
+SIM=
+trap - EXIT
+echo
+cat "$WORK/sim.txt"
+echo "logs in $WORK"
+exit $status
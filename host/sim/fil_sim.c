@@ -0,0 +1,610 @@
+/* fil_sim.c
+ * Firmware-in-the-loop simulator driver
+ *
+ * Usage: fil_sim [-s script | -p link] [-t seconds] [-x slowdown] [-f hz]
+ *                [-a amp] [-i in.raw] [-o out.raw] [-l uart.log] [-v]
+ *   Runs the firmware's main() and audio interrupt (sim.h) for -t seconds
+ *   of simulated time, feeding the ADC a sine (-f/-a, default 480 Hz at
+ *   0.2) or a 16-bit raw file, and USART3 the commands of the script.
+ *   -o writes the DAC output as 16-bit raw, -l the USART3 lines with
+ *   sample stamps ('>' received, '<' sent), -x runs slower than real time when the
+ *   host cannot keep up (see "late ticks" in the report).
+ *
+ * -p exposes USART3 as a pseudo-terminal instead of reading a script and
+ *   symlinks it at <link> (e.g. /tmp/stm32), so the bridge or a terminal
+ *   can talk to the simulated STM32 as to the real one at 115200 baud.
+ *   With -t 0 it runs until interrupted; the report then covers the
+ *   commands that came in over the PTY.
+ *
+ * Script lines: <time_ms> [x<count>[/<gap_ms>]] <command>
+ *   100 VOL:0.5          send at 100 ms
+ *   +20 OVR:ON           20 ms after the previous line's time
+ *   500 x50/0 VOL:0.40   50 copies back to back (a burst)
+ *   # comment
+ * Bytes go out at the USART3 baud rate; a command waits for the line.
+ *
+ * For every command the report gives, in samples from its last byte:
+ *   ack      the reply line (matched by "#<seq> " tag if the command had
+ *            one, else by keyword, e.g. VOL -> ACK:VOL=)
+ *   applied  the effect state (EffectParams_t) the interrupt runs with changed
+ *   audible  the output stopped repeating its steady-state period (sine
+ *            input only, and only if it was steady when the command arrived)
+ * Both are credited to the newest command on the line, within 0.5 s; a
+ * command that changes nothing (a repeated value) shows '-'. Commands that
+ * got no reply at all are counted as dropped.
+ */
+
+#include "main.h"
+#include "sim.h"
+#include "effects.h"
+#include "dsp_core.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define SIM_MAX_COMMANDS 16384
+#define SIM_CMD_LEN 256  // longer than the firmware line, to exercise its overlong NAK
+#define SIM_AUDIBLE_WINDOW_S 0.5
+#define SIM_AUDIBLE_CODES 3
+#define SIM_MAX_PERIOD 4096
+#define SIM_NONE UINT64_MAX
+
+typedef struct {
+  char text[SIM_CMD_LEN];
+  char keyword[16];
+  uint64_t due_tick;       // scheduled send time
+  uint64_t first_tick;     // first byte on the line
+  uint64_t sent_tick;      // last byte ('\n') on the line
+  uint64_t ack_tick;
+  uint64_t applied_tick;
+  uint64_t audible_tick;
+  uint8_t steady;          // output was periodic when the line ended
+} SimCommand_t;
+
+static SimCommand_t commands[SIM_MAX_COMMANDS];
+static uint32_t command_count = 0;
+
+// Interrupt-side cursors
+static uint32_t rx_cmd = 0;
+static uint32_t rx_pos = 0;
+static uint32_t ack_scan = 0;
+
+static double rate_hz = 48000.0;
+static float sine_hz = 480.0f;
+static float sine_amp = 0.2f;
+static int16_t *input_raw = NULL;
+static uint32_t input_len = 0;
+static FILE *out_file = NULL;
+static FILE *log_file = NULL;
+static int verbose = 0;
+
+// Output periodicity (audible change)
+static uint16_t out_hist[SIM_MAX_PERIOD];
+static uint32_t out_period = 0;
+static uint64_t out_count = 0;
+static uint64_t out_steady = 0;  // samples since the last period break
+static int32_t last_latest = -1;
+static uint16_t out_last = 2048;
+
+// Effect state fingerprint (applied change)
+static uint32_t state_hash = 0;
+
+// USART3 transmit stream parser
+static char tx_line[160];
+static uint32_t tx_line_len = 0;
+static uint32_t tx_frame_skip = 0;
+static uint8_t tx_prev = 0;
+static uint32_t tx_lines = 0;
+static uint32_t tx_frames = 0;
+
+// Pseudo-terminal standing in for the ESP32 link (-p)
+static int pty_fd = -1;
+static uint8_t pty_rx[256];
+static uint32_t pty_rx_len = 0;
+static uint32_t pty_rx_pos = 0;
+static uint8_t pty_tx[1024];
+static uint32_t pty_tx_len = 0;
+static SimCommand_t *pty_line = NULL;    // command being received
+static uint32_t pty_line_len = 0;
+static uint64_t pty_tx_dropped = 0;
+
+/* Length of a "#<seq> " reply tag at the start of a line, 0 if none */
+static size_t Tag_Length(const char *line)
+{
+  size_t n = 1;
+  if (line[0] != '#') return 0;
+  while (line[n] >= '0' && line[n] <= '9') n++;
+  return (n > 1 && line[n] == ' ') ? n + 1 : 0;
+}
+
+static void Keyword(const char *cmd, char *out, size_t size)
+{
+  size_t n = 0;
+  cmd += Tag_Length(cmd);
+  while (cmd[n] && cmd[n] != ':' && cmd[n] != '?' && cmd[n] != '=' && cmd[n] != ',' && n + 1 < size)
+  {
+    out[n] = cmd[n];
+    n++;
+  }
+  out[n] = '\0';
+}
+
+static void Load_Script(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  char line[256];
+  double last_ms = 0.0;
+
+  if (!f)
+  {
+    perror(path);
+    exit(2);
+  }
+  while (fgets(line, sizeof(line), f))
+  {
+    char *p = line;
+    char *end;
+    double ms;
+    unsigned count = 1;
+    double gap_ms = 0.0;
+
+    while (isspace((unsigned char)*p)) p++;
+    if (*p == '#' || *p == '\0') continue;
+    if (*p == '+') ms = last_ms + strtod(p + 1, &end);
+    else ms = strtod(p, &end);
+    p = end;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p == 'x' && isdigit((unsigned char)p[1]))
+    {
+      count = (unsigned)strtoul(p + 1, &end, 10);
+      p = end;
+      if (*p == '/') gap_ms = strtod(p + 1, &end), p = end;
+      while (isspace((unsigned char)*p)) p++;
+    }
+    p[strcspn(p, "\r\n")] = '\0';
+    last_ms = ms;
+
+    for (unsigned k = 0; k < count && command_count < SIM_MAX_COMMANDS; k++)
+    {
+      SimCommand_t *c = &commands[command_count++];
+      memset(c, 0, sizeof(*c));
+      snprintf(c->text, sizeof(c->text), "%s", p);
+      Keyword(c->text, c->keyword, sizeof(c->keyword));
+      c->due_tick = (uint64_t)((ms + k * gap_ms) * rate_hz / 1000.0);
+      c->first_tick = c->sent_tick = SIM_NONE;
+      c->ack_tick = c->applied_tick = c->audible_tick = SIM_NONE;
+    }
+  }
+  fclose(f);
+}
+
+static uint32_t Hash_State(void)
+{
+  EffectParams_t params;
+  const uint8_t *b = (const uint8_t*)&params;
+  uint32_t h = 2166136261U;
+
+  memset(&params, 0, sizeof(params));
+  Effects_Get_Params(&params);
+  for (size_t i = 0; i < sizeof(params); i++) h = (h ^ b[i]) * 16777619U;
+  return h;
+}
+
+/* Newest command already on the line at tick, or -1 */
+static int32_t Latest_Sent(uint64_t tick)
+{
+  for (int32_t i = (int32_t)rx_cmd; i >= 0; i--)
+  {
+    if (i < (int32_t)command_count && commands[i].sent_tick != SIM_NONE && commands[i].sent_tick <= tick)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Hooks (simulated interrupt) --------------------------------------------------*/
+float Sim_Input_Sample(uint64_t tick)
+{
+  double phase;
+
+  if (input_raw) return (tick < input_len) ? (float)input_raw[tick] / 32768.0f : 0.0f;
+  // Phase kept in [0, 1) so the tone stays exactly periodic for long runs
+  phase = fmod((double)tick * sine_hz / rate_hz, 1.0);
+  return sine_amp * (float)sin(2.0 * M_PI * phase);
+}
+
+/* Next byte written to the PTY; lines are recorded as commands for the report */
+static int Pty_Rx_Byte(uint64_t tick, uint8_t *byte)
+{
+  if (pty_rx_pos >= pty_rx_len)
+  {
+    ssize_t n = read(pty_fd, pty_rx, sizeof(pty_rx));
+    if (n <= 0) return 0;
+    pty_rx_len = (uint32_t)n;
+    pty_rx_pos = 0;
+  }
+  *byte = pty_rx[pty_rx_pos++];
+
+  if (*byte == '\n' || *byte == '\r')
+  {
+    if (pty_line)
+    {
+      pty_line->text[pty_line_len] = '\0';
+      Keyword(pty_line->text, pty_line->keyword, sizeof(pty_line->keyword));
+      pty_line->sent_tick = tick;
+      if (log_file) fprintf(log_file, "%10llu > %s\n", (unsigned long long)tick, pty_line->text);
+      rx_cmd = command_count;
+      pty_line = NULL;
+    }
+  }
+  else if (pty_line == NULL && command_count < SIM_MAX_COMMANDS)
+  {
+    pty_line = &commands[command_count++];
+    memset(pty_line, 0, sizeof(*pty_line));
+    pty_line->due_tick = pty_line->first_tick = tick;
+    pty_line->sent_tick = SIM_NONE;
+    pty_line->ack_tick = pty_line->applied_tick = pty_line->audible_tick = SIM_NONE;
+    pty_line->text[0] = (char)*byte;
+    pty_line_len = 1;
+  }
+  else if (pty_line && pty_line_len + 1 < sizeof(pty_line->text))
+  {
+    pty_line->text[pty_line_len++] = (char)*byte;
+  }
+  return 1;
+}
+
+int Sim_Rx_Byte(uint64_t tick, uint8_t *byte)
+{
+  SimCommand_t *c;
+  size_t len;
+
+  if (pty_fd >= 0) return Pty_Rx_Byte(tick, byte);
+  if (rx_cmd >= command_count) return 0;
+  c = &commands[rx_cmd];
+  if (tick < c->due_tick) return 0;
+
+  len = strlen(c->text);
+  if (rx_pos == 0) c->first_tick = tick;
+  if (rx_pos < len)
+  {
+    *byte = (uint8_t)c->text[rx_pos++];
+    return 1;
+  }
+  *byte = '\n';
+  c->sent_tick = tick;
+  if (log_file) fprintf(log_file, "%10llu > %s\n", (unsigned long long)tick, c->text);
+  rx_cmd++;
+  rx_pos = 0;
+  return 1;
+}
+
+static void Reply_Line(uint64_t tick, const char *line)
+{
+  char key[16];
+  size_t tag = Tag_Length(line);
+  const char *reply = line + tag;
+  const char *body = (strncmp(reply, "ACK:", 4) == 0) ? reply + 4 : reply;
+
+  tx_lines++;
+  Keyword(body, key, sizeof(key));
+  if (log_file) fprintf(log_file, "%10llu < %s\n", (unsigned long long)tick, line);
+
+  // Oldest sent command without a reply whose tag, or else keyword, matches
+  for (uint32_t i = ack_scan; i < rx_cmd; i++)
+  {
+    SimCommand_t *c = &commands[i];
+    if (c->ack_tick != SIM_NONE || c->sent_tick == SIM_NONE) continue;
+    if (tag ? strncmp(c->text, line, tag) == 0
+            : (strcmp(c->keyword, key) == 0 || strncmp(reply, "ACK:", 4) != 0))
+    {
+      c->ack_tick = tick;
+      break;
+    }
+  }
+  while (ack_scan < rx_cmd && commands[ack_scan].ack_tick != SIM_NONE) ack_scan++;
+}
+
+void Sim_Tx_Byte(uint64_t tick, uint8_t byte)
+{
+  if (pty_fd >= 0)
+  {
+    if (pty_tx_len < sizeof(pty_tx)) pty_tx[pty_tx_len++] = byte;
+    else pty_tx_dropped++;
+  }
+
+  // Binary frames: A5 5A type len_lo len_hi payload xor
+  if (tx_frame_skip)
+  {
+    if (tx_frame_skip == 0xFFFFFFFFU - 1U) tx_frame_skip = 0xFFFFFFFFU - 2U;  // type
+    else if (tx_frame_skip == 0xFFFFFFFFU - 2U) tx_frame_skip = byte | 0xFFFF0000U;
+    else if ((tx_frame_skip & 0xFFFF0000U) == 0xFFFF0000U) tx_frame_skip = (tx_frame_skip & 0xFFU) + ((uint32_t)byte << 8) + 1U;
+    else tx_frame_skip--;
+    if (tx_frame_skip == 0) tx_frames++;
+    tx_prev = byte;
+    return;
+  }
+  if (tx_prev == 0xA5 && byte == 0x5A)
+  {
+    tx_frame_skip = 0xFFFFFFFFU - 1U;
+    if (tx_line_len) tx_line_len--;  // the 0xA5 was not text
+    tx_prev = byte;
+    return;
+  }
+  tx_prev = byte;
+
+  if (byte == '\n')
+  {
+    tx_line[tx_line_len] = '\0';
+    if (tx_line_len) Reply_Line(tick, tx_line);
+    tx_line_len = 0;
+  }
+  else if (tx_line_len + 1 < sizeof(tx_line))
+  {
+    tx_line[tx_line_len++] = (char)byte;
+  }
+}
+
+void Sim_Output_Sample(uint64_t tick, uint16_t code)
+{
+  out_last = code;
+  if (out_file)
+  {
+    int16_t s = (int16_t)(((int32_t)code - 2048) * 16);
+    fwrite(&s, sizeof(s), 1, out_file);
+  }
+}
+
+void Sim_Tick_End(uint64_t tick)
+{
+  uint32_t h = Hash_State();
+  int32_t latest = Latest_Sent(tick);
+
+  // Nobody reading the PTY is a disconnected wire: the bytes are lost
+  if (pty_tx_len)
+  {
+    ssize_t n = write(pty_fd, pty_tx, pty_tx_len);
+    if (n < (ssize_t)pty_tx_len) pty_tx_dropped += pty_tx_len - (n > 0 ? (uint32_t)n : 0U);
+    pty_tx_len = 0;
+  }
+
+  SimCommand_t *c = (latest >= 0) ? &commands[latest] : NULL;
+  uint64_t window = (uint64_t)(SIM_AUDIBLE_WINDOW_S * rate_hz);
+
+  if (latest != last_latest)
+  {
+    last_latest = latest;
+    if (c) c->steady = (out_period && out_steady >= 2U * out_period);
+  }
+
+  // Applied: the effect state changed since the previous tick
+  if (h != state_hash)
+  {
+    state_hash = h;
+    if (c && c->applied_tick == SIM_NONE && tick - c->sent_tick < window) c->applied_tick = tick;
+  }
+
+  // Audible: output breaks from its own period (sine input)
+  if (out_period)
+  {
+    uint16_t then = out_hist[out_count % out_period];
+    int32_t diff = (int32_t)out_last - (int32_t)then;
+
+    if (out_count >= out_period && (diff > SIM_AUDIBLE_CODES || diff < -SIM_AUDIBLE_CODES))
+    {
+      if (c && c->steady && c->audible_tick == SIM_NONE && tick - c->sent_tick < window) c->audible_tick = tick;
+      out_steady = 0;
+    }
+    else
+    {
+      out_steady++;
+    }
+    out_hist[out_count % out_period] = out_last;
+    out_count++;
+  }
+}
+
+/* Master side of a raw PTY, slave path symlinked at link */
+static int Open_Pty(const char *link)
+{
+  struct termios tio;
+  const char *slave;
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  int slave_fd;
+
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0 || (slave = ptsname(fd)) == NULL)
+  {
+    perror("posix_openpt");
+    exit(2);
+  }
+  // Holding the slave open keeps the master readable while clients come and go
+  slave_fd = open(slave, O_RDWR | O_NOCTTY);
+  if (slave_fd < 0 || tcgetattr(slave_fd, &tio) != 0)
+  {
+    perror(slave);
+    exit(2);
+  }
+  cfmakeraw(&tio);
+  cfsetspeed(&tio, B115200);
+  tcsetattr(slave_fd, TCSANOW, &tio);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  unlink(link);
+  if (symlink(slave, link) != 0)
+  {
+    perror(link);
+    exit(2);
+  }
+  printf("USART3 on %s (%s), 115200 8N1\n", link, slave);
+  fflush(stdout);
+  return fd;
+}
+
+/* Report ---------------------------------------------------------------------*/
+static void Print_Latency(uint64_t from, uint64_t to)
+{
+  if (from == SIM_NONE || to == SIM_NONE) printf(" %9s", "-");
+  else printf(" %9lld", (long long)(to - from));
+}
+
+static int Compare_U64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static void Summary(const char *name, uint64_t *values, uint32_t n)
+{
+  if (n == 0)
+  {
+    printf("  %-8s no samples\n", name);
+    return;
+  }
+  qsort(values, n, sizeof(values[0]), Compare_U64);
+  printf("  %-8s median %llu, 95%% %llu, max %llu samples (max %.2f ms)\n", name,
+         (unsigned long long)values[n / 2], (unsigned long long)values[(n * 95) / 100],
+         (unsigned long long)values[n - 1], (double)values[n - 1] * 1000.0 / rate_hz);
+}
+
+int main(int argc, char **argv)
+{
+  const char *script = NULL;
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  const char *log_path = NULL;
+  const char *pty_link = NULL;
+  sigset_t stop_set;
+  double seconds = 2.0;
+  SimConfig_t config = { 1.0, 0, 1.0 };
+  static uint64_t ack_lat[SIM_MAX_COMMANDS], app_lat[SIM_MAX_COMMANDS], aud_lat[SIM_MAX_COMMANDS];
+  uint32_t n_ack = 0, n_app = 0, n_aud = 0, dropped = 0, unsent = 0;
+
+  for (int a = 1; a < argc; a++)
+  {
+    if (strcmp(argv[a], "-v") == 0) verbose = 1;
+    else if (a + 1 >= argc) break;
+    else if (strcmp(argv[a], "-s") == 0) script = argv[++a];
+    else if (strcmp(argv[a], "-p") == 0) pty_link = argv[++a];
+    else if (strcmp(argv[a], "-t") == 0) seconds = atof(argv[++a]);
+    else if (strcmp(argv[a], "-x") == 0) config.slowdown = atof(argv[++a]);
+    else if (strcmp(argv[a], "-f") == 0) sine_hz = (float)atof(argv[++a]);
+    else if (strcmp(argv[a], "-a") == 0) sine_amp = (float)atof(argv[++a]);
+    else if (strcmp(argv[a], "-i") == 0) in_path = argv[++a];
+    else if (strcmp(argv[a], "-o") == 0) out_path = argv[++a];
+    else if (strcmp(argv[a], "-l") == 0) log_path = argv[++a];
+    else
+    {
+      fprintf(stderr, "usage: %s [-s script | -p link] [-t seconds] [-x slowdown] [-f hz] "
+              "[-a amp] [-i in.raw] [-o out.raw] [-l uart.log] [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (pty_link) pty_fd = Open_Pty(pty_link);
+  else if (script) Load_Script(script);
+  if (in_path)
+  {
+    FILE *f = fopen(in_path, "rb");
+    if (!f)
+    {
+      perror(in_path);
+      return 2;
+    }
+    fseek(f, 0, SEEK_END);
+    input_len = (uint32_t)(ftell(f) / 2);
+    fseek(f, 0, SEEK_SET);
+    input_raw = malloc(input_len * sizeof(int16_t) + 2);
+    input_len = (uint32_t)fread(input_raw, sizeof(int16_t), input_len, f);
+    fclose(f);
+  }
+  else
+  {
+    // Steady state repeats every whole number of samples only for some tones
+    double period = rate_hz / sine_hz;
+    if (fabs(period - floor(period + 0.5)) < 1e-6 && period < SIM_MAX_PERIOD) out_period = (uint32_t)(period + 0.5);
+  }
+  if (out_path && !(out_file = fopen(out_path, "wb"))) perror(out_path);
+  if (log_path && !(log_file = fopen(log_path, "w"))) perror(log_path);
+  if (log_file) setvbuf(log_file, NULL, _IOLBF, 0);  // followed live in -p runs
+
+  // Ctrl-C ends an open-ended run; the firmware thread inherits the mask
+  sigemptyset(&stop_set);
+  sigaddset(&stop_set, SIGINT);
+  sigaddset(&stop_set, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop_set, NULL);
+
+  config.end_tick = (seconds > 0.0) ? (uint64_t)(seconds * rate_hz) : UINT64_MAX;
+  Sim_Start(&config);
+  if (seconds > 0.0)
+  {
+    Sim_Wait_Done(seconds * config.slowdown * 4.0 + 5.0);
+  }
+  else
+  {
+    int sig;
+    sigwait(&stop_set, &sig);
+    Sim_Stop();
+  }
+  if (pty_link) unlink(pty_link);
+
+  if (verbose || command_count <= 64)
+  {
+    printf("%8s %-28s %9s %9s %9s %9s\n", "t_ms", "command", "line", "ack", "applied", "audible");
+  }
+  for (uint32_t i = 0; i < command_count; i++)
+  {
+    SimCommand_t *c = &commands[i];
+
+    if (c->sent_tick == SIM_NONE)
+    {
+      unsent++;
+      continue;
+    }
+    if (c->ack_tick == SIM_NONE) dropped++;
+    else ack_lat[n_ack++] = c->ack_tick - c->sent_tick;
+    if (c->applied_tick != SIM_NONE) app_lat[n_app++] = c->applied_tick - c->sent_tick;
+    if (c->audible_tick != SIM_NONE) aud_lat[n_aud++] = c->audible_tick - c->sent_tick;
+
+    if (verbose || command_count <= 64)
+    {
+      printf("%8.1f %-28.28s", (double)c->due_tick * 1000.0 / rate_hz, c->text);
+      Print_Latency(c->first_tick, c->sent_tick);
+      Print_Latency(c->sent_tick, c->ack_tick);
+      Print_Latency(c->sent_tick, c->applied_tick);
+      Print_Latency(c->sent_tick, c->audible_tick);
+      printf("%s\n", (c->ack_tick == SIM_NONE) ? "  DROPPED" : "");
+    }
+  }
+
+  printf("\nsimulated %.3f s (%llu samples at %.1f Hz), host late ticks %llu\n",
+         (double)sim_stats.ticks / rate_hz, (unsigned long long)sim_stats.ticks, Sim_Sample_Rate(),
+         (unsigned long long)sim_stats.late_ticks);
+  printf("commands %u: replied %u, dropped %u, not sent by the end %u\n",
+         command_count, n_ack, dropped, unsent);
+  Summary("ack", ack_lat, n_ack);
+  Summary("applied", app_lat, n_app);
+  Summary("audible", aud_lat, n_aud);
+  printf("main loop in HAL_Delay %llu ms, LED toggles %u, block overruns %lu\n",
+         (unsigned long long)sim_stats.delay_ms, sim_stats.led_toggles,
+         (unsigned long)audio_block_overruns);
+  printf("USART3 rx %llu bytes (%llu overrun), tx %llu bytes: %u lines, %u frames\n",
+         (unsigned long long)sim_stats.rx_bytes, (unsigned long long)sim_stats.rx_overruns,
+         (unsigned long long)sim_stats.tx_bytes, tx_lines, tx_frames);
+  if (pty_fd >= 0 && pty_tx_dropped)
+  {
+    printf("PTY: %llu tx bytes lost with no reader\n", (unsigned long long)pty_tx_dropped);
+  }
+
+  if (out_file) fclose(out_file);
+  if (log_file) fclose(log_file);
+  return dropped ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+/* stm32g4xx_hal.h (firmware-in-the-loop simulator)
+ * Fake HAL: the handle types, constants and calls the firmware uses,
+ * backed by sim/fake_hal.c. Register blocks are plain structs; DWT reads
+ * the simulated cycle counter on every access.
+ */
+#ifndef STM32G4XX_HAL_H
+#define STM32G4XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "host_fpu.h"
+
+#define __IO volatile
+
+typedef enum {
+  HAL_OK = 0x00U,
+  HAL_ERROR = 0x01U,
+  HAL_BUSY = 0x02U,
+  HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum { RESET = 0U, SET = !RESET } FlagStatus;
+typedef enum { DISABLE = 0U, ENABLE = !DISABLE } FunctionalState;
+
+/* Interrupts: PRIMASK blocks the simulated interrupt signal */
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+void __enable_irq(void);
+static inline void __DMB(void) { __sync_synchronize(); }
+
+/* FPSCR.FZ is the host FPU's; the interrupt starts from FPU->FPDSCR */
+#define __FPU_PRESENT 1U
+static inline uint32_t __get_FPSCR(void) { return Host_Get_FZ(); }
+static inline void __set_FPSCR(uint32_t fpscr) { Host_Set_FZ(fpscr); }
+
+extern uint32_t SystemCoreClock;
+
+/* Register blocks ----------------------------------------------------------*/
+typedef struct { __IO uint32_t CTRL; __IO uint32_t CYCCNT; } DWT_Type;
+typedef struct { __IO uint32_t DEMCR; } CoreDebug_Type;
+typedef struct { __IO uint32_t FPCCR; __IO uint32_t FPCAR; __IO uint32_t FPDSCR; } FPU_Type;
+typedef struct { __IO uint32_t CR; __IO uint32_t CFGR; __IO uint32_t PLLCFGR; } RCC_TypeDef;
+typedef struct { __IO uint32_t DR; __IO uint32_t CR; __IO uint32_t INIT; __IO uint32_t POL; } CRC_TypeDef;
+typedef struct { __IO uint32_t DHR12R1; __IO uint32_t DHR12R2; __IO uint32_t DHR12RD; } DAC_TypeDef;
+typedef struct { __IO uint32_t CR1; __IO uint32_t DIER; __IO uint32_t CNT; __IO uint32_t ARR; } TIM_TypeDef;
+typedef struct { uint32_t id; } ADC_TypeDef;
+typedef struct { uint32_t id; } OPAMP_TypeDef;
+typedef struct { uint32_t id; } USART_TypeDef;
+typedef struct { __IO uint32_t ODR; } GPIO_TypeDef;
+typedef struct { __IO uint32_t CNDTR; } DMA_Channel_TypeDef;
+
+DWT_Type *sim_dwt(void);
+extern CoreDebug_Type sim_coredebug;
+extern FPU_Type sim_fpu;
+extern RCC_TypeDef sim_rcc;
+extern CRC_TypeDef sim_crc;
+extern DAC_TypeDef sim_dac1;
+extern TIM_TypeDef sim_tim1;
+extern ADC_TypeDef sim_adc1;
+extern OPAMP_TypeDef sim_opamp1;
+extern USART_TypeDef sim_usart2, sim_usart3;
+extern GPIO_TypeDef sim_gpioa;
+extern DMA_Channel_TypeDef sim_dma1_channel1;
+
+#ifdef SIM_DWT_FROZEN
+/* cost_bench: a counter read is one load, as on the target, not a clock read */
+extern DWT_Type sim_dwt_frozen;
+#define DWT (&sim_dwt_frozen)
+#else
+#define DWT (sim_dwt())
+#endif
+#define CoreDebug (&sim_coredebug)
+#define FPU (&sim_fpu)
+#define RCC (&sim_rcc)
+#define CRC (&sim_crc)
+#define DAC1 (&sim_dac1)
+#define TIM1 (&sim_tim1)
+#define ADC1 (&sim_adc1)
+#define OPAMP1 (&sim_opamp1)
+#define USART2 (&sim_usart2)
+#define USART3 (&sim_usart3)
+#define GPIOA (&sim_gpioa)
+#define DMA1_Channel1 (&sim_dma1_channel1)
+
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define RCC_CFGR_PPRE2_2 (1UL << 13)
+#define CRC_CR_RESET (1UL)
+
+/* Simulated flash sits at its real address so uint32_t addresses work */
+#define FLASH_BASE 0x08000000UL
+#define FLASH_PAGE_SIZE 0x800U
+#define FLASH_SIZE 0x20000U
+#define FLASH_BANK_1 1U
+#define FLASH_TYPEERASE_PAGES 0U
+#define FLASH_TYPEPROGRAM_DOUBLEWORD 0U
+#define FLASH_FLAG_ALL_ERRORS 0U
+#define FLASH_LATENCY_4 4U
+#define __HAL_FLASH_CLEAR_FLAG(flag) ((void)(flag))
+
+typedef struct {
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Page;
+  uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+
+/* Core / clocks --------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+#define PWR_REGULATOR_VOLTAGE_SCALE1_BOOST 0U
+#define RCC_OSCILLATORTYPE_HSI 2U
+#define RCC_HSI_ON 1U
+#define RCC_HSICALIBRATION_DEFAULT 0x40U
+#define RCC_PLL_ON 2U
+#define RCC_PLLSOURCE_HSI 2U
+#define RCC_PLLM_DIV4 4U
+#define RCC_PLLP_DIV10 10U
+#define RCC_PLLQ_DIV2 2U
+#define RCC_PLLR_DIV2 2U
+#define RCC_CLOCKTYPE_SYSCLK 1U
+#define RCC_CLOCKTYPE_HCLK 2U
+#define RCC_CLOCKTYPE_PCLK1 4U
+#define RCC_CLOCKTYPE_PCLK2 8U
+#define RCC_SYSCLKSOURCE_PLLCLK 3U
+#define RCC_SYSCLK_DIV1 0U
+#define RCC_HCLK_DIV1 0U
+
+typedef struct {
+  uint32_t PLLState, PLLSource, PLLM, PLLN, PLLP, PLLQ, PLLR;
+} RCC_PLLInitTypeDef;
+
+typedef struct {
+  uint32_t OscillatorType;
+  uint32_t HSIState;
+  uint32_t HSICalibrationValue;
+  RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct {
+  uint32_t ClockType, SYSCLKSource, AHBCLKDivider, APB1CLKDivider, APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+HAL_StatusTypeDef HAL_PWREx_ControlVoltageScaling(uint32_t VoltageScaling);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOF_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_CRC_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMAMUX1_CLK_ENABLE() ((void)0)
+
+/* GPIO -----------------------------------------------------------------------*/
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_MODE_OUTPUT_PP 1U
+#define GPIO_MODE_ANALOG 3U
+#define GPIO_NOPULL 0U
+#define GPIO_SPEED_FREQ_LOW 0U
+
+typedef enum { GPIO_PIN_RESET = 0U, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct {
+  uint32_t Pin, Mode, Pull, Speed, Alternate;
+} GPIO_InitTypeDef;
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* DMA ------------------------------------------------------------------------*/
+typedef struct {
+  uint32_t Request, Direction, PeriphInc, MemInc, PeriphDataAlignment, MemDataAlignment, Mode, Priority;
+} DMA_InitTypeDef;
+
+typedef struct {
+  DMA_Channel_TypeDef *Instance;
+  DMA_InitTypeDef Init;
+} DMA_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                uint32_t DataLength);
+#define __HAL_DMA_GET_COUNTER(h) ((h)->Instance->CNDTR)
+
+/* ADC ------------------------------------------------------------------------*/
+#define ADC_CLOCK_SYNC_PCLK_DIV4 0U
+#define ADC_RESOLUTION_12B 0U
+#define ADC_DATAALIGN_RIGHT 0U
+#define ADC_SCAN_DISABLE 0U
+#define ADC_EOC_SINGLE_CONV 0U
+#define ADC_SOFTWARE_START 0U
+#define ADC_EXTERNALTRIGCONVEDGE_NONE 0U
+#define ADC_OVR_DATA_PRESERVED 0U
+#define ADC_MODE_INDEPENDENT 0U
+#define ADC_CHANNEL_1 1U
+#define ADC_REGULAR_RANK_1 1U
+#define ADC_SAMPLETIME_92CYCLES_5 0U
+#define ADC_DIFFERENTIAL_ENDED 1U
+#define ADC_OFFSET_NONE 0U
+
+typedef struct {
+  uint32_t ClockPrescaler, Resolution, DataAlign, GainCompensation, ScanConvMode, EOCSelection;
+  uint32_t LowPowerAutoWait, ContinuousConvMode, NbrOfConversion, DiscontinuousConvMode;
+  uint32_t ExternalTrigConv, ExternalTrigConvEdge, DMAContinuousRequests, Overrun, OversamplingMode;
+} ADC_InitTypeDef;
+
+typedef struct {
+  ADC_TypeDef *Instance;
+  ADC_InitTypeDef Init;
+} ADC_HandleTypeDef;
+
+typedef struct { uint32_t Mode; } ADC_MultiModeTypeDef;
+
+typedef struct {
+  uint32_t Channel, Rank, SamplingTime, SingleDiff, OffsetNumber, Offset;
+} ADC_ChannelConfTypeDef;
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADCEx_MultiModeConfigChannel(ADC_HandleTypeDef *hadc, ADC_MultiModeTypeDef *multimode);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig);
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+
+/* DAC ------------------------------------------------------------------------*/
+#define DAC_CHANNEL_1 0x00U
+#define DAC_CHANNEL_2 0x10U
+#define DAC_ALIGN_12B_R 0x00U
+#define DAC_HIGH_FREQUENCY_INTERFACE_MODE_AUTOMATIC 0U
+#define DAC_SAMPLEANDHOLD_DISABLE 0U
+#define DAC_TRIGGER_NONE 0U
+#define DAC_OUTPUTBUFFER_ENABLE 0U
+#define DAC_CHIPCONNECT_EXTERNAL 0U
+#define DAC_TRIMMING_FACTORY 0U
+
+typedef struct {
+  DAC_TypeDef *Instance;
+} DAC_HandleTypeDef;
+
+typedef struct {
+  uint32_t DAC_HighFrequency, DAC_DMADoubleDataMode, DAC_SignedFormat, DAC_SampleAndHold;
+  uint32_t DAC_Trigger, DAC_Trigger2, DAC_OutputBuffer, DAC_ConnectOnChipPeripheral, DAC_UserTrimming;
+} DAC_ChannelConfTypeDef;
+
+HAL_StatusTypeDef HAL_DAC_Init(DAC_HandleTypeDef *hdac);
+HAL_StatusTypeDef HAL_DAC_ConfigChannel(DAC_HandleTypeDef *hdac, DAC_ChannelConfTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_DAC_Start(DAC_HandleTypeDef *hdac, uint32_t Channel);
+HAL_StatusTypeDef HAL_DAC_SetValue(DAC_HandleTypeDef *hdac, uint32_t Channel, uint32_t Alignment, uint32_t Data);
+
+/* OPAMP ----------------------------------------------------------------------*/
+#define OPAMP_POWERMODE_NORMALSPEED 0U
+#define OPAMP_PGA_MODE 0U
+#define OPAMP_NONINVERTINGINPUT_IO2 0U
+#define OPAMP_TIMERCONTROLLEDMUXMODE_DISABLE 0U
+#define OPAMP_PGA_CONNECT_INVERTINGINPUT_NO 0U
+#define OPAMP_PGA_GAIN_32_OR_MINUS_31 0U
+#define OPAMP_TRIMMING_FACTORY 0U
+
+typedef struct {
+  uint32_t PowerMode, Mode, NonInvertingInput, InternalOutput, TimerControlledMuxmode;
+  uint32_t PgaConnect, PgaGain, UserTrimming;
+} OPAMP_InitTypeDef;
+
+typedef struct {
+  OPAMP_TypeDef *Instance;
+  OPAMP_InitTypeDef Init;
+} OPAMP_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_OPAMP_Init(OPAMP_HandleTypeDef *hopamp);
+HAL_StatusTypeDef HAL_OPAMP_Start(OPAMP_HandleTypeDef *hopamp);
+
+/* TIM ------------------------------------------------------------------------*/
+#define TIM_COUNTERMODE_UP 0U
+#define TIM_CLOCKDIVISION_DIV1 0U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE 0U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE 1U
+#define TIM_CLOCKSOURCE_INTERNAL 0U
+#define TIM_TRGO_RESET 0U
+#define TIM_TRGO2_RESET 0U
+#define TIM_MASTERSLAVEMODE_DISABLE 0U
+#define TIM_DMA_UPDATE (1UL << 8)
+#define TIM_DMA_ID_UPDATE 1U
+
+typedef struct {
+  uint32_t Prescaler, CounterMode, Period, ClockDivision, RepetitionCounter, AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+  TIM_TypeDef *Instance;
+  TIM_Base_InitTypeDef Init;
+  DMA_HandleTypeDef *hdma[7];
+} TIM_HandleTypeDef;
+
+typedef struct { uint32_t ClockSource; } TIM_ClockConfigTypeDef;
+typedef struct { uint32_t MasterOutputTrigger, MasterOutputTrigger2, MasterSlaveMode; } TIM_MasterConfigTypeDef;
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, TIM_ClockConfigTypeDef *sClockSourceConfig);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+#define __HAL_TIM_SET_AUTORELOAD(h, v) do { (h)->Instance->ARR = (v); (h)->Init.Period = (v); } while (0)
+#define __HAL_TIM_SET_COUNTER(h, v) ((h)->Instance->CNT = (v))
+#define __HAL_TIM_ENABLE_DMA(h, d) ((h)->Instance->DIER |= (d))
+
+/* UART -----------------------------------------------------------------------*/
+#define UART_WORDLENGTH_8B 0U
+#define UART_STOPBITS_1 0U
+#define UART_PARITY_NONE 0U
+#define UART_MODE_TX_RX 0xCU
+#define UART_HWCONTROL_NONE 0U
+#define UART_OVERSAMPLING_16 0U
+#define UART_ONE_BIT_SAMPLE_DISABLE 0U
+#define UART_PRESCALER_DIV1 0U
+#define UART_ADVFEATURE_NO_INIT 0U
+#define UART_TXFIFO_THRESHOLD_1_8 0U
+#define UART_RXFIFO_THRESHOLD_1_8 0U
+
+typedef struct {
+  uint32_t BaudRate, WordLength, StopBits, Parity, Mode, HwFlowCtl, OverSampling;
+  uint32_t OneBitSampling, ClockPrescaler;
+} UART_InitTypeDef;
+
+typedef struct { uint32_t AdvFeatureInit; } UART_AdvFeatureInitTypeDef;
+
+typedef struct {
+  USART_TypeDef *Instance;
+  UART_InitTypeDef Init;
+  UART_AdvFeatureInitTypeDef AdvancedInit;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_SetTxFifoThreshold(UART_HandleTypeDef *huart, uint32_t Threshold);
+HAL_StatusTypeDef HAL_UARTEx_SetRxFifoThreshold(UART_HandleTypeDef *huart, uint32_t Threshold);
+HAL_StatusTypeDef HAL_UARTEx_DisableFifoMode(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+#endif // STM32G4XX_HAL_H
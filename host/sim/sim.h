@@ -0,0 +1,54 @@
+/* sim.h
+ * Firmware-in-the-loop simulator: the interrupt engine in fake_hal.c and
+ * the hooks the driver (fil_sim.c) provides
+ *
+ * The firmware's main() runs unchanged in its own thread. A POSIX timer
+ * delivers a signal to that thread once per sample period; the handler is
+ * the simulated interrupt: it moves USART3 bytes at the configured baud
+ * rate (RX complete / TX complete callbacks, as the UART interrupt would,
+ * which preempts TIM1 on the target) and then runs the TIM1 callback. The
+ * main loop is therefore interrupted at arbitrary points, exactly as on
+ * the target, and __disable_irq() really blocks the signal.
+ *
+ * Simulated time advances one sample period per handled tick, so all
+ * latencies are in samples of simulated time whatever the host speed.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+typedef struct {
+  double slowdown;          // host seconds per simulated second
+  uint64_t end_tick;        // stop after this many ticks
+  double cycle_scale;       // DWT cycles per host cycle at 170 MHz
+} SimConfig_t;
+
+typedef struct {
+  uint64_t ticks;           // handled timer signals = simulated samples
+  uint64_t late_ticks;      // timer overruns: the host fell behind
+  uint64_t rx_bytes;
+  uint64_t rx_overruns;     // bytes that arrived with reception not armed
+  uint64_t tx_bytes;
+  uint64_t delay_ms;        // simulated time spent in HAL_Delay
+  uint32_t led_toggles;
+} SimStats_t;
+
+extern SimStats_t sim_stats;
+
+void Sim_Start(const SimConfig_t *config);
+void Sim_Wait_Done(double timeout_s);
+void Sim_Stop(void);
+double Sim_Sample_Rate(void);
+
+/* Driver hooks, all called from the simulated interrupt */
+float Sim_Input_Sample(uint64_t tick);
+int Sim_Rx_Byte(uint64_t tick, uint8_t *byte);
+void Sim_Tx_Byte(uint64_t tick, uint8_t byte);
+void Sim_Output_Sample(uint64_t tick, uint16_t code);
+void Sim_Tick_End(uint64_t tick);
+
+/* The firmware's main(), renamed at compile time */
+int firmware_main(void);
+
+#endif // SIM_H